@@ -0,0 +1,152 @@
+import ctypes
+import ctypes.util
+import os
+import shutil
+import tempfile
+import threading
+
+import numpy
+
+_library = None
+
+def _load_library():
+  """Find and open the shared libavatar, looking first at $AVATAR_LIBRARY, then
+  next to this package's install prefix, then on the system library path."""
+  global _library
+  if _library is not None:
+    return _library
+
+  candidates = []
+  if "AVATAR_LIBRARY" in os.environ:
+    candidates.append(os.environ["AVATAR_LIBRARY"])
+  prefix = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+  candidates += [os.path.join(prefix, "lib", name) for name in ["libavatar.so", "libavatar.dylib"]]
+  found = ctypes.util.find_library("avatar")
+  if found is not None:
+    candidates.append(found)
+
+  for candidate in candidates:
+    try:
+      library = ctypes.CDLL(candidate)
+      break
+    except OSError:
+      pass
+  else:
+    raise OSError("Could not find the shared avatar library; set AVATAR_LIBRARY to the path of libavatar.so.")
+
+  # ctypes.CDLL drops the GIL for the duration of every call below
+  library.avatar_load.restype = ctypes.c_void_p
+  library.avatar_load.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_char_p, ctypes.c_int]
+  library.avatar_train.restype = ctypes.c_void_p
+  library.avatar_train.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_char_p), ctypes.c_char_p, ctypes.c_int, ctypes.c_char_p, ctypes.c_int]
+  library.avatar_predict_rows.restype = ctypes.c_int
+  library.avatar_predict_rows.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p]
+  library.avatar_cleanup.restype = None
+  library.avatar_cleanup.argtypes = [ctypes.c_void_p]
+  library.avatar_num_classes.restype = ctypes.c_int
+  library.avatar_num_classes.argtypes = [ctypes.c_void_p]
+  library.avatar_num_attributes.restype = ctypes.c_int
+  library.avatar_num_attributes.argtypes = [ctypes.c_void_p]
+  library.avatar_class_name.restype = ctypes.c_char_p
+  library.avatar_class_name.argtypes = [ctypes.c_void_p, ctypes.c_int]
+
+  _library = library
+  return _library
+
+def _bytes(value):
+  if isinstance(value, bytes):
+    return value
+  return value.encode("utf-8")
+
+class ensemble(object):
+  """An ensemble held in memory by libavatar.
+
+  Use load() or train() to create one.  predict() scores a NumPy array of rows
+  directly against the trees without writing any files.
+  """
+  def __init__(self, handle):
+    self._library = _load_library()
+    self._handle = handle
+    self._lock = threading.Lock()
+    self.num_classes = self._library.avatar_num_classes(handle)
+    self.num_attributes = self._library.avatar_num_attributes(handle)
+    self.class_names = numpy.array([self._library.avatar_class_name(handle, index).decode("utf-8") for index in range(self.num_classes)])
+
+  def __del__(self):
+    self.close()
+
+  def close(self):
+    """Release the ensemble's memory.  The ensemble can't be used afterwards."""
+    if getattr(self, "_handle", None):
+      self._library.avatar_cleanup(self._handle)
+      self._handle = None
+
+  def predict(self, rows):
+    """Score rows, returning a 2-tuple of predicted class numbers and class probabilities.
+
+    rows must be a 2D array with one column per attribute in names-file order
+    with the class column removed.  Discrete attributes hold the zero-based index
+    of their value in the names file and NaN marks a missing value.  A C-contiguous
+    float32 array is used in place; anything else is converted first.  Returns an
+    int32 array of length len(rows) that indexes class_names, and a float32 array
+    of shape (len(rows), num_classes).
+    """
+    if self._handle is None:
+      raise Exception("The ensemble has been closed.")
+    rows = numpy.ascontiguousarray(rows, dtype="float32")
+    if rows.ndim == 1:
+      rows = rows.reshape((1, -1))
+    if rows.ndim != 2 or rows.shape[1] != self.num_attributes:
+      raise ValueError("Expected rows with %s columns, got shape %s." % (self.num_attributes, rows.shape))
+
+    predictions = numpy.empty(rows.shape[0], dtype="int32")
+    probabilities = numpy.empty((rows.shape[0], self.num_classes), dtype="float32")
+    # A handle reuses its scratch space, so one call at a time per ensemble
+    with self._lock:
+      self._library.avatar_predict_rows(self._handle, rows.ctypes.data, rows.shape[0], rows.shape[1], predictions.ctypes.data, probabilities.ctypes.data)
+    return predictions, probabilities
+
+def load(filestem):
+  """Load the ensemble in filestem.trees using the attributes in filestem.names."""
+  library = _load_library()
+  if not os.path.exists(filestem + ".names") or not os.path.exists(filestem + ".trees"):
+    raise IOError("Missing %s.names or %s.trees." % (filestem, filestem))
+  handle = library.avatar_load(_bytes(filestem), None, 0, None, 0)
+  if not handle:
+    raise IOError("Could not load the ensemble in %s.trees." % filestem)
+  return ensemble(handle)
+
+def train(train, truth=None, exclude=[], discrete_threshold=10, seed=None, options=["--bagging", "--use-stopping-algorithm"]):
+  """Train an ensemble in-process from a collection of Avatar .data columns.
+
+  The columns and the truth, exclude and discrete_threshold arguments are the
+  same as for avatar.ensemble.build().  options holds additional avatardt
+  command line options.  The names and data are handed to libavatar as strings;
+  the trees are written to a temporary directory and read back into memory.
+  """
+  import avatar.data
+  import avatar.names
+  try:
+    from StringIO import StringIO
+  except ImportError:
+    from io import StringIO
+
+  library = _load_library()
+
+  names = StringIO()
+  avatar.names.guess(train, names, truth=truth, exclude=exclude, discrete_threshold=discrete_threshold)
+  data = StringIO()
+  avatar.data.dump(train, data)
+
+  workdir = tempfile.mkdtemp()
+  try:
+    arguments = ["avatardt", "-o", "avatar", "-f", os.path.join(workdir, "ensemble"), "--train"] + list(options)
+    if seed is not None:
+      arguments += ["--seed", str(seed)]
+    argv = (ctypes.c_char_p * (len(arguments) + 1))(*([_bytes(argument) for argument in arguments] + [None]))
+    handle = library.avatar_train(len(arguments), argv, _bytes(names.getvalue()), 1, _bytes(data.getvalue()), 1)
+  finally:
+    shutil.rmtree(workdir)
+  if not handle:
+    raise Exception("Training the ensemble failed.")
+  return ensemble(handle)
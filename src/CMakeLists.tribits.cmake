@@ -19,6 +19,14 @@ APPEND_SET(SOURCES
   attr_stats.c
   bagging.c
   balanced_learning.c
+  binary_trees.c
+  binary_data.c
+  test_stream.c
+  out_of_core.c
+  mapped_input.c
+  checkpoint.c
+  text_trees.c
+  lazy_trees.c
   boost.c
   crossval_util.c
   distinct_values.c
@@ -27,9 +35,11 @@ APPEND_SET(SOURCES
   heartbeat.c
   ivote.c
   knn.c
+  lockstep.c
   memory.c
   missing_values.c
   options.c
+  quickscorer.c
   read_line_from_string_or_file.c
   rw_data.c
   safe_memory.c
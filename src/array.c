@@ -133,44 +133,29 @@ void shuffle_sort_int_int(int size, int *array1, int *array2, int order) {
     
 }
 
-static int* origArr = NULL;
-static int* sortedArr = NULL;
-static int origLen = 0;
-
 //Linear search for key in the array of ints. Replaces grep_int().
 //Returns 0 if not found, or 1+index (in sorted order) if found.
+//The sorted position is the number of smaller values, so nothing is cached and
+//concurrent callers do not share any state.
 int find_int(int key, int n, int *arr)
 {
   int i;
-  //detect if the array changed, and if so, copy and sort it
-  if(arr != origArr || n != origLen)
-  {
-    origArr = arr;
-    origLen = n;
-    free(sortedArr);
-    sortedArr = malloc(n * sizeof(int));
-    memcpy(sortedArr, origArr, n * sizeof(int));
-    //int_array_sort uses 1-based indices
-    int_array_sort(n, sortedArr - 1);
-  }
-  int ind = 0;
+  int found = 0;
+  int num_smaller = 0;
   for(i = 0; i < n; i++)
   {
-    if(sortedArr[i] == key)
-    {
-      ind = i + 1;
-      break;
-    }
+    if(arr[i] == key)
+      found = 1;
+    else if(arr[i] < key)
+      num_smaller++;
   }
-  return ind;
+  return found ? num_smaller + 1 : 0;
 }
 
+//find_int no longer keeps a sorted copy, so there is nothing to release.
+//Kept so that existing callers do not need to change.
 void find_int_release()
 {
-  free(sortedArr);
-  sortedArr = NULL;
-  origArr = NULL;
-  origLen = 0;
 }
 
 int remove_dups_int(int num, int *array) {
@@ -406,6 +391,48 @@ void parse_delimited_string(char delimiter, char *str, int *num, char ***tokens)
     free(temp);
 }
 
+/*
+ * Split str on delimiter in place, for callers that parse line after line.
+ * Gives the same tokens as parse_delimited_string but nothing is copied: each delimiter
+ * (and any whitespace trailing a token) is overwritten with '\0' and (*tokens)[i] points
+ * into str at the start of token i. *tokens holds *num_malloced pointers and is only
+ * grown when a line has more tokens than any before it. Start with *tokens = NULL and
+ * *num_malloced = 0 and free(*tokens) when done; the tokens are not freed.
+ */
+void split_delimited_string(char delimiter, char *str, int *num, char ***tokens, int *num_malloced) {
+    char *start = str;
+    char *end;
+    char *last;
+    
+    *num = 0;
+    while (1) {
+        // strchr is vectorized in most C libraries so let it find the delimiter
+        end = strchr(start, delimiter);
+        if (end == NULL)
+            end = start + strlen(start);
+        
+        // Strip trailing whitespace then leading whitespace
+        last = end;
+        while (last > start && isspace(*(last-1)))
+            last--;
+        while (start < last && isspace(*start))
+            start++;
+        
+        if (*num == *num_malloced) {
+            *num_malloced = *num_malloced > 0 ? 2 * *num_malloced : 64;
+            *tokens = (char **)realloc(*tokens, *num_malloced * sizeof(char *));
+        }
+        (*tokens)[(*num)++] = start;
+        
+        if (*end == '\0') {
+            *last = '\0';
+            break;
+        }
+        *last = '\0';
+        start = end + 1;
+    }
+}
+
 // Strip leading/trailing whitespace
 void strip_lt_whitespace(char* s)
 {
@@ -59,6 +59,7 @@ void find_int_release();
 int remove_dups_int(int num, int *array);
 void parse_int_range(const char *str, int sort, int *num, int **range);
 void parse_delimited_string(char delimiter, char *str, int *num, char ***tokens);
+void split_delimited_string(char delimiter, char *str, int *num, char ***tokens, int *num_malloced);
 void _parse_comma_sep_string(char *str, int *num, char ***tokens);
 void parse_space_sep_string(char *str, int *num, char ***tokens);
 void parse_float_range(char *str, int sort, int *num, float **range);
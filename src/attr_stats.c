@@ -39,6 +39,7 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include <string.h>
 #include "crossval.h"
 #include "attr_stats.h"
+#include "lazy_trees.h"
 
 typedef struct attr_info {
   double mass;
@@ -97,7 +98,7 @@ compute_feature_imp(const DT_Ensemble *ensemble, Attr_Stats *stats)
   for (i = 0; i < ensemble->num_trees; ++i) {
     // ...compute feature importance stats from tree structure and training counts
     double root_path_mass = 0.0;
-    _tally_subtree_stats(ensemble->Trees[i], 
+    _tally_subtree_stats(ensemble_tree(*ensemble, i), 
 			 0, 
 			 ensemble->num_classes, 
 			 0, 
@@ -302,7 +303,7 @@ _write_ensemble(FILE *out, const DT_Ensemble *ensemble)
   int i;
   for (i = 0; i < ensemble->num_trees; ++i) {
     fprintf(out, "******************* TREE %d *******************\n", i+1);
-    _write_subtree(out, ensemble->Trees[i], 0, ensemble->num_classes, 0);
+    _write_subtree(out, ensemble_tree(*ensemble, i), 0, ensemble->num_classes, 0);
     fprintf(out, "\n");
   }
 }
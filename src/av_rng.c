@@ -34,6 +34,7 @@ For questions, comments or contributions contact
 Philip Kegelmeyer, wpk@sandia.gov 
 *******************************************************************************/
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include "av_rng.h"
 
@@ -118,6 +119,38 @@ int av_discrete_rand(struct AVDiscRandVar* var)
 }
 
 
+// initstate() and setstate() hand back the buffer of the state they replace, with the
+// generator's position saved in it, so swapping in a scratch state and straight back again
+// exposes the current state without moving it
+static char random_scratch[AV_RANDOM_STATE_SIZE];
+
+void av_get_random_state(char* state)
+{
+  char* current = initstate(1, random_scratch, AV_RANDOM_STATE_SIZE);
+  memcpy(state, current, AV_RANDOM_STATE_SIZE);
+  setstate(current);
+}
+
+void av_set_random_state(const char* state)
+{
+  char* current = initstate(1, random_scratch, AV_RANDOM_STATE_SIZE);
+  memcpy(current, state, AV_RANDOM_STATE_SIZE);
+  setstate(current);
+}
+
+// seed48() also returns the state it replaces
+void av_get_rand48_state(unsigned short* state)
+{
+  unsigned short scratch[3] = {0, 0, 0};
+  memcpy(state, seed48(scratch), 3 * sizeof(unsigned short));
+  seed48(state);
+}
+
+void av_set_rand48_state(unsigned short* state)
+{
+  seed48(state);
+}
+
 /**
  * TODO: add random discrete sample struct/functions
  * reset weights could be a no-op, compare pointers
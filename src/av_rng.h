@@ -143,4 +143,39 @@ unsigned long int av_pm_uniform_ul(struct ParkMiller* rng, unsigned long int n);
  * @return pseudorandom unsigned long int
  **/
 int av_pm_uniform_int(struct ParkMiller* rng, int n);
+
+/**
+ * Size of the state saved by av_get_random_state. This is the C library's
+ * default 128 byte state, which rand() shares with random() in glibc.
+ **/
+#define AV_RANDOM_STATE_SIZE 128
+
+/**
+ * Copy the state of the random()/rand() generator without disturbing it.
+ *
+ * @param  state buffer of AV_RANDOM_STATE_SIZE bytes to fill
+ **/
+void av_get_random_state(char* state);
+
+/**
+ * Put back a state saved by av_get_random_state.
+ *
+ * @param  state buffer of AV_RANDOM_STATE_SIZE bytes
+ **/
+void av_set_random_state(const char* state);
+
+/**
+ * Copy the 48-bit state of the drand48()/lrand48() generator without
+ * disturbing it.
+ *
+ * @param  state array of 3 to fill
+ **/
+void av_get_rand48_state(unsigned short* state);
+
+/**
+ * Put back a state saved by av_get_rand48_state.
+ *
+ * @param  state array of 3
+ **/
+void av_set_rand48_state(unsigned short* state);
 #endif // AV_RNG_H
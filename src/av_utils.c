@@ -235,6 +235,181 @@ int av_addBlobToSortedBlobArray(
     return 1;
 }
 
+/*************************************************************************/
+/* Appends a blob without keeping the array sorted. After the last append, 
+ * av_sortSortedBlobArray has to be called before the array is searched or
+ * added to with av_addBlobToSortedBlobArray. Building an array of N blobs 
+ * this way is O(N log N) instead of O(N^2) for adding them one at a time.
+ * Returns 1 if the blob was appended, or an error code.
+ */
+int av_appendBlobToSortedBlobArray(
+  AV_SortedBlobArray *sba, /**< input/output - sortedBlobArray */
+  void* blob               /**< input - blob to append */
+){
+  AV_ReturnCode rc;
+
+  // check args
+  if (!av_isSortedBlobArrayValid(sba) || !blob) {
+    av_printfErrorMessage("%s", av_getReturnCodeText(AV_INPUT_ERROR));
+    return AV_INPUT_ERROR;
+  }
+
+  // make sure there is room
+  if (sba->numBlob >= sba->maxNumBlob) {
+    rc = _av_expandBlobArray(&sba->maxNumBlob, &sba->blobs);
+    if (rc != AV_SUCCESS)
+      return rc;
+  }
+
+  sba->blobs[sba->numBlob++] = blob;
+  return 1;
+}
+
+/*************************************************************************/
+/* Stable merge sort of blobs[low, high) using scratch space of the same size
+ */
+static void _av_mergeSortBlobs(
+  void** blobs,  /**< input/output - the blobs */
+  void** temp,   /**< input - scratch space */
+  int low,       /**< input - first blob to sort */
+  int high,      /**< input - one past the last blob to sort */
+  int blobCmp(const void*, const void*) /**< input - the compare function */
+){
+  int mid, i, j, k;
+
+  if (high - low < 2)
+    return;
+  mid = low + (high - low)/2;
+  _av_mergeSortBlobs(blobs, temp, low, mid, blobCmp);
+  _av_mergeSortBlobs(blobs, temp, mid, high, blobCmp);
+
+  // already in order
+  if (blobCmp((const void*)blobs[mid-1], (const void*)blobs[mid]) <= 0)
+    return;
+
+  // ties go to the left half so the first appended blob stays first
+  i = low;
+  j = mid;
+  k = low;
+  while (i < mid && j < high)
+    temp[k++] = blobCmp((const void*)blobs[j], (const void*)blobs[i]) < 0 ?
+                blobs[j++] : blobs[i++];
+  while (i < mid)
+    temp[k++] = blobs[i++];
+  while (j < high)
+    temp[k++] = blobs[j++];
+  memcpy(blobs+low, temp+low, (high-low)*sizeof(void*));
+}
+
+/*************************************************************************/
+/* Sorts blobs appended by av_appendBlobToSortedBlobArray and drops all but
+ * the first appended of any blobs that compare equal, which leaves the same
+ * array that adding them one at a time with av_addBlobToSortedBlobArray 
+ * would have.
+ * Returns the number of blobs dropped, or an error code.
+ */
+int av_sortSortedBlobArray(
+  AV_SortedBlobArray *sba, /**< input/output - sortedBlobArray */
+  int blobCmp(const void*, const void*) /**< input - the blob comparison 
+					    function */
+){
+  int i, numKept;
+  void** temp;
+
+  // check args
+  if (!av_isSortedBlobArrayValid(sba) || !blobCmp) {
+    av_printfErrorMessage("%s", av_getReturnCodeText(AV_INPUT_ERROR));
+    return AV_INPUT_ERROR;
+  }
+  if (sba->numBlob < 2)
+    return 0;
+
+  // blobs that were appended in order, like the examples of a file, need
+  // no sorting
+  for (i = 1; i < sba->numBlob; i++)
+    if (blobCmp((const void*)sba->blobs[i-1], (const void*)sba->blobs[i]) > 0)
+      break;
+  if (i < sba->numBlob) {
+    temp = malloc(sba->numBlob*sizeof(void*));
+    if (!temp) {
+      av_printfErrorMessage("%s", av_getReturnCodeText(AV_MEMORY_ERROR));
+      return AV_MEMORY_ERROR;
+    }
+    _av_mergeSortBlobs(sba->blobs, temp, 0, sba->numBlob, blobCmp);
+    free(temp);
+  }
+
+  // drop duplicates
+  numKept = 1;
+  for (i = 1; i < sba->numBlob; i++)
+    if (blobCmp((const void*)sba->blobs[numKept-1], 
+		(const void*)sba->blobs[i]) != 0)
+      sba->blobs[numKept++] = sba->blobs[i];
+  i = sba->numBlob - numKept;
+  sba->numBlob = numKept;
+  return i;
+}
+
+/*************************************************************************/
+/* Adds every blob of other to sba in one pass. other must have been built
+ * with the same blobCmp by av_addBlobToSortedBlobArray or
+ * av_sortSortedBlobArray. Blobs of other that are already in sba are not
+ * added, as with av_addBlobToSortedBlobArray. other is left unchanged.
+ * Returns the number of blobs of other that were not added, or an error code.
+ */
+int av_mergeSortedBlobArrays(
+  AV_SortedBlobArray *sba,   /**< input/output - sortedBlobArray */
+  AV_SortedBlobArray *other, /**< input - sortedBlobArray to add */
+  int blobCmp(const void*, const void*) /**< input - the blob comparison 
+					    function */
+){
+  int i, j, k, cmpVal, numSkipped;
+  int newMax;
+  void** merged;
+
+  // check args
+  if (!av_isSortedBlobArrayValid(sba) || !av_isSortedBlobArrayValid(other) ||
+      sba == other || !blobCmp) {
+    av_printfErrorMessage("%s", av_getReturnCodeText(AV_INPUT_ERROR));
+    return AV_INPUT_ERROR;
+  }
+  if (other->numBlob == 0)
+    return 0;
+
+  // merge into a new array and keep the larger allocation
+  newMax = sba->maxNumBlob;
+  while (newMax < sba->numBlob + other->numBlob)
+    newMax = newMax > 0 ? 2*newMax : 1;
+  merged = malloc(newMax*sizeof(void*));
+  if (!merged) {
+    av_printfErrorMessage("%s", av_getReturnCodeText(AV_MEMORY_ERROR));
+    return AV_MEMORY_ERROR;
+  }
+  i = j = k = 0;
+  numSkipped = 0;
+  while (i < sba->numBlob && j < other->numBlob) {
+    cmpVal = blobCmp((const void*)sba->blobs[i], (const void*)other->blobs[j]);
+    if (cmpVal < 0) {
+      merged[k++] = sba->blobs[i++];
+    } else if (cmpVal > 0) {
+      merged[k++] = other->blobs[j++];
+    } else { // already there
+      j++;
+      numSkipped++;
+    }
+  }
+  while (i < sba->numBlob)
+    merged[k++] = sba->blobs[i++];
+  while (j < other->numBlob)
+    merged[k++] = other->blobs[j++];
+
+  free(sba->blobs);
+  sba->blobs = merged;
+  sba->numBlob = k;
+  sba->maxNumBlob = newMax;
+  return numSkipped;
+}
+
 /*************************************************************************/
 #define AV_VALUE_EQUIV(a,  b, EPS, MIN) \
 ( ( (a) == (b) ) ||                                                    \
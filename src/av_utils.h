@@ -106,6 +106,12 @@ int av_isSortedBlobArrayValid(AV_SortedBlobArray* sba);
 void av_freeSortedBlobArray(AV_SortedBlobArray *sba);
 int av_addBlobToSortedBlobArray(AV_SortedBlobArray *sba, void* blob,
 		   int blobCmp(const void* blob1, const void* blob2));
+// bulk construction: append any number of blobs, then sort once
+int av_appendBlobToSortedBlobArray(AV_SortedBlobArray *sba, void* blob);
+int av_sortSortedBlobArray(AV_SortedBlobArray *sba,
+		   int blobCmp(const void* blob1, const void* blob2));
+int av_mergeSortedBlobArrays(AV_SortedBlobArray *sba, AV_SortedBlobArray *other,
+		   int blobCmp(const void* blob1, const void* blob2));
 
 // floating point comparisons
 int av_eqf(double x, double y);
@@ -37,11 +37,13 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
 #include "crossval.h"
 #include "options.h"
 #include "rw_data.h"
 #include "util.h"
 #include "memory.h"
+#include "reset.h"
 #include "distinct_values.h"
 #include "tree.h"
 #include "array.h"
@@ -52,6 +54,7 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "version_info.h"
 #include "attr_stats.h"
 #include "evaluate.h"
+#include "quickscorer.h"
 #include "avatar_api.h"
 
 
@@ -66,6 +69,9 @@ struct Avatar_struct{
   CV_Class Class;
   Args_Opts Args;
   float * class_probs;
+  union data_type_union * row_votes; // One prediction matrix row reused by avatar_predict_rows
+  struct ParkMiller * tie_rng;       // Tie breaking is per handle so handles can be used from different threads
+  long tie_rng_seed;
 };
 
 Avatar_handle* create_Avatar_handle(){
@@ -165,10 +171,9 @@ Avatar_handle* avatar_load(char* filestem, char* names_file, int names_file_is_a
     //Create Avatar_handle object, then populate the handle with
     //the objects required to train and test avatar trees  
     Avatar_handle* a = create_Avatar_handle();
-    int argc = 1;
-    char* argv[] = {"./avatar_api.c"};
 
-    a->Args = process_opts(argc, argv);
+    // Fill in the defaults directly; process_opts() goes through getopt and a global Args_Opts
+    init_default_opts(&a->Args);
     a->Args.caller = AVATARDT_CALLER;
 
     int fslen = strlen(filestem);    
@@ -194,7 +199,11 @@ Avatar_handle* avatar_load(char* filestem, char* names_file, int names_file_is_a
     if (trees_file_is_a_string > 0){
       a->Args.trees_file_is_a_string = TRUE;
       a->Args.trees_string = av_strdup(trees_file);
-    } 
+    } else if (trees_file != NULL) {
+      // Otherwise a trees_file overrides filestem.trees. Binary ensembles must be loaded this way
+      free(a->Args.trees_file);
+      a->Args.trees_file = av_strdup(trees_file);
+    }
 
     av_exitIfError(av_initSortedBlobArray(&a->Train_Sorted_Examples));
 
@@ -205,6 +214,7 @@ Avatar_handle* avatar_load(char* filestem, char* names_file, int names_file_is_a
     read_names_file(&a->Train_Subset.meta, &a->Class, &a->Args, (a->Args.do_training == TRUE ? FALSE : TRUE));
     a->Test_Ensembles = calloc(1, sizeof(DT_Ensemble));
     read_ensemble(a->Test_Ensembles, -1, 0, &a->Args);
+    resolve_missing_values(a->Test_Ensembles, a->Train_Subset.meta, a->Args);
 
     // Make sure we allocate memory for testing
     free_CV_Class(a->Class); // Need to clean up class before it gets rewritten
@@ -221,18 +231,16 @@ Avatar_handle* avatar_train(int argc, char ** argv, char* names_file, int names_
     //the objects required to train and test avatar trees  
     Avatar_handle* a = calloc(1, sizeof(Avatar_handle));
 
-    #ifdef HAVE_AVATAR_FCLIB
     a->Test_Ensembles = calloc(1, sizeof(DT_Ensemble));
 
+    optind = 1; // getopt may already have been used by an earlier call
     a->Args = process_opts(argc, argv);
     a->Args.caller = AVATARDT_CALLER;
-    char * filestem;
-    filestem = av_strdup(a->Args.base_filestem);
-    a->Args.names_file = strcat(filestem, ".names");
-    filestem = av_strdup(a->Args.base_filestem);
-    a->Args.trees_file = strcat(filestem, ".trees");
-
     a->Args.do_training = TRUE;
+    if (! sanity_check(&a->Args))
+        exit(-1);
+    set_output_filenames(&a->Args, FALSE, FALSE);
+    srand48(a->Args.random_seed);
 
     //If the file_is_a_string flag is set for either
     //of the required file parameters, avatar will
@@ -244,13 +252,17 @@ Avatar_handle* avatar_train(int argc, char ** argv, char* names_file, int names_
 
     if (train_file_is_a_string > 0){
 	a->Args.train_file_is_a_string = TRUE;
-	a->Args.train_string = train_file;
+	a->Args.train_string = av_strdup(train_file);
     } 
 
     if (a->Args.format == EXODUS_FORMAT) {
-            init_fc(a->Args);
-            open_exo_datafile(&a->ds, a->Args.datafile);
-        }
+      #ifdef HAVE_AVATAR_FCLIB
+      init_fc(a->Args);
+      open_exo_datafile(&a->ds, a->Args.datafile);
+      #else
+      av_printfErrorMessage("To train using EXODUS_FORMAT, install the fclib 1.6.1 source in avatar/util/ and then rebuild.");
+      #endif
+    }
 
     //Read the required training data into the objects
     //stored in the Avatar_handle 
@@ -279,16 +291,34 @@ Avatar_handle* avatar_train(int argc, char ** argv, char* names_file, int names_
             if (! a->Args.do_testing)
                 a->Test_Subset.meta.num_examples = 0;
             train_ivote(a->Train_Subset, a->Test_Subset, -1, &a->Cache, a->Args);
+            free_Vote_Cache(a->Cache, a->Args);
         } else {
-            train(&a->Train_Subset, a->Test_Ensembles, -1, a->Args);
-            // May need to re-read the ensemble for testing.
-            // We'll delete the ensemble file later if --no-save-trees was requested
-            //save_ensemble(Test_Ensembles[0], Train_Subset.meta, -1, Args, Train_Subset.meta.num_classes);
-	    //free_DT_Ensemble(Train_Ensemble, TRAIN_MODE);
+            DT_Ensemble Train_Ensemble;
+            reset_DT_Ensemble(&Train_Ensemble);
+            train(&a->Train_Subset, &Train_Ensemble, -1, a->Args);
+            if (! a->Args.stream_trees)
+                save_ensemble(Train_Ensemble, a->Train_Subset.meta, -1, a->Args, a->Train_Subset.meta.num_classes);
+            free_DT_Ensemble(Train_Ensemble, TRAIN_MODE);
         }
-    #else
-    av_printfErrorMessage("To call avatar_train(), install the fclib 1.6.1 source in avatar/util/ and then rebuild.");
-    #endif
+
+    // Drop the training data and read the saved ensemble back the way avatar_load
+    // does so the handle can be used for scoring straight away
+    free_CV_Subset(&a->Train_Subset, a->Args, TRAIN_MODE);
+    free_CV_Dataset(a->Train_Dataset, a->Args);
+    av_freeSortedBlobArray(&a->Train_Sorted_Examples);
+    memset(&a->Train_Subset, 0, sizeof(CV_Subset));
+    memset(&a->Train_Dataset, 0, sizeof(CV_Dataset));
+    av_exitIfError(av_initSortedBlobArray(&a->Train_Sorted_Examples));
+
+    read_names_file(&a->Train_Subset.meta, &a->Class, &a->Args, TRUE);
+    reset_DT_Ensemble(a->Test_Ensembles);
+    read_ensemble(a->Test_Ensembles, -1, 0, &a->Args);
+    resolve_missing_values(a->Test_Ensembles, a->Train_Subset.meta, a->Args);
+    if (! a->Args.save_trees)
+        remove(a->Args.trees_file);
+    free_CV_Class(a->Class);
+    read_names_file(&a->Test_Dataset.meta, &a->Class, &a->Args, TRUE);
+    a->class_probs = (float*)malloc(a->Train_Subset.meta.num_classes * sizeof(float));
     return a;
 }
 
@@ -348,7 +378,7 @@ void avatar_test(Avatar_handle* a, char* test_data_file, int test_data_is_a_stri
       if (a->Args.do_boosting == TRUE){
         build_boost_prediction_matrix(a->Test_Subset, *a->Test_Ensembles, &Matrix);
       } else {
-        build_prediction_matrix(a->Test_Subset, *a->Test_Ensembles, &Matrix);
+        build_engine_prediction_matrix(a->Test_Subset, *a->Test_Ensembles, &Matrix, a->Args.scoring_engine);
       }
     } 
     else if (num_ensembles > 1) {
@@ -357,7 +387,7 @@ void avatar_test(Avatar_handle* a, char* test_data_file, int test_data_is_a_stri
       if (a->Args.do_boosting == TRUE){
         build_boost_prediction_matrix(a->Test_Subset, big_ensemble, &Matrix);		
       } else {
-        build_prediction_matrix(a->Test_Subset, big_ensemble, &Matrix); 
+        build_engine_prediction_matrix(a->Test_Subset, big_ensemble, &Matrix, a->Args.scoring_engine);
       }
     }
         
@@ -366,14 +396,29 @@ void avatar_test(Avatar_handle* a, char* test_data_file, int test_data_is_a_stri
     // NOTE: This pointer grabs part of the interior of the tree.  This does not need to be free'd.
     float *this_probs = NULL;
     
+    // With QuickScorer, find every tree's leaf at once instead of walking each tree for the probabilities
+    QuickScorer qs = {0};
+    uint64_t *qs_bitvectors = NULL;
+    int *qs_leaves = NULL;
+    if (a->Args.scoring_engine == QUICKSCORER_ENGINE) {
+      quickscorer_build(*a->Test_Ensembles, &qs);
+      qs_bitvectors = (uint64_t *)malloc((qs.num_words + 1) * sizeof(uint64_t));
+      qs_leaves = (int *)malloc((a->Test_Ensembles->num_trees + 1) * sizeof(int));
+    }
+    
     for (line = 0; line < a->Test_Subset.meta.num_examples; line++) {
       for (class = 0; class < a->Train_Subset.meta.num_classes; class++)
         a->class_probs[class] = 0;
       CV_Example e = a->Test_Subset.examples[line];
-      e.predicted_class_num = find_best_class_from_matrix(line, Matrix, a->Args, line, 0);
+      e.predicted_class_num = find_best_class_from_matrix_r(line, Matrix, a->Args, line, &a->tie_rng, &a->tie_rng_seed);
       predictions[line] = e.predicted_class_num;
+      if (a->Args.scoring_engine == QUICKSCORER_ENGINE)
+        quickscorer_find_leaves(&qs, *a->Test_Ensembles, e, a->Test_Subset.float_data, qs_bitvectors, qs_leaves);
       for (i = 0; i < a->Test_Ensembles->num_trees; i++){
-        this_probs = find_example_probabilities(a->Test_Ensembles->Trees[i], e, a->Test_Subset.float_data, &leaf_node);
+        if (a->Args.scoring_engine == QUICKSCORER_ENGINE)
+          this_probs = a->Test_Ensembles->Trees[i][qs_leaves[i]].class_probs;
+        else
+          this_probs = find_example_probabilities(a->Test_Ensembles->Trees[i], e, a->Test_Subset.float_data, &leaf_node);
         for (class = 0; class < a->Train_Subset.meta.num_classes; class++){
           a->class_probs[class] += this_probs[class]; 
         }
@@ -385,6 +430,11 @@ void avatar_test(Avatar_handle* a, char* test_data_file, int test_data_is_a_stri
         probabilities[line * a->Train_Subset.meta.num_classes + class] = a->class_probs[class];
       }
     }
+    if (a->Args.scoring_engine == QUICKSCORER_ENGINE) {
+      free(qs_bitvectors);
+      free(qs_leaves);
+      quickscorer_free(&qs);
+    }
     for (i = 0; i < a->Test_Subset.meta.num_examples; i++)
       free(Matrix.data[i]);
     free(Matrix.data);
@@ -394,6 +444,65 @@ void avatar_test(Avatar_handle* a, char* test_data_file, int test_data_is_a_stri
 }
 
 
+//Scores a caller-owned, row-major matrix of attribute values directly against the
+//trees, skipping the text reader. Each row holds the attribute values in names-file
+//order without the class column; discrete attributes hold the index of their value
+//and NaN marks a missing value. Predictions and probabilities are the same as those
+//avatar_test returns for the equivalent test data. Returns the number of rows scored,
+//or -1 if the rows do not have one column per attribute in the ensemble
+int avatar_predict_rows(Avatar_handle* a, const float *rows, int nrows, int ncols, int *predictions, float *probabilities){
+    CV_Matrix Matrix = {0};
+    DT_Ensemble *ensemble;
+    DT_Node *leaf;
+    int line, i, class;
+    int num_classes;
+
+    if(!a) return -1;
+    ensemble = a->Test_Ensembles;
+    num_classes = a->Train_Subset.meta.num_classes;
+    if (ncols != ensemble->num_attributes) {
+      fprintf(stderr, "avatar_predict_rows: rows have %d columns but the ensemble uses %d attributes\n",
+                      ncols, ensemble->num_attributes);
+      return -1;
+    }
+
+    // A one-row prediction matrix lets find_best_class_from_matrix_r break ties
+    // exactly as it does for avatar_test
+    if (a->row_votes == NULL)
+      a->row_votes = (union data_type_union *)malloc((ensemble->num_trees + num_classes + 1) * sizeof(union data_type_union));
+    Matrix.data = &a->row_votes;
+    Matrix.num_examples = 1;
+    Matrix.num_classifiers = ensemble->num_trees;
+    Matrix.num_classes = num_classes;
+    Matrix.additional_cols = (a->Args.do_boosting == TRUE ? 0 : 1);
+
+    for (line = 0; line < nrows; line++) {
+      const float *row = rows + (size_t)line * ncols;
+      for (class = 0; class < num_classes; class++) {
+        a->class_probs[class] = 0;
+        if (a->Args.do_boosting == TRUE)
+          a->row_votes[class].Real = 0.0;
+      }
+      if (a->Args.do_boosting != TRUE)
+        a->row_votes[0].Integer = 0; // No truth column
+      for (i = 0; i < ensemble->num_trees; i++) {
+        leaf = &ensemble->Trees[i][find_row_leaf(ensemble->Trees[i], row, ensemble->Missing)];
+        if (a->Args.do_boosting == TRUE)
+          a->row_votes[leaf->Node_Value.class_label].Real += (float)dlog_2(1.0/ensemble->boosting_betas[i]);
+        else
+          a->row_votes[i+1].Integer = leaf->Node_Value.class_label;
+        for (class = 0; class < num_classes; class++)
+          a->class_probs[class] += leaf->class_probs[class];
+      }
+      predictions[line] = find_best_class_from_matrix_r(0, Matrix, a->Args, line, &a->tie_rng, &a->tie_rng_seed);
+      for (class = 0; class < num_classes; class++)
+        probabilities[line * num_classes + class] = a->class_probs[class] / ensemble->num_trees;
+    }
+
+    return nrows;
+}
+
+
 //Free memory allocated by the Avatar_handle
 void avatar_cleanup(Avatar_handle* a){
   if(!a) return;
@@ -418,6 +527,10 @@ void avatar_cleanup(Avatar_handle* a){
   
   free(a->class_probs);
   a->class_probs = NULL;
+  free(a->row_votes);
+  a->row_votes = NULL;
+  free(a->tie_rng);
+  a->tie_rng = NULL;
   free_CV_Class(a->Class);
   free_Args_Opts_Full(a->Args);
   free(a);
@@ -428,3 +541,53 @@ int avatar_num_classes(Avatar_handle* handle) {
   return handle->Class.num_classes;
 }
 
+int avatar_num_attributes(Avatar_handle* handle) {
+  if(!handle) return -1;
+  return handle->Test_Ensembles->num_attributes;
+}
+
+int avatar_num_trees(Avatar_handle* handle) {
+  if(!handle) return -1;
+  return handle->Test_Ensembles->num_trees;
+}
+
+int avatar_num_attribute_values(Avatar_handle* handle, int att) {
+  DT_Ensemble *ensemble;
+  CV_Metadata meta;
+  int i, j;
+  if(!handle) return -1;
+  ensemble = handle->Test_Ensembles;
+  meta = handle->Train_Subset.meta;
+  if (att < 0 || att >= ensemble->num_attributes) return -1;
+  if (ensemble->attribute_types[att] != DISCRETE) return 0;
+  // The names file still lists any attributes the ensemble skipped
+  for (i = -1, j = 0; j < meta.num_attributes; j++) {
+    if (meta.num_attributes != ensemble->num_attributes &&
+        find_int(j+1, handle->Args.num_skipped_features, handle->Args.skipped_features))
+      continue;
+    if (++i == att)
+      return meta.num_discrete_values[j];
+  }
+  return -1;
+}
+
+int avatar_save_trees(Avatar_handle* handle, char* trees_file, int binary) {
+  if(!handle) return -1;
+  write_ensemble_file(trees_file, *handle->Test_Ensembles, handle->Args, binary ? TRUE : FALSE);
+  return 0;
+}
+
+const char* avatar_class_name(Avatar_handle* handle, int class_num) {
+  if(!handle || class_num < 0 || class_num >= handle->Class.num_classes) return NULL;
+  return handle->Class.class_names[class_num];
+}
+
+
+//Selects the backend avatar_test uses to evaluate the ensemble
+void avatar_set_scoring_engine(Avatar_handle* handle, int engine) {
+  if(!handle) return;
+  if (engine == AVATAR_ENGINE_QUICKSCORER)
+    handle->Args.scoring_engine = QUICKSCORER_ENGINE;
+  else
+    handle->Args.scoring_engine = LOCKSTEP_ENGINE;
+}
@@ -46,8 +46,34 @@ Avatar_handle* avatar_train(int argc, char ** argv, char* names_file, int names_
 
 void avatar_test(Avatar_handle* a, char* test_data_file, int test_data_is_a_string, int* predictions, float *probabilities); 
 
+// rows is a row-major nrows x ncols matrix of attribute values in names-file order
+// (class column removed, discrete values given as their index, NaN for missing).
+// Returns the number of rows scored or -1 if ncols does not match the ensemble
+int avatar_predict_rows(Avatar_handle* a, const float *rows, int nrows, int ncols, int* predictions, float *probabilities);
+
 void avatar_cleanup(Avatar_handle* a);
 
 int avatar_num_classes(Avatar_handle* handle);
 
+// Number of attribute columns avatar_predict_rows expects
+int avatar_num_attributes(Avatar_handle* handle);
+
+// Number of trees read from the ensemble file
+int avatar_num_trees(Avatar_handle* handle);
+
+// Number of values discrete attribute att takes, 0 if it is continuous or -1 if att is out of range
+int avatar_num_attribute_values(Avatar_handle* handle, int att);
+
+// Writes the ensemble to trees_file as text or, if binary is non-zero, in the binary format
+int avatar_save_trees(Avatar_handle* handle, char* trees_file, int binary);
+
+// Name of a class as given in the names file, or NULL if class_num is out of range
+const char* avatar_class_name(Avatar_handle* handle, int class_num);
+
+// Scoring engines for avatar_set_scoring_engine. Both give identical predictions and probabilities
+#define AVATAR_ENGINE_LOCKSTEP    0
+#define AVATAR_ENGINE_QUICKSCORER 1
+
+void avatar_set_scoring_engine(Avatar_handle* handle, int engine);
+
 #endif // AVATAR_API_H
@@ -54,6 +54,8 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "version_info.h"
 #include "attr_stats.h"
 #include "reset.h"
+#include "lazy_trees.h"
+#include "test_stream.h"
 
 // Included for cleanup purposes
 #include "evaluate.h"
@@ -71,9 +73,11 @@ int avatar_dt (int argc, char **argv) {
     int i;
     CV_Dataset Train_Dataset = {0}, Test_Dataset = {0};
     CV_Subset Train_Subset = {0}, Test_Subset = {0};
+    CV_Class Test_Class = {0};
     Vote_Cache Cache = {0};
     AV_SortedBlobArray Train_Sorted_Examples = {0}, Test_Sorted_Examples = {0};
     CV_Partition Partitions = {0};
+    CV_Overall_Confusion Overall_Confusion = {0};
     DT_Ensemble *Test_Ensembles = NULL;
     Test_Ensembles = (DT_Ensemble *)calloc(1, sizeof(DT_Ensemble));
     Args_Opts Args = {0};
@@ -141,7 +145,15 @@ int avatar_dt (int argc, char **argv) {
 #endif
         }
         av_exitIfError(av_initSortedBlobArray(&Test_Sorted_Examples));
-        read_testing_data(&ds, Train_Subset.meta, &Test_Dataset, &Test_Subset, &Test_Sorted_Examples, &Args);
+        if (Args.test_batch_size > 0) {
+            // test_stream() reads the test data a batch at a time so only the names are needed now
+            if (! read_names_file(&Test_Dataset.meta, &Test_Class, &Args, (Args.do_training == TRUE ? FALSE : TRUE))) {
+                fprintf(stderr, "Error reading names file\n");
+                exit(-8);
+            }
+        } else {
+            read_testing_data(&ds, Train_Subset.meta, &Test_Dataset, &Test_Subset, &Test_Sorted_Examples, &Args);
+        }
         if (Args.partitions_filename != NULL) {
             // Read parition file if it was specified
             read_partition_file(&Partitions, &Args);
@@ -167,6 +179,10 @@ int avatar_dt (int argc, char **argv) {
     if ((!Args.do_training) && Args.output_laplacean)
         check_tree_version(-1, &Args);
 
+    // When growing an ensemble, report and save the number of trees it will end up with
+    if (Args.add_trees > 0)
+        Args.num_trees = read_ensemble_num_trees(-1, Args) + Args.add_trees;
+
     // Init the stopping algorithm
     // We are now reporting OOB accuracy anytime bagging or ivoting is used
     if (Args.do_ivote == TRUE || Args.do_bagging == TRUE)
@@ -198,7 +214,9 @@ int avatar_dt (int argc, char **argv) {
 
             // May need to re-read the ensemble for testing.
             // We'll delete the ensemble file later if --no-save-trees was requested
-            save_ensemble(Train_Ensemble, Train_Subset.meta, -1, Args, Train_Subset.meta.num_classes);
+            // With --stream-trees, train() has already written it
+            if (! Args.stream_trees)
+                save_ensemble(Train_Ensemble, Train_Subset.meta, -1, Args, Train_Subset.meta.num_classes);
             free_DT_Ensemble(Train_Ensemble, TRAIN_MODE);
             memset(&Train_Ensemble, 0, sizeof(DT_Ensemble));
         }
@@ -207,7 +225,7 @@ int avatar_dt (int argc, char **argv) {
     if (Args.do_testing) {
         // Test
         if (Args.do_ivote && Args.do_training) {
-            test_ivote(Test_Subset, Cache, pred_prob, -1, Args);
+            test_ivote(Test_Subset, Cache, pred_prob, -1, Args, &Overall_Confusion);
         } else {
             // Save some parameters
             char *df;
@@ -228,7 +246,11 @@ int avatar_dt (int argc, char **argv) {
                 else
                     set_output_filenames(&Args, FALSE, FALSE);
                 reset_DT_Ensemble(&Test_Ensembles[i]);
-                read_ensemble(&Test_Ensembles[i], -1, 0, &Args);
+                // Partitioned ensembles are concatenated for testing which needs every tree
+                if (Args.max_tree_memory > 0 && Partitions.num_partitions == 1)
+                    read_lazy_ensemble(&Test_Ensembles[i], -1, 0, (size_t)Args.max_tree_memory << 20, &Args);
+                else
+                    read_ensemble(&Test_Ensembles[i], -1, 0, &Args);
                 //check_ensemble_validity("Test_Ensemble",&Test_Ensembles[i]);
             }
             // Restore
@@ -240,7 +262,10 @@ int avatar_dt (int argc, char **argv) {
             free(bf);
             free(dp);
             free(tf);
-            test(Test_Subset, Partitions.num_partitions, Test_Ensembles, pred_prob, -1, Args);
+            if (Args.test_batch_size > 0)
+                test_stream(&Test_Dataset, &Test_Class, Train_Subset.meta, Test_Ensembles[0], Args);
+            else
+                test(Test_Subset, Partitions.num_partitions, Test_Ensembles, pred_prob, -1, Args, &Overall_Confusion);
         }
     }
 
@@ -264,6 +289,8 @@ int avatar_dt (int argc, char **argv) {
         free_CV_Subset(&Test_Subset, Args, TEST_MODE);
         free_CV_Dataset(Test_Dataset, Args);
         av_freeSortedBlobArray(&Test_Sorted_Examples);
+        if (Args.test_batch_size > 0)
+            free_CV_Class(Test_Class);
     }
     if (Args.do_ivote) {
         free_Vote_Cache(Cache, Args);
@@ -336,6 +363,16 @@ void display_usage( void ) {
     printf("                       They are applied left to right.\n");
     printf("    --truth-column=S : Location of the truth column. S = first or last\n");
     printf("                       Default = last\n");
+    printf("    --threads=N      : Use N threads to read the data and ensemble files\n");
+    printf("                       Default = one per processor\n");
+    printf("    --data-cache     : Save the parsed data next to the data file as FILE.avbin\n");
+    printf("                       and load it instead of the text on later runs\n");
+    printf("    --out-of-core[=DIR] : Keep the training data and tree-building partitions in\n");
+    printf("                       scratch files in DIR so they need not fit in memory\n");
+    printf("                       Default DIR = the data file's directory\n");
+    printf("    --test-batch-size=N : Read, score and write predictions for the test data N\n");
+    printf("                       examples at a time so it need not fit in memory.\n");
+    printf("                       --test-file=- reads the test data from stdin\n");
     printf("\n");
     printf("tree-building options:\n");
     printf("    -n, --num-trees=N            : Build N trees. Default = 1\n");
@@ -366,6 +403,14 @@ void display_usage( void ) {
     printf("        --save-trees             : Write trees to disk\n");
     printf("                                   On by default.\n");
     printf("        --no-save-trees          : Do not write trees to disk\n");
+    printf("        --binary-trees           : Write trees in the binary ensemble format\n");
+    printf("        --stream-trees           : Write each tree as soon as it is built and free it\n");
+    printf("        --checkpoint=N           : Every N trees, save what is needed to resume training.\n");
+    printf("                                   Implies --stream-trees\n");
+    printf("        --resume                 : Carry on from the last checkpoint of an interrupted run\n");
+    printf("                                   given the same options\n");
+    printf("        --add-trees=N            : Add N trees to the existing ensemble file. Use the\n");
+    printf("                                   --seed and options the ensemble was built with\n");
     printf("\n");
     printf("ensemble options:\n");
     printf("    -B, --bagging=N           : Bagging with N%% of training set examples\n");
@@ -388,6 +433,16 @@ void display_usage( void ) {
     printf("    --do-memv : Do margin ensemble majority voting\n");
     printf("    --do-pmv  : Do probability majority voting\n");
     printf("    --do-spmv : Do scaled probability majority voting\n");
+    printf("    --early-exit-voting : For plain majority voting, stop evaluating trees for an\n");
+    printf("                          example once its voted class cannot change. Only the\n");
+    printf("                          predicted classes and voted accuracy are available\n");
+    printf("    --scoring-engine=E  : Evaluate the ensemble with engine E. E is one of\n");
+    printf("                            lockstep (default), quickscorer\n");
+    printf("                          Both give identical results. quickscorer is faster for\n");
+    printf("                          shallow trees\n");
+    printf("    --max-tree-memory=MB : Load trees as they are needed while testing and keep\n");
+    printf("                          at most MB megabytes of them in memory. The ensemble is\n");
+    printf("                          scored one tree at a time\n");
     printf("\n");
     printf("skew correction:\n");
     printf("    --majority-bagging        : Use majority bagging\n");
@@ -41,11 +41,46 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "array.h"
 #include "skew.h"
 #include "av_rng.h"
+#include "out_of_core.h"
+
+// Seeded on the first call to make_bag and kept for the whole run
+static struct ParkMiller* rng = NULL;
+
+/*
+ * Report where the bagging RNG is so a checkpoint can put it back.
+ * Returns FALSE if no bag has been made yet and so the RNG is not seeded.
+ */
+Boolean get_bag_rng_state(int *state) {
+    if (rng == NULL)
+        return FALSE;
+    *state = rng->state;
+    return TRUE;
+}
+
+/*
+ * Put the bagging RNG back where get_bag_rng_state found it
+ */
+void set_bag_rng_state(Boolean seeded, int state) {
+    if (! seeded) {
+        free(rng);
+        rng = NULL;
+        return;
+    }
+    if (rng == NULL)
+        rng = malloc(sizeof(struct ParkMiller));
+    av_pm_default_init(rng, state);
+}
+
+static void _bag_example(int num_atts, CV_Example src, CV_Example *dest, Args_Opts args) {
+    if (args.out_of_core == TRUE)
+        share_example_data(src, dest);
+    else
+        copy_example_data(num_atts, src, dest);
+}
 
 void make_bag(CV_Subset *src, CV_Subset *bag, Args_Opts args, int cleanup) {
     int i, j, k;
     static int count = 0;
-    static struct ParkMiller* rng = NULL;
 
     if (cleanup == 1)
     {
@@ -88,6 +123,11 @@ void make_bag(CV_Subset *src, CV_Subset *bag, Args_Opts args, int cleanup) {
     }
     
     copy_subset_meta(*src, bag, num_in_bag);
+    // An out-of-core bag is kept in a scratch file and shares src's attribute values
+    if (args.out_of_core == TRUE) {
+        free(bag->examples);
+        bag->examples = (CV_Example *)scratch_alloc(num_in_bag * sizeof(CV_Example), args);
+    }
     copy_subset_data(*src, bag);
     bag->meta.num_examples = num_in_bag;
     // Re-initialize to false
@@ -108,7 +148,7 @@ void make_bag(CV_Subset *src, CV_Subset *bag, Args_Opts args, int cleanup) {
             // If this is a minority class, include automatically
           if (find_int(src->examples[i].containing_class_num, args.num_minority_classes, args.minority_classes)) {
                 //printf("Copy(1) %d to %d\n", i, j);
-                copy_example_data(src->meta.num_attributes, src->examples[i], &(bag->examples[j]));
+                _bag_example(src->meta.num_attributes, src->examples[i], &(bag->examples[j]), args);
                 //printf("MIN:%d %d\n", count, i);
                 //samples_seen[i] = 1;
                 src->examples[i].in_bag = TRUE;
@@ -136,7 +176,7 @@ void make_bag(CV_Subset *src, CV_Subset *bag, Args_Opts args, int cleanup) {
             //printf("Copy(2) %d to %d\n", j, i);
             //printf("MAJ:%d %d\n", count, j);
             //samples_seen[j] = 1;
-            copy_example_data(src->meta.num_attributes, src->examples[j], &(bag->examples[i]));
+            _bag_example(src->meta.num_attributes, src->examples[j], &(bag->examples[i]), args);
             src->examples[j].in_bag = TRUE;
             bag->meta.num_examples_per_class[this_class]++;
         }
@@ -168,7 +208,7 @@ void make_bag(CV_Subset *src, CV_Subset *bag, Args_Opts args, int cleanup) {
             //}
             if (args.debug)
                 printf("Picking data point:%8d\n", j);
-            copy_example_data(src->meta.num_attributes, src->examples[j], &(bag->examples[i]));
+            _bag_example(src->meta.num_attributes, src->examples[j], &(bag->examples[i]), args);
             src->examples[j].in_bag = TRUE;
 
         }
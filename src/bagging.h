@@ -34,3 +34,5 @@ For questions, comments or contributions contact
 Philip Kegelmeyer, wpk@sandia.gov 
 *******************************************************************************/
 void make_bag(CV_Subset *src, CV_Subset *bag, Args_Opts args, int cleanup);
+Boolean get_bag_rng_state(int *state);
+void set_bag_rng_state(Boolean seeded, int state);
@@ -57,8 +57,9 @@ void get_next_balanced_set(int cycle, CV_Subset *src, CV_Subset *bal, Args_Opts
     int *per_class_count;
     per_class_count = (int *)calloc(src->meta.num_classes, sizeof(int));
     
-    // First time through, figure out number of clumps and the number of examples per clump
-    if (cycle == 0)
+    // First time through, figure out number of clumps and the number of examples per clump.
+    // A run resumed from a checkpoint starts part way through the cycle
+    if (cycle == 0 || num_clumps == 0)
         compute_number_of_clumps(src->meta, &args, &num_clumps, &ex_per_part);
     // Cycle should go from 0 to num_clumps then back to 0
     while (cycle >= num_clumps)
@@ -0,0 +1,343 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "crossval.h"
+#include "mapped_input.h"
+#include "binary_data.h"
+#include "out_of_core.h"
+
+static char *_cache_filename(char *filename);
+static uint64_t _hash_bytes(uint64_t hash, const void *bytes, size_t length);
+static uint64_t _schema_hash(CV_Subset *sub, char *ext, Args_Opts *args);
+static int64_t _align8(int64_t size);
+
+static const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+/*
+ * Loads the cache of filename if there is one that is still good for it. Fills in the same
+ * fields of data and sub that read_data_file does and adds the examples to blob.
+ * Returns FALSE if there is no usable cache, in which case nothing has been changed
+ */
+Boolean read_binary_data(char *filename, CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedBlobArray *blob, char *ext, Args_Opts *args) {
+    int i, j;
+    int ex_num;
+    int *rows = NULL;
+    int64_t size;
+    struct stat sb;
+    Input_Text input;
+    Binary_Data_Header *header;
+    char *cache_filename = _cache_filename(filename);
+    AV_ReturnCode rc;
+    
+    if (stat(filename, &sb) < 0 || access(cache_filename, R_OK) < 0 ||
+        ! open_input_text(cache_filename, NULL, FALSE, FALSE, &input)) {
+        free(cache_filename);
+        return FALSE;
+    }
+    free(cache_filename);
+    
+    // A stale or foreign cache is ignored and written again once the text has been parsed
+    header = (Binary_Data_Header *)input.text;
+    if (input.length < sizeof(Binary_Data_Header) || memcmp(header->magic, BINARY_DATA_MAGIC, 8) ||
+        header->byte_order != BINARY_DATA_BYTE_ORDER || header->version != BINARY_DATA_VERSION ||
+        header->flags != (strcmp(ext, "test") ? 0 : BINARY_DATA_TEST) ||
+        header->num_attributes != sub->meta.num_attributes || header->num_classes != sub->meta.num_classes ||
+        header->num_examples <= 0 || header->source_size != sb.st_size ||
+        header->source_mtime_sec != sb.st_mtim.tv_sec || header->source_mtime_nsec != sb.st_mtim.tv_nsec ||
+        header->schema_hash != _schema_hash(sub, ext, args)) {
+        close_input_text(&input);
+        return FALSE;
+    }
+    
+    int num_examples = header->num_examples;
+    int num_attributes = header->num_attributes;
+    int32_t *examples_per_class = (int32_t *)(input.text + sizeof(Binary_Data_Header));
+    union data_point_union *missing = (union data_point_union *)(examples_per_class + header->num_classes);
+    int32_t *high = (int32_t *)(missing + num_attributes);
+    float *float_data = (float *)(input.text + header->header_size);
+    size = header->header_size;
+    for (i = 0; i < num_attributes; i++)
+        if (sub->meta.attribute_types[i] == CONTINUOUS)
+            size += (high[i] + 1) * sizeof(float);
+    int32_t *classes = (int32_t *)(input.text + _align8(size));
+    size = _align8(size) + _align8(num_examples * sizeof(int32_t));
+    int32_t *values = (int32_t *)(input.text + size);
+    size += (int64_t)num_attributes * num_examples * sizeof(int32_t);
+    if (size != input.length) {
+        close_input_text(&input);
+        return FALSE;
+    }
+    
+    for (i = 0; i < header->num_classes; i++) {
+        sub->meta.num_examples_per_class[i] = examples_per_class[i];
+        class->class_frequencies[i] += examples_per_class[i];
+    }
+    
+    data->meta.num_examples = num_examples;
+    data->examples = (CV_Example *)realloc(data->examples, num_examples * sizeof(CV_Example));
+    memset(data->examples, 0, num_examples * sizeof(CV_Example));
+    // For --out-of-core training the rows go straight to a scratch file instead of the heap
+    if (! strcmp(ext, "data") && args->out_of_core == TRUE) {
+        rows = (int *)scratch_alloc((size_t)num_examples * num_attributes * sizeof(int), *args);
+        if (scratch_base(rows) == NULL) {
+            free(rows);
+            rows = NULL;
+        }
+    }
+    for (ex_num = 0; ex_num < num_examples; ex_num++) {
+        data->examples[ex_num].global_id_num = data->examples[ex_num].fclib_id_num = ex_num;
+        data->examples[ex_num].fclib_seq_num = 0;
+        data->examples[ex_num].predicted_class_num = -1;
+        data->examples[ex_num].containing_class_num = classes[ex_num];
+        if (rows != NULL)
+            data->examples[ex_num].distinct_attribute_values = rows + (size_t)ex_num * num_attributes;
+        else
+            data->examples[ex_num].distinct_attribute_values = (int *)malloc(num_attributes * sizeof(int));
+    }
+    // The values are stored by attribute so the mapped file is read straight through
+    for (j = 0; j < num_attributes; j++) {
+        int32_t *column = values + (int64_t)j * num_examples;
+        for (ex_num = 0; ex_num < num_examples; ex_num++)
+            data->examples[ex_num].distinct_attribute_values[j] = column[ex_num];
+    }
+    
+    if (!data->meta.global_offset)
+        data->meta.global_offset = (int *)calloc(2, sizeof(int));
+    data->meta.global_offset[1] = num_examples;
+    sub->meta.global_offset = data->meta.global_offset;
+    sub->examples = data->examples;
+    sub->meta.num_examples = num_examples;
+    
+    // The missing values of test data came from the training data or ensemble and are already in place
+    if (! strcmp(ext, "data")) {
+        sub->meta.Missing = (union data_point_union *)malloc(num_attributes * sizeof(union data_point_union));
+        memcpy(sub->meta.Missing, missing, num_attributes * sizeof(union data_point_union));
+    }
+    
+    // The same arrays create_float_data makes
+    free(sub->float_data);
+    free(sub->low);
+    free(sub->high);
+    free(sub->discrete_used);
+    sub->float_data = (float **)calloc(num_attributes, sizeof(float *));
+    sub->low = (int *)malloc(num_attributes * sizeof(int));
+    sub->high = (int *)malloc(num_attributes * sizeof(int));
+    sub->discrete_used = (Boolean *)malloc(num_attributes * sizeof(Boolean));
+    for (i = 0; i < num_attributes; i++) {
+        sub->discrete_used[i] = FALSE;
+        sub->low[i] = 0;
+        sub->high[i] = high[i];
+        if (sub->meta.attribute_types[i] == CONTINUOUS) {
+            sub->float_data[i] = (float *)malloc((high[i] + 1) * sizeof(float));
+            memcpy(sub->float_data[i], float_data, (high[i] + 1) * sizeof(float));
+            float_data += high[i] + 1;
+        }
+    }
+    close_input_text(&input);
+    
+    for (ex_num = 0; ex_num < num_examples; ex_num++) {
+        rc = av_appendBlobToSortedBlobArray(blob, &sub->examples[ex_num]);
+        if (rc < 0)
+            av_exitIfErrorPrintf(rc, "Failed to add example %d to SBA\n", ex_num);
+    }
+    rc = av_sortSortedBlobArray(blob, cv_example_compare_by_seq_id);
+    if (rc < 0) {
+        av_exitIfErrorPrintf(rc, "Failed to sort the examples in the SBA\n");
+    } else if (rc > 0) {
+        fprintf(stderr, "%d examples already existed in SBA\n", rc);
+    }
+    
+    return TRUE;
+}
+
+/*
+ * Writes the cache for the examples just read from filename. The cache is written under a
+ * temporary name and renamed into place so a reader never sees part of one. Failing to write
+ * a cache is not an error
+ */
+void save_binary_data(char *filename, CV_Dataset *data, CV_Subset *sub, char *ext, Args_Opts *args) {
+    int i, j;
+    int ex_num;
+    int num_examples = sub->meta.num_examples;
+    int num_attributes = sub->meta.num_attributes;
+    int64_t size;
+    struct stat sb;
+    FILE *fh;
+    Binary_Data_Header header;
+    char *cache_filename = _cache_filename(filename);
+    char *tmp_filename = (char *)malloc((strlen(cache_filename) + 32) * sizeof(char));
+    sprintf(tmp_filename, "%s.%d.tmp", cache_filename, (int)getpid());
+    
+    if (stat(filename, &sb) < 0 || (fh = fopen(tmp_filename, "w")) == NULL) {
+        fprintf(stderr, "WARNING: Could not write the dataset cache '%s'\n", cache_filename);
+        free(tmp_filename);
+        free(cache_filename);
+        return;
+    }
+    
+    memset(&header, 0, sizeof(Binary_Data_Header));
+    memcpy(header.magic, BINARY_DATA_MAGIC, 8);
+    header.byte_order = BINARY_DATA_BYTE_ORDER;
+    header.version = BINARY_DATA_VERSION;
+    header.num_examples = num_examples;
+    header.num_attributes = num_attributes;
+    header.num_classes = sub->meta.num_classes;
+    header.flags = strcmp(ext, "test") ? 0 : BINARY_DATA_TEST;
+    header.schema_hash = _schema_hash(sub, ext, args);
+    header.source_size = sb.st_size;
+    header.source_mtime_sec = sb.st_mtim.tv_sec;
+    header.source_mtime_nsec = sb.st_mtim.tv_nsec;
+    size = sizeof(Binary_Data_Header) + (header.num_classes + 2 * num_attributes) * sizeof(int32_t);
+    header.header_size = _align8(size);
+    fwrite(&header, sizeof(Binary_Data_Header), 1, fh);
+    
+    for (i = 0; i < header.num_classes; i++) {
+        int32_t count = sub->meta.num_examples_per_class[i];
+        fwrite(&count, sizeof(int32_t), 1, fh);
+    }
+    // Only the missing values of discrete and continuous attributes mean anything
+    for (i = 0; i < num_attributes; i++) {
+        union data_point_union missing;
+        missing.Discrete = 0;
+        if (sub->meta.attribute_types[i] == DISCRETE)
+            missing.Discrete = sub->meta.Missing[i].Discrete;
+        else if (sub->meta.attribute_types[i] == CONTINUOUS)
+            missing.Continuous = sub->meta.Missing[i].Continuous;
+        fwrite(&missing, sizeof(union data_point_union), 1, fh);
+    }
+    for (i = 0; i < num_attributes; i++) {
+        int32_t high = sub->high[i];
+        fwrite(&high, sizeof(int32_t), 1, fh);
+    }
+    fwrite(padding, 1, header.header_size - size, fh);
+    
+    size = header.header_size;
+    for (i = 0; i < num_attributes; i++) {
+        if (sub->meta.attribute_types[i] == CONTINUOUS) {
+            fwrite(sub->float_data[i], sizeof(float), sub->high[i] + 1, fh);
+            size += (sub->high[i] + 1) * sizeof(float);
+        }
+    }
+    fwrite(padding, 1, _align8(size) - size, fh);
+    
+    for (ex_num = 0; ex_num < num_examples; ex_num++) {
+        int32_t class_num = sub->examples[ex_num].containing_class_num;
+        fwrite(&class_num, sizeof(int32_t), 1, fh);
+    }
+    size = num_examples * sizeof(int32_t);
+    fwrite(padding, 1, _align8(size) - size, fh);
+    
+    int32_t *column = (int32_t *)malloc(num_examples * sizeof(int32_t));
+    for (j = 0; j < num_attributes; j++) {
+        for (ex_num = 0; ex_num < num_examples; ex_num++)
+            column[ex_num] = sub->examples[ex_num].distinct_attribute_values[j];
+        fwrite(column, sizeof(int32_t), num_examples, fh);
+    }
+    free(column);
+    
+    int failed = ferror(fh);
+    if (fclose(fh) != 0)
+        failed = 1;
+    if (failed || rename(tmp_filename, cache_filename) < 0) {
+        fprintf(stderr, "WARNING: Could not write the dataset cache '%s'\n", cache_filename);
+        unlink(tmp_filename);
+    }
+    free(tmp_filename);
+    free(cache_filename);
+}
+
+static char *_cache_filename(char *filename) {
+    char *cache_filename = (char *)malloc((strlen(filename) + strlen(BINARY_DATA_EXTENSION) + 1) * sizeof(char));
+    sprintf(cache_filename, "%s%s", filename, BINARY_DATA_EXTENSION);
+    return cache_filename;
+}
+
+// FNV-1a
+static uint64_t _hash_bytes(uint64_t hash, const void *bytes, size_t length) {
+    const unsigned char *p = (const unsigned char *)bytes;
+    while (length-- > 0) {
+        hash ^= *p++;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/*
+ * Hashes everything besides the text itself that the translated examples depend on
+ */
+static uint64_t _schema_hash(CV_Subset *sub, char *ext, Args_Opts *args) {
+    int i, j;
+    int32_t n;
+    uint64_t hash = 14695981039346656037ull;
+    
+    hash = _hash_bytes(hash, ext, strlen(ext) + 1);
+    hash = _hash_bytes(hash, &args->truth_column, sizeof(int));
+    hash = _hash_bytes(hash, &args->num_skipped_features, sizeof(int));
+    hash = _hash_bytes(hash, args->skipped_features, args->num_skipped_features * sizeof(int));
+    for (i = 0; i < sub->meta.num_attributes; i++) {
+        n = sub->meta.attribute_types[i];
+        hash = _hash_bytes(hash, &n, sizeof(int32_t));
+        hash = _hash_bytes(hash, sub->meta.attribute_names[i], strlen(sub->meta.attribute_names[i]) + 1);
+        if (sub->meta.attribute_types[i] == DISCRETE) {
+            hash = _hash_bytes(hash, &sub->meta.num_discrete_values[i], sizeof(int));
+            for (j = 0; j < sub->meta.num_discrete_values[i]; j++)
+                hash = _hash_bytes(hash, sub->meta.discrete_attribute_map[i][j],
+                                   strlen(sub->meta.discrete_attribute_map[i][j]) + 1);
+        }
+    }
+    for (i = 0; i < sub->meta.num_classes; i++)
+        hash = _hash_bytes(hash, sub->meta.class_names[i], strlen(sub->meta.class_names[i]) + 1);
+    
+    // Test examples are filled in with missing values that come from elsewhere
+    if (! strcmp(ext, "test")) {
+        for (i = 0; i < sub->meta.num_attributes; i++) {
+            if (sub->meta.attribute_types[i] == DISCRETE)
+                hash = _hash_bytes(hash, &sub->meta.Missing[i].Discrete, sizeof(int));
+            else if (sub->meta.attribute_types[i] == CONTINUOUS)
+                hash = _hash_bytes(hash, &sub->meta.Missing[i].Continuous, sizeof(float));
+        }
+    }
+    return hash;
+}
+
+static int64_t _align8(int64_t size) {
+    return (size + 7) & ~(int64_t)7;
+}
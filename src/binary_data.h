@@ -0,0 +1,81 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#ifndef __BINARY_DATA__
+#define __BINARY_DATA__
+
+#include <stdint.h>
+
+/*
+ * Binary dataset cache files.
+ *
+ * With --data-cache, a .data or .test file that has been read and translated is saved next to it
+ * with an .avbin extension, and later reads of the same file load the cache instead of parsing
+ * the text. The file header is followed by the examples per class, the type, missing value and
+ * number of float_data entries of every attribute, the float_data of the continuous attributes,
+ * the class of every example and then the distinct values one attribute at a time.
+ *
+ * A cache is only used if the text file has the same size and modification time it had when the
+ * cache was written, and the names file, included columns and truth column hash to the same value.
+ * For test data the missing values the examples were filled in with are part of the hash.
+ *
+ * All values are in the byte order of the machine that wrote the file.
+ */
+
+#define BINARY_DATA_MAGIC "AVBINDAT"
+#define BINARY_DATA_BYTE_ORDER 0x01020304
+#define BINARY_DATA_VERSION 1
+#define BINARY_DATA_EXTENSION ".avbin"
+#define BINARY_DATA_TEST 0x1
+
+typedef struct binary_data_header_struct {
+    char magic[8];
+    int32_t byte_order;
+    int32_t version;
+    int32_t num_examples;
+    int32_t num_attributes;
+    int32_t num_classes;
+    int32_t flags;
+    uint64_t schema_hash;
+    int64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    int64_t header_size;            // Offset of the examples per class
+} Binary_Data_Header;
+
+Boolean read_binary_data(char *filename, CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedBlobArray *blob, char *ext, Args_Opts *args);
+void save_binary_data(char *filename, CV_Dataset *data, CV_Subset *sub, char *ext, Args_Opts *args);
+
+#endif // __BINARY_DATA__
@@ -0,0 +1,524 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "crossval.h"
+#include "tree.h"
+#include "array.h"
+#include "reset.h"
+#include "binary_trees.h"
+
+typedef struct binary_tree_writer_struct {
+    int num_classes;
+    int next_node;
+    int next_leaf;
+    int next_ref;
+    Binary_Tree_Node *nodes;
+    int32_t *branches;
+    int32_t *counts;
+    float *probs;
+} Binary_Tree_Writer;
+
+static void _write_header(FILE *fh, Binary_Trees_Header *header, int *examples_per_class,
+                          int32_t *column_types, union data_point_union *missing, char **missing_names);
+static void _count_nodes(DT_Node *tree, int node, int *num_nodes, int *num_leaves, int *num_refs);
+static void _flatten_node(DT_Node *tree, int node, Binary_Tree_Writer *w);
+static void _read_header(FILE *fh, Binary_Trees_Header *header);
+static int64_t _align8(int64_t size);
+
+static const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+/*
+ * Returns TRUE if fh is positioned at the start of a binary ensemble. fh is left where it was
+ */
+Boolean is_binary_trees_file(FILE *fh) {
+    char magic[8];
+    long pos = ftell(fh);
+    size_t n = fread(magic, 1, 8, fh);
+    fseek(fh, pos, SEEK_SET);
+    return (n == 8 && ! memcmp(magic, BINARY_TREES_MAGIC, 8)) ? TRUE : FALSE;
+}
+
+/*
+ * The binary equivalent of the metadata that write_tree_file_header prints
+ */
+void write_binary_trees_header(FILE *fh, int num_trees, CV_Metadata meta, Args_Opts args) {
+    int i;
+    int skip_offset = 0;
+    char strbuf[64];
+    Binary_Trees_Header header;
+    int num_columns = meta.num_attributes + args.num_skipped_features;
+    int32_t *column_types = (int32_t *)malloc(num_columns * sizeof(int32_t));
+    union data_point_union *missing = (union data_point_union *)calloc(meta.num_attributes, sizeof(union data_point_union));
+    char **missing_names = (char **)calloc(meta.num_attributes, sizeof(char *));
+    
+    header.num_training_examples = meta.num_examples;
+    header.num_classes = meta.num_classes;
+    header.num_attributes = meta.num_attributes;
+    header.num_skipped_features = args.num_skipped_features;
+    header.num_trees = num_trees;
+    header.flags = args.do_boosting == TRUE ? BINARY_TREES_BOOSTED : 0;
+    for (i = 0; i < num_columns; i++) {
+        if (is_skipped_column(i, &args)) {
+            skip_offset++;
+            column_types[i] = UNKNOWN;
+            continue;
+        }
+        column_types[i] = meta.attribute_types[i-skip_offset];
+        // Store the missing values as they would read back from the text format
+        if (args.format == AVATAR_FORMAT && column_types[i] == DISCRETE) {
+            missing[i-skip_offset].Discrete = meta.Missing[i-skip_offset].Discrete;
+            missing_names[i-skip_offset] = meta.discrete_attribute_map[i-skip_offset][meta.Missing[i-skip_offset].Discrete];
+        } else if (args.format == AVATAR_FORMAT && column_types[i] == CONTINUOUS) {
+            sprintf(strbuf, "%g", meta.Missing[i-skip_offset].Continuous);
+            missing[i-skip_offset].Continuous = atof(strbuf);
+        }
+    }
+    _write_header(fh, &header, meta.num_examples_per_class, column_types, missing, missing_names);
+    free(column_types);
+    free(missing);
+    free(missing_names);
+}
+
+/*
+ * Writes the header for an ensemble that has already been read. The skipped columns are the
+ * ones read_ensemble_metadata recorded in args.skipped_features
+ */
+void write_binary_ensemble_header(FILE *fh, DT_Ensemble ensemble, Args_Opts args) {
+    int i;
+    int skip_offset = 0;
+    Binary_Trees_Header header;
+    int num_columns = ensemble.num_attributes + args.num_skipped_features;
+    int32_t *column_types = (int32_t *)malloc(num_columns * sizeof(int32_t));
+    
+    header.num_training_examples = ensemble.num_training_examples;
+    header.num_classes = ensemble.num_classes;
+    header.num_attributes = ensemble.num_attributes;
+    header.num_skipped_features = args.num_skipped_features;
+    header.num_trees = ensemble.num_trees;
+    header.flags = ensemble.boosting_betas != NULL ? BINARY_TREES_BOOSTED : 0;
+    for (i = 0; i < num_columns; i++) {
+        if (find_int(i+1, args.num_skipped_features, args.skipped_features)) {
+            skip_offset++;
+            column_types[i] = UNKNOWN;
+        } else {
+            column_types[i] = ensemble.attribute_types[i-skip_offset];
+        }
+    }
+    _write_header(fh, &header, ensemble.num_training_examples_per_class, column_types, ensemble.Missing,
+                  ensemble.missing_names);
+    free(column_types);
+}
+
+/*
+ * missing_names may be NULL, as may any of its entries, when the names of the missing values are unknown
+ */
+static void _write_header(FILE *fh, Binary_Trees_Header *header, int *examples_per_class,
+                          int32_t *column_types, union data_point_union *missing, char **missing_names) {
+    int i;
+    int num_columns = header->num_attributes + header->num_skipped_features;
+    int64_t size = sizeof(Binary_Trees_Header) +
+                   (header->num_classes + num_columns + header->num_attributes) * sizeof(int32_t);
+    
+    for (i = 0; i < header->num_attributes; i++)
+        size += (missing_names != NULL && missing_names[i] != NULL ? strlen(missing_names[i]) : 0) + 1;
+    
+    memcpy(header->magic, BINARY_TREES_MAGIC, 8);
+    header->byte_order = BINARY_TREES_BYTE_ORDER;
+    header->version = BINARY_TREES_VERSION;
+    header->header_size = _align8(size);
+    fwrite(header, sizeof(Binary_Trees_Header), 1, fh);
+    for (i = 0; i < header->num_classes; i++) {
+        int32_t count = examples_per_class[i];
+        fwrite(&count, sizeof(int32_t), 1, fh);
+    }
+    fwrite(column_types, sizeof(int32_t), num_columns, fh);
+    fwrite(missing, sizeof(union data_point_union), header->num_attributes, fh);
+    for (i = 0; i < header->num_attributes; i++) {
+        if (missing_names != NULL && missing_names[i] != NULL)
+            fputs(missing_names[i], fh);
+        fputc('\0', fh);
+    }
+    fwrite(padding, 1, header->header_size - size, fh);
+}
+
+/*
+ * Appends one tree block. Nodes are renumbered in pre-order
+ */
+void save_binary_tree(FILE *fh, DT_Node *tree, int tree_num, double beta, int num_classes) {
+    char strbuf[64];
+    int num_nodes = 0, num_leaves = 0, num_refs = 0;
+    Binary_Tree_Header header;
+    Binary_Tree_Writer w;
+    
+    _count_nodes(tree, 0, &num_nodes, &num_leaves, &num_refs);
+    memcpy(header.magic, "TREE", 4);
+    header.tree_num = tree_num;
+    sprintf(strbuf, "%g", beta);
+    header.beta = atof(strbuf);
+    header.num_nodes = num_nodes;
+    header.num_leaves = num_leaves;
+    header.num_branch_refs = num_refs;
+    header.reserved = 0;
+    int64_t size = sizeof(Binary_Tree_Header) + num_nodes * sizeof(Binary_Tree_Node) +
+                   num_refs * sizeof(int32_t) + num_leaves * num_classes * (sizeof(int32_t) + sizeof(float));
+    header.block_size = _align8(size);
+    
+    w.num_classes = num_classes;
+    w.next_node = w.next_leaf = w.next_ref = 0;
+    w.nodes = (Binary_Tree_Node *)calloc(num_nodes, sizeof(Binary_Tree_Node));
+    w.branches = (int32_t *)malloc(num_refs * sizeof(int32_t));
+    w.counts = (int32_t *)malloc(num_leaves * num_classes * sizeof(int32_t));
+    w.probs = (float *)malloc(num_leaves * num_classes * sizeof(float));
+    _flatten_node(tree, 0, &w);
+    
+    fwrite(&header, sizeof(Binary_Tree_Header), 1, fh);
+    fwrite(w.nodes, sizeof(Binary_Tree_Node), num_nodes, fh);
+    fwrite(w.branches, sizeof(int32_t), num_refs, fh);
+    fwrite(w.counts, sizeof(int32_t), num_leaves * num_classes, fh);
+    fwrite(w.probs, sizeof(float), num_leaves * num_classes, fh);
+    fwrite(padding, 1, header.block_size - size, fh);
+    free(w.nodes);
+    free(w.branches);
+    free(w.counts);
+    free(w.probs);
+}
+
+/*
+ * The binary version of save_ensemble. The file is written under a temporary name and renamed
+ * into place so that an ensemble mapped from the old file stays valid
+ */
+void save_binary_ensemble(DT_Ensemble ensemble, CV_Metadata data, int fold_num, Args_Opts args, int num_classes) {
+    int i;
+    FILE *tree_file;
+    char *tree_filename = build_output_filename(fold_num, args.trees_file, args);
+    char *tmp_filename = (char *)malloc((strlen(tree_filename) + 5) * sizeof(char));
+    sprintf(tmp_filename, "%s.tmp", tree_filename);
+    if ((tree_file = fopen(tmp_filename, "w")) == NULL) {
+        fprintf(stderr, "Failed to open file for saving trees: '%s'\nExiting ...\n", tmp_filename);
+        exit(8);
+    }
+    write_binary_trees_header(tree_file, ensemble.num_trees, data, args);
+    for (i = 0; i < ensemble.num_trees; i++)
+        save_binary_tree(tree_file, ensemble.Trees[i], i+1,
+                         args.do_boosting == TRUE ? ensemble.boosting_betas[i] : 0.0, num_classes);
+    fclose(tree_file);
+    if (rename(tmp_filename, tree_filename) < 0) {
+        fprintf(stderr, "Failed to rename '%s' to '%s'\nExiting ...\n", tmp_filename, tree_filename);
+        exit(8);
+    }
+    free(tmp_filename);
+    free(tree_filename);
+}
+
+static void _count_nodes(DT_Node *tree, int node, int *num_nodes, int *num_leaves, int *num_refs) {
+    int i;
+    (*num_nodes)++;
+    if (tree[node].branch_type == LEAF) {
+        (*num_leaves)++;
+        return;
+    }
+    *num_refs += tree[node].num_branches;
+    for (i = 0; i < tree[node].num_branches; i++)
+        _count_nodes(tree, tree[node].Node_Value.branch[i], num_nodes, num_leaves, num_refs);
+}
+
+/*
+ * Mirrors _save_node followed by _read_tree: a child is numbered just before it is visited
+ */
+static void _flatten_node(DT_Node *tree, int node, Binary_Tree_Writer *w) {
+    int i;
+    char strbuf[64];
+    Binary_Tree_Node *out = &w->nodes[w->next_node++];
+    
+    out->branch_type = tree[node].branch_type;
+    if (tree[node].branch_type == LEAF) {
+        int32_t *counts = w->counts + w->next_leaf * w->num_classes;
+        float *probs = w->probs + w->next_leaf * w->num_classes;
+        float total = 0.0;
+        w->next_leaf++;
+        out->value = tree[node].Node_Value.class_label;
+        if (tree[node].class_count[0] == -1) {
+            for (i = 0; i < w->num_classes; i++) {
+                counts[i] = -1;
+                probs[i] = 0.0;
+            }
+            probs[out->value] = 1.0;
+        } else {
+            for (i = 0; i < w->num_classes; i++) {
+                counts[i] = tree[node].class_count[i];
+                total += counts[i];
+            }
+            for (i = 0; i < w->num_classes; i++)
+                probs[i] = (counts[i] + 1.0)/(w->num_classes + total);
+        }
+        return;
+    }
+    
+    out->attribute_type = tree[node].attribute_type;
+    out->attribute = tree[node].attribute;
+    out->num_branches = tree[node].num_branches;
+    if (tree[node].attribute_type == CONTINUOUS) {
+        sprintf(strbuf, "%#6g", tree[node].branch_threshold);
+        out->branch_threshold = atof(strbuf);
+    }
+    out->value = w->next_ref;
+    w->next_ref += tree[node].num_branches;
+    for (i = 0; i < tree[node].num_branches; i++) {
+        w->branches[out->value + i] = w->next_node;
+        _flatten_node(tree, tree[node].Node_Value.branch[i], w);
+    }
+}
+
+static void _read_header(FILE *fh, Binary_Trees_Header *header) {
+    if (fread(header, sizeof(Binary_Trees_Header), 1, fh) != 1 || memcmp(header->magic, BINARY_TREES_MAGIC, 8)) {
+        fprintf(stderr, "ERROR: Not a binary ensemble file\n");
+        exit(8);
+    }
+    if (header->byte_order != BINARY_TREES_BYTE_ORDER) {
+        fprintf(stderr, "ERROR: Binary ensemble file was written on a machine with a different byte order\n");
+        exit(8);
+    }
+    if (header->version != BINARY_TREES_VERSION) {
+        fprintf(stderr, "ERROR: Binary ensemble file is version %d but only version %d is supported\n",
+                        header->version, BINARY_TREES_VERSION);
+        exit(8);
+    }
+}
+
+/*
+ * Fills in the same fields as read_ensemble_metadata and leaves fh at the first tree block
+ */
+void read_binary_ensemble_metadata(FILE *fh, DT_Ensemble *ensemble, int force_num_trees, Args_Opts *args) {
+    int i;
+    int skip_offset = 0;
+    long start = ftell(fh);
+    Binary_Trees_Header header;
+    
+    _read_header(fh, &header);
+    int num_columns = header.num_attributes + header.num_skipped_features;
+    int32_t *column_types = (int32_t *)malloc(num_columns * sizeof(int32_t));
+    
+    if (ensemble->missing_names != NULL) {
+        for (i = 0; i < ensemble->num_attributes; i++)
+            free(ensemble->missing_names[i]);
+        free(ensemble->missing_names);
+        ensemble->missing_names = NULL;
+    }
+    ensemble->num_training_examples = header.num_training_examples;
+    ensemble->num_classes = header.num_classes;
+    ensemble->num_attributes = header.num_attributes;
+    free(ensemble->num_training_examples_per_class);
+    ensemble->num_training_examples_per_class = (int *)malloc(ensemble->num_classes * sizeof(int));
+    fread(ensemble->num_training_examples_per_class, sizeof(int32_t), ensemble->num_classes, fh);
+    
+    args->num_skipped_features = header.num_skipped_features;
+    free(args->skipped_features);
+    args->skipped_features = (int *)malloc(args->num_skipped_features * sizeof(int));
+    free(ensemble->attribute_types);
+    ensemble->attribute_types = (Attribute_Type *)malloc(ensemble->num_attributes * sizeof(Attribute_Type));
+    fread(column_types, sizeof(int32_t), num_columns, fh);
+    for (i = 0; i < num_columns; i++) {
+        if (column_types[i] == UNKNOWN)
+            args->skipped_features[skip_offset++] = i+1;
+        else
+            ensemble->attribute_types[i-skip_offset] = column_types[i];
+    }
+    free(column_types);
+    free(ensemble->Missing);
+    ensemble->Missing = (union data_point_union *)malloc(ensemble->num_attributes * sizeof(union data_point_union));
+    fread(ensemble->Missing, sizeof(union data_point_union), ensemble->num_attributes, fh);
+    // The names let resolve_missing_values check the indexes against a names file and let the text
+    // format be written back out
+    ensemble->missing_names = (char **)calloc(ensemble->num_attributes, sizeof(char *));
+    for (i = 0; i < ensemble->num_attributes; i++) {
+        int c, len = 0;
+        char strbuf[1024];
+        while ((c = fgetc(fh)) != EOF && c != '\0')
+            if (len < (int)sizeof(strbuf) - 1)
+                strbuf[len++] = c;
+        strbuf[len] = '\0';
+        if (len > 0 && ensemble->attribute_types[i] == DISCRETE)
+            ensemble->missing_names[i] = av_strdup(strbuf);
+    }
+    
+    ensemble->num_trees = header.num_trees;
+    // If force_num_trees > 0, then don't trust the number in the file
+    if (force_num_trees > 0)
+        ensemble->num_trees = force_num_trees;
+    args->num_trees = ensemble->num_trees;
+    free(ensemble->Trees);
+    ensemble->Trees = (DT_Node **)calloc(ensemble->num_trees, sizeof(DT_Node *));
+    free(ensemble->Books);
+    ensemble->Books = (Tree_Bookkeeping *)calloc(ensemble->num_trees, sizeof(Tree_Bookkeeping));
+    if (header.flags & BINARY_TREES_BOOSTED)
+        args->do_boosting = TRUE;
+    
+    fseek(fh, start + header.header_size, SEEK_SET);
+}
+
+/*
+ * Reads the metadata and maps the tree blocks. Each tree gets its own array of DT_Nodes but the
+ * branch lists, class counts and class probabilities point into the mapped file
+ */
+void read_binary_ensemble(FILE *fh, DT_Ensemble *ensemble, int force_num_trees, Args_Opts *args) {
+    int i;
+    struct stat sb;
+    char *base;
+    int64_t offset;
+    int num_classes;
+    
+    read_binary_ensemble_metadata(fh, ensemble, force_num_trees, args);
+    num_classes = ensemble->num_classes;
+    offset = ftell(fh);
+    
+    if (fstat(fileno(fh), &sb) < 0) {
+        fprintf(stderr, "ERROR: Failed to stat binary ensemble file\n");
+        exit(8);
+    }
+    // Copy-on-write so the pages are shared with every other process reading the same file
+    base = (char *)mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(fh), 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "ERROR: Failed to map binary ensemble file\n");
+        exit(8);
+    }
+    ensemble->mapped_trees = base;
+    ensemble->mapped_size = sb.st_size;
+    if (((Binary_Trees_Header *)base)->flags & BINARY_TREES_BOOSTED)
+        ensemble->boosting_betas = (double *)malloc(ensemble->num_trees * sizeof(double));
+    
+    for (i = 0; i < ensemble->num_trees; i++) {
+        Binary_Tree_Header *header = (Binary_Tree_Header *)(base + offset);
+        if (offset + (int64_t)sizeof(Binary_Tree_Header) > (int64_t)ensemble->mapped_size) {
+            fprintf(stderr, "WARNING: Expected %d trees but the ensemble file only has %d\n", ensemble->num_trees, i);
+            ensemble->num_trees = args->num_trees = i;
+            break;
+        }
+        if (memcmp(header->magic, "TREE", 4) || header->block_size <= 0 ||
+            offset + header->block_size > (int64_t)ensemble->mapped_size) {
+            fprintf(stderr, "ERROR: Binary ensemble file is corrupt at tree #%d\n", i+1);
+            exit(8);
+        }
+        if (header->tree_num != i+1)
+            fprintf(stderr, "Found tree #%d but expected tree #%d\n", header->tree_num, i+1);
+        if (ensemble->boosting_betas != NULL)
+            ensemble->boosting_betas[i] = header->beta;
+        
+        ensemble->Trees[i] = read_binary_tree(header, i+1, num_classes, &ensemble->Books[i]);
+        offset += header->block_size;
+    }
+}
+
+/*
+ * Builds the DT_Nodes for one tree block. The branch lists, class counts and class probabilities
+ * point into the block, which must stay in memory as long as the tree does
+ */
+DT_Node *read_binary_tree(Binary_Tree_Header *header, int tree_num, int num_classes, Tree_Bookkeeping *book) {
+    int j, leaf;
+    Binary_Tree_Node *nodes = (Binary_Tree_Node *)(header + 1);
+    int32_t *branches = (int32_t *)(nodes + header->num_nodes);
+    int32_t *counts = branches + header->num_branch_refs;
+    float *probs = (float *)(counts + header->num_leaves * num_classes);
+    DT_Node *tree = (DT_Node *)malloc(header->num_nodes * sizeof(DT_Node));
+    
+    leaf = 0;
+    for (j = 0; j < header->num_nodes; j++) {
+        reset_DT_Node(&tree[j]);
+        tree[j].branch_type = nodes[j].branch_type;
+        tree[j].num_branches = nodes[j].num_branches;
+        if (nodes[j].branch_type == LEAF) {
+            if (leaf >= header->num_leaves || nodes[j].value < 0 || nodes[j].value >= num_classes) {
+                fprintf(stderr, "ERROR: Binary ensemble file has a bad leaf in tree #%d\n", tree_num);
+                exit(8);
+            }
+            tree[j].Node_Value.class_label = nodes[j].value;
+            tree[j].class_count = counts + leaf * num_classes;
+            tree[j].class_probs = probs + leaf * num_classes;
+            leaf++;
+        } else {
+            tree[j].attribute_type = nodes[j].attribute_type;
+            tree[j].attribute = nodes[j].attribute;
+            tree[j].branch_threshold = nodes[j].branch_threshold;
+            if (nodes[j].value < 0 || nodes[j].num_branches < 1 ||
+                nodes[j].value + nodes[j].num_branches > header->num_branch_refs) {
+                fprintf(stderr, "ERROR: Binary ensemble file has a bad split in tree #%d\n", tree_num);
+                exit(8);
+            }
+            tree[j].Node_Value.branch = branches + nodes[j].value;
+        }
+    }
+    book->num_malloced_nodes = header->num_nodes;
+    book->next_unused_node = header->num_nodes;
+    book->current_node = header->num_nodes - 1;
+    return tree;
+}
+
+/*
+ * The binary equivalent of check_tree_version: TRUE if the first leaf of the first tree has class counts
+ */
+Boolean binary_trees_have_proportions(FILE *fh) {
+    Binary_Trees_Header header;
+    Binary_Tree_Header tree_header;
+    int32_t count;
+    
+    _read_header(fh, &header);
+    fseek(fh, header.header_size, SEEK_SET);
+    if (fread(&tree_header, sizeof(Binary_Tree_Header), 1, fh) != 1)
+        return FALSE;
+    // Leaf counts are in node order so the first leaf's counts come first
+    fseek(fh, header.header_size + sizeof(Binary_Tree_Header) + tree_header.num_nodes * sizeof(Binary_Tree_Node) +
+              tree_header.num_branch_refs * sizeof(int32_t), SEEK_SET);
+    if (fread(&count, sizeof(int32_t), 1, fh) != 1)
+        return FALSE;
+    return count == -1 ? FALSE : TRUE;
+}
+
+/*
+ * The class counts, probabilities and branch lists of a mapped ensemble belong to the mapping
+ */
+void free_binary_ensemble(DT_Ensemble ensemble) {
+    int i;
+    for (i = 0; i < ensemble.num_trees; i++)
+        free(ensemble.Trees[i]);
+    munmap(ensemble.mapped_trees, ensemble.mapped_size);
+}
+
+static int64_t _align8(int64_t size) {
+    return (size + 7) & ~(int64_t)7;
+}
@@ -0,0 +1,107 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#ifndef __BINARY_TREES__
+#define __BINARY_TREES__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Binary ensemble files.
+ *
+ * A binary .trees file holds the same information as the text format but laid out so that it can
+ * be mmap'd and used in place. The file header is followed by the examples per class, the type of
+ * every column (UNKNOWN for skipped columns), the missing value of every attribute (the index of
+ * the value for a discrete attribute), and the name of every attribute's missing value as the text
+ * format writes it (empty for continuous attributes), each ending with a NUL. Each tree
+ * is then one block: a block header, the nodes in the pre-order that _read_tree would assign, the
+ * child node numbers of every split, and the class counts and probabilities of every leaf in node
+ * order. Thresholds, betas and missing values are rounded exactly as a text round trip would round
+ * them so an ensemble loaded from either format is the same.
+ *
+ * All values are in the byte order of the machine that wrote the file.
+ */
+
+#define BINARY_TREES_MAGIC "AVBTREES"
+#define BINARY_TREES_BYTE_ORDER 0x01020304
+#define BINARY_TREES_VERSION 2
+#define BINARY_TREES_BOOSTED 0x1
+
+typedef struct binary_trees_header_struct {
+    char magic[8];
+    int32_t byte_order;
+    int32_t version;
+    int32_t num_training_examples;
+    int32_t num_classes;
+    int32_t num_attributes;
+    int32_t num_skipped_features;
+    int32_t num_trees;
+    int32_t flags;
+    int64_t header_size;            // Offset of the first tree block
+} Binary_Trees_Header;
+
+typedef struct binary_tree_header_struct {
+    char magic[4];                  // "TREE"
+    int32_t tree_num;
+    double beta;
+    int32_t num_nodes;
+    int32_t num_leaves;
+    int32_t num_branch_refs;
+    int32_t reserved;
+    int64_t block_size;             // Offset of the next tree block from the start of this one
+} Binary_Tree_Header;
+
+typedef struct binary_tree_node_struct {
+    int32_t branch_type;
+    int32_t attribute_type;
+    int32_t attribute;
+    float branch_threshold;
+    int32_t num_branches;
+    int32_t value;                  // Class label of a LEAF or index of a split's first child
+} Binary_Tree_Node;
+
+Boolean is_binary_trees_file(FILE *fh);
+void write_binary_trees_header(FILE *fh, int num_trees, CV_Metadata meta, Args_Opts args);
+void write_binary_ensemble_header(FILE *fh, DT_Ensemble ensemble, Args_Opts args);
+void save_binary_ensemble(DT_Ensemble ensemble, CV_Metadata data, int fold_num, Args_Opts args, int num_classes);
+void save_binary_tree(FILE *fh, DT_Node *tree, int tree_num, double beta, int num_classes);
+void read_binary_ensemble_metadata(FILE *fh, DT_Ensemble *ensemble, int force_num_trees, Args_Opts *args);
+void read_binary_ensemble(FILE *fh, DT_Ensemble *ensemble, int force_num_trees, Args_Opts *args);
+DT_Node *read_binary_tree(Binary_Tree_Header *header, int tree_num, int num_classes, Tree_Bookkeeping *book);
+Boolean binary_trees_have_proportions(FILE *fh);
+void free_binary_ensemble(DT_Ensemble ensemble);
+
+#endif // __BINARY_TREES__
@@ -0,0 +1,269 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "crossval.h"
+#include "tree.h"
+#include "bagging.h"
+#include "av_rng.h"
+#include "checkpoint.h"
+
+static char *_checkpoint_filename(int fold_num, Args_Opts args);
+static void _sync(FILE *fh, char *filename);
+static void _read_or_die(void *ptr, size_t size, size_t num, FILE *fh, char *filename);
+
+/*
+ * Records the state of a training run after its last streamed tree. The checkpoint is written to a
+ * temporary file and renamed into place so an interruption leaves the previous one intact.
+ */
+void write_checkpoint(Tree_Stream *stream, Vote_Cache *cache, CV_Subset *data, int fold_num, Args_Opts args) {
+    int i;
+    char *filename, *tmp_filename;
+    FILE *fh;
+    Checkpoint_Header header;
+    unsigned short rand48_state[3];
+    char random_state[AV_RANDOM_STATE_SIZE];
+    int64_t tree_end;
+    
+    // The checkpoint must not get ahead of the trees it says are in the file
+    _sync(stream->fh, stream->body_filename != NULL ? stream->body_filename : stream->tmp_filename);
+    
+    memset(&header, 0, sizeof(Checkpoint_Header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, 8);
+    header.version = CHECKPOINT_VERSION;
+    if (args.do_bagging == TRUE)
+        header.flags |= CHECKPOINT_BAGGING;
+    if (args.do_boosting == TRUE)
+        header.flags |= CHECKPOINT_BOOSTING;
+    if (args.auto_stop == TRUE)
+        header.flags |= CHECKPOINT_AUTO_STOP;
+    if (args.binary_trees == TRUE)
+        header.flags |= CHECKPOINT_BINARY_TREES;
+    if (args.output_verbose_oob == TRUE)
+        header.flags |= CHECKPOINT_VERBOSE_OOB;
+    if (get_bag_rng_state(&header.bag_rng_state) == TRUE)
+        header.flags |= CHECKPOINT_BAG_RNG;
+    header.num_trees = stream->num_trees;
+    header.num_trees_requested = args.num_trees;
+    header.num_examples = data->meta.num_examples;
+    header.num_classes = data->meta.num_classes;
+    header.num_attributes = data->meta.num_attributes;
+    header.random_seed = args.random_seed;
+    if (args.output_verbose_oob == TRUE) {
+        struct stat sb;
+        char *oob_filename = build_output_filename(fold_num, args.oob_file, args);
+        if (stat(oob_filename, &sb) == 0)
+            header.oob_file_size = sb.st_size;
+        free(oob_filename);
+    }
+    
+    filename = _checkpoint_filename(fold_num, args);
+    tmp_filename = (char *)malloc((strlen(filename) + 5) * sizeof(char));
+    sprintf(tmp_filename, "%s.tmp", filename);
+    if ((fh = fopen(tmp_filename, "w")) == NULL) {
+        fprintf(stderr, "Failed to open file for saving checkpoint: '%s'\nExiting ...\n", tmp_filename);
+        exit(8);
+    }
+    
+    fwrite(&header, sizeof(Checkpoint_Header), 1, fh);
+    av_get_rand48_state(rand48_state);
+    fwrite(rand48_state, sizeof(unsigned short), 3, fh);
+    av_get_random_state(random_state);
+    fwrite(random_state, 1, AV_RANDOM_STATE_SIZE, fh);
+    for (i = 0; i < stream->num_trees; i++) {
+        tree_end = stream->tree_ends[i];
+        fwrite(&tree_end, sizeof(int64_t), 1, fh);
+    }
+    
+    if (args.do_bagging == TRUE) {
+        fwrite(&cache->oob_error, sizeof(double), 1, fh);
+        fwrite(&cache->average_train_accuracy, sizeof(float), 1, fh);
+        fwrite(cache->best_train_class, sizeof(int), cache->num_train_examples, fh);
+        for (i = 0; i < cache->num_train_examples; i++) {
+            fwrite(cache->oob_class_votes[i], sizeof(int), cache->num_classes, fh);
+            fwrite(cache->oob_class_weighted_votes[i], sizeof(float), cache->num_classes, fh);
+        }
+        write_stopping_history(fh, 0, args);
+    }
+    if (args.do_boosting == TRUE)
+        fwrite(data->weights, sizeof(double), data->meta.num_examples, fh);
+    
+    _sync(fh, tmp_filename);
+    if (fclose(fh) != 0) {
+        fprintf(stderr, "Failed to write checkpoint to '%s'\nExiting ...\n", tmp_filename);
+        exit(8);
+    }
+    if (rename(tmp_filename, filename) < 0) {
+        fprintf(stderr, "Failed to rename '%s' to '%s'\nExiting ...\n", tmp_filename, filename);
+        exit(8);
+    }
+    free(tmp_filename);
+    free(filename);
+}
+
+/*
+ * Puts a training run back the way write_checkpoint found it and reopens its stream. cache and the
+ * boosting weights in data must already be allocated.
+ * Returns the number of trees already built, or 0 if there is no checkpoint to resume from.
+ */
+int read_checkpoint(Tree_Stream *stream, Vote_Cache *cache, CV_Subset *data, int fold_num, Args_Opts args) {
+    int i;
+    char *filename;
+    FILE *fh;
+    Checkpoint_Header header;
+    int flags = 0;
+    unsigned short rand48_state[3];
+    char random_state[AV_RANDOM_STATE_SIZE];
+    int64_t tree_end;
+    long *tree_ends;
+    
+    filename = _checkpoint_filename(fold_num, args);
+    if ((fh = fopen(filename, "r")) == NULL) {
+        fprintf(stderr, "WARNING: No checkpoint in '%s'. Starting from the first tree\n", filename);
+        free(filename);
+        return 0;
+    }
+    
+    if (fread(&header, sizeof(Checkpoint_Header), 1, fh) != 1 || memcmp(header.magic, CHECKPOINT_MAGIC, 8) ||
+        header.version != CHECKPOINT_VERSION) {
+        fprintf(stderr, "'%s' is not an avatar checkpoint\nExiting ...\n", filename);
+        exit(8);
+    }
+    if (args.do_bagging == TRUE)
+        flags |= CHECKPOINT_BAGGING;
+    if (args.do_boosting == TRUE)
+        flags |= CHECKPOINT_BOOSTING;
+    if (args.auto_stop == TRUE)
+        flags |= CHECKPOINT_AUTO_STOP;
+    if (args.binary_trees == TRUE)
+        flags |= CHECKPOINT_BINARY_TREES;
+    if (args.output_verbose_oob == TRUE)
+        flags |= CHECKPOINT_VERBOSE_OOB;
+    if ((header.flags & ~CHECKPOINT_BAG_RNG) != flags || header.num_trees_requested != args.num_trees ||
+        header.num_examples != data->meta.num_examples || header.num_classes != data->meta.num_classes ||
+        header.num_attributes != data->meta.num_attributes || header.random_seed != args.random_seed) {
+        fprintf(stderr, "The checkpoint in '%s' was written with different data or options\nExiting ...\n", filename);
+        exit(8);
+    }
+    if (header.num_trees <= 0) {
+        fclose(fh);
+        free(filename);
+        return 0;
+    }
+    
+    _read_or_die(rand48_state, sizeof(unsigned short), 3, fh, filename);
+    _read_or_die(random_state, 1, AV_RANDOM_STATE_SIZE, fh, filename);
+    tree_ends = (long *)malloc(header.num_trees * sizeof(long));
+    for (i = 0; i < header.num_trees; i++) {
+        _read_or_die(&tree_end, sizeof(int64_t), 1, fh, filename);
+        tree_ends[i] = (long)tree_end;
+    }
+    if (resume_tree_stream(stream, args.auto_stop == TRUE ? 0 : args.num_trees, header.num_trees, tree_ends,
+                           data->meta, fold_num, args) == FALSE) {
+        fprintf(stderr, "WARNING: The trees saved with the checkpoint in '%s' are missing. Starting from the first tree\n",
+                        filename);
+        free(tree_ends);
+        fclose(fh);
+        free(filename);
+        return 0;
+    }
+    free(tree_ends);
+    
+    if (args.do_bagging == TRUE) {
+        _read_or_die(&cache->oob_error, sizeof(double), 1, fh, filename);
+        _read_or_die(&cache->average_train_accuracy, sizeof(float), 1, fh, filename);
+        _read_or_die(cache->best_train_class, sizeof(int), cache->num_train_examples, fh, filename);
+        for (i = 0; i < cache->num_train_examples; i++) {
+            _read_or_die(cache->oob_class_votes[i], sizeof(int), cache->num_classes, fh, filename);
+            _read_or_die(cache->oob_class_weighted_votes[i], sizeof(float), cache->num_classes, fh, filename);
+        }
+        if (read_stopping_history(fh, 0, args) == FALSE) {
+            fprintf(stderr, "The checkpoint in '%s' is truncated\nExiting ...\n", filename);
+            exit(8);
+        }
+    }
+    if (args.do_boosting == TRUE)
+        _read_or_die(data->weights, sizeof(double), data->meta.num_examples, fh, filename);
+    fclose(fh);
+    
+    av_set_rand48_state(rand48_state);
+    av_set_random_state(random_state);
+    set_bag_rng_state((header.flags & CHECKPOINT_BAG_RNG) ? TRUE : FALSE, header.bag_rng_state);
+    
+    // Drop any --verbose-oob lines for trees after the checkpoint
+    if (args.output_verbose_oob == TRUE) {
+        char *oob_filename = build_output_filename(fold_num, args.oob_file, args);
+        if (truncate(oob_filename, header.oob_file_size) != 0) {
+            fprintf(stderr, "Failed to truncate '%s'\nExiting ...\n", oob_filename);
+            exit(8);
+        }
+        free(oob_filename);
+    }
+    
+    free(filename);
+    return header.num_trees;
+}
+
+void remove_checkpoint(int fold_num, Args_Opts args) {
+    char *filename = _checkpoint_filename(fold_num, args);
+    remove(filename);
+    free(filename);
+}
+
+static char *_checkpoint_filename(int fold_num, Args_Opts args) {
+    char *trees_filename = build_output_filename(fold_num, args.trees_file, args);
+    char *filename = (char *)malloc((strlen(trees_filename) + 12) * sizeof(char));
+    sprintf(filename, "%s.checkpoint", trees_filename);
+    free(trees_filename);
+    return filename;
+}
+
+static void _sync(FILE *fh, char *filename) {
+    if (fflush(fh) != 0 || fsync(fileno(fh)) != 0) {
+        fprintf(stderr, "Failed to write '%s'\nExiting ...\n", filename);
+        exit(8);
+    }
+}
+
+static void _read_or_die(void *ptr, size_t size, size_t num, FILE *fh, char *filename) {
+    if (fread(ptr, size, num, fh) != num) {
+        fprintf(stderr, "The checkpoint in '%s' is truncated\nExiting ...\n", filename);
+        exit(8);
+    }
+}
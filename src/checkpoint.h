@@ -0,0 +1,85 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#ifndef __CHECKPOINT__
+#define __CHECKPOINT__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "crossval.h"
+#include "tree.h"
+
+/*
+ * Checkpoints for long training runs.
+ *
+ * A checkpoint sits next to the streamed ensemble file and records what train() needs to carry on
+ * after the last tree it covers as though it had never stopped: how far the streamed file had got,
+ * the state of every random number generator used while training, and the OOB votes, stopping
+ * algorithm history and boosting weights that the next tree depends on. The trees themselves are
+ * not copied; they are already in the partially written ensemble file.
+ *
+ * Checkpoints are only meaningful on the machine, and with the data and options, that wrote them.
+ */
+
+#define CHECKPOINT_MAGIC "AVCHKPNT"
+#define CHECKPOINT_VERSION 1
+
+#define CHECKPOINT_BAGGING      0x01
+#define CHECKPOINT_BOOSTING     0x02
+#define CHECKPOINT_AUTO_STOP    0x04
+#define CHECKPOINT_BINARY_TREES 0x08
+#define CHECKPOINT_VERBOSE_OOB  0x10
+#define CHECKPOINT_BAG_RNG      0x20   // make_bag had seeded its RNG
+
+typedef struct checkpoint_header_struct {
+    char magic[8];
+    int32_t version;
+    int32_t flags;
+    int32_t num_trees;              // Trees built so far
+    int32_t num_trees_requested;    // args.num_trees when the run started
+    int32_t num_examples;
+    int32_t num_classes;
+    int32_t num_attributes;
+    int32_t random_seed;
+    int32_t bag_rng_state;
+    int32_t reserved;
+    int64_t oob_file_size;          // Length of the --verbose-oob file
+} Checkpoint_Header;
+
+void write_checkpoint(Tree_Stream *stream, Vote_Cache *cache, CV_Subset *data, int fold_num, Args_Opts args);
+int read_checkpoint(Tree_Stream *stream, Vote_Cache *cache, CV_Subset *data, int fold_num, Args_Opts args);
+void remove_checkpoint(int fold_num, Args_Opts args);
+
+#endif // __CHECKPOINT__
@@ -168,6 +168,7 @@ int main (int argc, char **argv) {
     
     int iteration = 0;
     int fold;
+    CV_Overall_Confusion Overall_Confusion = {0};
     
     while (iteration < (Args.do_5x2_cv?5:1)) {
         
@@ -251,13 +252,13 @@ int main (int argc, char **argv) {
             if (Args.do_ivote) {
                 Vote_Cache Cache;
                 train_ivote(Trainset, Testset, fold + iteration*Args.num_folds, &Cache, Args);
-                test_ivote(Testset, Cache, pred_prob, fold + iteration*Args.num_folds, Args);
+                test_ivote(Testset, Cache, pred_prob, fold + iteration*Args.num_folds, Args, &Overall_Confusion);
                 free_Vote_Cache(Cache, Args);
             } else {
                 DT_Ensemble Ensemble[1];
                 reset_DT_Ensemble(Ensemble);
                 train(&Trainset, &Ensemble[0], fold + iteration*Args.num_folds, Args);
-                if (Args.save_trees) {
+                if (Args.save_trees && ! Args.stream_trees) {
                     write_tree_file_header(Ensemble[0].num_trees, Trainset.meta, fold + iteration*Args.num_folds,
                                            Args.trees_file, Args);
                     for (j = 0; j < Ensemble[0].num_trees; j++)
@@ -265,7 +266,7 @@ int main (int argc, char **argv) {
                     //save_ensemble(Ensemble[0], Trainset, fold, Args);
                 }
                 // Test
-                test(Testset, 1, Ensemble, pred_prob, fold + iteration*Args.num_folds, Args);
+                test(Testset, 1, Ensemble, pred_prob, fold + iteration*Args.num_folds, Args, &Overall_Confusion);
                 free_DT_Ensemble(Ensemble[0], TRAIN_MODE);
             }
             
@@ -357,15 +358,18 @@ void make_train_test_subsets(CV_Subset full, int fold_pop, int fold_num, CV_Subs
                         train_subset->high[k] = full.high[k];
                 }
             }
-            rc = av_addBlobToSortedBlobArray(blob, &train_subset->examples[train_subset->meta.num_examples], cv_example_compare_by_seq_id);
-            if (rc < 0) {
+            rc = av_appendBlobToSortedBlobArray(blob, &train_subset->examples[train_subset->meta.num_examples]);
+            if (rc < 0)
                 av_exitIfErrorPrintf(rc, "Failed to add training example %d to SBA\n", train_subset->meta.num_examples);
-            } else if (rc == 0) {
-                fprintf(stderr, "Example %d already exists in SBA\n", train_subset->meta.num_examples);
-            }
             train_subset->meta.num_examples++;
         }
     }
+    rc = av_sortSortedBlobArray(blob, cv_example_compare_by_seq_id);
+    if (rc < 0) {
+        av_exitIfErrorPrintf(rc, "Failed to sort the training examples in the SBA\n");
+    } else if (rc > 0) {
+        fprintf(stderr, "%d examples already existed in SBA\n", rc);
+    }
 }
 
 //Modified by DACIESL June-02-08: HDDT CAPABILITY
@@ -411,6 +415,13 @@ void display_usage( void ) {
     printf("                       They are applied left to right.\n");
     printf("    --truth-column=S : Location of the truth column. S = first or last\n");
     printf("                       Default = last\n");
+    printf("    --threads=N      : Use N threads to read the data and ensemble files\n");
+    printf("                       Default = one per processor\n");
+    printf("    --data-cache     : Save the parsed data next to the data file as FILE.avbin\n");
+    printf("                       and load it instead of the text on later runs\n");
+    printf("    --out-of-core[=DIR] : Keep the training data and tree-building partitions in\n");
+    printf("                       scratch files in DIR so they need not fit in memory\n");
+    printf("                       Default DIR = the data file's directory\n");
     printf("\n");
     printf("fold-generation options:\n");
     printf("        --no-rigorous-strat      : Do not use rigorous class stratification across folds.\n");
@@ -446,6 +457,8 @@ void display_usage( void ) {
     printf("        --save-trees             : Write trees to disk\n");
     printf("                                   On by default.\n");
     printf("        --no-save-trees          : Do not write trees to disk\n");
+    printf("        --binary-trees           : Write trees in the binary ensemble format\n");
+    printf("        --stream-trees           : Write each tree as soon as it is built\n");
     printf("\n");
     printf("ensemble options:\n");
     printf("    -B, --bagging=N           : Bagging with N%% of training set examples\n");
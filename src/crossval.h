@@ -64,7 +64,8 @@ typedef enum {
     AVATARMPI_CALLER,
     RFFEATUREVALUE_CALLER,
     DIVERSITY_CALLER,
-    PROXIMITY_CALLER
+    PROXIMITY_CALLER,
+    PRUNE_CALLER
 } Caller;
 
 typedef enum {
@@ -105,6 +106,12 @@ typedef enum {
     ABSOLUTE_DEVIATION
 } Deviation_Type;
 
+// Backend used to evaluate an ensemble on test data
+typedef enum {
+    LOCKSTEP_ENGINE,     // Blocks of examples walk each tree together (the default)
+    QUICKSCORER_ENGINE   // Bitvector evaluation of all trees at once
+} Scoring_Engine;
+
 typedef struct tree_bookkeeping_struct {
     int num_malloced_nodes;
     int next_unused_node;
@@ -118,6 +125,17 @@ typedef struct bst_node_struct {
     float value;
 } BST_Node;
 
+// Scratch state for collecting the distinct values of each attribute while a dataset is read
+typedef struct att_handling_struct {
+    float **values;         // Values seen for each attribute, sorted and made unique whenever they fill up
+    int *num_values;
+    int *num_malloced;
+    float *first_zero;      // The first of 0 and -0 seen for each attribute stands for both, as in tree_insert
+    Boolean *seen_zero;
+    int *high;
+    int *low;
+} Att_Handling;
+
 typedef struct class_metadata_struct {
     char *class_var_name;
     int num_classes;
@@ -160,6 +178,14 @@ typedef struct exodus_data_struct {
                              // seq_variables[fclib_seq][att_num]
 } Exo_Data;
 
+// Open-addressed hash of the labels in a discrete_attribute_map entry or class_names
+typedef struct discrete_index_struct {
+    char **labels;          // The labels that were indexed (not owned)
+    int num_labels;
+    int num_slots;          // A power of two at least twice num_labels
+    int *slots;             // Label index + 1 for each used slot, 0 for an empty slot
+} Discrete_Index;
+
 typedef struct crossval_metadata_struct {
     int num_classes;
     int num_attributes;
@@ -169,6 +195,8 @@ typedef struct crossval_metadata_struct {
     int *num_discrete_values;
     char ***discrete_attribute_map; // dam[i][j] gives the attribute label for the jth value of the ith attribute
     char **class_names; // Array holding the names of the classes
+    Discrete_Index **discrete_index; // Speeds up translate_discrete for each attribute's labels
+    Discrete_Index *class_index;     // Speeds up translate_discrete for class_names
     int *num_examples_per_class; // Array holding how many examples are in each class.
     Attribute_Type *attribute_types;
     int *global_offset;     // Global offset for start of each fclib sequence
@@ -226,7 +254,11 @@ typedef struct dt_ensemble_struct {
     int *num_training_examples_per_class;
     Attribute_Type *attribute_types;
     float *weights;
-    union data_point_union *Missing;
+    union data_point_union *Missing; // The index of the value for a discrete attribute
+    char **missing_names;   // Name of each discrete attribute's missing value in the ensemble file, if known
+    void *mapped_trees;     // Binary ensemble file the trees point into, if any
+    size_t mapped_size;
+    void *lazy_trees;       // Lazy_Ensemble that loads the trees on first use, if any
 } DT_Ensemble;
 
 typedef struct crossval_matrix_struct {
@@ -263,6 +295,16 @@ typedef struct crossval_voting_struct {
 
 //Modified by DACIESL June-11-08: Laplacean Estimates
 //added float ** class_weighted_votes_test
+// Confusion matrix totals accumulated over the folds that test() and test_ivote() see
+typedef struct overall_confusion_struct {
+    int **confusion;
+    int **confusion_5x2;
+    int diagonal_sum;
+    int total_sum;
+    int overall_diagonal_sum;
+    int overall_total_sum;
+} CV_Overall_Confusion;
+
 //weighted voting (laplace estimates)
 typedef struct voting_cache_struct {
     int num_classifiers;
@@ -337,6 +379,11 @@ typedef struct args_and_opts_struct {
     int minimum_examples;
     Split_Method split_method;
     Boolean save_trees;
+    Boolean binary_trees;
+    Boolean stream_trees;
+    int checkpoint_interval;        // Trees between checkpoints. 0 writes none
+    Boolean resume;
+    int add_trees;                  // Trees to add to an existing ensemble
     int random_forests;
     int extr_random_trees;
     int totl_random_trees;
@@ -382,6 +429,9 @@ typedef struct args_and_opts_struct {
     // diversity options
     Boolean kappa_plot_data;
     
+    // prune_trees options
+    float prune_tolerance;          // Accuracy, in percent, the pruned ensemble may give up
+    
     // deviation type for standardizing outlier metric in proximity
     Deviation_Type deviation_type;
     int sort_line_num;
@@ -406,6 +456,7 @@ typedef struct args_and_opts_struct {
     char *oob_file;
     char *prox_sorted_file;
     char *prox_matrix_file;
+    char *pruned_trees_file;
     
     // Output option
     Tristate output_accuracies;
@@ -424,6 +475,14 @@ typedef struct args_and_opts_struct {
     Boolean do_margin_ensemble_majority_vote;
     Boolean do_probabilistic_majority_vote;
     Boolean do_scaled_probabilistic_majority_vote;
+    Boolean early_exit_voting;
+    Scoring_Engine scoring_engine;
+    int max_tree_memory;            // In MB. 0 loads every tree before testing
+    int num_threads;                // Threads for reading data and ensemble files. 0 uses every processor
+    Boolean data_cache;             // Load and save .avbin caches of the data and test files
+    Boolean out_of_core;            // Keep the training data, bags and node partitions in scratch files
+    char *scratch_dir;              // Directory for the scratch files. NULL uses the data's directory
+    int test_batch_size;            // Read, score and write the test data this many examples at a time. 0 reads it all
 
     // Unpublished options
     Boolean debug;
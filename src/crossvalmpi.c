@@ -174,6 +174,7 @@ int main (int argc, char **argv) {
     
     int iteration = 0;
     int fold;
+    CV_Overall_Confusion Overall_Confusion = {0};
     while (iteration < (Args.do_5x2_cv?5:1)) {
         
         if (myrank == 0) {
@@ -198,7 +199,7 @@ int main (int argc, char **argv) {
             if (Args.do_ivote) {
                 Vote_Cache Cache;
                 train_ivote(Trainset, Testset, fold, &Cache, Args);
-                test_ivote(Testset, Cache, pred_prob, fold + iteration*Args.num_folds, Args);
+                test_ivote(Testset, Cache, pred_prob, fold + iteration*Args.num_folds, Args, &Overall_Confusion);
                 
                 free_Vote_Cache(Cache, Args);
             } else {
@@ -212,7 +213,7 @@ int main (int argc, char **argv) {
                     //save_ensemble(Ensemble[0], Trainset, fold, Args);
                 }
                 // Test
-                test(Testset, 1, Ensemble, pred_prob, fold + iteration*Args.num_folds, Args);
+                test(Testset, 1, Ensemble, pred_prob, fold + iteration*Args.num_folds, Args, &Overall_Confusion);
                 
                 free_DT_Ensemble(Ensemble[0], TRAIN_MODE);
             }
@@ -359,6 +360,7 @@ void display_usage( void ) {
     printf("        --save-trees             : Write trees to disk\n");
     printf("                                   On by default.\n");
     printf("        --no-save-trees          : Do not write trees to disk\n");
+    printf("        --binary-trees           : Write trees in the binary ensemble format\n");
     printf("\n");
     printf("ensemble options:\n");
     printf("    -B, --bagging=N          : Bagging with N%% of training set examples\n");
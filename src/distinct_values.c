@@ -36,6 +36,7 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include "crossval.h"
 #include "distinct_values.h"
 #include "util.h"
@@ -105,6 +106,59 @@ short tree_insert(BST_Node **tree, Tree_Bookkeeping *books, float new_value) {
     return 1;
 }
 
+/*
+ * Sorts values in place and removes the duplicates, returning the number of distinct values.
+ * This is an LSD radix sort on the bit patterns, one byte per pass, so it takes linear time
+ * whatever order the values arrive in. Each pattern is mapped to a key that sorts in numeric order.
+ * Values are duplicates only if their bit patterns match, so the values must not be NaN and 0 and -0
+ * are kept as two values.
+ */
+int sort_unique_floats(float *values, int num_values) {
+    int i, pass, num_unique;
+    int count[256];
+    uint32_t *keys, *scratch, *tmp;
+    
+    if (num_values < 2)
+        return num_values;
+    
+    keys = (uint32_t *)malloc(num_values * sizeof(uint32_t));
+    scratch = (uint32_t *)malloc(num_values * sizeof(uint32_t));
+    memcpy(keys, values, num_values * sizeof(uint32_t));
+    // Flip every bit of a negative value and just the sign bit of a positive one
+    for (i = 0; i < num_values; i++)
+        keys[i] ^= (keys[i] & 0x80000000) ? 0xFFFFFFFF : 0x80000000;
+    
+    for (pass = 0; pass < 32; pass += 8) {
+        memset(count, 0, 256 * sizeof(int));
+        for (i = 0; i < num_values; i++)
+            count[(keys[i] >> pass) & 0xFF]++;
+        // Skip a pass in which every key has the same byte
+        if (count[(keys[0] >> pass) & 0xFF] == num_values)
+            continue;
+        for (i = 1; i < 256; i++)
+            count[i] += count[i-1];
+        for (i = num_values - 1; i >= 0; i--)
+            scratch[--count[(keys[i] >> pass) & 0xFF]] = keys[i];
+        tmp = keys;
+        keys = scratch;
+        scratch = tmp;
+    }
+    
+    num_unique = 0;
+    for (i = 0; i < num_values; i++) {
+        if (num_unique > 0 && keys[i] == keys[num_unique-1])
+            continue;
+        keys[num_unique++] = keys[i];
+    }
+    for (i = 0; i < num_unique; i++)
+        keys[i] ^= (keys[i] & 0x80000000) ? 0x80000000 : 0xFFFFFFFF;
+    memcpy(values, keys, num_unique * sizeof(uint32_t));
+    
+    free(keys);
+    free(scratch);
+    return num_unique;
+}
+
 int translate(float *array, float value, int low, int high) {
     int match = (low + high)/2;
     //printf("   low -> match -> high = %d -> %d -> %d\n", low, match, high);
@@ -130,6 +184,67 @@ int translate_discrete(char **map, int num_ids, char *value) {
     return -1;
 }
 
+// FNV-1a
+static uint32_t _hash_label(const char *label) {
+    uint32_t hash = 2166136261u;
+    while (*label) {
+        hash ^= (unsigned char)*label++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*
+ * Index the labels in map so translate_discrete_indexed can find them without a linear scan.
+ * A label that appears more than once keeps its first index, as with translate_discrete.
+ */
+Discrete_Index *build_discrete_index(char **map, int num_ids) {
+    int i;
+    Discrete_Index *index = (Discrete_Index *)malloc(sizeof(Discrete_Index));
+    
+    index->labels = map;
+    index->num_labels = num_ids;
+    index->num_slots = 8;
+    while (index->num_slots < 2 * num_ids)
+        index->num_slots *= 2;
+    index->slots = (int *)calloc(index->num_slots, sizeof(int));
+    
+    for (i = 0; i < num_ids; i++) {
+        int slot = _hash_label(map[i]) & (index->num_slots - 1);
+        while (index->slots[slot] != 0 && strcmp(map[index->slots[slot]-1], map[i]))
+            slot = (slot + 1) & (index->num_slots - 1);
+        if (index->slots[slot] == 0)
+            index->slots[slot] = i + 1;
+    }
+    return index;
+}
+
+void free_discrete_index(Discrete_Index *index) {
+    if (index == NULL)
+        return;
+    free(index->slots);
+    free(index);
+}
+
+/*
+ * Same result as translate_discrete. Falls back to the linear scan if there is no index
+ * or if the index was built for some other map.
+ */
+int translate_discrete_indexed(Discrete_Index *index, char **map, int num_ids, char *value) {
+    int slot;
+    
+    if (index == NULL || index->labels != map || index->num_labels != num_ids)
+        return translate_discrete(map, num_ids, value);
+    
+    slot = _hash_label(value) & (index->num_slots - 1);
+    while (index->slots[slot] != 0) {
+        if (! strcmp(map[index->slots[slot]-1], value))
+            return index->slots[slot] - 1;
+        slot = (slot + 1) & (index->num_slots - 1);
+    }
+    return -1;
+}
+
 void create_cv_subset(CV_Dataset data, CV_Subset *train) {
     #ifdef HAVE_AVATAR_FCLIB
     int i, j, k;
@@ -39,8 +39,12 @@ Philip Kegelmeyer, wpk@sandia.gov
 short tree_insert(BST_Node **tree, Tree_Bookkeeping *books, float new_value);
 void tree_to_array(float *array, BST_Node *tree);
 void _tree_to_array(float *array, BST_Node *tree, int node, int *me);
+int sort_unique_floats(float *values, int num_values);
 int translate(float *array, float value, int low, int high);
 int translate_discrete(char **map, int num_ids, char *value);
+Discrete_Index *build_discrete_index(char **map, int num_ids);
+void free_discrete_index(Discrete_Index *index);
+int translate_discrete_indexed(Discrete_Index *index, char **map, int num_ids, char *value);
 
 void create_cv_subset(CV_Dataset data, CV_Subset *train);
 void populate_distinct_values_from_dataset(CV_Dataset data, CV_Subset *sub, AV_SortedBlobArray *blob);
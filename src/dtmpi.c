@@ -343,6 +343,7 @@ void display_usage( void ) {
     printf("        --save-trees             : Write trees to disk\n");
     printf("                                   On by default.\n");
     printf("        --no-save-trees          : Do not write trees to disk\n");
+    printf("        --binary-trees           : Write trees in the binary ensemble format\n");
     printf("\n");
     printf("ensemble options:\n");
     printf("    -B, --bagging=N          : Bagging with N%% of training set examples\n");
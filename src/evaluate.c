@@ -34,12 +34,16 @@ For questions, comments or contributions contact
 Philip Kegelmeyer, wpk@sandia.gov 
 *******************************************************************************/
 #include <string.h>
+#include <math.h>
 #include "crossval.h"
 #include "evaluate.h"
 #include "util.h"
 #include "gain.h"
 #include "av_rng.h"
 #include "tree.h"
+#include "lockstep.h"
+#include "quickscorer.h"
+#include "lazy_trees.h"
 
 typedef struct sortstore {
   double value;
@@ -122,6 +126,38 @@ int _classify_example(DT_Node *tree, int node, CV_Example example, float **xlate
     return class_label;
 }
 
+/*
+ * Walk a tree for a row of raw attribute values and return the leaf it lands in.
+ * Discrete attributes hold the index of their value and NaN marks a missing value,
+ * which is replaced by the ensemble's value for that attribute when there is one.
+ * A discrete value that isn't a valid index is treated as missing, and a missing
+ * discrete value with no known replacement takes the first branch.
+ */
+int find_row_leaf(DT_Node *tree, const float *row, union data_point_union *missing) {
+    int node = 0;
+    
+    while (tree[node].branch_type != LEAF) {
+        int att = tree[node].attribute;
+        float value = row[att];
+        if (tree[node].attribute_type == CONTINUOUS) {
+            if (isnan(value) && missing != NULL)
+                value = missing[att].Continuous;
+            node = tree[node].Node_Value.branch[value < tree[node].branch_threshold ? 0 : 1];
+        } else {
+            int b = -1;
+            if (value >= 0.0f && value < (float)tree[node].num_branches && value == floorf(value))
+                b = (int)value;
+            else if (missing != NULL)
+                b = missing[att].Discrete;
+            if (b < 0 || b >= tree[node].num_branches)
+                b = 0;
+            node = tree[node].Node_Value.branch[b];
+        }
+    }
+    
+    return node;
+}
+
 void print_pred_matrix(char *pre, CV_Matrix matrix) {
     int i, j;
     for (i = 0; i < matrix.num_examples; i++)
@@ -180,32 +216,56 @@ void build_probability_matrix_for_ivote(Vote_Cache cache, CV_Prob_Matrix *matrix
 //Added by DACIESL June-05-08: Laplacean Estimates
 //constructs a matrix of Laplacean probability estimates
 void build_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix) {
-    int i, j, k;
-    int leaf_node;
-    float *class_probs;
+    // Walk blocks of examples through each tree together using the best available SIMD kernel
+    lockstep_build_probability_matrix(data, ensemble, matrix, lockstep_best_isa());
+}
 
-    matrix->data = (float **)malloc(data.meta.num_examples * sizeof(float *));
-    for (i = 0; i < data.meta.num_examples; i++)
-        matrix->data[i] = (float *)calloc((ensemble.num_classes), sizeof(float));
-    matrix->num_examples = data.meta.num_examples;
-    matrix->num_classes = data.meta.num_classes;
+void build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix) {
+    // Walk blocks of examples through each tree together using the best available SIMD kernel
+    lockstep_build_prediction_matrix(data, ensemble, matrix, lockstep_best_isa());
+}
 
-    for (i = 0; i < data.meta.num_examples; i++) {
-        for (j = 0; j < ensemble.num_trees; j++) {
-	    leaf_node=0;
-            class_probs = find_example_probabilities(ensemble.Trees[j], data.examples[i], data.float_data, &leaf_node);
-            for (k = 0; k < data.meta.num_classes; k++) {
-	        matrix->data[i][k] += class_probs[k]/(double)ensemble.num_trees;
-		//printf("%f%s",class_probs[k],(k==data.meta.num_classes-1)?"\n":" ");
-            }
-        }
-    }
-    //print_pred_matrix("other", *matrix);
+/*
+ * Build the prediction/probability matrix with the scoring engine selected by --scoring-engine.
+ * The engines need every tree at once so a lazy ensemble is always scored a tree at a time
+ */
+void build_engine_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix, Scoring_Engine engine) {
+    if (ensemble.lazy_trees != NULL)
+        lazy_build_prediction_matrix(data, ensemble, matrix);
+    else if (engine == QUICKSCORER_ENGINE)
+        quickscorer_build_prediction_matrix(data, ensemble, matrix);
+    else
+        build_prediction_matrix(data, ensemble, matrix);
 }
 
-void build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix) {
-    int i, j;
+void build_engine_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix, Scoring_Engine engine) {
+    if (ensemble.lazy_trees != NULL)
+        lazy_build_probability_matrix(data, ensemble, matrix);
+    else if (engine == QUICKSCORER_ENGINE)
+        quickscorer_build_probability_matrix(data, ensemble, matrix);
+    else
+        build_probability_matrix(data, ensemble, matrix);
+}
+
+/*
+ * Same as build_prediction_matrix but stops evaluating trees for an example as soon as the
+ * leading class has more votes than the runner-up plus all remaining trees. The unevaluated
+ * columns are filled with the leading class so find_best_class_from_matrix picks the same winner.
+ * Only use this for plain majority voting when no probabilities, margins, or per-tree
+ * (i.e. average) accuracies are needed. Returns the number of tree evaluations skipped, or -1 for
+ * a lazy ensemble, which can't skip trees and is scored in full.
+ */
+long build_early_exit_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix) {
+    int i, j, k;
     int leaf_node;
+    int leader, runner_up;
+    int *votes;
+    long num_saved = 0;
+
+    if (ensemble.lazy_trees != NULL) {
+        lazy_build_prediction_matrix(data, ensemble, matrix);
+        return -1;
+    }
 
     matrix->data = (union data_type_union **)malloc(data.meta.num_examples * sizeof(union data_type_union*));
     for (i = 0; i < data.meta.num_examples; i++)
@@ -214,13 +274,37 @@ void build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *ma
     matrix->num_classifiers = ensemble.num_trees;
     matrix->additional_cols = 1;
     matrix->num_classes = data.meta.num_classes;
-    
+
+    votes = (int *)malloc(data.meta.num_classes * sizeof(int));
     for (i = 0; i < data.meta.num_examples; i++) {
         matrix->data[i][0].Integer = data.examples[i].containing_class_num;
-        for (j = 0; j < ensemble.num_trees; j++)
+        for (k = 0; k < data.meta.num_classes; k++)
+            votes[k] = 0;
+        leader = -1;
+        for (j = 0; j < ensemble.num_trees; j++) {
             matrix->data[i][j+1].Integer = classify_example(ensemble.Trees[j], data.examples[i], data.float_data, &leaf_node);
+            votes[matrix->data[i][j+1].Integer]++;
+
+            // Find the leader and the runner-up vote counts
+            leader = 0;
+            for (k = 1; k < data.meta.num_classes; k++)
+                if (votes[k] > votes[leader])
+                    leader = k;
+            runner_up = 0;
+            for (k = 0; k < data.meta.num_classes; k++)
+                if (k != leader && votes[k] > runner_up)
+                    runner_up = votes[k];
+            if (votes[leader] - runner_up > ensemble.num_trees - (j+1))
+                break;
+        }
+        // Fill in the trees we did not need to look at
+        for (k = j + 1; k < ensemble.num_trees; k++) {
+            matrix->data[i][k+1].Integer = leader;
+            num_saved++;
+        }
     }
-    //print_pred_matrix("other", *matrix);
+    free(votes);
+    return num_saved;
 }
 
 
@@ -228,6 +312,11 @@ void build_boost_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matr
     int i, j;
     int leaf_node;
 
+    if (ensemble.lazy_trees != NULL) {
+        lazy_build_boost_prediction_matrix(data, ensemble, matrix);
+        return;
+    }
+
     matrix->data = (union data_type_union **)malloc(data.meta.num_examples * sizeof(union data_type_union *));
     for (i = 0; i < data.meta.num_examples; i++)
         matrix->data[i] = (union data_type_union *)calloc(data.meta.num_classes, sizeof(union data_type_union));
@@ -253,6 +342,11 @@ void build_boost_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Pro
     int i, j, k;
     int leaf_node;
     float *class_probs;
+
+    if (ensemble.lazy_trees != NULL) {
+        lazy_build_boost_probability_matrix(data, ensemble, matrix);
+        return;
+    }
     matrix->data = (float **)malloc(data.meta.num_examples * sizeof(float*));
     for (i = 0; i < data.meta.num_examples; i++)
         matrix->data[i] = (float *)calloc((data.meta.num_classes), sizeof(float));
@@ -435,11 +529,6 @@ void count_class_votes_from_matrix(int example_num, CV_Matrix matrix, int **vote
 }
 
 int find_best_class_from_matrix(int example_num, CV_Matrix matrix, Args_Opts args, int seed_flag, int clean) {
-    int i;
-    int num_ties = 0;
-    int tied_classes[matrix.num_classes];
-    int best_class = -1;
-
     //static gsl_rng *R = NULL;
     //static long rng_seed;
     static struct ParkMiller* rng;
@@ -455,6 +544,21 @@ int find_best_class_from_matrix(int example_num, CV_Matrix matrix, Args_Opts arg
       return -1;
     }
     
+    return find_best_class_from_matrix_r(example_num, matrix, args, seed_flag, &rng, &rng_seed);
+}
+
+/*
+ * Reentrant form of find_best_class_from_matrix. The tie-breaking generator and its seed
+ * belong to the caller: *rng starts out NULL, is allocated on first use and must be freed
+ * by the caller.
+ */
+int find_best_class_from_matrix_r(int example_num, CV_Matrix matrix, Args_Opts args, int seed_flag,
+                                  struct ParkMiller **rng, long *rng_seed) {
+    int i;
+    int num_ties = 0;
+    int tied_classes[matrix.num_classes];
+    int best_class = -1;
+
     // seed > 0 means do nothing to the generator, just use it as is
     // seed = 0 means set seed to previous value to reproduce the stream
     // seed < 0 means use the next RN as the seed for the RNG
@@ -475,20 +579,20 @@ int find_best_class_from_matrix(int example_num, CV_Matrix matrix, Args_Opts arg
     } else {
         //printf("Using current seed\n");
         }*/
-    if (rng == NULL)
+    if (*rng == NULL)
     {
-      rng = malloc(sizeof(struct ParkMiller));
-      rng_seed = args.random_seed;
-      av_pm_default_init(rng, rng_seed);
+      *rng = malloc(sizeof(struct ParkMiller));
+      *rng_seed = args.random_seed;
+      av_pm_default_init(*rng, *rng_seed);
     }
     if (seed_flag == 0)
     {
-      av_pm_default_init(rng, rng_seed);
+      av_pm_default_init(*rng, *rng_seed);
     }
     else if (seed_flag < 0)
     {
-      rng_seed = rng->state;
-      av_pm_default_init(rng, rng_seed);
+      *rng_seed = (*rng)->state;
+      av_pm_default_init(*rng, *rng_seed);
     }
     
     if (args.do_boosting == TRUE) {
@@ -538,7 +642,7 @@ int find_best_class_from_matrix(int example_num, CV_Matrix matrix, Args_Opts arg
         //    printf(" %d", tied_classes[i]);
         //printf("\n");
         //best_class = tied_classes[gsl_rng_uniform_int(R, num_ties)];
-        best_class = tied_classes[av_pm_uniform_int(rng, num_ties)];
+        best_class = tied_classes[av_pm_uniform_int(*rng, num_ties)];
     }
     
     if (best_class < 0) {
@@ -60,8 +60,12 @@ int count_nodes(DT_Node *tree);
 void _count_nodes(DT_Node *tree, int node, int *count);
 int classify_example(DT_Node *tree, CV_Example example, float **xlate, int *leaf_node);
 int _classify_example(DT_Node *tree, int node, CV_Example example, float **xlate, int *leaf_node);
+int find_row_leaf(DT_Node *tree, const float *row, union data_point_union *missing);
 void build_prediction_matrix_for_ivote(CV_Subset data, Vote_Cache cache, CV_Matrix *matrix);
 void build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix);
+void build_engine_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix, Scoring_Engine engine);
+void build_engine_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix, Scoring_Engine engine);
+long build_early_exit_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix);
 void build_boost_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix);
 void build_boost_prediction_matrix_for_ivote(Vote_Cache cache, CV_Matrix *matrix);
 void concat_ensembles(int num_ensembles, DT_Ensemble *in, DT_Ensemble *out);
@@ -70,6 +74,9 @@ float compute_boosting_accuracy(CV_Matrix matrix, int ***confusion_matrix);
 float compute_average_accuracy(CV_Matrix matrix);
 void count_class_votes_from_matrix(int example_num, CV_Matrix matrix, int **votes);
 int find_best_class_from_matrix(int example_num, CV_Matrix matrix, Args_Opts args, int seed_flag, int clean);
+struct ParkMiller;
+int find_best_class_from_matrix_r(int example_num, CV_Matrix matrix, Args_Opts args, int seed_flag,
+                                  struct ParkMiller **rng, long *rng_seed);
 void print_confusion_matrix(int num_classes, int **confusion_matrix, char **class_names);
 //void _generate_confusion_matrix(CV_Matrix matrix, int ***confusion_matrix, Args_Opts args);
 void print_pred_matrix(char *pre, CV_Matrix matrix);
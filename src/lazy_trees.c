@@ -0,0 +1,379 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "crossval.h"
+#include "tree.h"
+#include "evaluate.h"
+#include "gain.h"
+#include "memory.h"
+#include "binary_trees.h"
+#include "text_trees.h"
+#include "lazy_trees.h"
+
+static void _index_text_trees(Lazy_Ensemble *lazy, DT_Ensemble *ensemble, Args_Opts *args);
+static void _index_binary_trees(Lazy_Ensemble *lazy, DT_Ensemble *ensemble, Args_Opts *args);
+static void _load_tree(Lazy_Ensemble *lazy, int tree_num);
+static void _unload_tree(Lazy_Ensemble *lazy, int tree_num);
+static size_t _text_tree_size(DT_Node *tree, Tree_Bookkeeping book, int num_classes);
+
+/*
+ * Reads the metadata of an ensemble and indexes its trees without loading any of them
+ */
+void read_lazy_ensemble(DT_Ensemble *ensemble, int fold_num, int force_num_trees, size_t memory_budget, Args_Opts *args) {
+    char *tree_filename = build_output_filename(fold_num, args->trees_file, *args);
+    Lazy_Ensemble *lazy = (Lazy_Ensemble *)calloc(1, sizeof(Lazy_Ensemble));
+    
+    // Initialize
+    ensemble->num_classes = 0;
+    ensemble->num_attributes = 0;
+    ensemble->num_trees = 0;
+    ensemble->mapped_trees = NULL;
+    ensemble->mapped_size = 0;
+    
+    // The file stays open so trees can be read as they are needed
+    if (args->trees_file_is_a_string == TRUE) {
+        lazy->fh = fmemopen(args->trees_string, strlen(args->trees_string), "r");
+    } else if ((lazy->fh = fopen(tree_filename, "r")) == NULL) {
+        fprintf(stderr, "Failed to open file for reading trees: '%s'\nExiting ...\n", tree_filename);
+        exit(8);
+    }
+    free(tree_filename);
+    
+    lazy->is_binary = args->trees_file_is_a_string == FALSE && is_binary_trees_file(lazy->fh);
+    read_ensemble_metadata(lazy->fh, ensemble, force_num_trees, args);
+    
+    lazy->tree_offsets = (long *)calloc(ensemble->num_trees + 1, sizeof(long));
+    lazy->tree_lengths = (long *)calloc(ensemble->num_trees + 1, sizeof(long));
+    if (lazy->is_binary)
+        _index_binary_trees(lazy, ensemble, args);
+    else
+        _index_text_trees(lazy, ensemble, args);
+    
+    lazy->num_trees = ensemble->num_trees;
+    lazy->num_classes = ensemble->num_classes;
+    lazy->trees = ensemble->Trees;
+    lazy->books = ensemble->Books;
+    lazy->tree_blocks = (char **)calloc(ensemble->num_trees, sizeof(char *));
+    lazy->tree_sizes = (size_t *)calloc(ensemble->num_trees, sizeof(size_t));
+    lazy->last_used = (long *)calloc(ensemble->num_trees, sizeof(long));
+    lazy->memory_budget = memory_budget;
+    ensemble->lazy_trees = lazy;
+}
+
+/*
+ * Returns tree tree_num of the ensemble, loading it first if this is a lazy ensemble
+ */
+DT_Node *ensemble_tree(DT_Ensemble ensemble, int tree_num) {
+    Lazy_Ensemble *lazy = (Lazy_Ensemble *)ensemble.lazy_trees;
+    int i, oldest;
+    
+    if (lazy == NULL)
+        return ensemble.Trees[tree_num];
+    
+    if (lazy->trees[tree_num] == NULL) {
+        _load_tree(lazy, tree_num);
+        // Make room by dropping whatever was used longest ago
+        while (lazy->memory_budget > 0 && lazy->memory_used > lazy->memory_budget) {
+            oldest = -1;
+            for (i = 0; i < lazy->num_trees; i++)
+                if (i != tree_num && lazy->trees[i] != NULL && (oldest < 0 || lazy->last_used[i] < lazy->last_used[oldest]))
+                    oldest = i;
+            if (oldest < 0)
+                break;
+            _unload_tree(lazy, oldest);
+        }
+    }
+    lazy->last_used[tree_num] = ++lazy->clock;
+    return lazy->trees[tree_num];
+}
+
+/*
+ * Frees the loaded trees and the index. The rest of the ensemble is freed by free_DT_Ensemble
+ */
+void free_lazy_ensemble(DT_Ensemble ensemble) {
+    Lazy_Ensemble *lazy = (Lazy_Ensemble *)ensemble.lazy_trees;
+    int i;
+    for (i = 0; i < lazy->num_trees; i++)
+        if (lazy->trees[i] != NULL)
+            _unload_tree(lazy, i);
+    fclose(lazy->fh);
+    free(lazy->tree_offsets);
+    free(lazy->tree_lengths);
+    free(lazy->tree_blocks);
+    free(lazy->tree_sizes);
+    free(lazy->last_used);
+    free(lazy);
+}
+
+/*
+ * Records where the nodes of each tree start and end and reads the betas, which the boosting
+ * matrices need for every tree up front. Only the start of each line is looked at
+ */
+static void _index_text_trees(Lazy_Ensemble *lazy, DT_Ensemble *ensemble, Args_Opts *args) {
+    char line[1024];
+    char *p;
+    size_t length;
+    long offset = ftell(lazy->fh);
+    Boolean at_line_start = FALSE; // The first read finishes the last line of metadata
+    Boolean want_beta = FALSE;
+    int num_found = 0;
+    
+    while (fgets(line, sizeof(line), lazy->fh) != NULL) {
+        length = strlen(line);
+        if (at_line_start) {
+            p = line + strspn(line, " \t");
+            if (! strncmp(p, "Tree", 4) && (p[4] == ' ' || p[4] == '\t')) {
+                if (num_found > 0)
+                    lazy->tree_lengths[num_found-1] = offset - lazy->tree_offsets[num_found-1];
+                if (num_found == ensemble->num_trees)
+                    break;
+                if (atoi(p + 4) != num_found+1)
+                    fprintf(stderr, "Found tree #%d but expected tree #%d\n", atoi(p + 4), num_found+1);
+                lazy->tree_offsets[num_found++] = offset + length;
+                want_beta = TRUE;
+            } else if (want_beta && *p != '#' && *p != '\n' && *p != '\r' && *p != '\0') {
+                if (! strncmp(p, "Beta", 4) && (p[4] == ' ' || p[4] == '\t')) {
+                    if (num_found == 1) {
+                        // Initialize boosting_betas array and set do_boosting to TRUE
+                        ensemble->boosting_betas = (double *)malloc(ensemble->num_trees * sizeof(double));
+                        args->do_boosting = TRUE;
+                    }
+                    ensemble->boosting_betas[num_found-1] = atof(p + 5);
+                    lazy->tree_offsets[num_found-1] = offset + length;
+                } else if (args->do_boosting == TRUE) {
+                    // If we're boosting, a tree without a beta is a problem
+                    fprintf(stderr, "ERROR: Ensemble file format error - no beta for tree %d\n", num_found);
+                    exit(-1);
+                }
+                want_beta = FALSE;
+            }
+        }
+        at_line_start = length > 0 && line[length-1] == '\n';
+        offset += length;
+    }
+    if (num_found > 0 && lazy->tree_lengths[num_found-1] == 0)
+        lazy->tree_lengths[num_found-1] = offset - lazy->tree_offsets[num_found-1];
+    
+    if (num_found < ensemble->num_trees) {
+        fprintf(stderr, "WARNING: Expected %d trees but the ensemble file only has %d\n", ensemble->num_trees, num_found);
+        ensemble->num_trees = args->num_trees = num_found;
+    }
+}
+
+/*
+ * Walks the block headers
+ */
+static void _index_binary_trees(Lazy_Ensemble *lazy, DT_Ensemble *ensemble, Args_Opts *args) {
+    int i;
+    struct stat sb;
+    long offset = ftell(lazy->fh);
+    Binary_Trees_Header file_header;
+    Binary_Tree_Header header;
+    
+    fstat(fileno(lazy->fh), &sb);
+    fseek(lazy->fh, 0, SEEK_SET);
+    fread(&file_header, sizeof(Binary_Trees_Header), 1, lazy->fh);
+    if (file_header.flags & BINARY_TREES_BOOSTED)
+        ensemble->boosting_betas = (double *)malloc(ensemble->num_trees * sizeof(double));
+    for (i = 0; i < ensemble->num_trees; i++) {
+        fseek(lazy->fh, offset, SEEK_SET);
+        if (fread(&header, sizeof(Binary_Tree_Header), 1, lazy->fh) != 1) {
+            fprintf(stderr, "WARNING: Expected %d trees but the ensemble file only has %d\n", ensemble->num_trees, i);
+            ensemble->num_trees = args->num_trees = i;
+            break;
+        }
+        if (memcmp(header.magic, "TREE", 4) || header.block_size <= 0 || offset + header.block_size > sb.st_size) {
+            fprintf(stderr, "ERROR: Binary ensemble file is corrupt at tree #%d\n", i+1);
+            exit(8);
+        }
+        if (header.tree_num != i+1)
+            fprintf(stderr, "Found tree #%d but expected tree #%d\n", header.tree_num, i+1);
+        if (ensemble->boosting_betas != NULL)
+            ensemble->boosting_betas[i] = header.beta;
+        lazy->tree_offsets[i] = offset;
+        lazy->tree_lengths[i] = header.block_size;
+        offset += header.block_size;
+    }
+}
+
+static void _load_tree(Lazy_Ensemble *lazy, int tree_num) {
+    char *text = (char *)malloc(lazy->tree_lengths[tree_num]);
+    fseek(lazy->fh, lazy->tree_offsets[tree_num], SEEK_SET);
+    if (fread(text, 1, lazy->tree_lengths[tree_num], lazy->fh) != (size_t)lazy->tree_lengths[tree_num]) {
+        fprintf(stderr, "ERROR: Failed to read tree #%d from the ensemble file\n", tree_num+1);
+        exit(8);
+    }
+    
+    if (lazy->is_binary) {
+        // The tree points into its block so the block is kept until the tree is unloaded
+        lazy->trees[tree_num] = read_binary_tree((Binary_Tree_Header *)text, tree_num+1, lazy->num_classes,
+                                                 &lazy->books[tree_num]);
+        lazy->tree_blocks[tree_num] = text;
+        lazy->tree_sizes[tree_num] = lazy->books[tree_num].num_malloced_nodes * sizeof(DT_Node) +
+                                     lazy->tree_lengths[tree_num];
+    } else {
+        read_text_tree(text, lazy->tree_lengths[tree_num], &lazy->trees[tree_num], &lazy->books[tree_num],
+                       lazy->num_classes);
+        free(text);
+        lazy->tree_sizes[tree_num] = _text_tree_size(lazy->trees[tree_num], lazy->books[tree_num], lazy->num_classes);
+    }
+    lazy->memory_used += lazy->tree_sizes[tree_num];
+}
+
+static void _unload_tree(Lazy_Ensemble *lazy, int tree_num) {
+    if (lazy->is_binary) {
+        free(lazy->trees[tree_num]);
+        free(lazy->tree_blocks[tree_num]);
+        lazy->tree_blocks[tree_num] = NULL;
+    } else {
+        free_DT_Node(lazy->trees[tree_num], lazy->books[tree_num].next_unused_node);
+    }
+    lazy->trees[tree_num] = NULL;
+    lazy->memory_used -= lazy->tree_sizes[tree_num];
+    lazy->tree_sizes[tree_num] = 0;
+}
+
+static size_t _text_tree_size(DT_Node *tree, Tree_Bookkeeping book, int num_classes) {
+    int i;
+    size_t size = book.num_malloced_nodes * sizeof(DT_Node);
+    for (i = 0; i < book.next_unused_node; i++) {
+        if (tree[i].branch_type == LEAF)
+            size += num_classes * (sizeof(int) + sizeof(float));
+        else
+            size += tree[i].num_branches * sizeof(int);
+    }
+    return size;
+}
+
+/*
+ * The same matrices as build_prediction_matrix, build_probability_matrix and the boosting
+ * versions, filled in one tree at a time. Each example's sums are still taken in tree order
+ */
+void lazy_build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix) {
+    int i, j;
+    int leaf_node;
+    DT_Node *tree;
+    
+    matrix->data = (union data_type_union **)malloc(data.meta.num_examples * sizeof(union data_type_union*));
+    for (i = 0; i < data.meta.num_examples; i++) {
+        matrix->data[i] = (union data_type_union *)malloc((ensemble.num_trees + 1) * sizeof(union data_type_union));
+        matrix->data[i][0].Integer = data.examples[i].containing_class_num;
+    }
+    matrix->num_examples = data.meta.num_examples;
+    matrix->num_classifiers = ensemble.num_trees;
+    matrix->additional_cols = 1;
+    matrix->num_classes = data.meta.num_classes;
+    
+    for (j = 0; j < ensemble.num_trees; j++) {
+        tree = ensemble_tree(ensemble, j);
+        for (i = 0; i < data.meta.num_examples; i++)
+            matrix->data[i][j+1].Integer = classify_example(tree, data.examples[i], data.float_data, &leaf_node);
+    }
+}
+
+void lazy_build_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix) {
+    int i, j, c;
+    int leaf_node;
+    float *class_probs;
+    DT_Node *tree;
+    
+    matrix->data = (float **)malloc(data.meta.num_examples * sizeof(float *));
+    for (i = 0; i < data.meta.num_examples; i++)
+        matrix->data[i] = (float *)calloc((ensemble.num_classes), sizeof(float));
+    matrix->num_examples = data.meta.num_examples;
+    matrix->num_classes = data.meta.num_classes;
+    
+    for (j = 0; j < ensemble.num_trees; j++) {
+        tree = ensemble_tree(ensemble, j);
+        for (i = 0; i < data.meta.num_examples; i++) {
+            class_probs = find_example_probabilities(tree, data.examples[i], data.float_data, &leaf_node);
+            for (c = 0; c < data.meta.num_classes; c++)
+                matrix->data[i][c] += class_probs[c]/(double)ensemble.num_trees;
+        }
+    }
+}
+
+void lazy_build_boost_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix) {
+    int i, j;
+    int leaf_node;
+    DT_Node *tree;
+    
+    matrix->data = (union data_type_union **)malloc(data.meta.num_examples * sizeof(union data_type_union *));
+    for (i = 0; i < data.meta.num_examples; i++)
+        matrix->data[i] = (union data_type_union *)calloc(data.meta.num_classes, sizeof(union data_type_union));
+    matrix->classes = (int *)malloc(data.meta.num_examples * sizeof(int));
+    matrix->num_examples = data.meta.num_examples;
+    matrix->num_classifiers = ensemble.num_trees;
+    matrix->additional_cols = 0;
+    matrix->num_classes = data.meta.num_classes;
+    
+    for (i = 0; i < data.meta.num_examples; i++)
+        matrix->classes[i] = data.examples[i].containing_class_num;
+    for (j = 0; j < ensemble.num_trees; j++) {
+        tree = ensemble_tree(ensemble, j);
+        for (i = 0; i < data.meta.num_examples; i++) {
+            int this_class = classify_example(tree, data.examples[i], data.float_data, &leaf_node);
+            matrix->data[i][this_class].Real += (float)dlog_2(1.0/ensemble.boosting_betas[j]);
+        }
+    }
+}
+
+void lazy_build_boost_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix) {
+    int i, j, k;
+    int leaf_node;
+    float *class_probs;
+    double sum_betas = 0.0;
+    DT_Node *tree;
+    
+    matrix->data = (float **)malloc(data.meta.num_examples * sizeof(float*));
+    for (i = 0; i < data.meta.num_examples; i++)
+        matrix->data[i] = (float *)calloc((data.meta.num_classes), sizeof(float));
+    matrix->num_examples = data.meta.num_examples;
+    matrix->num_classes = data.meta.num_classes;
+    
+    for (j = 0; j < ensemble.num_trees; j++)
+        sum_betas += ensemble.boosting_betas[j];
+    for (j = 0; j < ensemble.num_trees; j++) {
+        tree = ensemble_tree(ensemble, j);
+        for (i = 0; i < data.meta.num_examples; i++) {
+            class_probs = find_example_probabilities(tree, data.examples[i], data.float_data, &leaf_node);
+            for (k = 0; k < data.meta.num_classes; k++)
+                matrix->data[i][k] += (ensemble.boosting_betas[j]*class_probs[k])/sum_betas;
+        }
+    }
+}
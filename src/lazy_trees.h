@@ -0,0 +1,80 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#ifndef __LAZY_TREES__
+#define __LAZY_TREES__
+
+#include <stdio.h>
+
+/*
+ * Ensembles whose trees are loaded on first use.
+ *
+ * read_lazy_ensemble reads only the metadata and an index of where each tree starts in the
+ * ensemble file. Trees[i] stays NULL until ensemble_tree() asks for tree i. Once more than
+ * memory_budget bytes of trees are loaded, the least recently used trees are freed until the
+ * ensemble fits again, so a tree pointer is only good until the next ensemble_tree() call. The
+ * tree being asked for is always kept, so a budget smaller than one tree still works.
+ *
+ * Scoring with a lazy ensemble goes one tree at a time over every example. The results are the
+ * same as scoring the fully loaded ensemble. None of this is thread safe.
+ */
+
+typedef struct lazy_ensemble_struct {
+    FILE *fh;
+    Boolean is_binary;
+    int num_trees;
+    int num_classes;
+    DT_Node **trees;            // The ensemble's Trees and Books
+    Tree_Bookkeeping *books;
+    long *tree_offsets;         // Where each tree's nodes (text) or block (binary) start in fh
+    long *tree_lengths;
+    char **tree_blocks;         // Binary blocks the loaded trees point into
+    size_t *tree_sizes;         // Memory held by each loaded tree
+    long *last_used;
+    long clock;
+    size_t memory_budget;       // 0 means no limit
+    size_t memory_used;
+} Lazy_Ensemble;
+
+void read_lazy_ensemble(DT_Ensemble *ensemble, int fold_num, int force_num_trees, size_t memory_budget, Args_Opts *args);
+DT_Node *ensemble_tree(DT_Ensemble ensemble, int tree_num);
+void free_lazy_ensemble(DT_Ensemble ensemble);
+
+void lazy_build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix);
+void lazy_build_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix);
+void lazy_build_boost_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix);
+void lazy_build_boost_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix);
+
+#endif // __LAZY_TREES__
@@ -0,0 +1,338 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "crossval.h"
+#include "evaluate.h"
+#include "lockstep.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LOCKSTEP_X86 1
+#include <immintrin.h>
+#else
+#define LOCKSTEP_X86 0
+#endif
+
+#define LOCKSTEP_MAX_BLOCK 16
+
+static void _lockstep_scan_tree(DT_Node *tree, int node, int depth, int *max_node, int *max_depth,
+                                int *max_att, Boolean *is_continuous);
+static void _lockstep_fill_tree(DT_Node *tree, int node, Lockstep_Tree *ltree);
+static void _lockstep_fill_block(CV_Subset data, int first, int block_size, int num_atts, Boolean *att_used, float *values);
+static void _lockstep_walk(Lockstep_Tree *tree, int block_size, int num_atts, float *values, int *leaves, Lockstep_ISA isa);
+
+/*
+ * Returns the widest instruction set this CPU can run the lockstep kernels with
+ */
+Lockstep_ISA lockstep_best_isa(void) {
+#if LOCKSTEP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return LOCKSTEP_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return LOCKSTEP_AVX2;
+#endif
+    return LOCKSTEP_SCALAR;
+}
+
+int lockstep_block_size(Lockstep_ISA isa) {
+    if (isa == LOCKSTEP_AVX512)
+        return 16;
+    return 8;
+}
+
+/*
+ * Flatten each tree in the ensemble into the compact layout. num_atts is set to one more than the
+ * largest attribute used by a CONTINUOUS split and is the stride of the per-block value array
+ */
+void lockstep_build_trees(DT_Ensemble ensemble, Lockstep_Tree **trees, int *num_atts) {
+    int i, j;
+    int max_node, max_depth, max_att = -1;
+
+    (*trees) = (Lockstep_Tree *)malloc(ensemble.num_trees * sizeof(Lockstep_Tree));
+    for (i = 0; i < ensemble.num_trees; i++) {
+        Lockstep_Tree *lt = &(*trees)[i];
+        max_node = 0;
+        max_depth = 0;
+        lt->is_continuous = TRUE;
+        _lockstep_scan_tree(ensemble.Trees[i], 0, 0, &max_node, &max_depth, &max_att, &lt->is_continuous);
+        lt->depth = max_depth;
+        if (lt->is_continuous == FALSE) {
+            lt->num_nodes = 0;
+            lt->attribute = NULL;
+            lt->threshold = NULL;
+            lt->left = NULL;
+            lt->right = NULL;
+            continue;
+        }
+        lt->num_nodes = max_node + 1;
+        lt->attribute = (int *)calloc(lt->num_nodes, sizeof(int));
+        lt->threshold = (float *)calloc(lt->num_nodes, sizeof(float));
+        lt->left = (int *)malloc(lt->num_nodes * sizeof(int));
+        lt->right = (int *)malloc(lt->num_nodes * sizeof(int));
+        // Nodes that are not reachable from the root are treated as leaves
+        for (j = 0; j < lt->num_nodes; j++)
+            lt->left[j] = lt->right[j] = j;
+        _lockstep_fill_tree(ensemble.Trees[i], 0, lt);
+    }
+    *num_atts = max_att + 1;
+}
+
+void lockstep_free_trees(int num_trees, Lockstep_Tree *trees) {
+    int i;
+    for (i = 0; i < num_trees; i++) {
+        free(trees[i].attribute);
+        free(trees[i].threshold);
+        free(trees[i].left);
+        free(trees[i].right);
+    }
+    free(trees);
+}
+
+static void _lockstep_scan_tree(DT_Node *tree, int node, int depth, int *max_node, int *max_depth,
+                                int *max_att, Boolean *is_continuous) {
+    int i;
+    if (node > *max_node)
+        *max_node = node;
+    if (tree[node].branch_type == LEAF) {
+        if (depth > *max_depth)
+            *max_depth = depth;
+        return;
+    }
+    if (tree[node].attribute_type == CONTINUOUS) {
+        if (tree[node].attribute > *max_att)
+            *max_att = tree[node].attribute;
+    } else {
+        *is_continuous = FALSE;
+    }
+    for (i = 0; i < tree[node].num_branches; i++)
+        _lockstep_scan_tree(tree, tree[node].Node_Value.branch[i], depth + 1, max_node, max_depth, max_att, is_continuous);
+}
+
+static void _lockstep_fill_tree(DT_Node *tree, int node, Lockstep_Tree *ltree) {
+    if (tree[node].branch_type == LEAF)
+        return;
+    ltree->attribute[node] = tree[node].attribute;
+    ltree->threshold[node] = tree[node].branch_threshold;
+    ltree->left[node] = tree[node].Node_Value.branch[0];
+    ltree->right[node] = tree[node].Node_Value.branch[1];
+    _lockstep_fill_tree(tree, ltree->left[node], ltree);
+    _lockstep_fill_tree(tree, ltree->right[node], ltree);
+}
+
+/*
+ * Copy the translated float values of the attributes used by CONTINUOUS splits into a dense
+ * block_size x num_atts array. Unused lanes past the end of the data repeat the last example
+ */
+static void _lockstep_fill_block(CV_Subset data, int first, int block_size, int num_atts, Boolean *att_used, float *values) {
+    int i, j, ex;
+    for (i = 0; i < block_size; i++) {
+        ex = first + i < data.meta.num_examples ? first + i : data.meta.num_examples - 1;
+        for (j = 0; j < num_atts; j++)
+            if (att_used[j] == TRUE)
+                values[i*num_atts + j] = data.float_data[j][data.examples[ex].distinct_attribute_values[j]];
+    }
+}
+
+static void _lockstep_walk_scalar(Lockstep_Tree *tree, int block_size, int num_atts, float *values, int *leaves) {
+    int i, d, node;
+    for (i = 0; i < block_size; i++) {
+        node = 0;
+        for (d = 0; d < tree->depth; d++)
+            node = values[i*num_atts + tree->attribute[node]] < tree->threshold[node] ? tree->left[node] : tree->right[node];
+        leaves[i] = node;
+    }
+}
+
+#if LOCKSTEP_X86
+__attribute__((target("avx2")))
+static void _lockstep_walk_avx2(Lockstep_Tree *tree, int num_atts, float *values, int *leaves) {
+    int d;
+    __m256i node = _mm256_setzero_si256();
+    __m256i base = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(num_atts));
+    for (d = 0; d < tree->depth; d++) {
+        __m256i att = _mm256_i32gather_epi32(tree->attribute, node, 4);
+        __m256 thresh = _mm256_i32gather_ps(tree->threshold, node, 4);
+        __m256 val = _mm256_i32gather_ps(values, _mm256_add_epi32(base, att), 4);
+        __m256i left = _mm256_i32gather_epi32(tree->left, node, 4);
+        __m256i right = _mm256_i32gather_epi32(tree->right, node, 4);
+        __m256 lt = _mm256_cmp_ps(val, thresh, _CMP_LT_OQ);
+        node = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(right), _mm256_castsi256_ps(left), lt));
+    }
+    _mm256_storeu_si256((__m256i *)leaves, node);
+}
+
+__attribute__((target("avx512f")))
+static void _lockstep_walk_avx512(Lockstep_Tree *tree, int num_atts, float *values, int *leaves) {
+    int d;
+    __m512i node = _mm512_setzero_si512();
+    __m512i base = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                      _mm512_set1_epi32(num_atts));
+    for (d = 0; d < tree->depth; d++) {
+        __m512i att = _mm512_i32gather_epi32(node, tree->attribute, 4);
+        __m512 thresh = _mm512_i32gather_ps(node, tree->threshold, 4);
+        __m512 val = _mm512_i32gather_ps(_mm512_add_epi32(base, att), values, 4);
+        __m512i left = _mm512_i32gather_epi32(node, tree->left, 4);
+        __m512i right = _mm512_i32gather_epi32(node, tree->right, 4);
+        __mmask16 lt = _mm512_cmp_ps_mask(val, thresh, _CMP_LT_OQ);
+        node = _mm512_mask_blend_epi32(lt, right, left);
+    }
+    _mm512_storeu_si512((void *)leaves, node);
+}
+#endif
+
+/*
+ * Push a block of examples through a tree and return the leaf node each one lands in.
+ * block_size must be lockstep_block_size(isa) for the vector kernels
+ */
+static void _lockstep_walk(Lockstep_Tree *tree, int block_size, int num_atts, float *values, int *leaves, Lockstep_ISA isa) {
+#if LOCKSTEP_X86
+    if (isa == LOCKSTEP_AVX512) {
+        _lockstep_walk_avx512(tree, num_atts, values, leaves);
+        return;
+    } else if (isa == LOCKSTEP_AVX2) {
+        _lockstep_walk_avx2(tree, num_atts, values, leaves);
+        return;
+    }
+#endif
+    _lockstep_walk_scalar(tree, block_size, num_atts, values, leaves);
+}
+
+/*
+ * Flag the attributes that some CONTINUOUS split actually looks at so only those get copied
+ */
+static Boolean *_lockstep_used_atts(int num_trees, Lockstep_Tree *trees, int num_atts) {
+    int j, n;
+    Boolean *att_used = (Boolean *)calloc(num_atts + 1, sizeof(Boolean));
+    for (j = 0; j < num_trees; j++)
+        if (trees[j].is_continuous == TRUE)
+            for (n = 0; n < trees[j].num_nodes; n++)
+                if (trees[j].left[n] != n)
+                    att_used[trees[j].attribute[n]] = TRUE;
+    return att_used;
+}
+
+/*
+ * Lockstep version of build_prediction_matrix. Produces the same matrix
+ */
+void lockstep_build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix, Lockstep_ISA isa) {
+    int i, j, k;
+    int leaf_node;
+    int num_atts;
+    int block_size = lockstep_block_size(isa);
+    int leaves[LOCKSTEP_MAX_BLOCK];
+    float *values;
+    Boolean *att_used;
+    Lockstep_Tree *trees;
+
+    matrix->data = (union data_type_union **)malloc(data.meta.num_examples * sizeof(union data_type_union*));
+    for (i = 0; i < data.meta.num_examples; i++)
+        matrix->data[i] = (union data_type_union *)malloc((ensemble.num_trees + 1) * sizeof(union data_type_union));
+    matrix->num_examples = data.meta.num_examples;
+    matrix->num_classifiers = ensemble.num_trees;
+    matrix->additional_cols = 1;
+    matrix->num_classes = data.meta.num_classes;
+    
+    lockstep_build_trees(ensemble, &trees, &num_atts);
+    att_used = _lockstep_used_atts(ensemble.num_trees, trees, num_atts);
+    values = (float *)calloc(block_size * (num_atts + 1), sizeof(float));
+    
+    for (i = 0; i < data.meta.num_examples; i += block_size) {
+        _lockstep_fill_block(data, i, block_size, num_atts, att_used, values);
+        for (k = i; k < i + block_size && k < data.meta.num_examples; k++)
+            matrix->data[k][0].Integer = data.examples[k].containing_class_num;
+        for (j = 0; j < ensemble.num_trees; j++) {
+            if (trees[j].is_continuous == TRUE) {
+                _lockstep_walk(&trees[j], block_size, num_atts, values, leaves, isa);
+                for (k = i; k < i + block_size && k < data.meta.num_examples; k++)
+                    matrix->data[k][j+1].Integer = ensemble.Trees[j][leaves[k-i]].Node_Value.class_label;
+            } else {
+                for (k = i; k < i + block_size && k < data.meta.num_examples; k++)
+                    matrix->data[k][j+1].Integer = classify_example(ensemble.Trees[j], data.examples[k], data.float_data, &leaf_node);
+            }
+        }
+    }
+    
+    free(values);
+    free(att_used);
+    lockstep_free_trees(ensemble.num_trees, trees);
+}
+
+/*
+ * Lockstep version of build_probability_matrix. The per-example sums are accumulated in the same
+ * tree order so the result is identical
+ */
+void lockstep_build_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix, Lockstep_ISA isa) {
+    int i, j, k, c;
+    int leaf_node;
+    int num_atts;
+    int block_size = lockstep_block_size(isa);
+    int leaves[LOCKSTEP_MAX_BLOCK];
+    float *values;
+    float *class_probs;
+    Boolean *att_used;
+    Lockstep_Tree *trees;
+
+    matrix->data = (float **)malloc(data.meta.num_examples * sizeof(float *));
+    for (i = 0; i < data.meta.num_examples; i++)
+        matrix->data[i] = (float *)calloc((ensemble.num_classes), sizeof(float));
+    matrix->num_examples = data.meta.num_examples;
+    matrix->num_classes = data.meta.num_classes;
+
+    lockstep_build_trees(ensemble, &trees, &num_atts);
+    att_used = _lockstep_used_atts(ensemble.num_trees, trees, num_atts);
+    values = (float *)calloc(block_size * (num_atts + 1), sizeof(float));
+    
+    for (i = 0; i < data.meta.num_examples; i += block_size) {
+        _lockstep_fill_block(data, i, block_size, num_atts, att_used, values);
+        for (j = 0; j < ensemble.num_trees; j++) {
+            if (trees[j].is_continuous == TRUE)
+                _lockstep_walk(&trees[j], block_size, num_atts, values, leaves, isa);
+            for (k = i; k < i + block_size && k < data.meta.num_examples; k++) {
+                if (trees[j].is_continuous == TRUE)
+                    class_probs = ensemble.Trees[j][leaves[k-i]].class_probs;
+                else
+                    class_probs = find_example_probabilities(ensemble.Trees[j], data.examples[k], data.float_data, &leaf_node);
+                for (c = 0; c < data.meta.num_classes; c++)
+                    matrix->data[k][c] += class_probs[c]/(double)ensemble.num_trees;
+            }
+        }
+    }
+    
+    free(values);
+    free(att_used);
+    lockstep_free_trees(ensemble.num_trees, trees);
+}
@@ -0,0 +1,71 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#ifndef __LOCKSTEP__
+#define __LOCKSTEP__
+
+/*
+ * Lockstep evaluation of several examples through the same tree.
+ *
+ * Trees are flattened into a compact layout (parallel attribute/threshold/child arrays indexed by
+ * the original node number, with leaves pointing back to themselves) so a block of examples can
+ * walk a tree together for exactly depth steps. On x86 the block is pushed through AVX2 (8 lanes)
+ * or AVX-512 (16 lanes) gathers and compares, chosen at runtime. Trees with DISCRETE splits fall
+ * back to the recursive classify_example/find_example_probabilities.
+ */
+typedef enum {
+    LOCKSTEP_SCALAR,
+    LOCKSTEP_AVX2,
+    LOCKSTEP_AVX512
+} Lockstep_ISA;
+
+typedef struct lockstep_tree_struct {
+    Boolean is_continuous;  // FALSE if the tree has a DISCRETE split and so must be evaluated recursively
+    int num_nodes;          // Length of the arrays below
+    int depth;              // Number of steps needed to reach any leaf from the root
+    int *attribute;         // Split attribute. 0 for leaves
+    float *threshold;       // Split threshold. 0 for leaves
+    int *left;              // Branch taken when value < threshold. Leaves point to themselves
+    int *right;             // Branch taken when value >= threshold. Leaves point to themselves
+} Lockstep_Tree;
+
+Lockstep_ISA lockstep_best_isa(void);
+int lockstep_block_size(Lockstep_ISA isa);
+void lockstep_build_trees(DT_Ensemble ensemble, Lockstep_Tree **trees, int *num_atts);
+void lockstep_free_trees(int num_trees, Lockstep_Tree *trees);
+void lockstep_build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix, Lockstep_ISA isa);
+void lockstep_build_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix, Lockstep_ISA isa);
+
+#endif // __LOCKSTEP__
@@ -0,0 +1,162 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "crossval.h"
+#include "mapped_input.h"
+
+static int _read_input_text(int fd, Input_Text *in);
+
+/*
+ * Sets up in to read filename, or string if is_a_string is TRUE.
+ * Ask for a writable view only if the parser changes the text; a string is then copied.
+ * Returns 0 if the file can't be opened
+ */
+int open_input_text(const char *filename, char *string, Boolean is_a_string, Boolean writable, Input_Text *in) {
+    int fd;
+    struct stat sb;
+    
+    memset(in, 0, sizeof(Input_Text));
+    
+    if (is_a_string == TRUE) {
+        in->length = strlen(string);
+        if (writable == TRUE) {
+            in->text = (char *)malloc(in->length + 1);
+            memcpy(in->text, string, in->length + 1);
+            in->copied = TRUE;
+        } else {
+            in->text = string;
+        }
+        return 1;
+    }
+    
+    if ((fd = open(filename, O_RDONLY)) < 0)
+        return 0;
+    
+    // Pipes and the like can't be mapped so read them
+    if (fstat(fd, &sb) < 0 || ! S_ISREG(sb.st_mode) || sb.st_size == 0) {
+        int ok = _read_input_text(fd, in);
+        close(fd);
+        return ok;
+    }
+    
+    // Map at least one byte more than the file, which reads as the '\0' that ends the text.
+    // The bytes after the end of the file in its last page are zero, but if the file fills
+    // its last page an anonymous page follows it
+    long page_size = sysconf(_SC_PAGESIZE);
+    int prot = writable == TRUE ? PROT_READ | PROT_WRITE : PROT_READ;
+    char *base;
+    in->length = sb.st_size;
+    in->mapped_size = (in->length / page_size + 1) * page_size;
+    base = (char *)mmap(NULL, in->mapped_size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED &&
+        mmap(base, in->length, prot, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, in->mapped_size);
+        base = MAP_FAILED;
+    }
+    if (base == MAP_FAILED) {
+        int ok;
+        memset(in, 0, sizeof(Input_Text));
+        ok = _read_input_text(fd, in);
+        close(fd);
+        return ok;
+    }
+    close(fd);
+    
+    madvise(base, in->mapped_size, MADV_SEQUENTIAL);
+    in->text = base;
+    return 1;
+}
+
+void close_input_text(Input_Text *in) {
+    if (in->mapped_size > 0)
+        munmap(in->text, in->mapped_size);
+    else if (in->copied == TRUE)
+        free(in->text);
+    memset(in, 0, sizeof(Input_Text));
+}
+
+/*
+ * Returns the line that starts at *pos, with its \n and any \r before it replaced by '\0',
+ * and moves *pos to the start of the next line. Start with *pos = in->text.
+ * Returns NULL when there are no more lines. The view must be writable
+ */
+char *next_input_line(Input_Text *in, char **pos) {
+    char *line = *pos;
+    char *end = in->text + in->length;
+    char *eol;
+    
+    if (line >= end)
+        return NULL;
+    eol = memchr(line, '\n', end - line);
+    if (eol == NULL)
+        eol = end;
+    *pos = eol < end ? eol + 1 : end;
+    *eol = '\0';
+    if (eol > line && *(eol-1) == '\r')
+        *(eol-1) = '\0';
+    return line;
+}
+
+/*
+ * Reads everything from fd into a malloc'd text
+ */
+static int _read_input_text(int fd, Input_Text *in) {
+    size_t num_malloced = 1 << 20;
+    ssize_t num_read;
+    
+    in->text = (char *)malloc(num_malloced);
+    in->length = 0;
+    in->copied = TRUE;
+    while ((num_read = read(fd, in->text + in->length, num_malloced - in->length - 1)) > 0) {
+        in->length += num_read;
+        if (in->length == num_malloced - 1) {
+            num_malloced *= 2;
+            in->text = (char *)realloc(in->text, num_malloced);
+        }
+    }
+    in->text[in->length] = '\0';
+    if (num_read < 0) {
+        close_input_text(in);
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,61 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#ifndef __MAPPED_INPUT__
+#define __MAPPED_INPUT__
+
+#include <stddef.h>
+
+/*
+ * Input layer for the data, names and ensemble readers.
+ *
+ * A file is mmap'd with a sequential access hint and the parsers work on the mapped bytes. A
+ * string given in place of a file (train_file_is_a_string and friends) is used directly, so
+ * both take the same code path. The text is always followed by a '\0'. A writable view is a
+ * private copy-on-write mapping, or a copy of a string, that a parser may split in place.
+ */
+
+typedef struct input_text_struct {
+    char *text;             // The bytes, followed by a '\0'
+    size_t length;
+    size_t mapped_size;     // Bytes mapped at text, 0 if text is not mapped
+    Boolean copied;         // text was malloc'd and is freed by close_input_text
+} Input_Text;
+
+int open_input_text(const char *filename, char *string, Boolean is_a_string, Boolean writable, Input_Text *in);
+void close_input_text(Input_Text *in);
+char *next_input_line(Input_Text *in, char **pos);
+
+#endif // __MAPPED_INPUT__
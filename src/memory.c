@@ -40,6 +40,10 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "av_utils.h"
 #include "crossval.h"
 #include "memory.h"
+#include "binary_trees.h"
+#include "lazy_trees.h"
+#include "distinct_values.h"
+#include "out_of_core.h"
 
 void clear_CV_Metadata(CV_Metadata* meta, Data_Format format, Boolean read_folds)
 {
@@ -55,6 +59,7 @@ void clear_CV_Metadata(CV_Metadata* meta, Data_Format format, Boolean read_folds
         free(meta->class_names[i]);  
     }
     free(meta->class_names);
+    free_discrete_index(meta->class_index);
     free(meta->num_examples_per_class);
 
     // Free data about attributes.
@@ -65,9 +70,12 @@ void clear_CV_Metadata(CV_Metadata* meta, Data_Format format, Boolean read_folds
                 free(meta->discrete_attribute_map[i][j]);
             }
             free(meta->discrete_attribute_map[i]);
+            if (meta->discrete_index != NULL)
+                free_discrete_index(meta->discrete_index[i]);
         }
     }
     free(meta->attribute_names);
+    free(meta->discrete_index);
     if (format == AVATAR_FORMAT) {
         // REVIEW-2012-03-27-ArtM: Why are these not freed if format == EXODUS?
         free(meta->num_discrete_values);
@@ -126,6 +134,8 @@ void free_CV_Metadata_Aliasing(CV_Metadata* meta, CV_Metadata* aliased, Data_For
     }
     free(meta->class_names);
   }
+  if(meta->class_index != aliased->class_index)
+    free_discrete_index(meta->class_index);
   if(meta->num_examples_per_class != aliased->num_examples_per_class)
     free(meta->num_examples_per_class);
   // Free data about attributes.
@@ -148,6 +158,12 @@ void free_CV_Metadata_Aliasing(CV_Metadata* meta, CV_Metadata* aliased, Data_For
     }
     free(meta->discrete_attribute_map);
   }
+  if(meta->discrete_index && meta->discrete_index != aliased->discrete_index)
+  {
+    for (i = 0; i < meta->num_attributes; ++i)
+      free_discrete_index(meta->discrete_index[i]);
+    free(meta->discrete_index);
+  }
   if(meta->num_discrete_values != aliased->num_discrete_values)
     free(meta->num_discrete_values);
   if(meta->attribute_types != aliased->attribute_types)
@@ -159,10 +175,16 @@ void free_CV_Metadata_Aliasing(CV_Metadata* meta, CV_Metadata* aliased, Data_For
 void free_DT_Ensemble(DT_Ensemble ensemble, CV_Mode mode) {
     //printf("free_DT_Ensemble\n");
     int i;
-    for (i = 0; i < ensemble.num_trees; i++)
-    {
-      if(ensemble.Trees[i])
-        free_DT_Node(ensemble.Trees[i], ensemble.Books[i].next_unused_node);
+    if (ensemble.mapped_trees != NULL) {
+        free_binary_ensemble(ensemble);
+    } else if (ensemble.lazy_trees != NULL) {
+        free_lazy_ensemble(ensemble);
+    } else {
+        for (i = 0; i < ensemble.num_trees; i++)
+        {
+          if(ensemble.Trees[i])
+            free_DT_Node(ensemble.Trees[i], ensemble.Books[i].next_unused_node);
+        }
     }
     //Cosmin added if statements below
     if (ensemble.Books != NULL) {
@@ -189,6 +211,12 @@ void free_DT_Ensemble(DT_Ensemble ensemble, CV_Mode mode) {
         free(ensemble.Missing);
         ensemble.Missing = NULL;
     }
+    if (ensemble.missing_names != NULL) {
+        for (i = 0; i < ensemble.num_attributes; i++)
+            free(ensemble.missing_names[i]);
+        free(ensemble.missing_names);
+        ensemble.missing_names = NULL;
+    }
     //if (mode == TRAIN_MODE)
     //    free(ensemble.weights);
 }
@@ -249,11 +277,16 @@ void free_CV_Dataset(CV_Dataset data, Args_Opts args) {
 void free_CV_Subset(CV_Subset* sub, Args_Opts args, CV_Mode mode) {
     //printf("free_CV_Subset\n");
     int i;
+    // Values in scratch files (see page_out_examples) are released with the files
+    void *row_scratch = NULL, *float_scratch = NULL;
     if(sub->examples)
     {
       for (i = 0; i < sub->meta.num_examples; i++) {
           if(sub->examples[i].distinct_attribute_values) {
-              free(sub->examples[i].distinct_attribute_values);
+              if (scratch_base(sub->examples[i].distinct_attribute_values) != NULL)
+                  row_scratch = scratch_base(sub->examples[i].distinct_attribute_values);
+              else
+                  free(sub->examples[i].distinct_attribute_values);
               sub->examples[i].distinct_attribute_values = NULL;
           }
       }
@@ -268,13 +301,19 @@ void free_CV_Subset(CV_Subset* sub, Args_Opts args, CV_Mode mode) {
     {
       for (i = 0; i < sub->meta.num_attributes; i++) {
         if (sub->float_data[i]){
-          free(sub->float_data[i]);
+          if (scratch_base(sub->float_data[i]) != NULL)
+              float_scratch = scratch_base(sub->float_data[i]);
+          else
+              free(sub->float_data[i]);
           sub->float_data[i] = NULL;
         }
       }
       free(sub->float_data);
       sub->float_data = NULL;
     }
+    if (float_scratch != row_scratch)
+        scratch_free(float_scratch);
+    scratch_free(row_scratch);
     if (args.format == AVATAR_FORMAT)
       free(sub->discrete_used);
     sub->discrete_used = NULL;
@@ -287,7 +326,7 @@ void free_CV_Subset_inter(CV_Subset* sub, Args_Opts args, CV_Mode mode) {
     //int i;
     //for (i = 0; i < sub.num_examples; i++)
     //    free(sub.examples[i].distinct_attribute_values);
-    free(sub->examples);
+    scratch_free(sub->examples);
     sub->examples = NULL;
     //if (mode == TRAIN_MODE && ! args.do_ivote && args.random_subspaces == 0)
     //    free(sub.weights);
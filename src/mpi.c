@@ -153,6 +153,8 @@ void derive_MPI_OPTIONS() {
     MPI_Address(&Args.minimum_examples,             &disp[i++]);
     MPI_Address(&Args.split_method,                 &disp[i++]);
     MPI_Address(&Args.save_trees,                   &disp[i++]);
+    MPI_Address(&Args.binary_trees,                 &disp[i++]);
+    MPI_Address(&Args.stream_trees,                 &disp[i++]);
     MPI_Address(&Args.random_forests,               &disp[i++]);
     MPI_Address(&Args.random_attributes,            &disp[i++]);
     type[i] = MPI_FLOAT;
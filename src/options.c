@@ -90,6 +90,15 @@ enum {
     option_prox_matrix_file,
     option_sort,
     option_probability_type,
+    option_scoring_engine,
+    option_max_tree_memory,
+    option_checkpoint,
+    option_add_trees,
+    option_prune_tolerance,
+    option_pruned_trees_file,
+    option_threads,
+    option_out_of_core,
+    option_test_batch_size,
 };
 
 //Modified by DACIESL June-04-08: Laplacean Estimates
@@ -146,11 +155,20 @@ static const struct option long_opts[] = {
     {"no-dynamic-bounds", no_argument, (int *)&Args.dynamic_bounds, FALSE},
     {"save-trees", no_argument, (int *)&Args.save_trees, TRUE},
     {"no-save-trees", no_argument, (int *)&Args.save_trees, FALSE},
+    {"binary-trees", no_argument, (int *)&Args.binary_trees, TRUE},
+    {"stream-trees", no_argument, (int *)&Args.stream_trees, TRUE},
+    {"checkpoint", required_argument, NULL, option_checkpoint},
+    {"resume", no_argument, (int *)&Args.resume, TRUE},
+    {"add-trees", required_argument, NULL, option_add_trees},
     
     // User Customizations
     {"exclude", required_argument, NULL, option_exclude},
     {"include", required_argument, NULL, option_include},
     {"truth-column", optional_argument, NULL, option_truth_column},
+    {"threads", required_argument, NULL, option_threads},
+    {"data-cache", no_argument, (int *)&Args.data_cache, TRUE},
+    {"out-of-core", optional_argument, NULL, option_out_of_core},
+    {"test-batch-size", required_argument, NULL, option_test_batch_size},
 
     // ivoting options
     {"ivoting", no_argument, NULL, 'I'},
@@ -176,6 +194,9 @@ static const struct option long_opts[] = {
     // diversity options
     {"output-kappa-plot-data", no_argument, (int *)&Args.kappa_plot_data, TRUE},
     
+    // prune_trees options
+    {"prune-tolerance", required_argument, NULL, option_prune_tolerance},
+    
     // proximity options
     {"use-standard-deviation", no_argument, (int *)&Args.deviation_type, STANDARD_DEVIATION},
     {"use-absolute-deviation", no_argument, (int *)&Args.deviation_type, ABSOLUTE_DEVIATION},
@@ -194,6 +215,7 @@ static const struct option long_opts[] = {
     {"oob-file", required_argument, NULL, option_oob_file},
     {"prox-sorted-file", required_argument, NULL, option_prox_sorted_file},
     {"prox-matrix-file", required_argument, NULL, option_prox_matrix_file},
+    {"pruned-trees-file", required_argument, NULL, option_pruned_trees_file},
     {"test-file-string", no_argument, NULL, 'i'},
     
     // Output options
@@ -215,6 +237,10 @@ static const struct option long_opts[] = {
     {"do-memv", no_argument, (int *)&Args.do_margin_ensemble_majority_vote, TRUE},
     {"do-pmv", no_argument, (int *)&Args.do_probabilistic_majority_vote, TRUE},
     {"do-spmv", no_argument, (int *)&Args.do_scaled_probabilistic_majority_vote, TRUE},
+    {"early-exit-voting", no_argument, (int *)&Args.early_exit_voting, TRUE},
+    {"no-early-exit-voting", no_argument, (int *)&Args.early_exit_voting, FALSE},
+    {"scoring-engine", required_argument, NULL, option_scoring_engine},
+    {"max-tree-memory", required_argument, NULL, option_max_tree_memory},
     
     // Unpublished options
     {"debug", no_argument, (int *)&Args.debug, TRUE},
@@ -233,160 +259,184 @@ static const struct option long_opts[] = {
 //Added HELLINGER to 's' flag
 //Modified by DACIESL June-04-08: Laplacean Estimates
 //Added default for Args.output_laplacean = FALSE
-//Modified by MEGOLDS August, 2012: subsampling
-//Added default for Args.subsampling = 0
-Args_Opts process_opts(int argc, char **argv) {//, Args_Opts *args) {
-    
-    int i;
-    int opt = 0;
-    int long_index = 0;
-    Boolean *included_features = NULL;
-    int sizeof_included_features = 0;
-    int *features_in_out;
-    int num_features_in_out, biggest, t_count, num_p;
-    char *t;
-    char **tokens;
+/*
+ * Fill in the default value of every option. Unlike process_opts() this only touches
+ * the caller's structure, so several can be initialized at once from different threads.
+ */
+void init_default_opts(Args_Opts *args) {
+    args->go4it = TRUE;
     
-    // Initialize
-    Args.go4it = TRUE;
-    
-    Args.caller = UNKNOWN_CALLER;
-    Args.format = EXODUS_FORMAT;
-    Args.datafile = NULL;
-    Args.data_path = NULL;
-    Args.class_var_name = NULL;
-    Args.classes_filename = NULL;
-    Args.partitions_filename = NULL;
-    Args.num_folds = 10;
-    Args.do_5x2_cv = FALSE;
-    Args.do_nfold_cv = FALSE;
-    Args.do_rigorous_strat = TRUE;
-    Args.do_training = FALSE;
-    Args.num_train_times = 0;
-    Args.do_testing = FALSE;
-    Args.num_test_times = 0;
-    Args.write_folds = FALSE;
-    Args.random_seed = time(NULL) + getpid();
-    srand48(Args.random_seed);
-    Args.base_filestem = NULL;
-    Args.verbosity = 0;
-    Args.print_version = FALSE;
+    args->caller = UNKNOWN_CALLER;
+    args->format = EXODUS_FORMAT;
+    args->datafile = NULL;
+    args->data_path = NULL;
+    args->class_var_name = NULL;
+    args->classes_filename = NULL;
+    args->partitions_filename = NULL;
+    args->num_folds = 10;
+    args->do_5x2_cv = FALSE;
+    args->do_nfold_cv = FALSE;
+    args->do_rigorous_strat = TRUE;
+    args->do_training = FALSE;
+    args->num_train_times = 0;
+    args->do_testing = FALSE;
+    args->num_test_times = 0;
+    args->write_folds = FALSE;
+    args->random_seed = time(NULL) + getpid();
+    args->base_filestem = NULL;
+    args->verbosity = 0;
+    args->print_version = FALSE;
     
     // User customization options
-    Args.truth_column = -1;
-    Args.exclude_all_features_above = -1;
-    Args.num_skipped_features = 0;
-    Args.skipped_features = NULL;
-    Args.num_explicitly_skipped_features = 0;
-    Args.explicitly_skipped_features = NULL;
+    args->truth_column = -1;
+    args->exclude_all_features_above = -1;
+    args->num_skipped_features = 0;
+    args->skipped_features = NULL;
+    args->num_explicitly_skipped_features = 0;
+    args->explicitly_skipped_features = NULL;
 
     // Decision Tree Generation options
-    Args.num_trees = 0;
-    Args.auto_stop = FALSE;
-    Args.build_size = 20;
-    Args.slide_size = 5;
-    Args.split_on_zero_gain = FALSE;
-    Args.subsample = 0;
-    Args.dynamic_bounds = TRUE;
-    Args.minimum_examples = 2;
-    Args.split_method = C45STYLE;
-    Args.save_trees = TRUE;
-    Args.random_forests = 0;
-    Args.extr_random_trees = 0;
-    Args.totl_random_trees = 0;
-    Args.random_attributes = 0;
-    Args.random_subspaces = 0.0;
-    Args.collapse_subtree = TRUE;
+    args->num_trees = 0;
+    args->auto_stop = FALSE;
+    args->build_size = 20;
+    args->slide_size = 5;
+    args->split_on_zero_gain = FALSE;
+    args->subsample = 0;
+    args->dynamic_bounds = TRUE;
+    args->minimum_examples = 2;
+    args->split_method = C45STYLE;
+    args->save_trees = TRUE;
+    args->binary_trees = FALSE;
+    args->stream_trees = FALSE;
+    args->checkpoint_interval = 0;
+    args->resume = FALSE;
+    args->add_trees = 0;
+    args->random_forests = 0;
+    args->extr_random_trees = 0;
+    args->totl_random_trees = 0;
+    args->random_attributes = 0;
+    args->random_subspaces = 0.0;
+    args->collapse_subtree = TRUE;
     
     // bagging options
-    Args.do_bagging = FALSE;
-    Args.bag_size = 0.0;
-    Args.majority_bagging = FALSE;
+    args->do_bagging = FALSE;
+    args->bag_size = 0.0;
+    args->majority_bagging = FALSE;
     
     // ivote options
-    Args.do_ivote = FALSE;
-    Args.bite_size = 0;
-    Args.ivote_p_factor = 0.75;
-    Args.majority_ivoting = FALSE;
+    args->do_ivote = FALSE;
+    args->bite_size = 0;
+    args->ivote_p_factor = 0.75;
+    args->majority_ivoting = FALSE;
     
     // SMOTE options
-    Args.do_smote = FALSE;
-    Args.smote_knn = 5;
-    Args.smote_Ln = 2;
-    Args.smote_type = OPEN_SMOTE;
+    args->do_smote = FALSE;
+    args->smote_knn = 5;
+    args->smote_Ln = 2;
+    args->smote_type = OPEN_SMOTE;
     
     // Boosting and SMOTEBoost options
-    Args.do_boosting = FALSE;
-    Args.do_smoteboost = FALSE;
-    Args.smoteboost_type = ALL_MINORITY_CLASSES;
+    args->do_boosting = FALSE;
+    args->do_smoteboost = FALSE;
+    args->smoteboost_type = ALL_MINORITY_CLASSES;
     
     // balanced learning options
-    Args.do_balanced_learning = FALSE;
+    args->do_balanced_learning = FALSE;
     
     // skew data handling options (SMOTE, Balanced Learning, Majority Bagging)
-    Args.num_minority_classes = 0;
-    Args.minority_classes = NULL;
-    Args.minority_classes_char = NULL;
-    Args.proportions = NULL;
+    args->num_minority_classes = 0;
+    args->minority_classes = NULL;
+    args->minority_classes_char = NULL;
+    args->proportions = NULL;
     
     // rfFeatureValue options
-    Args.do_noising = FALSE;
+    args->do_noising = FALSE;
     
     // diversity options
-    Args.kappa_plot_data = FALSE;
+    args->kappa_plot_data = FALSE;
+    
+    // prune_trees options
+    args->prune_tolerance = 0.0;
     
     // proximity options
-    Args.deviation_type = STANDARD_DEVIATION;
-    Args.sort_line_num = -1;
-    Args.save_prox_matrix = TRUE;
-    Args.load_prox_matrix = FALSE;
+    args->deviation_type = STANDARD_DEVIATION;
+    args->sort_line_num = -1;
+    args->save_prox_matrix = TRUE;
+    args->load_prox_matrix = FALSE;
     
     // Ensemble handling options
-    Args.do_mass_majority_vote = FALSE;
-    Args.do_ensemble_majority_vote = FALSE;
-    Args.do_margin_ensemble_majority_vote = FALSE;
-    Args.do_probabilistic_majority_vote = FALSE;
-    Args.do_scaled_probabilistic_majority_vote = FALSE;
+    args->do_mass_majority_vote = FALSE;
+    args->do_ensemble_majority_vote = FALSE;
+    args->do_margin_ensemble_majority_vote = FALSE;
+    args->do_probabilistic_majority_vote = FALSE;
+    args->do_scaled_probabilistic_majority_vote = FALSE;
+    args->early_exit_voting = FALSE;
+    args->scoring_engine = LOCKSTEP_ENGINE;
+    args->max_tree_memory = 0;
+    args->num_threads = 0;
+    args->data_cache = FALSE;
+    args->out_of_core = FALSE;
+    args->scratch_dir = NULL;
+    args->test_batch_size = 0;
     
     // Alternate filenames]
-    Args.train_file = NULL;
-    Args.train_file_is_a_string = FALSE;
-    Args.train_string = NULL;
-    Args.names_file = NULL;
-    Args.names_file_is_a_string = FALSE;
-    Args.names_string = NULL;
-    Args.test_file = NULL;
-    Args.test_file_is_a_string = FALSE;
-    Args.test_string = NULL;
-    Args.trees_file = NULL;
-    Args.trees_file_is_a_string = FALSE;
-    Args.trees_string = NULL;
-    Args.predictions_file = NULL;
-    Args.oob_file = NULL;
-    Args.prox_sorted_file = NULL;
+    args->train_file = NULL;
+    args->train_file_is_a_string = FALSE;
+    args->train_string = NULL;
+    args->names_file = NULL;
+    args->names_file_is_a_string = FALSE;
+    args->names_string = NULL;
+    args->test_file = NULL;
+    args->test_file_is_a_string = FALSE;
+    args->test_string = NULL;
+    args->trees_file = NULL;
+    args->trees_file_is_a_string = FALSE;
+    args->trees_string = NULL;
+    args->predictions_file = NULL;
+    args->oob_file = NULL;
+    args->prox_sorted_file = NULL;
     
     // Output options
-    Args.output_accuracies = LIMBO;
-    Args.output_predictions = FALSE;
-    Args.output_probabilities = FALSE;
-    Args.output_probabilities_warning = FALSE;
-    Args.output_laplacean = FALSE;
-    Args.output_confusion_matrix = FALSE;
-    Args.output_verbose_oob = FALSE;
-    Args.output_margins = FALSE;
+    args->output_accuracies = LIMBO;
+    args->output_predictions = FALSE;
+    args->output_probabilities = FALSE;
+    args->output_probabilities_warning = FALSE;
+    args->output_laplacean = FALSE;
+    args->output_confusion_matrix = FALSE;
+    args->output_verbose_oob = FALSE;
+    args->output_margins = FALSE;
 
     // Unpublished options
-    Args.debug = FALSE;
-    Args.read_folds = FALSE;
-    Args.use_opendt_shuffle = FALSE;
-    Args.run_regression_test = FALSE;
-    Args.break_ties_randomly = TRUE;
-    Args.stopping_algorithm_regtest = FALSE;
-    Args.show_per_process_stats = FALSE;
-    Args.common_mpi_rand48_seed = FALSE;
+    args->debug = FALSE;
+    args->read_folds = FALSE;
+    args->use_opendt_shuffle = FALSE;
+    args->run_regression_test = FALSE;
+    args->break_ties_randomly = TRUE;
+    args->stopping_algorithm_regtest = FALSE;
+    args->show_per_process_stats = FALSE;
+    args->common_mpi_rand48_seed = FALSE;
     
     // Derived element for MPI
-    Args.mpi_rank = 0; // Defaults to root node
+    args->mpi_rank = 0; // Defaults to root node
+}
+
+//Modified by MEGOLDS August, 2012: subsampling
+//Added default for Args.subsampling = 0
+Args_Opts process_opts(int argc, char **argv) {//, Args_Opts *args) {
+    
+    int i;
+    int opt = 0;
+    int long_index = 0;
+    Boolean *included_features = NULL;
+    int sizeof_included_features = 0;
+    int *features_in_out;
+    int num_features_in_out, biggest, t_count, num_p;
+    char *t;
+    char **tokens;
+    
+    // Initialize
+    init_default_opts(&Args);
+    srand48(Args.random_seed);
     
     //Modified by MEGOLDS August, 2012: subsampling
     //Added case 'b' 
@@ -695,6 +745,70 @@ Args_Opts process_opts(int argc, char **argv) {//, Args_Opts *args) {
                 }
                 Args.num_minority_classes = num_p;
                 break;
+            case option_scoring_engine:
+                if (! strcasecmp(optarg, "lockstep"))
+                    Args.scoring_engine = LOCKSTEP_ENGINE;
+                else if (! strcasecmp(optarg, "quickscorer"))
+                    Args.scoring_engine = QUICKSCORER_ENGINE;
+                else {
+                    fprintf(stderr, "Invalid scoring engine. Must be one of lockstep, quickscorer\n");
+                    display_usage();
+                    break;
+                }
+                break;
+            case option_max_tree_memory:
+                Args.max_tree_memory = atoi(optarg);
+                if (Args.max_tree_memory <= 0) {
+                    fprintf(stderr, "--max-tree-memory must be a positive number of MB\n");
+                    display_usage();
+                    break;
+                }
+                break;
+            case option_checkpoint:
+                Args.checkpoint_interval = atoi(optarg);
+                if (Args.checkpoint_interval <= 0) {
+                    fprintf(stderr, "--checkpoint must be a positive number of trees\n");
+                    display_usage();
+                    break;
+                }
+                break;
+            case option_add_trees:
+                Args.add_trees = atoi(optarg);
+                if (Args.add_trees <= 0) {
+                    fprintf(stderr, "--add-trees must be a positive number of trees\n");
+                    display_usage();
+                    break;
+                }
+                break;
+            case option_threads:
+                Args.num_threads = atoi(optarg);
+                if (Args.num_threads <= 0) {
+                    fprintf(stderr, "--threads must be a positive number of threads\n");
+                    display_usage();
+                    break;
+                }
+                break;
+            case option_out_of_core:
+                if (optarg)
+                    Args.scratch_dir = av_strdup(optarg);
+                Args.out_of_core = TRUE;
+                break;
+            case option_test_batch_size:
+                Args.test_batch_size = atoi(optarg);
+                if (Args.test_batch_size <= 0) {
+                    fprintf(stderr, "--test-batch-size must be a positive number of examples\n");
+                    display_usage();
+                    break;
+                }
+                break;
+            case option_prune_tolerance:
+                Args.prune_tolerance = atof(optarg);
+                if (Args.prune_tolerance < 0.0 || Args.prune_tolerance > 100.0) {
+                    fprintf(stderr, "--prune-tolerance must be a percentage between 0 and 100\n");
+                    display_usage();
+                    break;
+                }
+                break;
             case option_sort:
                 if (optarg)
                     Args.sort_line_num = atoi(optarg);
@@ -741,6 +855,9 @@ Args_Opts process_opts(int argc, char **argv) {//, Args_Opts *args) {
             case option_prox_matrix_file:
                 Args.prox_matrix_file = av_strdup(optarg);
                 break;
+            case option_pruned_trees_file:
+                Args.pruned_trees_file = av_strdup(optarg);
+                break;
 
             default:
                 if (opt > 0)
@@ -848,6 +965,12 @@ void set_output_filenames(Args_Opts *args, Boolean force_input, Boolean force_ou
             sprintf(args->prox_matrix_file, "%s/%s.proximity_matrix", args->data_path, args->base_filestem);
         }
     }
+    if (args->caller == PRUNE_CALLER) {
+        if (force_output || args->pruned_trees_file == NULL) {
+            args->pruned_trees_file = (char *)malloc((strlen(args->data_path) + strlen(args->base_filestem) + 15) * sizeof(char));
+            sprintf(args->pruned_trees_file, "%s/%s.pruned.trees", args->data_path, args->base_filestem);
+        }
+    }
     /*
     printf("Filenames:\n");
     printf("  datafile    = %s\n", args->datafile);
@@ -908,7 +1031,9 @@ void free_Args_Opts_Full(Args_Opts args)
   free(args.oob_file);
   free(args.prox_sorted_file);
   free(args.prox_matrix_file);
+  free(args.pruned_trees_file);
   free(args.tree_stats_file);
+  free(args.scratch_dir);
 }
 
 void read_partition_file(CV_Partition *partition, Args_Opts *args) {
@@ -1020,6 +1145,8 @@ int sanity_check(Args_Opts *args) {
             printf("%s ", "diversity");
         else if (args->caller == PROXIMITY_CALLER)
             printf("%s ", "proximity");
+        else if (args->caller == PRUNE_CALLER)
+            printf("%s ", "prune_trees");
         printf(get_version_string());
         printf("\n");
         printf("For information contact\n");
@@ -1113,6 +1240,32 @@ int sanity_check(Args_Opts *args) {
         //}
     }
 
+    // Checkpoints hold the part of the ensemble file written so far, so they need --stream-trees
+    if (args->checkpoint_interval > 0 || args->resume == TRUE) {
+        if (args->caller != AVATARDT_CALLER || args->do_training == FALSE || args->do_ivote == TRUE ||
+            args->do_smoteboost == TRUE) {
+            fprintf(stderr, "--checkpoint and --resume are for avatardt --train without ivoting or SMOTEBoost\n");
+            num_errors++;
+        }
+        args->stream_trees = TRUE;
+    }
+    
+    // Growing an ensemble replays make_bag to recover each existing tree's bag, so nothing else may
+    // come between the data and the bags
+    if (args->add_trees > 0) {
+        if (args->caller != AVATARDT_CALLER || args->do_training == FALSE || args->do_ivote == TRUE ||
+            args->auto_stop == TRUE || args->do_balanced_learning == TRUE || args->do_smoteboost == TRUE) {
+            fprintf(stderr, "--add-trees is for avatardt --train without ivoting, the stopping algorithm,\n");
+            fprintf(stderr, "balanced learning or SMOTEBoost\n");
+            num_errors++;
+        }
+        if (args->checkpoint_interval > 0 || args->resume == TRUE) {
+            fprintf(stderr, "--add-trees cannot be used with --checkpoint or --resume\n");
+            num_errors++;
+        }
+        args->stream_trees = TRUE;
+    }
+
     if (args->auto_stop && ! (args->do_ivote == TRUE || args->do_bagging == TRUE)) {
         fprintf(stderr, "--use-stopping-algorithm must be used with either bagging or ivoting\n");
         num_errors++;
@@ -1140,6 +1293,29 @@ int sanity_check(Args_Opts *args) {
         // If unspecified and not turned ON by other options, default is OFF
         args->output_accuracies = OFF;
     }
+    if (args->early_exit_voting == TRUE) {
+        // Early exit only gives the voted class so anything that needs every tree's vote is out
+        if (args->output_laplacean == TRUE || args->output_probabilities == TRUE ||
+            args->output_margins == TRUE || args->output_accuracies == VERBOSE) {
+            fprintf(stderr, "--early-exit-voting cannot be used with --output-probabilities, --output-margins,\n");
+            fprintf(stderr, "or --output-performance-metrics\n");
+            num_errors++;
+        }
+        if (args->do_boosting == TRUE) {
+            fprintf(stderr, "--early-exit-voting cannot be used with --boosting\n");
+            num_errors++;
+        }
+    }
+    // Each batch of streamed test data is scored on its own, so only the plain voting of one ensemble works
+    if (args->test_batch_size > 0) {
+        if (args->caller != AVATARDT_CALLER || args->format != AVATAR_FORMAT || args->do_testing == FALSE ||
+            args->do_ivote == TRUE || args->do_boosting == TRUE || args->partitions_filename != NULL ||
+            args->output_accuracies == VERBOSE) {
+            fprintf(stderr, "--test-batch-size is for avatardt --test on avatar data without ivoting, boosting,\n");
+            fprintf(stderr, "partitions or --output-performance-metrics\n");
+            num_errors++;
+        }
+    }
     
     // Skew data handling
     if (args->do_smote == TRUE || args->do_balanced_learning == TRUE ||
@@ -1314,6 +1490,8 @@ void display_dtmpi_opts(FILE *fh, char *comment, Args_Opts args) {
     }
     if (args.save_trees)
         fprintf(fh, "%sEnsemble File          : %s\n", comment, args.trees_file);
+    if (args.save_trees && args.binary_trees)
+        fprintf(fh, "%sEnsemble Format        : Binary\n", comment);
     if (args.output_predictions)
         fprintf(fh, "%sPredictions File       : %s\n", comment, args.predictions_file);
     if (args.output_verbose_oob)
@@ -1421,6 +1599,8 @@ void display_dt_opts(FILE *fh, char *comment, Args_Opts args, CV_Metadata meta)
     }
     if (args.save_trees)
         fprintf(fh, "%sEnsemble File          : %s\n", comment, args.trees_file);
+    if (args.save_trees && args.binary_trees)
+        fprintf(fh, "%sEnsemble Format        : Binary\n", comment);
     if (args.output_predictions)
         fprintf(fh, "%sPredictions File       : %s\n", comment, args.predictions_file);
     if (args.output_verbose_oob)
@@ -1438,6 +1618,12 @@ void display_dt_opts(FILE *fh, char *comment, Args_Opts args, CV_Metadata meta)
 					       (args.split_method==GAINRATIO?"Gain Ratio":
                                                (args.split_method==HELLINGER?"Hellinger Distance":"N/A"))));
         fprintf(fh, "%sSave Trees             : %s\n", comment, args.save_trees?"TRUE":"FALSE");
+        if (args.stream_trees)
+            fprintf(fh, "%sStream Trees           : TRUE\n", comment);
+        if (args.checkpoint_interval > 0)
+            fprintf(fh, "%sCheckpoint Interval    : %d trees\n", comment, args.checkpoint_interval);
+        if (args.add_trees > 0)
+            fprintf(fh, "%sAdded Trees            : %d\n", comment, args.add_trees);
         if (args.random_forests > 0)
             fprintf(fh, "%sRandom Forests         : %d\n", comment, args.random_forests);
         if (args.extr_random_trees > 0)
@@ -1492,6 +1678,12 @@ void display_dt_opts(FILE *fh, char *comment, Args_Opts args, CV_Metadata meta)
             fprintf(fh, "%s                         Unweighted calculation used\n", comment);
 	}
         fprintf(fh, "%sOutput Confusion Matrix: %s\n", comment, args.output_confusion_matrix?"TRUE":"FALSE");
+        if (args.early_exit_voting)
+            fprintf(fh, "%sEarly Exit Voting      : TRUE\n", comment);
+        if (args.scoring_engine == QUICKSCORER_ENGINE)
+            fprintf(fh, "%sScoring Engine         : QuickScorer\n", comment);
+        if (args.max_tree_memory > 0)
+            fprintf(fh, "%sMax Tree Memory        : %d MB\n", comment, args.max_tree_memory);
     }
     fprintf(fh, "%s============================================================\n", comment);
 }
@@ -1524,6 +1716,8 @@ void display_cv_opts(FILE *fh, char *comment, Args_Opts args) {
     }
     if (args.save_trees)
         fprintf(fh, "%sEnsemble File          : %s\n", comment, args.trees_file);
+    if (args.save_trees && args.binary_trees)
+        fprintf(fh, "%sEnsemble Format        : Binary\n", comment);
     if (args.output_predictions)
         fprintf(fh, "%sPredictions File       : %s\n", comment, args.predictions_file);
     if (args.output_verbose_oob)
@@ -1560,6 +1754,8 @@ void display_cv_opts(FILE *fh, char *comment, Args_Opts args) {
                                                            (args.split_method==GAINRATIO?"Gain Ratio":
                                                            (args.split_method==HELLINGER?"Hellinger Distance":"N/A"))));
     fprintf(fh, "%sSave Trees             : %s\n", comment, args.save_trees?"TRUE":"FALSE");
+    if (args.stream_trees)
+        fprintf(fh, "%sStream Trees           : TRUE\n", comment);
     if (args.random_forests > 0)
         fprintf(fh, "%sRandom Forests         : %d\n", comment, args.random_forests);
     if (args.extr_random_trees > 0)
@@ -1603,6 +1799,12 @@ void display_cv_opts(FILE *fh, char *comment, Args_Opts args) {
         fprintf(fh, "%s                         Unweighted calculation used\n", comment);
     }
     fprintf(fh, "%sOutput Confusion Matrix: %s\n", comment, args.output_confusion_matrix?"TRUE":"FALSE");
+    if (args.early_exit_voting)
+        fprintf(fh, "%sEarly Exit Voting      : TRUE\n", comment);
+    if (args.scoring_engine == QUICKSCORER_ENGINE)
+        fprintf(fh, "%sScoring Engine         : QuickScorer\n", comment);
+    if (args.max_tree_memory > 0)
+        fprintf(fh, "%sMax Tree Memory        : %d MB\n", comment, args.max_tree_memory);
     
     fprintf(fh, "%s============================================================\n", comment);
 }
@@ -1658,6 +1860,8 @@ void display_fv_opts(FILE *fh, char *comment, Args_Opts args) {
                                                            (args.split_method==INFOGAIN?"Information Gain":
                                                            (args.split_method==GAINRATIO?"Gain Ratio":"N/A")));
     fprintf(fh, "%sSave Trees             : %s\n", comment, args.save_trees?"TRUE":"FALSE");
+    if (args.stream_trees)
+        fprintf(fh, "%sStream Trees           : TRUE\n", comment);
     if (args.random_forests > 0)
         fprintf(fh, "%sRandom Forests         : %d\n", comment, args.random_forests);
     if (args.extr_random_trees > 0)
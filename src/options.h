@@ -36,6 +36,7 @@ Philip Kegelmeyer, wpk@sandia.gov
 #ifndef __OPTIONS__
 #define __OPTIONS__
 
+void init_default_opts(Args_Opts *args);
 Args_Opts process_opts(int argc, char **argv);
 void late_process_opts(int num_atts, int num_examples, Args_Opts *args);
 void set_output_filenames(Args_Opts *args, Boolean force_input, Boolean force_output);
@@ -0,0 +1,211 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "crossval.h"
+#include "out_of_core.h"
+
+// Smaller blocks aren't worth a file of their own
+#define SCRATCH_MIN_BYTES (1 << 20)
+
+typedef struct scratch_map_struct {
+    char *base;
+    size_t size;
+} Scratch_Map;
+
+// The scratch files that are mapped. They are shared by every run in the process, and API
+// handles may train and free their data on different threads, so hold maps_lock to use them
+static Scratch_Map *maps = NULL;
+static int num_maps = 0;
+static int num_malloced_maps = 0;
+static Boolean warned = FALSE;
+static pthread_mutex_t maps_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *_map_scratch(size_t size, Args_Opts args);
+static int _find_map(const void *ptr);
+
+/*
+ * Returns size bytes that live in a scratch file if --out-of-core was given and size is big
+ * enough to be worth it, or malloc'd memory otherwise. Release it with scratch_free
+ */
+void *scratch_alloc(size_t size, Args_Opts args) {
+    void *ptr = NULL;
+    if (args.out_of_core == TRUE && size >= SCRATCH_MIN_BYTES)
+        ptr = _map_scratch(size, args);
+    if (ptr == NULL)
+        ptr = malloc(size);
+    return ptr;
+}
+
+/*
+ * Frees memory from scratch_alloc or page_out_examples, or from malloc
+ */
+void scratch_free(void *ptr) {
+    int i;
+    Scratch_Map map = { NULL, 0 };
+    if (ptr == NULL)
+        return;
+    pthread_mutex_lock(&maps_lock);
+    for (i = 0; i < num_maps; i++) {
+        if (maps[i].base == ptr) {
+            map = maps[i];
+            maps[i] = maps[--num_maps];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&maps_lock);
+    if (map.base != NULL)
+        munmap(map.base, map.size);
+    else
+        free(ptr);
+}
+
+/*
+ * Returns the start of the scratch file that holds ptr, or NULL if ptr is heap memory
+ */
+void *scratch_base(const void *ptr) {
+    int i;
+    void *base;
+    pthread_mutex_lock(&maps_lock);
+    i = _find_map(ptr);
+    base = i < 0 ? NULL : maps[i].base;
+    pthread_mutex_unlock(&maps_lock);
+    return base;
+}
+
+/*
+ * Moves the attribute values of every example in sub, and the float_data for its continuous
+ * attributes, into one scratch file. Rows that are already in a scratch file are left alone.
+ * free_CV_Subset releases the file
+ */
+void page_out_examples(CV_Subset *sub, Args_Opts args) {
+    int i;
+    size_t size = 0;
+    Boolean move_rows;
+    char *block, *next;
+    
+    if (args.out_of_core == FALSE || sub->meta.num_examples == 0)
+        return;
+    
+    move_rows = scratch_base(sub->examples[0].distinct_attribute_values) == NULL ? TRUE : FALSE;
+    if (move_rows == TRUE)
+        size += (size_t)sub->meta.num_examples * sub->meta.num_attributes * sizeof(int);
+    for (i = 0; i < sub->meta.num_attributes; i++)
+        if (sub->meta.attribute_types[i] == CONTINUOUS && sub->float_data[i] != NULL)
+            size += (sub->high[i] + 1) * sizeof(float);
+    if (size == 0 || (block = (char *)_map_scratch(size, args)) == NULL)
+        return;
+    
+    next = block;
+    if (move_rows == TRUE) {
+        for (i = 0; i < sub->meta.num_examples; i++) {
+            memcpy(next, sub->examples[i].distinct_attribute_values, sub->meta.num_attributes * sizeof(int));
+            free(sub->examples[i].distinct_attribute_values);
+            sub->examples[i].distinct_attribute_values = (int *)next;
+            next += sub->meta.num_attributes * sizeof(int);
+        }
+    }
+    for (i = 0; i < sub->meta.num_attributes; i++) {
+        if (sub->meta.attribute_types[i] == CONTINUOUS && sub->float_data[i] != NULL) {
+            memcpy(next, sub->float_data[i], (sub->high[i] + 1) * sizeof(float));
+            free(sub->float_data[i]);
+            sub->float_data[i] = (float *)next;
+            next += (sub->high[i] + 1) * sizeof(float);
+        }
+    }
+}
+
+/*
+ * Creates an unlinked file of size bytes in the scratch directory and maps it.
+ * The space is reserved up front so a full disk is found here rather than as a SIGBUS later.
+ * Returns NULL, after a one-time warning, if that fails
+ */
+static void *_map_scratch(size_t size, Args_Opts args) {
+    const char *dir = args.scratch_dir != NULL ? args.scratch_dir :
+                      args.data_path != NULL ? args.data_path : ".";
+    char *filename;
+    int fd, err;
+    void *base = MAP_FAILED;
+    
+    filename = (char *)malloc(strlen(dir) + 24);
+    sprintf(filename, "%s/.avatar-scratch-XXXXXX", dir);
+    if ((fd = mkstemp(filename)) < 0) {
+        err = errno;
+    } else {
+        unlink(filename);
+        if ((err = posix_fallocate(fd, 0, size)) == 0 &&
+            (base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+            err = errno;
+        close(fd);
+    }
+    free(filename);
+    
+    pthread_mutex_lock(&maps_lock);
+    if (base == MAP_FAILED) {
+        if (warned == FALSE)
+            fprintf(stderr, "WARNING: Could not make a scratch file in '%s' (%s). Keeping the data in memory\n",
+                            dir, strerror(err));
+        warned = TRUE;
+        pthread_mutex_unlock(&maps_lock);
+        return NULL;
+    }
+    if (num_maps == num_malloced_maps) {
+        num_malloced_maps = num_malloced_maps == 0 ? 16 : 2 * num_malloced_maps;
+        maps = (Scratch_Map *)realloc(maps, num_malloced_maps * sizeof(Scratch_Map));
+    }
+    maps[num_maps].base = (char *)base;
+    maps[num_maps].size = size;
+    num_maps++;
+    pthread_mutex_unlock(&maps_lock);
+    return base;
+}
+
+/*
+ * Returns the index of the map that holds ptr, or -1. maps_lock must be held
+ */
+static int _find_map(const void *ptr) {
+    int i;
+    for (i = 0; i < num_maps; i++)
+        if ((const char *)ptr >= maps[i].base && (const char *)ptr < maps[i].base + maps[i].size)
+            return i;
+    return -1;
+}
@@ -0,0 +1,284 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "crossval.h"
+#include "evaluate.h"
+#include "quickscorer.h"
+
+static void _qs_scan_tree(DT_Node *tree, int node, int *num_leaves, int *max_att, Boolean *is_continuous);
+static void _qs_number_leaves(DT_Node *tree, int node, int tree_num, QuickScorer *qs, int *next_leaf);
+static int _qs_compare_conditions(const void *a, const void *b);
+static void _qs_clear_leaves(uint64_t *bv, int first, int last);
+static int _qs_lowest_bit(uint64_t word);
+
+/*
+ * Precompute the per-attribute sorted split lists for the ensemble
+ */
+void quickscorer_build(DT_Ensemble ensemble, QuickScorer *qs) {
+    int i, next_leaf;
+    int max_att = -1;
+
+    qs->num_trees = ensemble.num_trees;
+    qs->is_continuous = (Boolean *)malloc(ensemble.num_trees * sizeof(Boolean));
+    qs->num_leaves = (int *)calloc(ensemble.num_trees, sizeof(int));
+    qs->leaf_nodes = (int **)calloc(ensemble.num_trees, sizeof(int *));
+    qs->word_offset = (int *)malloc(ensemble.num_trees * sizeof(int));
+    qs->num_words = 0;
+    for (i = 0; i < ensemble.num_trees; i++) {
+        qs->is_continuous[i] = TRUE;
+        _qs_scan_tree(ensemble.Trees[i], 0, &qs->num_leaves[i], &max_att, &qs->is_continuous[i]);
+        qs->word_offset[i] = qs->num_words;
+        if (qs->is_continuous[i] == TRUE)
+            qs->num_words += (qs->num_leaves[i] + 63) / 64;
+    }
+    qs->num_atts = max_att + 1;
+    qs->num_conditions = (int *)calloc(qs->num_atts + 1, sizeof(int));
+    qs->conditions = (QS_Condition **)calloc(qs->num_atts + 1, sizeof(QS_Condition *));
+    
+    // The first pass counts splits per attribute, the second fills them in
+    for (i = 0; i < ensemble.num_trees; i++) {
+        if (qs->is_continuous[i] == FALSE)
+            continue;
+        qs->leaf_nodes[i] = (int *)malloc(qs->num_leaves[i] * sizeof(int));
+        next_leaf = 0;
+        _qs_number_leaves(ensemble.Trees[i], 0, i, qs, &next_leaf);
+    }
+    for (i = 0; i < qs->num_atts; i++) {
+        qs->conditions[i] = (QS_Condition *)malloc((qs->num_conditions[i] + 1) * sizeof(QS_Condition));
+        qs->num_conditions[i] = 0;
+    }
+    for (i = 0; i < ensemble.num_trees; i++) {
+        if (qs->is_continuous[i] == FALSE)
+            continue;
+        next_leaf = 0;
+        _qs_number_leaves(ensemble.Trees[i], 0, i, qs, &next_leaf);
+    }
+    for (i = 0; i < qs->num_atts; i++)
+        qsort(qs->conditions[i], qs->num_conditions[i], sizeof(QS_Condition), _qs_compare_conditions);
+}
+
+void quickscorer_free(QuickScorer *qs) {
+    int i;
+    for (i = 0; i < qs->num_atts; i++)
+        free(qs->conditions[i]);
+    free(qs->conditions);
+    free(qs->num_conditions);
+    for (i = 0; i < qs->num_trees; i++)
+        free(qs->leaf_nodes[i]);
+    free(qs->leaf_nodes);
+    free(qs->num_leaves);
+    free(qs->is_continuous);
+    free(qs->word_offset);
+    memset(qs, 0, sizeof(QuickScorer));
+}
+
+static void _qs_scan_tree(DT_Node *tree, int node, int *num_leaves, int *max_att, Boolean *is_continuous) {
+    int i;
+    if (tree[node].branch_type == LEAF) {
+        (*num_leaves)++;
+        return;
+    }
+    if (tree[node].attribute_type == CONTINUOUS) {
+        if (tree[node].attribute > *max_att)
+            *max_att = tree[node].attribute;
+    } else {
+        *is_continuous = FALSE;
+    }
+    for (i = 0; i < tree[node].num_branches; i++)
+        _qs_scan_tree(tree, tree[node].Node_Value.branch[i], num_leaves, max_att, is_continuous);
+}
+
+/*
+ * Number the leaves left to right and record each split's left-subtree leaf range.
+ * If qs->conditions[att] has not been allocated yet, only count the splits
+ */
+static void _qs_number_leaves(DT_Node *tree, int node, int tree_num, QuickScorer *qs, int *next_leaf) {
+    int att, first_leaf;
+    if (tree[node].branch_type == LEAF) {
+        qs->leaf_nodes[tree_num][*next_leaf] = node;
+        (*next_leaf)++;
+        return;
+    }
+    att = tree[node].attribute;
+    first_leaf = *next_leaf;
+    _qs_number_leaves(tree, tree[node].Node_Value.branch[0], tree_num, qs, next_leaf);
+    if (qs->conditions[att] != NULL) {
+        QS_Condition *c = &qs->conditions[att][qs->num_conditions[att]];
+        c->threshold = tree[node].branch_threshold;
+        c->tree = tree_num;
+        c->first_leaf = first_leaf;
+        c->last_leaf = *next_leaf - 1;
+    }
+    qs->num_conditions[att]++;
+    _qs_number_leaves(tree, tree[node].Node_Value.branch[1], tree_num, qs, next_leaf);
+}
+
+static int _qs_compare_conditions(const void *a, const void *b) {
+    float ta = ((const QS_Condition *)a)->threshold;
+    float tb = ((const QS_Condition *)b)->threshold;
+    if (ta < tb)
+        return -1;
+    if (ta > tb)
+        return 1;
+    return 0;
+}
+
+static void _qs_clear_leaves(uint64_t *bv, int first, int last) {
+    int w;
+    int first_word = first / 64;
+    int last_word = last / 64;
+    uint64_t first_mask = ~(uint64_t)0 << (first % 64);
+    uint64_t last_mask = ~(uint64_t)0 >> (63 - last % 64);
+    if (first_word == last_word) {
+        bv[first_word] &= ~(first_mask & last_mask);
+        return;
+    }
+    bv[first_word] &= ~first_mask;
+    for (w = first_word + 1; w < last_word; w++)
+        bv[w] = 0;
+    bv[last_word] &= ~last_mask;
+}
+
+static int _qs_lowest_bit(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int b = 0;
+    while (! (word & 1)) {
+        word >>= 1;
+        b++;
+    }
+    return b;
+#endif
+}
+
+/*
+ * Find the leaf node each tree sends the example to. bitvectors must hold qs->num_words words
+ */
+void quickscorer_find_leaves(QuickScorer *qs, DT_Ensemble ensemble, CV_Example example, float **xlate,
+                             uint64_t *bitvectors, int *leaves) {
+    int i, j, w;
+    float value;
+    
+    for (w = 0; w < qs->num_words; w++)
+        bitvectors[w] = ~(uint64_t)0;
+    
+    for (i = 0; i < qs->num_atts; i++) {
+        if (qs->num_conditions[i] == 0)
+            continue;
+        value = xlate[i][example.distinct_attribute_values[i]];
+        // Splits with threshold <= value send the example right so their left subtrees are out.
+        // Written as !(value < threshold) to match classify_example for NaN values
+        for (j = 0; j < qs->num_conditions[i] && ! (value < qs->conditions[i][j].threshold); j++) {
+            QS_Condition *c = &qs->conditions[i][j];
+            _qs_clear_leaves(bitvectors + qs->word_offset[c->tree], c->first_leaf, c->last_leaf);
+        }
+    }
+    
+    for (i = 0; i < qs->num_trees; i++) {
+        if (qs->is_continuous[i] == FALSE) {
+            classify_example(ensemble.Trees[i], example, xlate, &leaves[i]);
+            continue;
+        }
+        // The exit leaf is the leftmost one still set
+        uint64_t *bv = bitvectors + qs->word_offset[i];
+        for (w = 0; bv[w] == 0; w++)
+            ;
+        leaves[i] = qs->leaf_nodes[i][w*64 + _qs_lowest_bit(bv[w])];
+    }
+}
+
+/*
+ * QuickScorer version of build_prediction_matrix. Produces the same matrix
+ */
+void quickscorer_build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix) {
+    int i, j;
+    int *leaves;
+    uint64_t *bitvectors;
+    QuickScorer qs;
+    
+    matrix->data = (union data_type_union **)malloc(data.meta.num_examples * sizeof(union data_type_union*));
+    for (i = 0; i < data.meta.num_examples; i++)
+        matrix->data[i] = (union data_type_union *)malloc((ensemble.num_trees + 1) * sizeof(union data_type_union));
+    matrix->num_examples = data.meta.num_examples;
+    matrix->num_classifiers = ensemble.num_trees;
+    matrix->additional_cols = 1;
+    matrix->num_classes = data.meta.num_classes;
+    
+    quickscorer_build(ensemble, &qs);
+    bitvectors = (uint64_t *)malloc((qs.num_words + 1) * sizeof(uint64_t));
+    leaves = (int *)malloc((ensemble.num_trees + 1) * sizeof(int));
+    for (i = 0; i < data.meta.num_examples; i++) {
+        matrix->data[i][0].Integer = data.examples[i].containing_class_num;
+        quickscorer_find_leaves(&qs, ensemble, data.examples[i], data.float_data, bitvectors, leaves);
+        for (j = 0; j < ensemble.num_trees; j++)
+            matrix->data[i][j+1].Integer = ensemble.Trees[j][leaves[j]].Node_Value.class_label;
+    }
+    free(leaves);
+    free(bitvectors);
+    quickscorer_free(&qs);
+}
+
+/*
+ * QuickScorer version of build_probability_matrix. Produces the same matrix
+ */
+void quickscorer_build_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix) {
+    int i, j, k;
+    int *leaves;
+    uint64_t *bitvectors;
+    QuickScorer qs;
+    
+    matrix->data = (float **)malloc(data.meta.num_examples * sizeof(float *));
+    for (i = 0; i < data.meta.num_examples; i++)
+        matrix->data[i] = (float *)calloc((ensemble.num_classes), sizeof(float));
+    matrix->num_examples = data.meta.num_examples;
+    matrix->num_classes = data.meta.num_classes;
+    
+    quickscorer_build(ensemble, &qs);
+    bitvectors = (uint64_t *)malloc((qs.num_words + 1) * sizeof(uint64_t));
+    leaves = (int *)malloc((ensemble.num_trees + 1) * sizeof(int));
+    for (i = 0; i < data.meta.num_examples; i++) {
+        quickscorer_find_leaves(&qs, ensemble, data.examples[i], data.float_data, bitvectors, leaves);
+        for (j = 0; j < ensemble.num_trees; j++)
+            for (k = 0; k < data.meta.num_classes; k++)
+                matrix->data[i][k] += ensemble.Trees[j][leaves[j]].class_probs[k]/(double)ensemble.num_trees;
+    }
+    free(leaves);
+    free(bitvectors);
+    quickscorer_free(&qs);
+}
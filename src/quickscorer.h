@@ -0,0 +1,78 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#ifndef __QUICKSCORER__
+#define __QUICKSCORER__
+
+#include <stdint.h>
+
+/*
+ * QuickScorer-style evaluation of a whole ensemble.
+ *
+ * Leaves of each tree are numbered left to right and every tree keeps a bitvector of the leaves
+ * that can still be reached. Each CONTINUOUS split is stored with its attribute, its threshold,
+ * and the range of leaves in its left subtree. An example is scored by walking each attribute's
+ * splits in increasing threshold order and, for every split the example does not satisfy
+ * (value >= threshold), clearing that split's left-subtree leaves. The exit leaf of each tree is
+ * then the leftmost leaf still set. Trees with DISCRETE splits are evaluated with classify_example.
+ */
+
+typedef struct qs_condition_struct {
+    float threshold;
+    int tree;           // Index of the tree in the ensemble
+    int first_leaf;     // Leaves first_leaf..last_leaf are in the left subtree of this split
+    int last_leaf;
+} QS_Condition;
+
+typedef struct quickscorer_struct {
+    int num_trees;
+    int num_atts;               // One more than the largest attribute with a CONTINUOUS split
+    int *num_conditions;        // Number of splits on each attribute
+    QS_Condition **conditions;  // Splits on each attribute sorted by threshold
+    Boolean *is_continuous;     // FALSE if the tree has a DISCRETE split
+    int *num_leaves;            // Number of leaves in each tree
+    int **leaf_nodes;           // Node number of each tree's leaves in left to right order
+    int *word_offset;           // Start of each tree's bitvector in the scratch bitvector
+    int num_words;              // Total length of the scratch bitvector
+} QuickScorer;
+
+void quickscorer_build(DT_Ensemble ensemble, QuickScorer *qs);
+void quickscorer_free(QuickScorer *qs);
+void quickscorer_find_leaves(QuickScorer *qs, DT_Ensemble ensemble, CV_Example example, float **xlate,
+                             uint64_t *bitvectors, int *leaves);
+void quickscorer_build_prediction_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Matrix *matrix);
+void quickscorer_build_probability_matrix(CV_Subset data, DT_Ensemble ensemble, CV_Prob_Matrix *matrix);
+
+#endif // __QUICKSCORER__
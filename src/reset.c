@@ -97,6 +97,8 @@ void reset_CV_Metadata(CV_Metadata *cvm) {
     cvm->num_discrete_values    = NULL;
     cvm->discrete_attribute_map = NULL; 
     cvm->class_names            = NULL; 
+    cvm->discrete_index         = NULL;
+    cvm->class_index            = NULL;
     cvm->num_examples_per_class = NULL; 
     cvm->attribute_types        = NULL;
     cvm->global_offset          = NULL;     
@@ -135,6 +137,10 @@ void reset_DT_Ensemble(DT_Ensemble *dte) {
     dte->attribute_types                 = NULL;
     dte->weights                         = NULL;
     dte->Missing                         = NULL;
+    dte->missing_names                   = NULL;
+    dte->mapped_trees                    = NULL;
+    dte->mapped_size                     = 0;
+    dte->lazy_trees                      = NULL;
     return;
 }
 
@@ -200,6 +206,11 @@ void reset_Args_Opts(Args_Opts *d) {
     d->minimum_examples=0;
     d->split_method=0;
     d->save_trees=0;
+    d->binary_trees=0;
+    d->stream_trees=0;
+    d->checkpoint_interval=0;
+    d->resume=0;
+    d->add_trees=0;
     d->random_forests=0;
     d->extr_random_trees=0;
     d->totl_random_trees=0;
@@ -245,6 +256,9 @@ void reset_Args_Opts(Args_Opts *d) {
     // diversity options
     d->kappa_plot_data=0;
     
+    // prune_trees options
+    d->prune_tolerance=0;
+    
     // deviation type for standardizing outlier metric in proximity
     d->deviation_type=0;
     d->sort_line_num=0;
@@ -269,6 +283,7 @@ void reset_Args_Opts(Args_Opts *d) {
     d->oob_file=0;
     d->prox_sorted_file=0;
     d->prox_matrix_file=0;
+    d->pruned_trees_file=0;
     
     // Output option
     d->output_accuracies=0;
@@ -287,6 +302,14 @@ void reset_Args_Opts(Args_Opts *d) {
     d->do_margin_ensemble_majority_vote=0;
     d->do_probabilistic_majority_vote=0;
     d->do_scaled_probabilistic_majority_vote=0;
+    d->early_exit_voting=0;
+    d->scoring_engine=0;
+    d->max_tree_memory=0;
+    d->num_threads=0;
+    d->data_cache=0;
+    d->out_of_core=0;
+    d->scratch_dir=0;
+    d->test_batch_size=0;
 
     // Unpublished options
     d->debug=0;
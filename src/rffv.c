@@ -151,7 +151,7 @@ int main (int argc, char **argv) {
         train_ivote(Trainset, Testset, -1, &Cache, Args);
     } else {
         train(&Trainset, &Ensemble, -1, Args);
-        if (Args.save_trees)
+        if (Args.save_trees && ! Args.stream_trees)
 	    save_ensemble(Ensemble, Trainset.meta, -1, Args, Trainset.meta.num_classes);
         free_DT_Ensemble(Ensemble, TRAIN_MODE);
     }
@@ -212,6 +212,11 @@ void display_usage( void ) {
     printf("                       They are applied left to right.\n");
     printf("    --truth-column=S : Location of the truth column. S = first or last\n");
     printf("                       Default = last\n");
+    printf("    --data-cache     : Save the parsed data next to the data file as FILE.avbin\n");
+    printf("                       and load it instead of the text on later runs\n");
+    printf("    --out-of-core[=DIR] : Keep the training data and tree-building partitions in\n");
+    printf("                       scratch files in DIR so they need not fit in memory\n");
+    printf("                       Default DIR = the data file's directory\n");
     printf("\n");
     printf("tree-building options:\n");
     printf("    -n, --num-trees=N            : Build N trees. Default = 1\n");
@@ -239,6 +244,8 @@ void display_usage( void ) {
     printf("        --save-trees             : Write trees to disk\n");
     printf("                                   On by default.\n");
     printf("        --no-save-trees          : Do not write trees to disk\n");
+    printf("        --binary-trees           : Write trees in the binary ensemble format\n");
+    printf("        --stream-trees           : Write each tree as soon as it is built and free it\n");
     printf("\n");
     printf("ensemble options:\n");
     printf("    -B, --bagging=N          : Bagging with N%% of training set examples\n");
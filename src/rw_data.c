@@ -34,10 +34,13 @@ For questions, comments or contributions contact
 Philip Kegelmeyer, wpk@sandia.gov 
 *******************************************************************************/
 #include <assert.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <libgen.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "crossval.h"
 #include "distinct_values.h"
 #include "rw_data.h"
@@ -50,12 +53,61 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "memory.h"
 #include "safe_memory.h"
 #include "schema.h"
+#include "mapped_input.h"
+#include "binary_data.h"
+#include "out_of_core.h"
 
 #include <execinfo.h>
 
+// Don't start a thread to parse less than this much of a .data or .test file
+#define MIN_BYTES_PER_PARSE_THREAD 262144
+
+typedef enum {
+    EXAMPLE_LINE,
+    COMMENT_LINE,
+    SHORT_LINE
+} Line_Kind;
+
+// What was found on one non-blank line of a .data or .test file
+typedef struct parsed_line_struct {
+    Line_Kind kind;
+    char *text;                     // The whole line, for comment lines
+    int num_elements;               // For lines with too few values
+    int *distinct_attribute_values; // Translated discrete values, 0 for continuous values, -1 for missing values
+    float *staged_values;           // The continuous values
+    int containing_class_num;
+    int num_errors;                 // Number of values on this line that could not be translated
+} Parsed_Line;
+
+// A discrete value or class that could not be translated
+typedef struct parse_error_struct {
+    int att;                        // -1 for the class
+    int column;
+    char *value;                    // Points into the line
+} Parse_Error;
+
+// One chunk of whole lines and what one thread found in it
+typedef struct parse_chunk_struct {
+    char *start;
+    char *end;
+    CV_Metadata *meta;
+    int *att_columns;               // The column holding each attribute
+    int class_column;
+    int min_elements;
+    int num_continuous_atts;
+    int num_lines;
+    int num_example_lines;
+    Parsed_Line *lines;
+    int num_errors;
+    Parse_Error *errors;
+} Parse_Chunk;
+
 // Forward declarations of prototypes for helper functions.
 void update_skipped_features(int num_attributes, Args_Opts *args);
 void _show_skipped_features(FILE* fh, const char* msg, int num_skipped, const int* skipped);
+static void *_parse_data_chunk(void *arg);
+static void _add_parse_error(Parse_Chunk *c, int *num_malloced_errors, int att, int column, char *value);
+static void _read_ensemble_missing_values(CV_Subset *sub, Att_Handling *atts, Args_Opts *args);
 
 void read_metadata(FC_Dataset *ds, CV_Metadata *meta, Args_Opts *args) {
     int i;
@@ -724,24 +776,35 @@ int add_fold_data(int num_folds, CV_Dataset dataset, CV_Subset *subset, int **fo
 //Use argsIn to remember the pointers that were passed in, so that it's easy to tell which ones changed in args locally
 int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedBlobArray *blob, char *ext, Args_Opts *args) {
     Args_Opts* argsIn = args;
-    int i, j, k, all_atts;
+    int i, j, k, l, all_atts;
     char *filename = NULL;
-    FILE *fh = NULL;
-    //char strbuf[262144];
-    char *strbuf;
+    char *string = NULL;
+    Boolean is_a_string = FALSE;
+    Boolean use_cache;
+    Input_Text input;
     int num_elements;
-    char **elements;
+    char **elements = NULL;
+    int num_malloced_elements = 0;
+    char *text;
+    size_t text_length;
+    int num_chunks;
+    Parse_Chunk *chunks;
+    pthread_t *threads;
+    Parsed_Line *lines;
+    Parsed_Line *line;
+    Parse_Error *errors;
+    int num_lines, num_errors, num_example_lines, next_error;
     AV_ReturnCode rc;
+    Att_Handling atts;
     
     // Set up stuff for filling in missing values
     int disc_count, cont_count; // Keep separate track of which discrete and which continuous att we're on
                                 // Both start at 0 and go to num_discrete_atts and num_continuous_atts, respectively
     int *num_continuous_exs;    // Array holding number of examples with non-missing values for continuous attribute
     int *num_discrete_exs;      // Array holding number of examples with non-missing values for discrete attribute
-    char *this_att;             // The current attribute value's character representation
     float **continuous_values;  // Array holding continuous att values for each continuous att and each example
     int **discrete_values;      // Array holding discrete att value index for each discrete att and each example
-    int sizeof_cont_disc_val = 1000;    // Current size of continuous_values and discrete_values
+    float **staged_values;      // Array holding continuous att values for each example until they can be translated
     int num_continuous_atts = 0;
     int num_discrete_atts = 0;
     for (i = 0; i < data->meta.num_attributes; i++) {
@@ -750,14 +813,11 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
         else if (data->meta.attribute_types[i] == CONTINUOUS)
             num_continuous_atts++;
     }
-    num_continuous_exs = (int *)calloc(num_continuous_atts, sizeof(int));
-    continuous_values = (float **)malloc(num_continuous_atts * sizeof(float *));
-    for (i = 0; i < num_continuous_atts; i++)
-        continuous_values[i] = (float *)malloc(sizeof_cont_disc_val * sizeof(float));
-    num_discrete_exs = (int *)calloc(num_discrete_atts, sizeof(int));
-    discrete_values = (int **)malloc(num_discrete_atts * sizeof(int *));
-    for (i = 0; i < num_discrete_atts; i++)
-        discrete_values[i] = (int *)malloc(sizeof_cont_disc_val * sizeof(int));
+    
+    int ex_num;
+    int num_class_xlate_errors = 0;
+    int num_att_xlate_errors = 0;
+    int line_num = 1;
     
     sub->meta.num_classes = data->meta.num_classes;
     sub->meta.num_attributes = data->meta.num_attributes;
@@ -766,54 +826,159 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
     sub->meta.attribute_types = data->meta.attribute_types;
     sub->meta.num_discrete_values = data->meta.num_discrete_values;
     sub->meta.discrete_attribute_map = data->meta.discrete_attribute_map;
+    sub->meta.discrete_index = data->meta.discrete_index;
+    sub->meta.class_index = data->meta.class_index;
     sub->meta.exo_data.num_seq_meshes = data->meta.exo_data.num_seq_meshes;
     free(sub->meta.num_examples_per_class);
     sub->meta.num_examples_per_class = (int *)calloc(class->num_classes, sizeof(int));
     data->meta.num_examples = 0;
     
-    // Allocate one tree and one set of high/low for each attribute
-    init_att_handling(sub->meta);
-    
-    if (! strcmp(ext, "data")){
+    if (! strcmp(ext, "data")) {
         filename = av_strdup(args->datafile);
-        if (args->train_file_is_a_string == TRUE){
-	        fh = fmemopen(args->train_string, strlen(args->train_string), "r");
-    	}
-    	else {
-            if ((fh = fopen(filename, "r")) == NULL) {
-                fprintf(stderr, "Failed to open file \"%s\" for reading.\n", filename);
-                return 0;
-    	    }
+        string = args->train_string;
+        is_a_string = args->train_file_is_a_string;
+    } else if (! strcmp(ext, "test")) {
+        filename = av_strdup(args->test_file);
+        string = args->test_string;
+        is_a_string = args->test_file_is_a_string;
+    }
+    
+    // Load the dataset cache instead if it is still good. For test data it depends on the missing values,
+    // which have to be known first
+    use_cache = args->data_cache == TRUE && is_a_string == FALSE &&
+                (strcmp(ext, "test") || args->partitions_filename == NULL);
+    if (use_cache) {
+        if (! strcmp(ext, "test") && args->do_training == FALSE)
+            _read_ensemble_missing_values(sub, NULL, args);
+        if (read_binary_data(filename, data, sub, class, blob, ext, args)) {
+            if (! strcmp(ext, "data"))
+                page_out_examples(sub, *args);
+            free(filename);
+            find_int_release();
+            return 1;
         }
     }
-    else if (! strcmp(ext, "test")){
-        filename = av_strdup(args->test_file);
-    	if (args->test_file_is_a_string == TRUE){
-	    fh = fmemopen(args->test_string, strlen(args->test_string), "r");
-    	}
-    	else {
-            if ((fh = fopen(filename, "r")) == NULL) {
-                fprintf(stderr, "Failed to open file \"%s\" for reading.\n", filename);
-                return 0;
-    	    }
-       }
+    
+    // Allocate one tree and one set of high/low for each attribute
+    init_att_handling(sub->meta, &atts);
+    
+    // The lines are split in place so the view has to be writable
+    if (! open_input_text(filename, string, is_a_string, TRUE, &input)) {
+        fprintf(stderr, "Failed to open file \"%s\" for reading.\n", filename);
+        return 0;
     }
+    text = input.text;
+    text_length = input.length;
+    
+    // Work out which column holds each attribute, allowing for skips
+    // Loop over all features but we'll skip args->num_skipped_features to be left with data.num_attributes
+    int *att_columns = (int *)malloc(sub->meta.num_attributes * sizeof(int));
+    for (j = 0; j < sub->meta.num_attributes; j++)
+        att_columns[j] = -1;
+    j = -1; // This is the index for the current attribute allowing for skips
+    for (all_atts = 0; all_atts < data->meta.num_attributes + args->num_skipped_features; all_atts++) {
+        if (args->truth_column > 0 && all_atts+1 >= args->truth_column &&
+            find_int(all_atts+2, args->num_skipped_features, args->skipped_features)) {
+            // The current attribute is in a column past the truth column so look for the
+            // attribute number + 2 (extra +1 is because all_atts is 0-based) in the list
+            // of features to skip since the list is based on column number and not attribute number
+            continue;
+        }
+        if (args->truth_column > 0 && all_atts+1 < args->truth_column &&
+            find_int(all_atts+1, args->num_skipped_features, args->skipped_features)) {
+            // The current attribute is before the truth column so attribute number corresponds
+            // to column number.
+            continue;
+        }
+        if (args->truth_column < 0 &&
+            find_int(all_atts+1, args->num_skipped_features, args->skipped_features)) {
+            // The truth column is last so all attributes are before the truth column
+            continue;
+        }
+        j++;
+        att_columns[j] = all_atts + (all_atts < args->truth_column-1 ? 0 : 1);
+    }
+    
+    // Split the text into one chunk of whole lines per thread. Small files aren't worth the threads
+    num_chunks = args->num_threads > 0 ? args->num_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_chunks > text_length / MIN_BYTES_PER_PARSE_THREAD)
+        num_chunks = text_length / MIN_BYTES_PER_PARSE_THREAD;
+    if (num_chunks < 1)
+        num_chunks = 1;
+    chunks = (Parse_Chunk *)calloc(num_chunks, sizeof(Parse_Chunk));
+    for (i = 0; i < num_chunks; i++) {
+        chunks[i].meta = &sub->meta;
+        chunks[i].att_columns = att_columns;
+        chunks[i].class_column = args->truth_column - 1;
+        chunks[i].min_elements = data->meta.num_attributes + args->num_skipped_features + 1;
+        chunks[i].num_continuous_atts = num_continuous_atts;
+        chunks[i].start = i == 0 ? text : chunks[i-1].end;
+        chunks[i].end = text + text_length;
+        if (i < num_chunks - 1 && chunks[i].start < text + text_length * (i+1) / num_chunks) {
+            char *eol = memchr(text + text_length * (i+1) / num_chunks, '\n',
+                               text_length - text_length * (i+1) / num_chunks);
+            if (eol != NULL)
+                chunks[i].end = eol + 1;
+        } else if (i < num_chunks - 1) {
+            chunks[i].end = chunks[i].start;
+        }
+    }
+    
+    // Parse the chunks at the same time; this thread takes the first one
+    threads = (pthread_t *)malloc(num_chunks * sizeof(pthread_t));
+    for (i = 1; i < num_chunks; i++)
+        if (pthread_create(&threads[i], NULL, _parse_data_chunk, &chunks[i]) != 0)
+            break;
+    for (k = i; k < num_chunks; k++)
+        _parse_data_chunk(&chunks[k]);
+    _parse_data_chunk(&chunks[0]);
+    for (k = 1; k < i; k++)
+        pthread_join(threads[k], NULL);
+    free(threads);
+    
+    // Put the lines and errors back together in file order
+    num_lines = num_errors = num_example_lines = 0;
+    for (i = 0; i < num_chunks; i++) {
+        num_lines += chunks[i].num_lines;
+        num_errors += chunks[i].num_errors;
+        num_example_lines += chunks[i].num_example_lines;
+    }
+    lines = (Parsed_Line *)malloc(num_lines * sizeof(Parsed_Line));
+    errors = (Parse_Error *)malloc(num_errors * sizeof(Parse_Error));
+    num_lines = num_errors = 0;
+    for (i = 0; i < num_chunks; i++) {
+        // A chunk with no lines or no errors never allocated the array
+        if (chunks[i].num_lines > 0)
+            memcpy(lines + num_lines, chunks[i].lines, chunks[i].num_lines * sizeof(Parsed_Line));
+        if (chunks[i].num_errors > 0)
+            memcpy(errors + num_errors, chunks[i].errors, chunks[i].num_errors * sizeof(Parse_Error));
+        num_lines += chunks[i].num_lines;
+        num_errors += chunks[i].num_errors;
+        free(chunks[i].lines);
+        free(chunks[i].errors);
+    }
+    free(chunks);
+    free(att_columns);
+    
+    // Everything that depends on the order of the lines is done here, in order
+    num_continuous_exs = (int *)calloc(num_continuous_atts, sizeof(int));
+    continuous_values = (float **)malloc(num_continuous_atts * sizeof(float *));
+    for (i = 0; i < num_continuous_atts; i++)
+        continuous_values[i] = (float *)malloc(num_example_lines * sizeof(float));
+    num_discrete_exs = (int *)calloc(num_discrete_atts, sizeof(int));
+    discrete_values = (int **)malloc(num_discrete_atts * sizeof(int *));
+    for (i = 0; i < num_discrete_atts; i++)
+        discrete_values[i] = (int *)malloc(num_example_lines * sizeof(int));
+    data->examples = (CV_Example *)realloc(data->examples, (num_example_lines > 0 ? num_example_lines : 1) * sizeof(CV_Example));
+    staged_values = (float **)malloc(num_example_lines * sizeof(float *));
+    next_error = 0;
     
-    //while (fscanf(fh, "%[^\n]", strbuf) > 0 || fscanf(fh, "%[\n]", strbuf) > 0) {
-    while (read_line(fh, &strbuf) > 0) {
-        //if (strbuf[0] == '\n')
-        //    continue;
+    for (l = 0; l < num_lines; l++) {
+        line = &lines[l];
         
-        strip_lt_whitespace(strbuf);
-        if (*strbuf == '\0')
-            continue;
-
-        //parse_comma_sep_string(strbuf, &num_elements, &elements);
-        parse_delimited_string(',', strbuf, &num_elements, &elements);
-        //printf("Got %d elements processing '%s'\n",num_elements, strbuf);
-        free(strbuf);
-
-        if (elements[0][0] == '#') {
+        if (line->kind == COMMENT_LINE) {
+            split_delimited_string(',', line->text, &num_elements, &elements, &num_malloced_elements);
+            
             // Look and process labels
             int found_label = 0;
             // Split elements[0] on spaces
@@ -835,10 +1000,7 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
                 // Process attribute labels
                 
                 // First, replace elements[0] with first label (i.e. remove '#labels') so elements holds the labels
-                char *temp;
-                temp = (char *)malloc(strlen(elements[0]) * sizeof(char));
-                temp = strstr(elements[0], tkns[found_label]);
-                elements[0] = av_strdup(temp);
+                elements[0] = strstr(elements[0], tkns[found_label]);
                 // printf("Got %d attributes, %d skipped features, %d elements\n", sub->meta.num_attributes, args->num_skipped_features, num_elements);
                 if (sub->meta.num_attributes + args->num_skipped_features + 1 != num_elements) { // +1 for the class column
                     fprintf(stderr, "ERROR: .%s file has %d columns but should have %d\n",
@@ -884,106 +1046,89 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
             for (k = 0; k < num_tkns; k++)
                 free(tkns[k]);
             free(tkns);
-            for (k = 0; k < num_elements; k++)
-                free(elements[k]);
-            free(elements);
             
             // Ignore comments
             continue;
         }
 
         // Make sure we have enough elements for all attributes (including skipped ones) and the true class
-        if (num_elements < data->meta.num_attributes + args->num_skipped_features + 1){
+        if (line->kind == SHORT_LINE) {
             fprintf(stderr, "Expected at least %d+%d+1 values but read %d ... skipping\n",
-                                                        data->meta.num_attributes, args->num_skipped_features, num_elements);
+                                                        data->meta.num_attributes, args->num_skipped_features, line->num_elements);
             continue;
         }
         
         // We now have a valid example ...
-        data->meta.num_examples++;
-        j = -1; // This is the index for the current attribute allowing for skips
+        ex_num = data->meta.num_examples++;
         disc_count = 0;
         cont_count = 0;
         
-        // Make sure arrays of values for missing value computation are big enough
-        while (data->meta.num_examples > sizeof_cont_disc_val) {
-            sizeof_cont_disc_val *= 2;
-            for (i = 0; i < num_continuous_atts; i++)
-                continuous_values[i] = (float *)realloc(continuous_values[i], sizeof_cont_disc_val * sizeof(float));
-            for (i = 0; i < num_discrete_atts; i++)
-                discrete_values[i] = (int *)realloc(discrete_values[i], sizeof_cont_disc_val * sizeof(int));
+        data->examples[ex_num].global_id_num = data->examples[ex_num].fclib_id_num = ex_num;
+        data->examples[ex_num].fclib_seq_num = 0;
+        data->examples[ex_num].predicted_class_num = -1;
+        data->examples[ex_num].distinct_attribute_values = line->distinct_attribute_values;
+        data->examples[ex_num].containing_class_num = line->containing_class_num;
+        staged_values[ex_num] = line->staged_values;
+        
+        // Report the values that could not be translated
+        for (k = 0; k < line->num_errors; k++, next_error++) {
+            Parse_Error *e = &errors[next_error];
+            if (e->att < 0) {
+                // This is an invalid class
+                if (args->output_accuracies == ON) {
+                    num_class_xlate_errors++;
+                    fprintf(stderr, "Invalid class '%s': line %d of %s\n", e->value, line_num, filename);
+                }
+                continue;
+            }
+            num_att_xlate_errors++;
+            all_atts = e->column - (e->column > args->truth_column-1 ? 1 : 0);
+            fprintf(stderr, "Invalid value (%s) for attribute %d: line %d of %s\n",
+                             e->value, all_atts+1, line_num, filename);
+            printf("Failed to find '%s' in [", e->value);
+            for (i = 0; i < sub->meta.num_discrete_values[e->att]; i++)
+                printf("'%s',", sub->meta.discrete_attribute_map[e->att][i]);
+            printf("\b]\n");
         }
         
         // Build tree for getting distinct values for continuous attributes
         // Also, temporarily store data for filling in missing values
-        
-        // Loop over all features but we'll skip args->num_skipped_features to be left with data.num_attributes
-        for (all_atts = 0; all_atts < data->meta.num_attributes + args->num_skipped_features; all_atts++) {
-            if (args->truth_column > 0 && all_atts+1 >= args->truth_column &&
-                find_int(all_atts+2, args->num_skipped_features, args->skipped_features)) {
-                // The current attribute is in a column past the truth column so look for the
-                // attribute number + 2 (extra +1 is because all_atts is 0-based) in the list
-                // of features to skip since the list is based on column number and not attribute number
-                //printf("Skipping this att because %d+1 is in the list of features to skip\n", all_atts+1);
-                continue;
-            }
-            if (args->truth_column > 0 && all_atts+1 < args->truth_column &&
-                find_int(all_atts+1, args->num_skipped_features, args->skipped_features)) {
-                // The current attribute is before the truth column so attribute number corresponds
-                // to column number.
-                //printf("Skipping this att because %d is in the list of features to skip\n", all_atts+1);
-                continue;
-            }
-            if (args->truth_column < 0 &&
-                find_int(all_atts+1, args->num_skipped_features, args->skipped_features)) {
-                // The truth column is last so all attributes are before the truth column
-                //printf("Skipping this att because %d is in the list of features to skip\n", all_atts+1);
-                continue;
-            }
-            
-            //printf("Processing feature %d\n", all_atts);
-            j++; // This is the index for the current attribute allowing for skips
-            //printf("Global (1-based) feature %d is this run's (1-based) feature %d\n", all_atts+1, j+1);
-            
-            //printf("Using column %d for this att\n", all_atts + (all_atts < args->truth_column-1 ? 0 : 1));
-            this_att = av_strdup(elements[all_atts + (all_atts < args->truth_column-1 ? 0 : 1)]);
-            //printf("Read '%s' as att value\n", this_att);
-            int dv = process_attribute_char_value(this_att, j, sub->meta);
-            /*
-            if(dv == -1)
-            {
-              fprintf(stderr, "Failed to find attribute \"%s\".\n", this_att);
-              return 0;
-            }
-            */
+        // Discrete values were translated by the parse. Continuous values are staged until the distinct values
+        // are known and missing values have -1 in distinct_attribute_values until the missing values are known
+        for (j = 0; j < sub->meta.num_attributes; j++) {
             if (sub->meta.attribute_types[j] == DISCRETE) {
-                if (strcmp(this_att, "?")) {
-                    discrete_values[disc_count][num_discrete_exs[disc_count]++] = dv;
-                }
+                if (line->distinct_attribute_values[j] != -1)
+                    discrete_values[disc_count][num_discrete_exs[disc_count]++] = line->distinct_attribute_values[j];
                 disc_count++;
             } else if (sub->meta.attribute_types[j] == CONTINUOUS) {
-                if (strcmp(this_att, "?")) {
+                if (line->distinct_attribute_values[j] != -1) {
+                    float value = line->staged_values[cont_count];
+                    process_attribute_float_value(value, j, &atts);
                     // Add continous attribute value to array for missing value computation
-                    continuous_values[cont_count][num_continuous_exs[cont_count]++] = atof(this_att);
+                    continuous_values[cont_count][num_continuous_exs[cont_count]++] = value;
                 }
                 cont_count++;
             }
-            free(this_att);
         }
-
-        for (i = 0; i < num_elements; i++)
-            free(elements[i]);
-        free(elements);
-
+        
+        // Populate the class for this example
+        if (data->examples[ex_num].containing_class_num >= 0) {
+            sub->meta.num_examples_per_class[data->examples[ex_num].containing_class_num]++;
+            class->class_frequencies[data->examples[ex_num].containing_class_num]++;
+        }
+        
+        line_num++;
     }
+    free(lines);
+    free(errors);
+    free(elements);
+    close_input_text(&input);
 
     if (data->meta.num_examples == 0) {
         fprintf(stderr, "No examples found in the .%s file: '%s'\n", ext, filename);
 	return 0;
     }
     
-    fclose(fh);
-    
     data->examples = (CV_Example *)realloc(data->examples, data->meta.num_examples * sizeof(CV_Example));
     if (!data->meta.global_offset)
     {
@@ -1005,7 +1150,7 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
         if (args->do_training == TRUE) {
             for (i = 0; i < sub->meta.num_attributes; i++)
                 if (sub->meta.attribute_types[i] == CONTINUOUS)
-                    process_attribute_float_value(sub->meta.Missing[i].Continuous, i);
+                    process_attribute_float_value(sub->meta.Missing[i].Continuous, i, &atts);
         // If we didn't train, then we don't know the missing values yet.
         // In this case, use a throw-away ensemble to read the metadata in the trees file to get them
         } else {
@@ -1053,7 +1198,7 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
 /* NEED TO FIGURE OUT WHAT MISSING VALUES TO USE WHEN DOING TESTING SINCE WE HAVE MULTIPLTE SETS */
                     for (i = 0; i < junk_ensemble.num_attributes; i++)
                         if (junk_ensemble.attribute_types[i] == CONTINUOUS)
-                            process_attribute_float_value(junk_ensemble.Missing[i].Continuous, i);
+                            process_attribute_float_value(junk_ensemble.Missing[i].Continuous, i, &atts);
                     fclose(tree_file);
                     free_DT_Ensemble(junk_ensemble, TEST_MODE);
                 }
@@ -1067,45 +1212,13 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
                 free(dp);
                 free(tf);
             } else {
-                DT_Ensemble junk_ensemble = {0};
-                char *tree_filename = build_output_filename(-1, args->trees_file, *args);
-                FILE *tree_file;
-                
-                // Initialize
-                junk_ensemble.num_classes = 0;
-                junk_ensemble.num_attributes = 0;
-                junk_ensemble.num_trees = 0;
-                
-                // Open tree file
-                if (args->trees_file_is_a_string == TRUE){
-                  tree_file = fmemopen(args->trees_string, strlen(args->trees_string), "r");
-                } else {
-                  if ((tree_file = fopen(tree_filename, "r")) == NULL) {
-                    fprintf(stderr, "Failed to open file for reading trees: '%s'\nExiting ...\n", tree_filename);
-                    exit(8);
-                  }
-                }
-
-                read_ensemble_metadata(tree_file, &junk_ensemble, 1, args);
-                free(sub->meta.Missing);
-                sub->meta.Missing = (union data_point_union *)malloc(junk_ensemble.num_attributes * sizeof(union data_point_union));
-                for (i = 0; i < junk_ensemble.num_attributes; i++) {
-                    if (junk_ensemble.attribute_types[i] == CONTINUOUS) {
-                        process_attribute_float_value(junk_ensemble.Missing[i].Continuous, i);
-                        sub->meta.Missing[i].Continuous = junk_ensemble.Missing[i].Continuous;
-                    } else if (junk_ensemble.attribute_types[i] == DISCRETE) {
-                        sub->meta.Missing[i].Discrete = junk_ensemble.Missing[i].Discrete;
-                    }
-                }
-                free(tree_filename);
-                fclose(tree_file);
-                free_DT_Ensemble(junk_ensemble, TEST_MODE);
+                _read_ensemble_missing_values(sub, &atts, args);
             }
         }
     }
 
     // Create the float array to translate int back to float for each attribute
-    create_float_data(sub);
+    create_float_data(sub, &atts);
     
     // Free up temp storage of values
     for (i = 0; i < num_continuous_atts; i++)
@@ -1118,143 +1231,42 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
     free(num_discrete_exs);
     
     /*
-     * Read data file again and populate the distinct_attribute_value array
+     * Populate the distinct_attribute_value array from the values staged while reading
+     * continuous attributes get the index into float_data
+     * discrete attributes get the index of the discrete attribute value
      */
-
-    if (args->test_file_is_a_string == TRUE){
-	fh = fmemopen(args->test_string, strlen(args->test_string), "r");
-    } else {
-        if ((fh = fopen(filename, "r")) == NULL) {
-                fprintf(stderr, "Failed to open .%s file: '%s'\n", ext, filename);
-                return 0;
-    	 }
-    }
-    
-    
-    
-    int ex_num = -1;
-    int num_class_xlate_errors = 0;
-    int num_att_xlate_errors = 0;
-    int line_num = 1;
-    //while (fscanf(fh, "%[^\n]", strbuf) > 0 || fscanf(fh, "%[\n]", strbuf) > 0) {
-    while (read_line(fh, &strbuf) > 0) {
-        //if (strbuf[0] == '\n') {
-        //    line_num++;
-        //    continue;
-        //}
-        
-        strip_lt_whitespace(strbuf);
-        if (*strbuf == '\0')
-            continue;
-
-        //parse_comma_sep_string(strbuf, &num_elements, &elements);
-        parse_delimited_string(',', strbuf, &num_elements, &elements);
-        free(strbuf);
-
-        // Skip comments
-        if (elements[0][0] == '#') {
-            for (i = 0; i < num_elements; i++)
-                free(elements[i]);
-            free(elements);
-            continue;
-        }
-
-        // Make sure we have enough elements for all attributes and the true class
-        if (num_elements < data->meta.num_attributes + args->num_skipped_features + 1) {
-            fprintf(stderr, "Expected at least %d+%d+1 values but read %d ... skipping\n",
-                                                data->meta.num_attributes, args->num_skipped_features, num_elements);
-            for (i = 0; i < num_elements; i++)
-                free(elements[i]);
-            free(elements);
-            continue;
-        }
-        
-        // We now have a valid example ...
-        ex_num++;
-        j = -1; // This is the index for the current attribute allowing for skips
-
-        // Populate the distinct_attribute_values array for each attribute
-        // continuous attributes get the index into float_data
-        // discrete attributes get the index of the discrete attribute value
-        
-        // Loop over all features but we'll skip args->num_skipped_features to be left with data.num_attributes
-        //printf("Loopin over %d atts\n", data->meta.num_attributes + args->num_skipped_features);
-        for (all_atts = 0; all_atts < data->meta.num_attributes + args->num_skipped_features; all_atts++) {
-        //for (all_atts = 0; all_atts < data->meta.num_attributes; all_atts++) {
-            
-            if (args->truth_column > 0 && all_atts+1 >= args->truth_column &&
-                find_int(all_atts+2, args->num_skipped_features, args->skipped_features)) {
-                // The current attribute is in a column past the truth column so look for the
-                // attribute number + 2 (extra +1 is because all_atts is 0-based) in the list
-                // of features to skip since the list is based on column number and not attribute number
-                //printf("Skipping this att because %d+1 is in the list of features to skip\n", all_atts+1);
-                continue;
-            }
-            if (args->truth_column > 0 && all_atts+1 < args->truth_column &&
-                find_int(all_atts+1, args->num_skipped_features, args->skipped_features)) {
-                // The current attribute is before the truth column so attribute number corresponds
-                // to column number.
-                //printf("Skipping this att because %d is in the list of features to skip\n", all_atts+1);
-                continue;
-            }
-            if (args->truth_column < 0 &&
-                find_int(all_atts+1, args->num_skipped_features, args->skipped_features)) {
-                // The truth column is last so all attributes are before the truth column
-                //printf("Skipping this att because %d is in the list of features to skip\n", all_atts+1);
-                continue;
-            }
-            j++;
-            //printf("Processing global feature %d (%s) and this run's feature %d\n", all_atts, sub->meta.attribute_names[j], j);
-            
-            if (j == 0) { // This is the first attribute seen for this example so init some stuff
-                sub->examples[ex_num].global_id_num = sub->examples[ex_num].fclib_id_num = ex_num;
-                sub->examples[ex_num].fclib_seq_num = 0;
-                sub->examples[ex_num].distinct_attribute_values = (int *)malloc(sub->meta.num_attributes * sizeof(int));
-                rc = av_addBlobToSortedBlobArray(blob, &sub->examples[ex_num], cv_example_compare_by_seq_id);
-                if (rc < 0) {
-                    av_exitIfErrorPrintf(rc, "Failed to add example %d to SBA\n", ex_num);
-                } else if (rc == 0) {
-                    fprintf(stderr, "Example %d already exists in SBA\n", ex_num);
-                }
-            }
-            this_att = av_strdup(elements[all_atts + (all_atts < args->truth_column-1 ? 0 : 1)]);
-            num_att_xlate_errors += add_attribute_char_value(this_att, sub, ex_num, j, all_atts, line_num,
-                                                             filename, args->truth_column, elements);
-            free(this_att);
-        }
-        // Populate the class for this example
-        // The class is in the last column
-        sub->examples[ex_num].predicted_class_num = -1;
-        //printf("Trying to translate a truth value of '%s' using", elements[args->truth_column-1]);
-        //for (i = 0; i < sub->meta.num_classes; i++)
-        //    printf(" '%s'", sub->meta.class_names[i]);
-        //printf("\n");
-        sub->examples[ex_num].containing_class_num =
-                    translate_discrete(sub->meta.class_names, sub->meta.num_classes, elements[args->truth_column-1]);
-        //printf("Incrementing nepc %d\n", sub->examples[ex_num].containing_class_num);
-        //printf("  was %d\n", sub->meta.num_examples_per_class[sub->examples[ex_num].containing_class_num]);
-        if (sub->examples[ex_num].containing_class_num < 0) {
-            // This is an invalid class
-            if (args->output_accuracies == ON) {
-                num_class_xlate_errors++;
-                fprintf(stderr, "Invalid class '%s': line %d of %s\n", elements[args->truth_column-1], line_num, filename);
+    for (ex_num = 0; ex_num < data->meta.num_examples; ex_num++) {
+        cont_count = 0;
+        for (j = 0; j < sub->meta.num_attributes; j++) {
+            if (sub->meta.attribute_types[j] == DISCRETE) {
+                // Use missing value for this attribute
+                if (sub->examples[ex_num].distinct_attribute_values[j] < 0)
+                    sub->examples[ex_num].distinct_attribute_values[j] = sub->meta.Missing[j].Discrete;
+            } else if (sub->meta.attribute_types[j] == CONTINUOUS) {
+                if (sub->examples[ex_num].distinct_attribute_values[j] < 0)
+                    // Use missing value for this attribute
+                    sub->examples[ex_num].distinct_attribute_values[j] = translate(sub->float_data[j],
+                                                                                   sub->meta.Missing[j].Continuous,
+                                                                                   0, sub->high[j] + 1);
+                else
+                    add_attribute_float_value(staged_values[ex_num][cont_count], sub, ex_num, j);
+                cont_count++;
             }
-        } else {
-            sub->meta.num_examples_per_class[sub->examples[ex_num].containing_class_num]++;
-            class->class_frequencies[sub->examples[ex_num].containing_class_num]++;
         }
-        //if (ex_num == 0)
-        //    cv_example_print(sub->examples[ex_num], sub->meta.num_attributes);
+        free(staged_values[ex_num]);
         
-        for (i = 0; i < num_elements; i++)
-            free(elements[i]);
-        free(elements);
-        
-        line_num++;
+        rc = av_appendBlobToSortedBlobArray(blob, &sub->examples[ex_num]);
+        if (rc < 0)
+            av_exitIfErrorPrintf(rc, "Failed to add example %d to SBA\n", ex_num);
+    }
+    free(staged_values);
+    // Sort the examples into the SBA all at once rather than one insertion at a time
+    rc = av_sortSortedBlobArray(blob, cv_example_compare_by_seq_id);
+    if (rc < 0) {
+        av_exitIfErrorPrintf(rc, "Failed to sort the examples in the SBA\n");
+    } else if (rc > 0) {
+        fprintf(stderr, "%d examples already existed in SBA\n", rc);
     }
-    
-    fclose(fh);
-    free(filename);
 
     // FIXME: This might leak memory, but it certainly causes errors if we uncomment things
     /*    
@@ -1264,8 +1276,18 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
 
     find_int_release();
 
-    if (num_class_xlate_errors > 0 || num_att_xlate_errors > 0)
+    if (num_class_xlate_errors > 0 || num_att_xlate_errors > 0) {
+        free(filename);
         return 0;
+    }
+    
+    // Save the translated examples so the next read of this file can skip the parse
+    if (use_cache)
+        save_binary_data(filename, data, sub, ext, args);
+    // With --out-of-core the training data lives in a scratch file from here on
+    if (! strcmp(ext, "data"))
+        page_out_examples(sub, *args);
+    free(filename);
     return 1;
 }
 
@@ -1383,6 +1405,7 @@ int read_names_file(CV_Metadata *meta, CV_Class *class, Args_Opts *args, Boolean
     meta->attribute_types = e_calloc(meta->num_attributes, sizeof(Attribute_Type));
     meta->num_discrete_values = e_calloc(meta->num_attributes, sizeof(int));
     meta->discrete_attribute_map = e_calloc(meta->num_attributes, sizeof(char**));
+    meta->discrete_index = e_calloc(meta->num_attributes, sizeof(Discrete_Index*));
     i = 0;
     for (colID = 0; colID < num_columns; ++colID) {
         Boolean isActivePredictor = schema_attr_is_active(schema, colID) 
@@ -1407,6 +1430,7 @@ int read_names_file(CV_Metadata *meta, CV_Class *class, Args_Opts *args, Boolean
                         schema_get_discrete_value(schema, colID, valID));
                 }
                 meta->discrete_attribute_map[i] = values;
+                meta->discrete_index[i] = build_discrete_index(values, arity);
                 break;
             }
             case UNKNOWN: // fall through
@@ -1429,6 +1453,7 @@ int read_names_file(CV_Metadata *meta, CV_Class *class, Args_Opts *args, Boolean
         free(meta->class_names[i]);
       free(meta->class_names);
       free(meta->num_examples_per_class);
+      free_discrete_index(meta->class_index);
     }
 
     // Fill in the meta data for the class variable.
@@ -1442,6 +1467,7 @@ int read_names_file(CV_Metadata *meta, CV_Class *class, Args_Opts *args, Boolean
         for (valID = 0; valID < arity; ++valID) {
             meta->class_names[valID] = e_strdup(schema_get_class_value(schema, valID));
         }
+        meta->class_index = build_discrete_index(meta->class_names, arity);
         // Cosmin added if statement (09/01/2020)
         if (meta->num_examples_per_class != NULL) free(meta->num_examples_per_class);
         meta->num_examples_per_class = e_calloc(arity, sizeof(int));
@@ -1879,112 +1905,31 @@ int store_predictions_text(CV_Subset test_data, Vote_Cache cache, CV_Matrix matr
         
         // Retain comment lines
         if (strbuf[0] == '#') {
-            fprintf(p_fh, "%s", strbuf);
-            if (args.do_5x2_cv == TRUE && iter_num == 5)
-                fprintf(op_fh, "%s", strbuf);
             // If this is the #labels line, then add other column headers
             // Find first non-'#' and non-' ' character and see if it's "labels "
             int i = 0;
             while (strbuf[i] == '#' || strbuf[i] == ' ')
                 i++;
             if (! strncmp(strbuf + i, "labels ", 7)) {
-                wrote_labels = TRUE;
-                fprintf(p_fh, ",Pred");
-                if (args.do_5x2_cv == TRUE && iter_num == 5)
-                    fprintf(op_fh, ",Pred");
-                if (args.output_margins == TRUE) {
-                    fprintf(p_fh, ",Margin");
-                    if (args.do_5x2_cv == TRUE && iter_num == 5)
-                        fprintf(op_fh, ",Margin");
-                }
-                if (args.output_probabilities == TRUE || args.output_laplacean == TRUE) {
-                    int num_classes = 0;
-                    if (matrix.num_classes > 0)
-                        num_classes = matrix.num_classes;
-                    else if (votes.num_classes > 0)
-                        num_classes = votes.num_classes;
-                    for (j = 0; j < num_classes; j++) {
-                        fprintf(p_fh, ",Pr %s", test_data.meta.class_names[j]);
-                        if (args.do_5x2_cv == TRUE && iter_num == 5)
-                            fprintf(op_fh, ",Pr %s", test_data.meta.class_names[j]);
-                    }
-                }
-            }
-            fprintf(p_fh, "\n");
-            if (args.do_5x2_cv == TRUE && iter_num == 5)
-                fprintf(op_fh, "\n");
-            continue;
-        }
-        
-        // If we've gotten here without echoing the #labels line then there wasn't one. Make it up.
-        if (wrote_labels == FALSE) {
-            wrote_labels = TRUE;
-            fprintf(p_fh, "#labels ");
-            if (args.do_5x2_cv == TRUE && iter_num == 5)
-                fprintf(op_fh, "#labels ");
-            int consec_count = -1;
-            for (j = 0; j < test_data.meta.num_attributes + args.num_skipped_features + 1; j++) {
-                // This is a skipped attribute and we don't know the attribute name so write SKIPPED
-              if (find_int(j+1, args.num_skipped_features, args.skipped_features)) {
-                    fprintf(p_fh, "SKIPPED,");
-                    if (args.do_5x2_cv == TRUE && iter_num == 5)
-                        fprintf(op_fh, "SKIPPED,");
-                    continue;
-                }
-                // This is the truth column so write Truth
-                if (j == args.truth_column-1) {
-                    fprintf(p_fh, "Truth,");
-                    if (args.do_5x2_cv == TRUE && iter_num == 5)
-                        fprintf(op_fh, "Truth,");
-                    continue;
-                }
-                // This is an attribute that we actually used so print its name.
-                consec_count++;
-                fprintf(p_fh, "%s,", test_data.meta.attribute_names[consec_count]);
-                if (args.do_5x2_cv == TRUE && iter_num == 5)
-                    fprintf(op_fh, "%s,", test_data.meta.attribute_names[consec_count]);
-            }
-            fprintf(p_fh, "Pred");
-            if (args.do_5x2_cv == TRUE && iter_num == 5)
-                fprintf(op_fh, "Pred");
-            if (args.output_margins == TRUE) {
-                fprintf(p_fh, ",Margin");
-                if (args.do_5x2_cv == TRUE && iter_num == 5)
-                    fprintf(op_fh, ",Margin");
-            }
-            if (args.output_probabilities == TRUE || args.output_laplacean == TRUE) {
                 int num_classes = 0;
-                //DACIESL: changed this guy up a bit, hope it's ok!
-                if(prob_matrix.num_classes > 0)
-		  num_classes = prob_matrix.num_classes;
-                else if (matrix.num_classes > 0)
+                if (matrix.num_classes > 0)
                     num_classes = matrix.num_classes;
                 else if (votes.num_classes > 0)
                     num_classes = votes.num_classes;
-                for (j = 0; j < num_classes; j++) {
-                    fprintf(p_fh, ",Pr %s", test_data.meta.class_names[j]);
-                    if (args.do_5x2_cv == TRUE && iter_num == 5)
-                        fprintf(op_fh, ",Pr %s", test_data.meta.class_names[j]);
-                }
+                wrote_labels = TRUE;
+                write_prediction_labels(p_fh, strbuf, test_data.meta, num_classes, args);
+                if (args.do_5x2_cv == TRUE && iter_num == 5)
+                    write_prediction_labels(op_fh, strbuf, test_data.meta, num_classes, args);
+            } else {
+                fprintf(p_fh, "%s\n", strbuf);
+                if (args.do_5x2_cv == TRUE && iter_num == 5)
+                    fprintf(op_fh, "%s\n", strbuf);
             }
-            fprintf(p_fh, "\n");
-            if (args.do_5x2_cv == TRUE && iter_num == 5)
-                fprintf(op_fh, "\n");
+            continue;
         }
-        // Duplicate .test or .data file line
-        fprintf(p_fh, "%s", strbuf);
-        if (args.do_5x2_cv == TRUE && iter_num == 5)
-            fprintf(op_fh, "%s", strbuf);
-        free(strbuf);
-        //CV_Example e = test_data.examples[line];
-        // Write predicted class value
-        //if (e.predicted_class_num == -1)
-        //    e.predicted_class_num = find_best_class_from_matrix(line, matrix, args);
-        //fprintf(p_fh, ",%s", test_data.meta.class_names[e.predicted_class_num]);
-        fprintf(p_fh, ",%s", test_data.meta.class_names[pred_data[line]]);
         
         int num_classes = 0;
-        //DACIESL: and again here
+        //DACIESL: changed this guy up a bit, hope it's ok!
         if(prob_matrix.num_classes > 0)
             num_classes = prob_matrix.num_classes;
         else if (matrix.num_classes > 0)
@@ -1992,6 +1937,21 @@ int store_predictions_text(CV_Subset test_data, Vote_Cache cache, CV_Matrix matr
         else if (votes.num_classes > 0)
             num_classes = votes.num_classes;
         
+        // If we've gotten here without echoing the #labels line then there wasn't one. Make it up.
+        if (wrote_labels == FALSE) {
+            wrote_labels = TRUE;
+            write_prediction_labels(p_fh, NULL, test_data.meta, num_classes, args);
+            if (args.do_5x2_cv == TRUE && iter_num == 5)
+                write_prediction_labels(op_fh, NULL, test_data.meta, num_classes, args);
+        }
+        
+        // Duplicate .test or .data file line followed by the predicted class and probabilities
+        double class_probs[num_classes > 0 ? num_classes : 1];
+        if (args.output_probabilities == TRUE || args.output_margins == TRUE || args.output_laplacean == TRUE)
+            for (j = 0; j < num_classes; j++)
+                class_probs[j] = class_data[j][line];
+        write_prediction_line(p_fh, strbuf, test_data.meta.class_names[pred_data[line]], num_classes, class_probs, args);
+        
         if (args.do_5x2_cv == TRUE && iter_num == 5) {
             float probs[num_classes];
             int classes[num_classes];
@@ -1999,47 +1959,12 @@ int store_predictions_text(CV_Subset test_data, Vote_Cache cache, CV_Matrix matr
                 classes[j] = j;
                 //printf("Setting probs[%d] for sample %d to %g\n", j, line, overall_class_data[j][line]/5.0);
                 probs[j] = overall_class_data[j][line]/5.0;
+                class_probs[j] = overall_class_data[j][line]/5.0;
             }
             float_int_array_sort(num_classes, probs-1, classes-1);
-            fprintf(op_fh, ",%s", test_data.meta.class_names[classes[0]]);
+            write_prediction_line(op_fh, strbuf, test_data.meta.class_names[classes[0]], num_classes, class_probs, args);
         }
-        
-        // Write probabilities
-        if (args.output_probabilities == TRUE || args.output_margins == TRUE || args.output_laplacean == TRUE) {
-        //    int *part_sums;
-        //    part_sums = (int *)calloc(matrix.num_classes, sizeof(int));
-        //    for (j = matrix.additional_cols; j < matrix.num_classifiers + matrix.additional_cols; j++)
-        //        part_sums[matrix.data[line][j]]++;
-            if (args.output_margins == TRUE) {
-                float probs[num_classes];
-                for (j = 0; j < num_classes; j++) {
-                    probs[j] = class_data[j][line];
-                }
-                float_array_sort(num_classes, probs-1);
-                fprintf(p_fh, ",%g", probs[num_classes-1] - probs[num_classes-2]);
-                if (args.do_5x2_cv == TRUE && iter_num == 5) {
-                    for (j = 0; j < num_classes; j++) {
-                        probs[j] = overall_class_data[j][line]/5.0;
-                    }
-                    float_array_sort(num_classes, probs-1);
-                    fprintf(op_fh, ",%g", probs[num_classes-1] - probs[num_classes-2]);
-                }
-            }
-            if (args.output_probabilities == TRUE || args.output_laplacean == TRUE) {
-                for (j = 0; j < num_classes; j++) {
-                    //printf("Writing %d.%03d\n", j, line);
-                    fprintf(p_fh, ",%g", class_data[j][line]);
-                    if (args.do_5x2_cv == TRUE && iter_num == 5)
-                        fprintf(op_fh, ",%g", overall_class_data[j][line]/5.0);
-                }
-            }
-        //        fprintf(p_fh, ",%g", (double)part_sums[j] / (double)matrix.num_classifiers);
-        //    free(part_sums);
-        }
-        // End the line
-        fprintf(p_fh, "\n");
-        if (args.do_5x2_cv == TRUE && iter_num == 5)
-            fprintf(op_fh, "\n");
+        free(strbuf);
 
         line++;
         //if (line > test_data.meta.num_examples) {
@@ -2056,6 +1981,61 @@ int store_predictions_text(CV_Subset test_data, Vote_Cache cache, CV_Matrix matr
     return 1;
 }
 
+/*
+ * Writes the #labels line of a .pred file: comment, the test file's own #labels line, or one made
+ * up from the attribute names if comment is NULL, followed by the headers of the prediction columns
+ */
+void write_prediction_labels(FILE *fh, const char *comment, CV_Metadata meta, int num_classes, Args_Opts args) {
+    int j;
+    int consec_count = -1;
+    
+    if (comment != NULL) {
+        fprintf(fh, "%s,", comment);
+    } else {
+        fprintf(fh, "#labels ");
+        for (j = 0; j < meta.num_attributes + args.num_skipped_features + 1; j++) {
+            // This is a skipped attribute and we don't know the attribute name so write SKIPPED
+            if (find_int(j+1, args.num_skipped_features, args.skipped_features))
+                fprintf(fh, "SKIPPED,");
+            // This is the truth column so write Truth
+            else if (j == args.truth_column-1)
+                fprintf(fh, "Truth,");
+            // This is an attribute that we actually used so print its name.
+            else
+                fprintf(fh, "%s,", meta.attribute_names[++consec_count]);
+        }
+    }
+    fprintf(fh, "Pred");
+    if (args.output_margins == TRUE)
+        fprintf(fh, ",Margin");
+    if (args.output_probabilities == TRUE || args.output_laplacean == TRUE)
+        for (j = 0; j < num_classes; j++)
+            fprintf(fh, ",Pr %s", meta.class_names[j]);
+    fprintf(fh, "\n");
+}
+
+/*
+ * Writes one line of a .pred file: the test file line, the predicted class and, if requested,
+ * the margin and the probabilities in class_probs
+ */
+void write_prediction_line(FILE *fh, const char *line, const char *pred_class, int num_classes,
+                           const double *class_probs, Args_Opts args) {
+    int j;
+    
+    fprintf(fh, "%s,%s", line, pred_class);
+    if (args.output_margins == TRUE) {
+        float probs[num_classes];
+        for (j = 0; j < num_classes; j++)
+            probs[j] = class_probs[j];
+        float_array_sort(num_classes, probs-1);
+        fprintf(fh, ",%g", probs[num_classes-1] - probs[num_classes-2]);
+    }
+    if (args.output_probabilities == TRUE || args.output_laplacean == TRUE)
+        for (j = 0; j < num_classes; j++)
+            fprintf(fh, ",%g", class_probs[j]);
+    fprintf(fh, "\n");
+}
+
 /*
  * Not used at the current time
  *
@@ -2453,37 +2433,33 @@ AV_ReturnCode _copy_and_delete_orig(FC_Mesh mesh, char *var_name, FC_Variable **
     #endif
 }
 
-static BST_Node **tree;
-static Tree_Bookkeeping *books;
-static int *high;
-static int *low;
-
-void init_att_handling(CV_Metadata meta) {
+// The caller owns atts so that datasets can be read concurrently
+void init_att_handling(CV_Metadata meta, Att_Handling *atts) {
     int i;
-    tree = (BST_Node **)malloc(meta.num_attributes * sizeof(BST_Node *));
-    books = (Tree_Bookkeeping *)malloc(meta.num_attributes * sizeof(Tree_Bookkeeping));
-    low = (int *)malloc(meta.num_attributes * sizeof(int));
-    high = (int *)malloc(meta.num_attributes * sizeof(int));
-    
-    // Initialize the tree for each attribute on the first example only
-    // Even though we're only using the tree for continuous attributes.
-    // MAY WANT TO LOOK INTO THIS FOR OPTIMIZATION LATER
+    atts->values = (float **)malloc(meta.num_attributes * sizeof(float *));
+    atts->num_values = (int *)calloc(meta.num_attributes, sizeof(int));
+    atts->num_malloced = (int *)malloc(meta.num_attributes * sizeof(int));
+    atts->first_zero = (float *)calloc(meta.num_attributes, sizeof(float));
+    atts->seen_zero = (Boolean *)calloc(meta.num_attributes, sizeof(Boolean));
+    atts->low = (int *)malloc(meta.num_attributes * sizeof(int));
+    atts->high = (int *)malloc(meta.num_attributes * sizeof(int));
+    
+    // Only continuous attributes collect values
     for (i = 0; i < meta.num_attributes; i++) {
-        books[i].num_malloced_nodes = 1000;
-        books[i].next_unused_node = 1;
-        books[i].current_node = 0;
-        tree[i] = (BST_Node *)malloc(books[i].num_malloced_nodes * sizeof(BST_Node));
+        atts->num_malloced[i] = meta.attribute_types[i] == CONTINUOUS ? 1000 : 0;
+        atts->values[i] = (float *)malloc(atts->num_malloced[i] * sizeof(float));
     }
 }
 
-int process_attribute_char_value(char *att_value, int att_index, CV_Metadata meta) {
+int process_attribute_char_value(char *att_value, int att_index, CV_Metadata meta, Att_Handling *atts) {
     int dv = -1;
     
     // If the attribute value is "?" this is a missing value so skip it. We'll fill it in later
     if (meta.attribute_types[att_index] == DISCRETE) {
         if (strcmp(att_value, "?")) {
             // Add discrete attribute value to array for missing value computation
-            dv = translate_discrete(meta.discrete_attribute_map[att_index], meta.num_discrete_values[att_index], att_value);
+            dv = translate_discrete_indexed(meta.discrete_index[att_index], meta.discrete_attribute_map[att_index],
+                                            meta.num_discrete_values[att_index], att_value);
             if (dv == -1) {
                 /*
                 printf("For attribute %d failed to index %s into [", att_index+1, att_value);
@@ -2498,33 +2474,41 @@ int process_attribute_char_value(char *att_value, int att_index, CV_Metadata met
         }
     } else if (meta.attribute_types[att_index] == CONTINUOUS) {
         if (strcmp(att_value, "?"))
-            dv = process_attribute_float_value(atof(att_value), att_index);
+            dv = process_attribute_float_value(fast_atof(att_value), att_index, atts);
     }
     
     return dv;
 }
 
-int process_attribute_float_value(float att_value, int att_index) {
+int process_attribute_float_value(float att_value, int att_index, Att_Handling *atts) {
     int dv = -1;
     //printf("  Handling attribute %d with value %g\n", att_index, att_value);
-    if (books[att_index].current_node == 0) {
-        tree[att_index][0].value = att_value;
-        tree[att_index][0].left = -1;
-        tree[att_index][0].right = -1;
-        low[att_index] = 0;
-        high[att_index] = 0;
-        
-        // current_node == 0 only triggers the initialization. Otherwise we don't care about it.
-        // Increment it only so the initialization is not repeated
-        books[att_index].current_node++;
-    } else {
-        high[att_index] += tree_insert(&tree[att_index], &books[att_index], att_value);
+    // A NaN never compares equal to anything so it can't be translated. Leave it out.
+    if (att_value != att_value)
+        return dv;
+    if (att_value == 0.0) {
+        if (atts->seen_zero[att_index] == FALSE) {
+            atts->seen_zero[att_index] = TRUE;
+            atts->first_zero[att_index] = att_value;
+        }
+        att_value = atts->first_zero[att_index];
+    }
+    
+    // When the values fill up, keep only the distinct ones and only make more room if that didn't free half
+    if (atts->num_values[att_index] == atts->num_malloced[att_index]) {
+        atts->num_values[att_index] = sort_unique_floats(atts->values[att_index], atts->num_values[att_index]);
+        if (atts->num_values[att_index] >= atts->num_malloced[att_index] / 2) {
+            atts->num_malloced[att_index] = atts->num_malloced[att_index] > 0 ? 2 * atts->num_malloced[att_index] : 1000;
+            atts->values[att_index] = (float *)realloc(atts->values[att_index],
+                                                       atts->num_malloced[att_index] * sizeof(float));
+        }
     }
+    atts->values[att_index][atts->num_values[att_index]++] = att_value;
     
     return dv;
 }
 
-void create_float_data(CV_Subset *data) {
+void create_float_data(CV_Subset *data, Att_Handling *atts) {
     int i;
     free(data->float_data);
     free(data->low);
@@ -2536,25 +2520,29 @@ void create_float_data(CV_Subset *data) {
     data->discrete_used = (Boolean *)malloc(data->meta.num_attributes * sizeof(Boolean));
     for (i = 0; i < data->meta.num_attributes; i++) {
         data->discrete_used[i] = FALSE;
-        data->low[i] = low[i];
-        data->high[i] = high[i];
+        atts->num_values[i] = sort_unique_floats(atts->values[i], atts->num_values[i]);
+        atts->low[i] = 0;
+        atts->high[i] = atts->num_values[i] > 0 ? atts->num_values[i] - 1 : 0;
+        data->low[i] = atts->low[i];
+        data->high[i] = atts->high[i];
         if (data->meta.attribute_types[i] == CONTINUOUS) {
-            data->float_data[i] = (float *)malloc((data->high[i] + 1) * sizeof(float));
-            // Check that initialization was done which means the tree has some nodes in it.
-            // If there is a single testing sample and this attribute is continuous and contains '?'
-            //    then the tree was never initialized and tree_to_array with segfault.
-            if (books[i].current_node > 0)
-                tree_to_array(data->float_data[i], tree[i]);
+            // The sorted values become float_data. There may be none if there is a single testing sample
+            // and this attribute is continuous and contains '?'
+            data->float_data[i] = (float *)realloc(atts->values[i], (data->high[i] + 1) * sizeof(float));
             //int j;
             //for (j = data->low[i]; j <= data->high[i]; j++)
             //    printf("FLOAT_DATA[%d][%d] = %g\n", i, j, data->float_data[i][j]);
+        } else {
+            free(atts->values[i]);
         }
-        free(tree[i]);
     }
-    free(tree);
-    free(books);
-    free(high);
-    free(low);
+    free(atts->values);
+    free(atts->num_values);
+    free(atts->num_malloced);
+    free(atts->first_zero);
+    free(atts->seen_zero);
+    free(atts->high);
+    free(atts->low);
 }
 
 int add_attribute_char_value(char *a_val, CV_Subset *sub, int e_num, int a_num, int all_a, int line, char *file, int truth_col, char **elements) {
@@ -2568,7 +2556,8 @@ int add_attribute_char_value(char *a_val, CV_Subset *sub, int e_num, int a_num,
         } else {
             //printf("Looking for '%s' in discrete map for attribute %d\n",
             //          elements[all_atts + (a_num < args.truth_column-1 ? 0 : 1)], a_num);
-            int dv = translate_discrete(sub->meta.discrete_attribute_map[a_num], sub->meta.num_discrete_values[a_num], a_val);
+            int dv = translate_discrete_indexed(sub->meta.discrete_index[a_num], sub->meta.discrete_attribute_map[a_num],
+                                                sub->meta.num_discrete_values[a_num], a_val);
             if (dv < 0) {
                 num_errors++;
                 fprintf(stderr, "Invalid value (%s) for attribute %d: line %d of %s\n",
@@ -2588,7 +2577,7 @@ int add_attribute_char_value(char *a_val, CV_Subset *sub, int e_num, int a_num,
                                                                               sub->meta.Missing[a_num].Continuous,
                                                                               0, sub->high[a_num] + 1);
         } else {
-            add_attribute_float_value(atof(a_val), sub, e_num, a_num);
+            add_attribute_float_value(fast_atof(a_val), sub, e_num, a_num);
         }
     }
     return num_errors;
@@ -2602,6 +2591,9 @@ void add_attribute_float_value(float a_val, CV_Subset *sub, int e_num, int a_num
 void datafile_to_string_array(char *file, int *num_lines, char ***data_lines, int *num_comments, char ***leading_comments) {
     int i;
     FILE *fh;
+    char *strbuf = NULL;
+    int strbuf_size = 0;
+    int num_malloced_lines = 1000;
     if ((fh = fopen(file, "r")) == NULL) {
         fprintf(stderr, "ERROR: %s could not be read\n", file);
         exit(-1);
@@ -2609,12 +2601,18 @@ void datafile_to_string_array(char *file, int *num_lines, char ***data_lines, in
     *num_lines = 0;
     
     // Initialize data_lines and leading_comments
-    *data_lines = (char **)malloc(sizeof(char *));
+    *data_lines = (char **)malloc(num_malloced_lines * sizeof(char *));
     
-    while (read_line(fh, &(*data_lines)[*num_lines]) > 0) {
-        (*num_lines)++;
-        *data_lines = (char **)realloc(*data_lines, ((*num_lines)+1)*sizeof(char *));
+    // Read into one reused buffer and keep an exact-size copy of each line
+    while (read_line_reuse(fh, &strbuf, &strbuf_size) > 0) {
+        if (*num_lines == num_malloced_lines) {
+            num_malloced_lines *= 2;
+            *data_lines = (char **)realloc(*data_lines, num_malloced_lines * sizeof(char *));
+        }
+        (*data_lines)[(*num_lines)++] = av_strdup(strbuf);
     }
+    free(strbuf);
+    fclose(fh);
     
     // Count leading comment lines
     *num_comments = 0;
@@ -2637,15 +2635,14 @@ void datafile_to_string_array(char *file, int *num_lines, char ***data_lines, in
     int orig_num_lines = *num_lines;
     for (i = 0; i < orig_num_lines; i++) {
         if (strchr((*data_lines)[i], '#') != NULL) {
+            free((*data_lines)[i]);
             comment_count++;
             // Update number of data lines
             (*num_lines)--;
         } else {
-            // This is a data line so if there have been some comments, copy this line to the right spot
-            if (comment_count > 0) {
-                free((*data_lines)[i-comment_count]);
-                (*data_lines)[i-comment_count] = av_strdup((*data_lines)[i]);
-            }
+            // This is a data line so if there have been some comments, move this line to the right spot
+            if (comment_count > 0)
+                (*data_lines)[i-comment_count] = (*data_lines)[i];
         }
     }
     
@@ -2733,3 +2730,160 @@ _show_skipped_features(FILE* fh, const char* msg, int num_skipped, const int* sk
         free(range);
     }
 }
+
+/*
+ * Thread body: split each line of one chunk in place, translate its discrete values and class,
+ * and convert its continuous values. Nothing here depends on other lines, so chunks can be
+ * parsed at the same time. Comment lines are left whole for read_data_file
+ */
+static void *_parse_data_chunk(void *arg) {
+    Parse_Chunk *c = (Parse_Chunk *)arg;
+    CV_Metadata *meta = c->meta;
+    char *start = c->start;
+    char *eol, *last;
+    char *this_att;
+    char **elements = NULL;
+    int num_elements;
+    int num_malloced_elements = 0;
+    int num_malloced_lines = 1024;
+    int num_malloced_errors = 0;
+    int j, cont_count, dv;
+    
+    c->lines = (Parsed_Line *)malloc(num_malloced_lines * sizeof(Parsed_Line));
+    c->num_lines = c->num_example_lines = c->num_errors = 0;
+    c->errors = NULL;
+    
+    for (; start < c->end; start = eol + 1) {
+        eol = memchr(start, '\n', c->end - start);
+        if (eol == NULL)
+            eol = c->end;
+        *eol = '\0';
+        
+        // Strip leading and trailing whitespace, which takes care of DOS line endings, and skip blank lines
+        last = eol;
+        while (last > start && isspace(*(last-1)))
+            last--;
+        *last = '\0';
+        while (start < last && isspace(*start))
+            start++;
+        if (start == last)
+            continue;
+        
+        if (c->num_lines == num_malloced_lines) {
+            num_malloced_lines *= 2;
+            c->lines = (Parsed_Line *)realloc(c->lines, num_malloced_lines * sizeof(Parsed_Line));
+        }
+        Parsed_Line *line = &c->lines[c->num_lines++];
+        line->num_errors = 0;
+        
+        if (*start == '#') {
+            line->kind = COMMENT_LINE;
+            line->text = start;
+            continue;
+        }
+        
+        split_delimited_string(',', start, &num_elements, &elements, &num_malloced_elements);
+        if (num_elements < c->min_elements) {
+            line->kind = SHORT_LINE;
+            line->num_elements = num_elements;
+            continue;
+        }
+        
+        line->kind = EXAMPLE_LINE;
+        line->distinct_attribute_values = (int *)malloc(meta->num_attributes * sizeof(int));
+        line->staged_values = (float *)malloc(c->num_continuous_atts * sizeof(float));
+        c->num_example_lines++;
+        
+        cont_count = 0;
+        for (j = 0; j < meta->num_attributes; j++) {
+            if (c->att_columns[j] < 0) {
+                line->distinct_attribute_values[j] = -1;
+                continue;
+            }
+            this_att = elements[c->att_columns[j]];
+            dv = -1;
+            if (meta->attribute_types[j] == DISCRETE) {
+                if (strcmp(this_att, "?")) {
+                    dv = translate_discrete_indexed(meta->discrete_index[j], meta->discrete_attribute_map[j],
+                                                    meta->num_discrete_values[j], this_att);
+                    if (dv < 0) {
+                        _add_parse_error(c, &num_malloced_errors, j, c->att_columns[j], this_att);
+                        line->num_errors++;
+                        dv = 0;
+                    }
+                }
+            } else if (meta->attribute_types[j] == CONTINUOUS) {
+                if (strcmp(this_att, "?")) {
+                    line->staged_values[cont_count] = fast_atof(this_att);
+                    dv = 0;
+                }
+                cont_count++;
+            }
+            line->distinct_attribute_values[j] = dv;
+        }
+        
+        line->containing_class_num = translate_discrete_indexed(meta->class_index, meta->class_names,
+                                                                meta->num_classes, elements[c->class_column]);
+        if (line->containing_class_num < 0) {
+            _add_parse_error(c, &num_malloced_errors, -1, c->class_column, elements[c->class_column]);
+            line->num_errors++;
+        }
+    }
+    
+    free(elements);
+    return NULL;
+}
+
+static void _add_parse_error(Parse_Chunk *c, int *num_malloced_errors, int att, int column, char *value) {
+    if (c->num_errors == *num_malloced_errors) {
+        *num_malloced_errors = *num_malloced_errors > 0 ? 2 * *num_malloced_errors : 16;
+        c->errors = (Parse_Error *)realloc(c->errors, *num_malloced_errors * sizeof(Parse_Error));
+    }
+    c->errors[c->num_errors].att = att;
+    c->errors[c->num_errors].column = column;
+    c->errors[c->num_errors].value = value;
+    c->num_errors++;
+}
+
+/*
+ * Sets the missing values of test data that is read without training to the ones in the ensemble
+ * file and, if atts is not NULL, makes sure the continuous ones are among the distinct values
+ */
+static void _read_ensemble_missing_values(CV_Subset *sub, Att_Handling *atts, Args_Opts *args) {
+    int i;
+    DT_Ensemble junk_ensemble = {0};
+    char *tree_filename = build_output_filename(-1, args->trees_file, *args);
+    FILE *tree_file;
+    
+    // Initialize
+    junk_ensemble.num_classes = 0;
+    junk_ensemble.num_attributes = 0;
+    junk_ensemble.num_trees = 0;
+    
+    // Open tree file
+    if (args->trees_file_is_a_string == TRUE) {
+        tree_file = fmemopen(args->trees_string, strlen(args->trees_string), "r");
+    } else {
+        if ((tree_file = fopen(tree_filename, "r")) == NULL) {
+            fprintf(stderr, "Failed to open file for reading trees: '%s'\nExiting ...\n", tree_filename);
+            exit(8);
+        }
+    }
+    
+    read_ensemble_metadata(tree_file, &junk_ensemble, 1, args);
+    resolve_missing_values(&junk_ensemble, sub->meta, *args);
+    free(sub->meta.Missing);
+    sub->meta.Missing = (union data_point_union *)malloc(junk_ensemble.num_attributes * sizeof(union data_point_union));
+    for (i = 0; i < junk_ensemble.num_attributes; i++) {
+        if (junk_ensemble.attribute_types[i] == CONTINUOUS) {
+            if (atts != NULL)
+                process_attribute_float_value(junk_ensemble.Missing[i].Continuous, i, atts);
+            sub->meta.Missing[i].Continuous = junk_ensemble.Missing[i].Continuous;
+        } else if (junk_ensemble.attribute_types[i] == DISCRETE) {
+            sub->meta.Missing[i].Discrete = junk_ensemble.Missing[i].Discrete;
+        }
+    }
+    free(tree_filename);
+    fclose(tree_file);
+    free_DT_Ensemble(junk_ensemble, TEST_MODE);
+}
@@ -42,6 +42,9 @@ Philip Kegelmeyer, wpk@sandia.gov
 //Modified by DACIESL June-04-08: Laplacean Estimates
 //modified function prototype
 int store_predictions_text(CV_Subset test_data, Vote_Cache cache, CV_Matrix matrix, CV_Voting votes, CV_Prob_Matrix prob_matrix, int fold, Args_Opts args);
+void write_prediction_labels(FILE *fh, const char *comment, CV_Metadata meta, int num_classes, Args_Opts args);
+void write_prediction_line(FILE *fh, const char *line, const char *pred_class, int num_classes,
+                           const double *class_probs, Args_Opts args);
 
 int add_fold_data(int num_folds, CV_Dataset data, CV_Subset *train, int **fold_pop, Args_Opts args);
 int read_opendt_names_file(CV_Dataset *data, CV_Class *class, Args_Opts args);
@@ -50,10 +53,10 @@ int read_data_file(CV_Dataset *data, CV_Subset *sub, CV_Class *class, AV_SortedB
 //int store_predictions_text(CV_Subset test_data, Vote_Cache cache, CV_Matrix matrix, CV_Voting votes, int fold, Args_Opts args);
 int _store_predictions_text(CV_Subset test_data, CV_Matrix matrix, Args_Opts args);
 void read_metadata(FC_Dataset *ds, CV_Metadata *meta, Args_Opts *args);
-void init_att_handling(CV_Metadata meta);
-int process_attribute_char_value(char *att_value, int att_index, CV_Metadata meta);
-int process_attribute_float_value(float att_value, int att_index);
-void create_float_data(CV_Subset *data);
+void init_att_handling(CV_Metadata meta, Att_Handling *atts);
+int process_attribute_char_value(char *att_value, int att_index, CV_Metadata meta, Att_Handling *atts);
+int process_attribute_float_value(float att_value, int att_index, Att_Handling *atts);
+void create_float_data(CV_Subset *data, Att_Handling *atts);
 int add_attribute_char_value(char *a_val, CV_Subset *sub, int e_num, int a_num, int all_a, int line, char *file, int truth_col, char **elements);
 void add_attribute_float_value(float a_val, CV_Subset *sub, int e_num, int a_num);
 void datafile_to_string_array(char *file, int *num_lines, char ***data_lines, int *num_comments, char ***leading_comments);
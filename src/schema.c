@@ -44,6 +44,7 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "array.h"
 #include "datatypes.h"
 #include "read_line_from_string_or_file.h"
+#include "mapped_input.h"
 #include "safe_memory.h"
 #include "util.h"
 
@@ -101,19 +102,15 @@ read_schema(
     
     Schema* schema = (Schema*)e_calloc(1, sizeof(Schema));
     Boolean success = TRUE;
-    FILE* fh = NULL;
+    Input_Text input = {0};
+    char* pos = NULL;
     uint i = 0;
 
     // This loop exists so we can break out if there is an error.
     char* buffer = NULL;
     do {
-	if (namesfile_is_a_file){
-	    fh = fopen(namesfile, "r");
-	}
-	else {
-	  fh = fmemopen((char*)namesfile, strlen(namesfile), "r");	
-	}
-        if (fh == NULL) {
+        // The lines are stripped in place so the view has to be writable
+        if (! open_input_text(namesfile, (char*)namesfile, namesfile_is_a_file ? FALSE : TRUE, TRUE, &input)) {
             fprintf(stderr, "Failed to open .names file: '%s'\n", namesfile);
             success = FALSE;
             break;
@@ -128,13 +125,13 @@ read_schema(
         free(buffer); buffer=NULL;
         uint line_num = 0;
         uint column_count = 0;
-        while (success && read_line(fh, &buffer) > 0) {
+        pos = input.text;
+        while (success && (buffer = next_input_line(&input, &pos)) != NULL) {
             line_num++;
             strip_lt_whitespace(buffer);
 
             // Skip empty lines and comment lines.
             if (*buffer == '\0' || *buffer == '#') {
-                free(buffer); buffer=NULL;
                 continue;
             }
 
@@ -167,11 +164,8 @@ read_schema(
             else {
                 fprintf(stderr, "warning: ignoring line %d with unexpected format in %s\n", line_num, namesfile);
             }
-
-            free(buffer); buffer=NULL;
         } // end reading lines from names file
-        fclose(fh);
-	fh = NULL;
+        buffer = NULL;
         if (!success) { break; }
         
         // Trim excess space from attributes.
@@ -231,10 +225,7 @@ read_schema(
     } while (FALSE);
     free(buffer); buffer=NULL;
 
-    if (fh != NULL) {
-        fclose(fh);
-        fh = NULL;
-    }
+    close_input_text(&input);
     
     // If anything in the read failed, cleanup.
     if (!success) {
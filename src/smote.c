@@ -53,6 +53,7 @@ void smote(CV_Subset *data, CV_Subset *knn_src, AV_SortedBlobArray *blob, Args_O
     int running_count;
     float *new_c_vals; // Keep a running list of continuous values to add
     int *new_d_vals;   // Keep a running list of discrete values to add
+    Att_Handling atts;
     
     //printf("There are %d examples in the dataset\n", data->meta.num_examples);
     // Find the nearest neighbors
@@ -91,7 +92,7 @@ void smote(CV_Subset *data, CV_Subset *knn_src, AV_SortedBlobArray *blob, Args_O
     new_d_vals = (int *)malloc(total_deficit * data->meta.num_attributes * sizeof(int));
     
     // Regenerate the tree for handling the attributes so that the new samples can be added
-    init_att_handling(data->meta);
+    init_att_handling(data->meta, &atts);
     // Since data->examples has been moved due to the realloc, the existing blob points nowhere so regenerate
     av_freeSortedBlobArray(blob);
     av_exitIfError(av_initSortedBlobArray(blob));
@@ -100,14 +101,15 @@ void smote(CV_Subset *data, CV_Subset *knn_src, AV_SortedBlobArray *blob, Args_O
             if (data->meta.attribute_types[j] == DISCRETE) {
                 char *val;
                 val = av_strdup(data->meta.discrete_attribute_map[j][data->examples[i].distinct_attribute_values[j]]);
-                process_attribute_char_value(val, j, data->meta);
+                process_attribute_char_value(val, j, data->meta, &atts);
                 free(val);
             } else if (data->meta.attribute_types[j] == CONTINUOUS) {
-                process_attribute_float_value(data->float_data[j][data->examples[i].distinct_attribute_values[j]], j);
+                process_attribute_float_value(data->float_data[j][data->examples[i].distinct_attribute_values[j]], j, &atts);
             }
         }
-        av_addBlobToSortedBlobArray(blob, &data->examples[i], cv_example_compare_by_seq_id);
+        av_appendBlobToSortedBlobArray(blob, &data->examples[i]);
     }
+    av_sortSortedBlobArray(blob, cv_example_compare_by_seq_id);
     
     // If we have less than 2 examples in a class that gets SMOTEd, skip it
     for (i = 0; i < data->meta.num_classes; i++) {
@@ -185,7 +187,7 @@ Don't do this now. The YEAST dataset HAS valid duplicates
                     new_c_vals[running_count] = ((n - e) * fraction) + e;
                     if (print_new_points)
                         printf("%.16f,", new_c_vals[running_count]);
-                    process_attribute_float_value(new_c_vals[running_count], k);
+                    process_attribute_float_value(new_c_vals[running_count], k, &atts);
                     running_count++;
                 } else if (data->meta.attribute_types[k] == DISCRETE) {
                     int *discrete;
@@ -234,7 +236,7 @@ Don't do this now. The YEAST dataset HAS valid duplicates
     // Instead, in create_float_data() we malloc data->float_data to put it in a new memory location.
     
     // Now do the second step and actually add the data to the dataset
-    create_float_data(data);
+    create_float_data(data, &atts);
     
     // With new float_data, some of the original distinct_attribute_values will be wrong.
     // Recompute all of these before going on:
@@ -250,6 +252,9 @@ Don't do this now. The YEAST dataset HAS valid duplicates
     
     running_count = 0;
     AV_ReturnCode rc;
+    // The new examples are collected separately and merged into blob at the end
+    AV_SortedBlobArray smoted;
+    av_exitIfError(av_initSortedBlobArray(&smoted));
     // Add new, SMOTEd values to the tree
     for (i = 0; i < data->meta.num_classes; i++) {
         for (j = 0; j < class_deficits[i]; j++) {
@@ -264,13 +269,9 @@ Don't do this now. The YEAST dataset HAS valid duplicates
                                                                 (int *)malloc(data->meta.num_attributes * sizeof(int));
                     data->examples[data->meta.num_examples].containing_class_num = i;
                     
-                    rc = av_addBlobToSortedBlobArray(blob, &data->examples[data->meta.num_examples],
-                                                     cv_example_compare_by_seq_id);
-                    if (rc < 0) {
+                    rc = av_appendBlobToSortedBlobArray(&smoted, &data->examples[data->meta.num_examples]);
+                    if (rc < 0)
                         av_exitIfErrorPrintf(rc, "Failed to add SMOTEd example %d to SBA\n", data->meta.num_examples);
-                    } else if (rc == 0) {
-                        fprintf(stderr, "Example %d already exists in SBA\n", data->meta.num_examples);
-                    }
                 }
                 if (data->meta.attribute_types[k] == CONTINUOUS) {
                     //printf("%f ", new_c_vals[running_count]);
@@ -291,6 +292,15 @@ Don't do this now. The YEAST dataset HAS valid duplicates
         }
         data->meta.num_examples_per_class[i] += class_deficits[i];
     }
+    rc = av_sortSortedBlobArray(&smoted, cv_example_compare_by_seq_id);
+    if (rc >= 0)
+        rc = av_mergeSortedBlobArrays(blob, &smoted, cv_example_compare_by_seq_id);
+    if (rc < 0) {
+        av_exitIfErrorPrintf(rc, "Failed to merge the SMOTEd examples into the SBA\n");
+    } else if (rc > 0) {
+        fprintf(stderr, "%d SMOTEd examples already existed in SBA\n", rc);
+    }
+    av_freeSortedBlobArray(&smoted);
     
     free(new_c_vals);
     free(new_d_vals);
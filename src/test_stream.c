@@ -0,0 +1,284 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "crossval.h"
+#include "test_stream.h"
+#include "rw_data.h"
+#include "evaluate.h"
+#include "memory.h"
+#include "reset.h"
+#include "array.h"
+#include "util.h"
+
+static void _write_prediction(FILE *fh, const char *line, int ex, int best_class, CV_Matrix matrix,
+                              CV_Prob_Matrix prob_matrix, CV_Metadata meta, Args_Opts args);
+
+/*
+ * Tests the ensemble on the test file args.test_batch_size examples at a time. names and class
+ * hold the attributes and classes read from the names file; train_meta has the missing values
+ * when training was done in this run.
+ */
+void test_stream(CV_Dataset *names, CV_Class *class, CV_Metadata train_meta, DT_Ensemble ensemble, Args_Opts args) {
+    int i, j;
+    FILE *t_fh, *p_fh = NULL;
+    char *line = NULL;
+    int line_size = 0;
+    char **lines = NULL;
+    int num_lines, num_malloced_lines = 0;
+    int num_batch_examples;
+    char *text;
+    size_t text_length;
+    int *best_class = NULL;
+    Boolean done = FALSE;
+    Boolean wrote_labels = FALSE;
+    int num_tested = 0;
+    int num_correct = 0;
+    long num_correct_votes = 0;
+    long num_votes = 0;
+    long num_evals_saved = args.early_exit_voting == TRUE ? 0 : -1;
+    int **Confusion;
+    
+    if (! strcmp(args.test_file, "-")) {
+        t_fh = stdin;
+    } else if ((t_fh = fopen(args.test_file, "r")) == NULL) {
+        fprintf(stderr, "Failed to open file \"%s\" for reading.\n", args.test_file);
+        exit(-8);
+    }
+    if ((args.output_predictions || args.output_laplacean) && (p_fh = fopen(args.predictions_file, "w")) == NULL) {
+        fprintf(stderr, "Failed to open .pred file for write: '%s'\n", args.predictions_file);
+        exit(-8);
+    }
+    
+    Confusion = (int **)malloc(names->meta.num_classes * sizeof(int *));
+    for (i = 0; i < names->meta.num_classes; i++)
+        Confusion[i] = (int *)calloc(names->meta.num_classes, sizeof(int));
+    
+    while (done == FALSE) {
+        // Collect the lines of the next batch. Comments ride along so they land in the same
+        // place in the .pred file
+        num_lines = num_batch_examples = 0;
+        text_length = 0;
+        while (num_batch_examples < args.test_batch_size) {
+            if (read_line_reuse(t_fh, &line, &line_size) <= 0) {
+                done = TRUE;
+                break;
+            }
+            strip_lt_whitespace(line);
+            if (*line == '\0')
+                continue;
+            if (num_lines == num_malloced_lines) {
+                num_malloced_lines = num_malloced_lines == 0 ? 1024 : 2 * num_malloced_lines;
+                lines = (char **)realloc(lines, num_malloced_lines * sizeof(char *));
+            }
+            lines[num_lines++] = av_strdup(line);
+            text_length += strlen(line) + 1;
+            if (line[0] != '#')
+                num_batch_examples++;
+        }
+        
+        CV_Dataset batch_data = {0};
+        CV_Subset batch = {0};
+        CV_Matrix matrix;
+        CV_Prob_Matrix prob_matrix;
+        reset_CV_Matrix(&matrix);
+        prob_matrix.num_classes = 0;
+        
+        if (num_batch_examples > 0) {
+            AV_SortedBlobArray blob = {0};
+            
+            // Translate the batch the same way read_data_file does a whole .test file
+            text = (char *)malloc(text_length + 1);
+            text_length = 0;
+            for (i = 0; i < num_lines; i++) {
+                strcpy(text + text_length, lines[i]);
+                text_length += strlen(lines[i]);
+                text[text_length++] = '\n';
+            }
+            text[text_length] = '\0';
+            args.test_string = text;
+            args.test_file_is_a_string = TRUE;
+            
+            batch_data.meta = names->meta;
+            batch_data.meta.global_offset = NULL;
+            if (args.do_training)
+                batch.meta.Missing = train_meta.Missing;
+            av_exitIfError(av_initSortedBlobArray(&blob));
+            if (! read_data_file(&batch_data, &batch, class, &blob, "test", &args)) {
+                fprintf(stderr, "Error reading data file\n");
+                exit(-8);
+            }
+            av_freeSortedBlobArray(&blob);
+            free(text);
+            if (batch.meta.num_examples != num_batch_examples) {
+                fprintf(stderr, "Expected %d examples in the batch of test data at example %d but read %d\n",
+                                num_batch_examples, num_tested+1, batch.meta.num_examples);
+                exit(-8);
+            }
+            
+            // Score the batch
+            if (args.early_exit_voting == TRUE) {
+                long saved = build_early_exit_prediction_matrix(batch, ensemble, &matrix);
+                num_evals_saved = (saved < 0 || num_evals_saved < 0) ? -1 : num_evals_saved + saved;
+            } else {
+                build_engine_prediction_matrix(batch, ensemble, &matrix, args.scoring_engine);
+            }
+            if (args.output_laplacean)
+                build_engine_probability_matrix(batch, ensemble, &prob_matrix, args.scoring_engine);
+            
+            // Votes are tied the same way test() breaks them: it reseeds on the first example when
+            // computing the accuracy and replays the saved seed when only writing predictions
+            best_class = (int *)realloc(best_class, num_batch_examples * sizeof(int));
+            for (i = 0; i < num_batch_examples; i++) {
+                int seed_flag = num_tested + i;
+                if (seed_flag == 0 && args.output_accuracies == ON)
+                    seed_flag = -1;
+                best_class[i] = find_best_class_from_matrix(i, matrix, args, seed_flag, 0);
+                if (args.output_accuracies == ON) {
+                    if (best_class[i] == matrix.data[i][0].Integer)
+                        num_correct++;
+                    Confusion[best_class[i]][matrix.data[i][0].Integer]++;
+                    for (j = matrix.additional_cols; j < matrix.num_classifiers + matrix.additional_cols; j++)
+                        if (matrix.data[i][j].Integer == matrix.data[i][0].Integer)
+                            num_correct_votes++;
+                }
+            }
+            num_votes += (long)num_batch_examples * (long)matrix.num_classifiers;
+        }
+        
+        // Write this batch's part of the .pred file
+        num_batch_examples = 0;
+        for (i = 0; i < num_lines; i++) {
+            if (p_fh != NULL) {
+                if (lines[i][0] == '#') {
+                    // If this is the #labels line, then add the other column headers
+                    j = 0;
+                    while (lines[i][j] == '#' || lines[i][j] == ' ')
+                        j++;
+                    if (! strncmp(lines[i] + j, "labels ", 7)) {
+                        wrote_labels = TRUE;
+                        write_prediction_labels(p_fh, lines[i], names->meta, names->meta.num_classes, args);
+                    } else {
+                        fprintf(p_fh, "%s\n", lines[i]);
+                    }
+                } else {
+                    // If we've gotten here without echoing the #labels line then there wasn't one. Make it up.
+                    if (wrote_labels == FALSE) {
+                        wrote_labels = TRUE;
+                        write_prediction_labels(p_fh, NULL, names->meta, names->meta.num_classes, args);
+                    }
+                    _write_prediction(p_fh, lines[i], num_batch_examples, best_class[num_batch_examples],
+                                      matrix, prob_matrix, names->meta, args);
+                    num_batch_examples++;
+                }
+            }
+            free(lines[i]);
+        }
+        
+        // Done with this batch
+        if (batch.examples != NULL) {
+            for (i = 0; i < batch.meta.num_examples; i++)
+                free(matrix.data[i]);
+            free(matrix.data);
+            if (args.output_laplacean) {
+                for (i = 0; i < batch.meta.num_examples; i++)
+                    free(prob_matrix.data[i]);
+                free(prob_matrix.data);
+            }
+            num_tested += batch.meta.num_examples;
+            if (! args.do_training)
+                free(batch.meta.Missing);
+            free(batch.meta.num_examples_per_class);
+            free(batch_data.meta.global_offset);
+            free_CV_Subset(&batch, args, TEST_MODE);
+        }
+    }
+    free(lines);
+    free(line);
+    free(best_class);
+    if (t_fh != stdin)
+        fclose(t_fh);
+    if (p_fh != NULL)
+        fclose(p_fh);
+    
+    if (num_tested == 0) {
+        fprintf(stderr, "No examples found in the .test file: '%s'\n", args.test_file);
+        exit(-8);
+    }
+    
+    if (args.output_accuracies == ON) {
+        printf("Voted Accuracy   = %.4f%%\n", (float)num_correct / (float)num_tested * 100.0);
+        // Average accuracy needs every tree's vote which early exit voting does not have
+        if (num_evals_saved < 0)
+            printf("Average Accuracy = %.4f%%\n", (float)num_correct_votes / (float)num_votes * 100.0);
+    }
+    if (num_evals_saved >= 0)
+        printf("Early Exit Voting skipped %ld of %ld tree evaluations (%.2f%%)\n", num_evals_saved, num_votes,
+               num_votes > 0 ? (float)num_evals_saved * 100.0 / (float)num_votes : 0.0);
+    // print_confusion_matrix frees Confusion
+    if (args.output_confusion_matrix) {
+        print_confusion_matrix(names->meta.num_classes, Confusion, names->meta.class_names);
+    } else {
+        for (i = 0; i < names->meta.num_classes; i++)
+            free(Confusion[i]);
+        free(Confusion);
+    }
+    printf("\n");
+}
+
+/*
+ * Writes the .pred line for example ex of the batch. The class probabilities are the vote
+ * fractions, or the Laplacean estimates with --output-laplacean, as in store_predictions_text
+ */
+static void _write_prediction(FILE *fh, const char *line, int ex, int best_class, CV_Matrix matrix,
+                              CV_Prob_Matrix prob_matrix, CV_Metadata meta, Args_Opts args) {
+    int j;
+    double class_probs[meta.num_classes];
+    
+    if (prob_matrix.num_classes > 0) {
+        for (j = 0; j < meta.num_classes; j++)
+            class_probs[j] = (double)prob_matrix.data[ex][j];
+    } else {
+        for (j = 0; j < meta.num_classes; j++)
+            class_probs[j] = 0.0;
+        for (j = matrix.additional_cols; j < matrix.num_classifiers + matrix.additional_cols; j++)
+            class_probs[matrix.data[ex][j].Integer]++;
+        for (j = 0; j < meta.num_classes; j++)
+            class_probs[j] /= (double)matrix.num_classifiers;
+    }
+    write_prediction_line(fh, line, meta.class_names[best_class], meta.num_classes, class_probs, args);
+}
@@ -0,0 +1,428 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "crossval.h"
+#include "reset.h"
+#include "text_trees.h"
+
+// Don't start a thread for less than this much text
+#define MIN_BYTES_PER_THREAD 65536
+
+typedef struct tree_tokenizer_struct {
+    const char *pos;
+    const char *end;
+} Tree_Tokenizer;
+
+typedef struct tree_parser_struct {
+    Tree_Tokenizer tk;
+    DT_Node **tree;
+    Tree_Bookkeeping *book;
+    int num_classes;
+} Tree_Parser;
+
+typedef struct tree_parse_job_struct {
+    DT_Ensemble *ensemble;
+    const char **starts;
+    const char **ends;
+    int next_tree;
+    pthread_mutex_t lock;
+} Tree_Parse_Job;
+
+static int _next_token(Tree_Tokenizer *tk, const char **token);
+static int _token_is(const char *token, int len, const char *word);
+static int _parse_int(const char *token, int len);
+static double _parse_double(const char *token, int len);
+static void _skip_tokens(Tree_Tokenizer *tk, int num);
+static void _grow_tree(Tree_Parser *p, int node);
+static void _parse_node(Tree_Parser *p);
+static void *_parse_trees(void *arg);
+
+// Every power of ten that is exactly representable as a double
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * Builds ensemble->Trees and ensemble->Books from the text that follows the header read by
+ * read_ensemble_metadata. ensemble->num_trees trees are read
+ */
+void read_text_trees(const char *text, size_t length, DT_Ensemble *ensemble, Args_Opts *args) {
+    int i, num_found, num_threads;
+    const char *end = text + length;
+    const char *p;
+    const char *token;
+    int len;
+    const char **tree_lines = (const char **)malloc((ensemble->num_trees + 1) * sizeof(const char *));
+    Tree_Parse_Job job;
+    pthread_t *threads;
+    
+    // Find the "Tree N" line that starts each tree. The trees after the last one we want end the text
+    num_found = 0;
+    for (p = text; p < end && num_found <= ensemble->num_trees; ) {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (end - p > 4 && ! strncmp(p, "Tree", 4) && (p[4] == ' ' || p[4] == '\t'))
+            tree_lines[num_found++] = p;
+        p = memchr(p, '\n', end - p);
+        p = p == NULL ? end : p + 1;
+    }
+    if (num_found > ensemble->num_trees) {
+        end = tree_lines[ensemble->num_trees];
+    } else if (num_found < ensemble->num_trees) {
+        fprintf(stderr, "WARNING: Expected %d trees but the ensemble file only has %d\n", ensemble->num_trees, num_found);
+        ensemble->num_trees = args->num_trees = num_found;
+    }
+    
+    job.ensemble = ensemble;
+    job.starts = (const char **)malloc(ensemble->num_trees * sizeof(const char *));
+    job.ends = (const char **)malloc(ensemble->num_trees * sizeof(const char *));
+    job.next_tree = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    
+    // The tree numbers and betas are read in order
+    for (i = 0; i < ensemble->num_trees; i++) {
+        Tree_Tokenizer tk;
+        int this_tree_num;
+        tk.pos = tree_lines[i];
+        tk.end = i < ensemble->num_trees - 1 ? tree_lines[i+1] : end;
+        _next_token(&tk, &token);
+        len = _next_token(&tk, &token);
+        this_tree_num = _parse_int(token, len);
+        if (this_tree_num != i+1)
+            fprintf(stderr, "Found tree #%d but expected tree #%d\n", this_tree_num, i+1);
+        job.starts[i] = tk.pos;
+        job.ends[i] = tk.end;
+        len = _next_token(&tk, &token);
+        if (_token_is(token, len, "Beta")) {
+            if (i == 0) {
+                // Initialize boosting_betas array and set do_boosting to TRUE
+                ensemble->boosting_betas = (double *)malloc(ensemble->num_trees * sizeof(double));
+                args->do_boosting = TRUE;
+            }
+            len = _next_token(&tk, &token);
+            ensemble->boosting_betas[i] = _parse_double(token, len);
+            job.starts[i] = tk.pos;
+        } else if (args->do_boosting == TRUE) {
+            // If we're boosting, a tree without a beta is a problem
+            fprintf(stderr, "ERROR: Ensemble file format error - no beta for tree %d\n", this_tree_num);
+            exit(-1);
+        }
+    }
+    
+    // Small ensembles aren't worth the threads
+    num_threads = args->num_threads > 0 ? args->num_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads > (end - text) / MIN_BYTES_PER_THREAD)
+        num_threads = (end - text) / MIN_BYTES_PER_THREAD;
+    if (num_threads > ensemble->num_trees)
+        num_threads = ensemble->num_trees;
+    if (num_threads < 1)
+        num_threads = 1;
+    threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
+    for (i = 1; i < num_threads; i++)
+        if (pthread_create(&threads[i], NULL, _parse_trees, &job) != 0)
+            break;
+    num_threads = i;
+    _parse_trees(&job);
+    for (i = 1; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+    
+    pthread_mutex_destroy(&job.lock);
+    free(threads);
+    free(job.starts);
+    free(job.ends);
+    free(tree_lines);
+}
+
+/*
+ * Thread body: parse trees until there are none left
+ */
+static void *_parse_trees(void *arg) {
+    Tree_Parse_Job *job = (Tree_Parse_Job *)arg;
+    DT_Ensemble *ensemble = job->ensemble;
+    int i;
+    
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        i = job->next_tree++;
+        pthread_mutex_unlock(&job->lock);
+        if (i >= ensemble->num_trees)
+            break;
+        read_text_tree(job->starts[i], job->ends[i] - job->starts[i], &ensemble->Trees[i], &ensemble->Books[i],
+                       ensemble->num_classes);
+    }
+    return NULL;
+}
+
+/*
+ * Builds one tree from the text of its nodes, i.e. what follows its "Tree N" and "Beta" lines
+ */
+void read_text_tree(const char *text, size_t length, DT_Node **tree, Tree_Bookkeeping *book, int num_classes) {
+    Tree_Parser p;
+    book->num_malloced_nodes = 1;
+    book->next_unused_node = 1;
+    book->current_node = 0;
+    *tree = (DT_Node *)malloc(book->num_malloced_nodes * sizeof(DT_Node));
+    reset_DT_Node(*tree);
+    p.tk.pos = text;
+    p.tk.end = text + length;
+    p.tree = tree;
+    p.book = book;
+    p.num_classes = num_classes;
+    _parse_node(&p);
+}
+
+/*
+ * Parses the node numbered book->current_node and, recursively, its subtree. Children are numbered
+ * in the order they are reached, which is the order _save_node wrote them in
+ */
+static void _parse_node(Tree_Parser *p) {
+    int this_node = p->book->current_node;
+    DT_Node **tree = p->tree;
+    const char *token;
+    int len, i;
+    
+    len = _next_token(&p->tk, &token);
+    if (len == 0) {
+        fprintf(stderr, "Got EOF. Returning\n");
+        return;
+    }
+    
+    // We have a leaf
+    if (_token_is(token, len, "LEAF")) {
+        float total = 0.0;
+        _grow_tree(p, this_node);
+        (*tree)[this_node].branch_type = LEAF;
+        (*tree)[this_node].num_branches = 0;
+        (*tree)[this_node].class_count = (int *)calloc(p->num_classes, sizeof(int));
+        (*tree)[this_node].class_probs = (float *)calloc(p->num_classes, sizeof(float));
+        len = _next_token(&p->tk, &token);
+        if (_token_is(token, len, "Class")) {
+            len = _next_token(&p->tk, &token);
+            (*tree)[this_node].Node_Value.class_label = _parse_int(token, len);
+            _skip_tokens(&p->tk, 1); // "Proportions"
+            for (i = 0; i < p->num_classes; i++) {
+                len = _next_token(&p->tk, &token);
+                (*tree)[this_node].class_count[i] = _parse_int(token, len);
+                total += (*tree)[this_node].class_count[i];
+            }
+            for (i = 0; i < p->num_classes; i++)
+                (*tree)[this_node].class_probs[i] = ((*tree)[this_node].class_count[i] + 1.0)/(p->num_classes + total);
+        } else {
+            // Older files have only the class
+            (*tree)[this_node].Node_Value.class_label = _parse_int(token, len);
+            for (i = 0; i < p->num_classes; i++)
+                (*tree)[this_node].class_count[i] = -1;
+            (*tree)[this_node].class_probs[(*tree)[this_node].Node_Value.class_label] = 1.0;
+        }
+        return;
+    }
+    
+    if (! _token_is(token, len, "SPLIT")) {
+        fprintf(stderr, "Got unexpected token inside a tree: '%.*s'\n", len, token);
+        return;
+    }
+    
+    len = _next_token(&p->tk, &token);
+    if (_token_is(token, len, "DISCRETE")) {
+        int this_branch_number, num_branches;
+        _grow_tree(p, this_node);
+        (*tree)[this_node].branch_type = BRANCH;
+        (*tree)[this_node].attribute_type = DISCRETE;
+        _skip_tokens(&p->tk, 1); // "ATT#"
+        len = _next_token(&p->tk, &token);
+        (*tree)[this_node].attribute = _parse_int(token, len);
+        _skip_tokens(&p->tk, 1); // "VAL#"
+        len = _next_token(&p->tk, &token);
+        this_branch_number = _parse_int(token, len);
+        _skip_tokens(&p->tk, 1); // "/"
+        len = _next_token(&p->tk, &token);
+        num_branches = (*tree)[this_node].num_branches = _parse_int(token, len);
+        (*tree)[this_node].Node_Value.branch = (int *)malloc(num_branches * sizeof(int));
+        while (1) {
+            (*tree)[this_node].Node_Value.branch[this_branch_number-1] = p->book->next_unused_node;
+            p->book->current_node = p->book->next_unused_node;
+            p->book->next_unused_node++;
+            _parse_node(p);
+            if (this_branch_number >= num_branches)
+                break;
+            // The next "SPLIT DISCRETE ATT# a VAL# i / n" line for this node
+            _skip_tokens(&p->tk, 5);
+            len = _next_token(&p->tk, &token);
+            this_branch_number = _parse_int(token, len);
+            _skip_tokens(&p->tk, 1); // "/"
+            len = _next_token(&p->tk, &token);
+            if (_parse_int(token, len) != num_branches) {
+                fprintf(stderr, "ERROR: Error reading tree file: Got %d branches but expected %d\n",
+                                _parse_int(token, len), num_branches);
+                exit(-8);
+            }
+        }
+    } else if (_token_is(token, len, "CONTINUOUS")) {
+        _grow_tree(p, this_node);
+        (*tree)[this_node].branch_type = BRANCH;
+        (*tree)[this_node].attribute_type = CONTINUOUS;
+        _skip_tokens(&p->tk, 1); // "ATT#"
+        len = _next_token(&p->tk, &token);
+        (*tree)[this_node].attribute = _parse_int(token, len);
+        _skip_tokens(&p->tk, 1); // "<"
+        len = _next_token(&p->tk, &token);
+        (*tree)[this_node].branch_threshold = _parse_double(token, len);
+        (*tree)[this_node].num_branches = 2;
+        (*tree)[this_node].Node_Value.branch = (int *)malloc(2 * sizeof(int));
+        (*tree)[this_node].Node_Value.branch[0] = p->book->next_unused_node;
+        p->book->current_node = p->book->next_unused_node;
+        p->book->next_unused_node++;
+        _parse_node(p);
+        (*tree)[this_node].Node_Value.branch[1] = p->book->next_unused_node;
+        p->book->current_node = p->book->next_unused_node;
+        p->book->next_unused_node++;
+        // Skip over the ">=" line which is the redefinition of the previous SPLIT
+        _skip_tokens(&p->tk, 6);
+        _parse_node(p);
+    } else {
+        fprintf(stderr, "Got unknown node type: '%.*s'\n", len, token);
+    }
+}
+
+/*
+ * Same growth as _read_tree used so Books[i].num_malloced_nodes comes out the same
+ */
+static void _grow_tree(Tree_Parser *p, int node) {
+    while (node >= p->book->num_malloced_nodes) {
+        p->book->num_malloced_nodes *= 2;
+        *p->tree = (DT_Node *)realloc(*p->tree, p->book->num_malloced_nodes * sizeof(DT_Node));
+    }
+}
+
+/*
+ * Sets *token to the next whitespace delimited token and returns its length, or 0 at the end of
+ * the text. Comment lines are skipped
+ */
+static int _next_token(Tree_Tokenizer *tk, const char **token) {
+    const char *p = tk->pos;
+    while (p < tk->end) {
+        if (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f') {
+            p++;
+        } else if (*p == '#') {
+            while (p < tk->end && *p != '\n')
+                p++;
+        } else {
+            break;
+        }
+    }
+    *token = p;
+    while (p < tk->end && *p != ' ' && *p != '\n' && *p != '\t' && *p != '\r' && *p != '\v' && *p != '\f')
+        p++;
+    tk->pos = p;
+    return p - *token;
+}
+
+static void _skip_tokens(Tree_Tokenizer *tk, int num) {
+    const char *token;
+    while (num-- > 0)
+        _next_token(tk, &token);
+}
+
+static int _token_is(const char *token, int len, const char *word) {
+    return (int)strlen(word) == len && ! strncmp(token, word, len);
+}
+
+/*
+ * atoi() for a token that isn't NUL terminated
+ */
+static int _parse_int(const char *token, int len) {
+    const char *end = token + len;
+    int negative = 0;
+    int value = 0;
+    if (token < end && (*token == '-' || *token == '+'))
+        negative = *token++ == '-';
+    for (; token < end && *token >= '0' && *token <= '9'; token++)
+        value = value * 10 + (*token - '0');
+    return negative ? -value : value;
+}
+
+/*
+ * atof() for a token that isn't NUL terminated. A token with at most 15 significant digits and a
+ * small exponent is one exact integer times or divided by one exact power of ten, so a single
+ * correctly rounded operation gives the same double as atof(). Anything else goes to atof()
+ */
+static double _parse_double(const char *token, int len) {
+    const char *p = token;
+    const char *end = token + len;
+    int negative = 0;
+    int num_digits = 0;
+    int exponent = 0;
+    uint64_t mantissa = 0;
+    char strbuf[64];
+    
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    for (; p < end && *p >= '0' && *p <= '9'; p++, num_digits++)
+        mantissa = mantissa * 10 + (*p - '0');
+    if (p < end && *p == '.')
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, num_digits++, exponent--)
+            mantissa = mantissa * 10 + (*p - '0');
+    if (p < end && (*p == 'e' || *p == 'E') && num_digits > 0) {
+        int exp_negative = 0;
+        int exp_value = 0;
+        int exp_digits = 0;
+        p++;
+        if (p < end && (*p == '-' || *p == '+'))
+            exp_negative = *p++ == '-';
+        for (; p < end && *p >= '0' && *p <= '9' && exp_digits < 4; p++, exp_digits++)
+            exp_value = exp_value * 10 + (*p - '0');
+        if (exp_digits == 0)
+            p = token; // Not a number we understand
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+    if (p == end && num_digits > 0 && num_digits <= 15 && exponent >= -22 && exponent <= 22) {
+        double value = (double)mantissa;
+        value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+        return negative ? -value : value;
+    }
+    
+    if (len >= (int)sizeof(strbuf))
+        len = sizeof(strbuf) - 1;
+    memcpy(strbuf, token, len);
+    strbuf[len] = '\0';
+    return atof(strbuf);
+}
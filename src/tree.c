@@ -37,6 +37,8 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "gain.h"
 #include "array.h"
 #include "util.h"
@@ -55,9 +57,17 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "options.h"
 #include "heartbeat.h"
 #include "reset.h"
+#include "binary_trees.h"
+#include "text_trees.h"
+#include "mapped_input.h"
+#include "checkpoint.h"
+#include "out_of_core.h"
+#include "distinct_values.h"
 
 /* Prototype declarations for internal module functions. */
 void free_copied_CV_Subset(CV_Subset *sub);
+static void _write_tree_file_header(FILE *tree_file, int num_trees, CV_Metadata meta, char *tree_filename, Args_Opts args);
+static int _continue_ensemble(Tree_Stream *stream, Vote_Cache *cache, CV_Subset *data, int fold_num, Args_Opts args);
 
 void train(CV_Subset *data, DT_Ensemble *ensemble, int fold_num, Args_Opts args) {
     int i, num_trees;
@@ -75,6 +85,13 @@ void train(CV_Subset *data, DT_Ensemble *ensemble, int fold_num, Args_Opts args)
     // Since stopping algorithm must be used with bagging or ivoting, then compute if bagging
     Boolean compute_oob_acc = args.do_bagging;
     
+    // With --stream-trees each tree goes to the ensemble file as soon as it is built. avatardt always
+    // writes the file (and removes it later for --no-save-trees) but the others only write it when
+    // saving trees. crossval tests the trees it just built so it is the only caller that keeps them
+    Tree_Stream stream;
+    Boolean stream_trees = args.stream_trees && (args.save_trees || args.caller == AVATARDT_CALLER);
+    Boolean keep_trees = stream_trees == FALSE || args.caller == CROSSVALFC_CALLER;
+    
     ensemble->num_trees = 10;
     if (args.num_trees > 0) {
         ensemble->num_trees = args.num_trees;
@@ -98,6 +115,8 @@ void train(CV_Subset *data, DT_Ensemble *ensemble, int fold_num, Args_Opts args)
     }
     ensemble->Trees = (DT_Node **)malloc(ensemble->num_trees * sizeof(DT_Node *));
     ensemble->Books = (Tree_Bookkeeping *)malloc(ensemble->num_trees * sizeof(Tree_Bookkeeping));
+    ensemble->mapped_trees = NULL;
+    ensemble->lazy_trees = NULL;
     ensemble->weights = (float *)malloc(ensemble->num_trees * sizeof(float));
     int num_boosting_betas = ensemble->num_trees;
     ensemble->boosting_betas = (double *)malloc(num_boosting_betas * sizeof(double));
@@ -115,10 +134,6 @@ void train(CV_Subset *data, DT_Ensemble *ensemble, int fold_num, Args_Opts args)
     // reset_CV_Subset(data_bag);
     // reset_CV_Subset(data_skw);
 
-    // Initialize the oob-data file for --verbose-oob
-    if (args.output_verbose_oob)
-        write_tree_file_header(args.num_trees, data->meta, fold_num, args.oob_file, args);
-
     // If we're bagging, initialize the Vote_Cache so we can report OOB accuracy
     if (compute_oob_acc == TRUE) {
         cache = (Vote_Cache *)realloc(cache, sizeof(Vote_Cache));
@@ -165,8 +180,35 @@ void train(CV_Subset *data, DT_Ensemble *ensemble, int fold_num, Args_Opts args)
         init_weighted_rng(data->meta.num_examples, data->weights, args);
     }
     
-    begin_progress_counters(1);
     num_trees = 0;
+    // Pick up after the last checkpoint. Its trees are already in the partially written ensemble file
+    if (args.resume == TRUE)
+        num_trees = read_checkpoint(&stream, cache, data, fold_num, args);
+    if (num_trees > 0) {
+        while (num_trees > ensemble->num_trees)
+            ensemble->num_trees *= 2;
+        ensemble->Trees = (DT_Node **)realloc(ensemble->Trees, ensemble->num_trees * sizeof(DT_Node *));
+        ensemble->Books = (Tree_Bookkeeping *)realloc(ensemble->Books, ensemble->num_trees * sizeof(Tree_Bookkeeping));
+        ensemble->weights = (float *)realloc(ensemble->weights, ensemble->num_trees * sizeof(float));
+        for (i = 0; i < num_trees; i++)
+            ensemble->Trees[i] = NULL;
+    } else {
+        // Initialize the oob-data file for --verbose-oob
+        if (args.output_verbose_oob)
+            write_tree_file_header(args.num_trees, data->meta, fold_num, args.oob_file, args);
+        
+        if (stream_trees == TRUE)
+            begin_tree_stream(&stream, args.auto_stop == TRUE ? 0 : args.num_trees, data->meta, fold_num, args);
+        
+        // Growing an existing ensemble. Its trees start the new file
+        if (args.add_trees > 0) {
+            num_trees = _continue_ensemble(&stream, cache, data, fold_num, args);
+            for (i = 0; i < num_trees; i++)
+                ensemble->Trees[i] = NULL;
+        }
+    }
+    
+    begin_progress_counters(1);
     while ((args.num_trees > 0 && num_trees < args.num_trees) || (args.auto_stop == TRUE && stop_building_at == 0)) {
         
         if (compute_oob_acc == TRUE)
@@ -276,6 +318,16 @@ void train(CV_Subset *data, DT_Ensemble *ensemble, int fold_num, Args_Opts args)
             reset_weights(data->meta.num_examples, data->weights);
         }
         
+        // The OOB votes and boosting weights are up to date so the tree isn't needed any more
+        if (stream_trees == TRUE) {
+            stream_tree(&stream, ensemble->Trees[num_trees],
+                        args.do_boosting == TRUE ? ensemble->boosting_betas[num_trees] : 0.0, args, data->meta.num_classes);
+            if (keep_trees == FALSE) {
+                free_DT_Node(ensemble->Trees[num_trees], ensemble->Books[num_trees].next_unused_node);
+                ensemble->Trees[num_trees] = NULL;
+            }
+        }
+        
         // Increment number of trees in ensemble
         num_trees++;
         
@@ -284,8 +336,10 @@ void train(CV_Subset *data, DT_Ensemble *ensemble, int fold_num, Args_Opts args)
         update_progress_counters(1, &num_trees);
         
         if (args.do_bagging == TRUE) {
-            for (i = 0; i < (int)(args.bag_size * (float)data_bag->meta.num_examples / 100.0); i++)
-                free(data_bag->examples[i].distinct_attribute_values);
+            // An out-of-core bag shares its attribute values with data
+            if (args.out_of_core == FALSE)
+                for (i = 0; i < (int)(args.bag_size * (float)data_bag->meta.num_examples / 100.0); i++)
+                    free(data_bag->examples[i].distinct_attribute_values);
             free_CV_Subset_inter(data_bag, args, TRAIN_MODE);
         }
         if (args.random_subspaces > 0)
@@ -293,8 +347,16 @@ void train(CV_Subset *data, DT_Ensemble *ensemble, int fold_num, Args_Opts args)
         if (args.do_balanced_learning || args.do_boosting)
             free_CV_Subset_inter(data_skw, args, TRAIN_MODE);
         //printf("%d %d %d %d\n", args.num_trees, num_trees, args.auto_stop, stop_building_at);
+        
+        if (stream_trees == TRUE && args.checkpoint_interval > 0 && num_trees % args.checkpoint_interval == 0)
+            write_checkpoint(&stream, cache, data, fold_num, args);
     }
     end_progress_counters();
+    if (stream_trees == TRUE) {
+        end_tree_stream(&stream, ensemble->num_trees);
+        if (args.checkpoint_interval > 0 || args.resume == TRUE)
+            remove_checkpoint(fold_num, args);
+    }
     if (args.auto_stop == TRUE) {
         printf("Stopping Algorithm Result: %d trees with an oob accuracy of %.4f%%\n",
                ensemble->num_trees, best_oob_acc * 100.0);
@@ -683,7 +745,7 @@ void train_ivote(CV_Subset train_data, CV_Subset test_data, int fold_num, Vote_C
 
 //Modified by DACIESL June-05-08: Laplacean Estimates
 //added consideration for cases of Laplacean Estimate output
-void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Dataset dataset, int fold_num, Args_Opts args) {
+void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Dataset dataset, int fold_num, Args_Opts args, CV_Overall_Confusion *overall) {
 
     int i, j, k;
     if (args.output_accuracies == ON || args.output_accuracies == VERBOSE ||args.output_predictions || args.output_laplacean || args.output_confusion_matrix) 
@@ -698,12 +760,7 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
             CV_Matrix Boost_Matrix;
             CV_Prob_Matrix Prob_Matrix;
             int **Confusion;
-            static int **Overall_Confusion;
-            static int **Overall_Confusion_5x2;
-            static int diagonal_sum = 0;
-            static int total_sum = 0;
-            static int overall_diagonal_sum = 0;
-            static int overall_total_sum = 0;
+            long num_evals_saved = -1;
 
             // First time through with crossvalfc, initialize Overall_Confusion
             if (args.caller == CROSSVALFC_CALLER && ( (args.do_nfold_cv == TRUE && fold_num == 0) ||
@@ -711,22 +768,22 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
                 // If this is 5x2 CV, and fold_num > 0, we need to free the old one before allocating
                 //if (args.do_5x2_cv == TRUE && fold_num > 0) {
                 //    for (i = 0; i < test_data.meta.num_classes; i++)
-                //        free(Overall_Confusion[i]);
-                //    free(Overall_Confusion);
+                //        free(overall->confusion[i]);
+                //    free(overall->confusion);
                 //}
                 
-                Overall_Confusion = (int **)malloc(test_data.meta.num_classes * sizeof(int *));
+                overall->confusion = (int **)malloc(test_data.meta.num_classes * sizeof(int *));
                 for (i = 0; i < test_data.meta.num_classes; i++)
-                    Overall_Confusion[i] = (int *)calloc(test_data.meta.num_classes, sizeof(int));
+                    overall->confusion[i] = (int *)calloc(test_data.meta.num_classes, sizeof(int));
                     
                 if (fold_num == 0 && args.do_5x2_cv == TRUE) {
-                    Overall_Confusion_5x2 = (int **)malloc(test_data.meta.num_classes * sizeof(int *));
+                    overall->confusion_5x2 = (int **)malloc(test_data.meta.num_classes * sizeof(int *));
                     for (i = 0; i < test_data.meta.num_classes; i++)
-                        Overall_Confusion_5x2[i] = (int *)calloc(test_data.meta.num_classes, sizeof(int));
+                        overall->confusion_5x2[i] = (int *)calloc(test_data.meta.num_classes, sizeof(int));
                 }
                 
-                diagonal_sum = 0;
-                total_sum = 0;
+                overall->diagonal_sum = 0;
+                overall->total_sum = 0;
             }
             
             if (num_ensembles == 1) {
@@ -738,9 +795,12 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
                     else
   		        Prob_Matrix.num_classes = 0;
 	        } else {
-		    build_prediction_matrix(test_data, ensemble[0], &Matrix);
+                    if (args.early_exit_voting == TRUE)
+                        num_evals_saved = build_early_exit_prediction_matrix(test_data, ensemble[0], &Matrix);
+                    else
+		        build_engine_prediction_matrix(test_data, ensemble[0], &Matrix, args.scoring_engine);
                     if (args.output_laplacean)
-                        build_probability_matrix(test_data, ensemble[0], &Prob_Matrix);
+                        build_engine_probability_matrix(test_data, ensemble[0], &Prob_Matrix, args.scoring_engine);
                     else
   		        Prob_Matrix.num_classes = 0;
 	        }
@@ -758,9 +818,12 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
                     else
   		        Prob_Matrix.num_classes = 0;
                 } else {
-                    build_prediction_matrix(test_data, big_ensemble, &Matrix);
+                    if (args.early_exit_voting == TRUE)
+                        num_evals_saved = build_early_exit_prediction_matrix(test_data, big_ensemble, &Matrix);
+                    else
+                        build_engine_prediction_matrix(test_data, big_ensemble, &Matrix, args.scoring_engine);
                     if (args.output_laplacean)
-                        build_probability_matrix(test_data, big_ensemble, &Prob_Matrix);
+                        build_engine_probability_matrix(test_data, big_ensemble, &Prob_Matrix, args.scoring_engine);
                     else
   		        Prob_Matrix.num_classes = 0;
 		    }
@@ -772,27 +835,34 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
                     //printf("Average Accuracy = %.4f%%\n", compute_average_accuracy(Matrix) * 100.0);
                 } else {
                     printf("Voted Accuracy   = %.4f%%\n", compute_voted_accuracy(Matrix, &Confusion, args) * 100.0);
-                    printf("Average Accuracy = %.4f%%\n", compute_average_accuracy(Matrix) * 100.0);
+                    // Average accuracy needs every tree's vote which early exit voting does not have
+                    if (num_evals_saved < 0)
+                        printf("Average Accuracy = %.4f%%\n", compute_average_accuracy(Matrix) * 100.0);
                 }
                 
                 // Compute Overall_Confusion and Overall_Confusion_5x2 matrixes
                 if (args.caller == CROSSVALFC_CALLER) {
                     for (i = 0; i < test_data.meta.num_classes; i++) {
                         for (j = 0; j < test_data.meta.num_classes; j++) {
-                            Overall_Confusion[i][j] += Confusion[i][j];
-                            total_sum += Confusion[i][j];
+                            overall->confusion[i][j] += Confusion[i][j];
+                            overall->total_sum += Confusion[i][j];
                             if (i == j)
-                                diagonal_sum += Confusion[i][j];
+                                overall->diagonal_sum += Confusion[i][j];
                             if (args.do_5x2_cv == TRUE) {
-                                Overall_Confusion_5x2[i][j] += Confusion[i][j];
-                                overall_total_sum += Confusion[i][j];
+                                overall->confusion_5x2[i][j] += Confusion[i][j];
+                                overall->overall_total_sum += Confusion[i][j];
                                 if (i == j)
-                                    overall_diagonal_sum += Confusion[i][j];
+                                    overall->overall_diagonal_sum += Confusion[i][j];
                             }
                         }
                     }
                 }
             }
+            if (num_evals_saved >= 0) {
+                long num_evals = (long)Matrix.num_examples * (long)Matrix.num_classifiers;
+                printf("Early Exit Voting skipped %ld of %ld tree evaluations (%.2f%%)\n", num_evals_saved, num_evals,
+                       num_evals > 0 ? (float)num_evals_saved * 100.0 / (float)num_evals : 0.0);
+            }
             if (args.output_accuracies == VERBOSE) {
 
 	    //DACIESL: NOTE TO SELF, PUT IN SUPPORT HERE FOR ``VERBOSE PERFORMANCE''
@@ -801,7 +871,7 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
                         if (args.do_boosting == TRUE)
                             build_boost_probability_matrix(test_data, ensemble[0], &Prob_Matrix);
                         else 
-                            build_probability_matrix(test_data, ensemble[0], &Prob_Matrix);
+                            build_engine_probability_matrix(test_data, ensemble[0], &Prob_Matrix, args.scoring_engine);
                     } else if (num_ensembles > 1) {
                         DT_Ensemble big_ensemble;
                         reset_DT_Ensemble(&big_ensemble);
@@ -809,7 +879,7 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
                         if (args.do_boosting == TRUE)
                             build_boost_probability_matrix(test_data, big_ensemble, &Prob_Matrix);
 	  	        else
-                            build_probability_matrix(test_data, big_ensemble, &Prob_Matrix);
+                            build_engine_probability_matrix(test_data, big_ensemble, &Prob_Matrix, args.scoring_engine);
 		    }
 	        }
 
@@ -844,28 +914,28 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
             if (args.output_accuracies == ON)
                 if ( (args.do_nfold_cv == TRUE && fold_num == args.num_folds-1) ||
                      (args.do_5x2_cv   == TRUE && fold_num % 2 == 1) )
-                         printf("\nOverall Voted Accuracy = %.4f%%\n", (float)diagonal_sum * 100.0 / (float)total_sum);
+                         printf("\nOverall Voted Accuracy = %.4f%%\n", (float)overall->diagonal_sum * 100.0 / (float)overall->total_sum);
             if (args.output_confusion_matrix) {
                 if ( (args.do_nfold_cv == TRUE && fold_num == args.num_folds-1) ||
                      (args.do_5x2_cv   == TRUE && fold_num % 2 == 1) ) {
                     printf("Overall Confusion Matrix:\n\n");
                     if (args.do_boosting == TRUE)
-                        print_confusion_matrix(Boost_Matrix.num_classes, Overall_Confusion, test_data.meta.class_names);
+                        print_confusion_matrix(Boost_Matrix.num_classes, overall->confusion, test_data.meta.class_names);
                     else
-                        print_confusion_matrix(Matrix.num_classes, Overall_Confusion, test_data.meta.class_names);
+                        print_confusion_matrix(Matrix.num_classes, overall->confusion, test_data.meta.class_names);
                 }
             }
             printf("\n");
             if (args.do_5x2_cv == TRUE && fold_num == 9) {
                 if (args.output_accuracies == ON) {
-                    printf("\n5x2 Overall Voted Accuracy = %.4f%%\n", (float)overall_diagonal_sum * 100.0 / (float)overall_total_sum);
+                    printf("\n5x2 Overall Voted Accuracy = %.4f%%\n", (float)overall->overall_diagonal_sum * 100.0 / (float)overall->overall_total_sum);
                 }
                 if (args.output_confusion_matrix == TRUE) {
                     printf("5x2 Overall Confusion Matrix:\n\n");
                     if (args.do_boosting == TRUE)
-                        print_confusion_matrix(Boost_Matrix.num_classes, Overall_Confusion_5x2, test_data.meta.class_names);
+                        print_confusion_matrix(Boost_Matrix.num_classes, overall->confusion_5x2, test_data.meta.class_names);
                     else
-                        print_confusion_matrix(Matrix.num_classes, Overall_Confusion_5x2, test_data.meta.class_names);
+                        print_confusion_matrix(Matrix.num_classes, overall->confusion_5x2, test_data.meta.class_names);
                 }
                 printf("\n");
             }
@@ -893,7 +963,7 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
             Matrix = (CV_Matrix *)malloc(num_ensembles * sizeof(CV_Matrix));
             for (i = 0; i < num_ensembles; i++) {
                 test_data.meta.Missing = ensemble[i].Missing;
-                build_prediction_matrix(test_data, ensemble[i], &Matrix[i]);
+                build_engine_prediction_matrix(test_data, ensemble[i], &Matrix[i], args.scoring_engine);
                 //char title[100];
                 //sprintf(title, "Matrix%1d", i+1);
                 //print_pred_matrix(title, Matrix[i]);
@@ -903,7 +973,7 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
                 Prob_Matrix = (CV_Prob_Matrix *)malloc(num_ensembles * sizeof(CV_Prob_Matrix));
                     for (i = 0; i < num_ensembles; i++) {
                     test_data.meta.Missing = ensemble[i].Missing;
-                    build_probability_matrix(test_data, ensemble[i], &Prob_Matrix[i]);
+                    build_engine_probability_matrix(test_data, ensemble[i], &Prob_Matrix[i], args.scoring_engine);
                 }
             }
             
@@ -1004,14 +1074,14 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
             Matrix = (CV_Matrix *)malloc(num_ensembles * sizeof(CV_Matrix));
             for (i = 0; i < num_ensembles; i++) {
                 test_data.meta.Missing = ensemble[i].Missing;
-                build_prediction_matrix(test_data, ensemble[i], &Matrix[i]);
+                build_engine_prediction_matrix(test_data, ensemble[i], &Matrix[i], args.scoring_engine);
             }
 
             //DACIESL: Add in for Laplacean support
 	    Prob_Matrix = (CV_Prob_Matrix *)malloc(num_ensembles * sizeof(CV_Prob_Matrix));
 	    for(i = 0; i < num_ensembles; i++) {
                 test_data.meta.Missing = ensemble[i].Missing;
-                build_probability_matrix(test_data, ensemble[i], &Prob_Matrix[i]);
+                build_engine_probability_matrix(test_data, ensemble[i], &Prob_Matrix[i], args.scoring_engine);
 	    }
 
             //DACIESL: Add in for Laplacean support
@@ -1183,14 +1253,14 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
             for (i = 0; i < num_ensembles; i++) {
                 reset_CV_Matrix(&Matrix[i]);
                 test_data.meta.Missing = ensemble[i].Missing;
-                build_prediction_matrix(test_data, ensemble[i], &Matrix[i]);
+                build_engine_prediction_matrix(test_data, ensemble[i], &Matrix[i], args.scoring_engine);
             }
 
             //DACIESL: Add in for Laplacean support
 	    Prob_Matrix = (CV_Prob_Matrix *)malloc(num_ensembles * sizeof(CV_Prob_Matrix));
 	    for(i = 0; i < num_ensembles; i++) {
                 test_data.meta.Missing = ensemble[i].Missing;
-                build_probability_matrix(test_data, ensemble[i], &Prob_Matrix[i]);
+                build_engine_probability_matrix(test_data, ensemble[i], &Prob_Matrix[i], args.scoring_engine);
 	    }
 
             //DACIESL: Add in for Laplacean support
@@ -1347,7 +1417,7 @@ void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Data
     
 }
 
-void test_ivote(CV_Subset test_data, Vote_Cache cache, FC_Dataset dataset, int fold_num, Args_Opts args) {
+void test_ivote(CV_Subset test_data, Vote_Cache cache, FC_Dataset dataset, int fold_num, Args_Opts args, CV_Overall_Confusion *overall) {
     int i, j;
     
     CV_Matrix Matrix;
@@ -1355,30 +1425,24 @@ void test_ivote(CV_Subset test_data, Vote_Cache cache, FC_Dataset dataset, int f
     CV_Prob_Matrix Prob_Matrix;
     Prob_Matrix.num_classes=0;
     int **Confusion;
-    static int **Overall_Confusion;
-    static int **Overall_Confusion_5x2;
-    static int diagonal_sum = 0;
-    static int total_sum = 0;
-    static int overall_diagonal_sum = 0;
-    static int overall_total_sum = 0;
     
     if (args.output_accuracies == ON || args.output_accuracies == VERBOSE || args.output_predictions || args.output_confusion_matrix || args.output_laplacean) {
         
         // First time through with crossvalfc, initialize Overall_Confusion
         if (args.caller == CROSSVALFC_CALLER && ( (args.do_nfold_cv == TRUE && fold_num == 0) ||
                                                   (args.do_5x2_cv == TRUE && fold_num % 2 == 0) )) {
-            Overall_Confusion = (int **)malloc(test_data.meta.num_classes * sizeof(int *));
+            overall->confusion = (int **)malloc(test_data.meta.num_classes * sizeof(int *));
             for (i = 0; i < test_data.meta.num_classes; i++)
-                Overall_Confusion[i] = (int *)calloc(test_data.meta.num_classes, sizeof(int));
+                overall->confusion[i] = (int *)calloc(test_data.meta.num_classes, sizeof(int));
             
             if (fold_num == 0 && args.do_5x2_cv == TRUE) {
-                Overall_Confusion_5x2 = (int **)malloc(test_data.meta.num_classes * sizeof(int *));
+                overall->confusion_5x2 = (int **)malloc(test_data.meta.num_classes * sizeof(int *));
                 for (i = 0; i < test_data.meta.num_classes; i++)
-                    Overall_Confusion_5x2[i] = (int *)calloc(test_data.meta.num_classes, sizeof(int));
+                    overall->confusion_5x2[i] = (int *)calloc(test_data.meta.num_classes, sizeof(int));
             }
             
-            diagonal_sum = 0;
-            total_sum = 0;
+            overall->diagonal_sum = 0;
+            overall->total_sum = 0;
         }
         
         if (args.do_boosting == TRUE) {
@@ -1403,15 +1467,15 @@ void test_ivote(CV_Subset test_data, Vote_Cache cache, FC_Dataset dataset, int f
             if (args.caller == CROSSVALFC_CALLER) {
                 for (i = 0; i < test_data.meta.num_classes; i++) {
                     for (j = 0; j < test_data.meta.num_classes; j++) {
-                        Overall_Confusion[i][j] += Confusion[i][j];
-                        total_sum += Confusion[i][j];
+                        overall->confusion[i][j] += Confusion[i][j];
+                        overall->total_sum += Confusion[i][j];
                         if (i == j)
-                            diagonal_sum += Confusion[i][j];
+                            overall->diagonal_sum += Confusion[i][j];
                         if (args.do_5x2_cv == TRUE) {
-                            Overall_Confusion_5x2[i][j] += Confusion[i][j];
-                            overall_total_sum += Confusion[i][j];
+                            overall->confusion_5x2[i][j] += Confusion[i][j];
+                            overall->overall_total_sum += Confusion[i][j];
                             if (i == j)
-                                overall_diagonal_sum += Confusion[i][j];
+                                overall->overall_diagonal_sum += Confusion[i][j];
                         }
                     }
                 }
@@ -1446,25 +1510,25 @@ void test_ivote(CV_Subset test_data, Vote_Cache cache, FC_Dataset dataset, int f
         if (args.output_accuracies == ON)
             if ( (args.do_nfold_cv == TRUE && fold_num == args.num_folds-1) ||
                  (args.do_5x2_cv   == TRUE && fold_num % 2 == 1) )
-                     printf("\nOverall Voted Accuracy = %.4f%%\n", (float)diagonal_sum * 100.0 / (float)total_sum);
+                     printf("\nOverall Voted Accuracy = %.4f%%\n", (float)overall->diagonal_sum * 100.0 / (float)overall->total_sum);
         if (args.output_confusion_matrix) {
             if ( (args.do_nfold_cv == TRUE && fold_num == args.num_folds-1) ||
                  (args.do_5x2_cv   == TRUE && fold_num % 2 == 1) ) {
                      printf("Overall Confusion Matrix:\n\n");
-                     print_confusion_matrix(Matrix.num_classes, Overall_Confusion, test_data.meta.class_names);
+                     print_confusion_matrix(Matrix.num_classes, overall->confusion, test_data.meta.class_names);
             }
         }
         printf("\n");
         if (args.do_5x2_cv == TRUE && fold_num == 9) {
             if (args.output_accuracies == ON) {
-                printf("\n5x2 Overall Voted Accuracy = %.4f%%\n", (float)overall_diagonal_sum * 100.0 / (float)overall_total_sum);
+                printf("\n5x2 Overall Voted Accuracy = %.4f%%\n", (float)overall->overall_diagonal_sum * 100.0 / (float)overall->overall_total_sum);
             }
             if (args.output_confusion_matrix == TRUE) {
                 printf("5x2 Overall Confusion Matrix:\n\n");
                 if (args.do_boosting == TRUE)
-                    print_confusion_matrix(Boost_Matrix.num_classes, Overall_Confusion_5x2, test_data.meta.class_names);
+                    print_confusion_matrix(Boost_Matrix.num_classes, overall->confusion_5x2, test_data.meta.class_names);
                 else
-                    print_confusion_matrix(Matrix.num_classes, Overall_Confusion_5x2, test_data.meta.class_names);
+                    print_confusion_matrix(Matrix.num_classes, overall->confusion_5x2, test_data.meta.class_names);
             }
             printf("\n");
         }
@@ -1532,8 +1596,12 @@ void save_tree(DT_Node *tree, int fold_num, int tree_num, Args_Opts args, int nu
         fprintf(stderr, "Failed to open file for saving trees: '%s'\nExiting ...\n", tree_filename);
         exit(8);
     }
-    fprintf(tree_file, "\nTree %d\n", tree_num);
-    _save_node(tree, 0, tree_file, num_classes);
+    if (args.binary_trees) {
+        save_binary_tree(tree_file, tree, tree_num, 0.0, num_classes);
+    } else {
+        fprintf(tree_file, "\nTree %d\n", tree_num);
+        _save_node(tree, 0, tree_file, num_classes);
+    }
     fclose(tree_file);
     free(tree_filename);
 }
@@ -1543,6 +1611,11 @@ void read_ensemble_metadata(FILE *fh, DT_Ensemble *ensemble, int force_num_trees
     int skip_offset;
     char strbuf[262144];
     
+    if (is_binary_trees_file(fh)) {
+        read_binary_ensemble_metadata(fh, ensemble, force_num_trees, args);
+        return;
+    }
+    
     // Read metadata
     
     // Skip comments at top of file
@@ -1572,6 +1645,12 @@ void read_ensemble_metadata(FILE *fh, DT_Ensemble *ensemble, int force_num_trees
     }
     fscanf(fh, "%s", strbuf);
     if (! strcmp(strbuf, "NumAttributes") && fscanf(fh, "%s", strbuf) > 0) {
+        if (ensemble->missing_names != NULL) {
+            for (i = 0; i < ensemble->num_attributes; i++)
+                free(ensemble->missing_names[i]);
+            free(ensemble->missing_names);
+            ensemble->missing_names = NULL;
+        }
         ensemble->num_attributes = atoi(strbuf);
         free(ensemble->attribute_types);
         ensemble->attribute_types = (Attribute_Type *)malloc(ensemble->num_attributes * sizeof(Attribute_Type));
@@ -1631,6 +1710,7 @@ void read_ensemble_metadata(FILE *fh, DT_Ensemble *ensemble, int force_num_trees
     if (! strcmp(strbuf, "MissingAttributeValues:") && ensemble->num_attributes > 0) {
         free(ensemble->Missing);
         ensemble->Missing = (union data_point_union *)malloc(ensemble->num_attributes * sizeof(union data_point_union));
+        ensemble->missing_names = (char **)calloc(ensemble->num_attributes, sizeof(char *));
         fscanf(fh, "%[^\n]", strbuf);
         int num_values;
         char **values = NULL;
@@ -1640,8 +1720,11 @@ void read_ensemble_metadata(FILE *fh, DT_Ensemble *ensemble, int force_num_trees
             if (strcmp(values[i], "??")) {
                 if (ensemble->attribute_types[i-skip_offset] == CONTINUOUS)
                     ensemble->Missing[i-skip_offset].Continuous = atof(values[i]);
-                else if (ensemble->attribute_types[i-skip_offset] == DISCRETE)
-                    ensemble->Missing[i-skip_offset].Discrete = atoi(values[i]);
+                else if (ensemble->attribute_types[i-skip_offset] == DISCRETE) {
+                    // The file holds the value's name; resolve_missing_values() maps it to an index
+                    ensemble->Missing[i-skip_offset].Discrete = 0;
+                    ensemble->missing_names[i-skip_offset] = av_strdup(values[i]);
+                }
             } else {
                 skip_offset++;
             }
@@ -1655,6 +1738,37 @@ void read_ensemble_metadata(FILE *fh, DT_Ensemble *ensemble, int force_num_trees
     }
 }
 
+/*
+ * Maps the names of the discrete missing values read from an ensemble file to value indexes using
+ * meta, which may either have the ensemble's attributes or every attribute in the names file when
+ * the ensemble skipped some (args then holds the ensemble's skipped features)
+ */
+void resolve_missing_values(DT_Ensemble *ensemble, CV_Metadata meta, Args_Opts args) {
+    int i, j;
+    if (ensemble->missing_names == NULL || ensemble->Missing == NULL)
+        return;
+    if (meta.num_attributes != ensemble->num_attributes &&
+        meta.num_attributes != ensemble->num_attributes + args.num_skipped_features) {
+        fprintf(stderr, "WARNING: The ensemble has %d attributes but the names file has %d; discrete missing values are unresolved\n",
+                        ensemble->num_attributes, meta.num_attributes);
+        return;
+    }
+    for (i = 0, j = 0; i < ensemble->num_attributes; i++, j++) {
+        if (meta.num_attributes != ensemble->num_attributes)
+            while (find_int(j+1, args.num_skipped_features, args.skipped_features))
+                j++;
+        if (ensemble->missing_names[i] == NULL || meta.attribute_types[j] != DISCRETE)
+            continue;
+        ensemble->Missing[i].Discrete = translate_discrete(meta.discrete_attribute_map[j],
+                                                           meta.num_discrete_values[j], ensemble->missing_names[i]);
+        if (ensemble->Missing[i].Discrete < 0) {
+            fprintf(stderr, "WARNING: Missing value '%s' for attribute %d is not one of its values\n",
+                            ensemble->missing_names[i], i);
+            ensemble->Missing[i].Discrete = 0;
+        }
+    }
+}
+
 //Added by DACIESL June-09-08: Laplacean Estimates
 //added to check if new or old trees are being used
 void check_tree_version(int fold_num, Args_Opts *args) {
@@ -1676,6 +1790,14 @@ void check_tree_version(int fold_num, Args_Opts *args) {
     }
 
     
+    if (is_binary_trees_file(tree_file)) {
+        if (! binary_trees_have_proportions(tree_file))
+            args->output_probabilities_warning=TRUE;
+        fclose(tree_file);
+        free(tree_filename);
+        return;
+    }
+    
     fscanf(tree_file, "%s", strbuf);
     while (! strcmp(strbuf, "LEAF")) {
         strbuf[0]='\0';
@@ -1692,11 +1814,7 @@ void check_tree_version(int fold_num, Args_Opts *args) {
     free(tree_filename);
 }
 
-//Modified by DACIESL June-04-08: Laplacean Estimates
-//added new _read_tree call
 void read_ensemble(DT_Ensemble *ensemble, int fold_num, int force_num_trees, Args_Opts *args) {
-    int i;
-    char strbuf[262144];
     char *tree_filename = build_output_filename(fold_num, args->trees_file, *args);
     FILE *tree_file;
 
@@ -1704,6 +1822,9 @@ void read_ensemble(DT_Ensemble *ensemble, int fold_num, int force_num_trees, Arg
     ensemble->num_classes = 0;
     ensemble->num_attributes = 0;
     ensemble->num_trees = 0;
+    ensemble->mapped_trees = NULL;
+    ensemble->mapped_size = 0;
+    ensemble->lazy_trees = NULL;
     
     // Open tree file
     if (args->trees_file_is_a_string == TRUE){
@@ -1716,54 +1837,31 @@ void read_ensemble(DT_Ensemble *ensemble, int fold_num, int force_num_trees, Arg
     }
 
     
+    // Binary ensembles are mapped rather than parsed
+    if (args->trees_file_is_a_string == FALSE && is_binary_trees_file(tree_file)) {
+        read_binary_ensemble(tree_file, ensemble, force_num_trees, args);
+        fclose(tree_file);
+        free(tree_filename);
+        return;
+    }
+    
     // Read metadata
     read_ensemble_metadata(tree_file, ensemble, force_num_trees, args);
 
-    // Read trees
-    int this_tree_num = -1;
-    for (i = 0; i < ensemble->num_trees; i++) {
-        fscanf(tree_file, "%s", strbuf);
-        while (! strncmp(strbuf, "#", 1)) {
-            // Finish reading the comment line
-            //printf("Comment line: '%s", strbuf);
-            if (fscanf(tree_file, "%[^\n]", strbuf) <= 0)
-                fscanf(tree_file, "%[\n]", strbuf);
-            //printf("%s'\n", strbuf);
-            // Read start of next line
-            fscanf(tree_file, "%s", strbuf);
-        }
-        if (! strcmp(strbuf, "Tree") && fscanf(tree_file, "%s", strbuf) > 0) {
-            this_tree_num = atoi(strbuf);
-            if (this_tree_num != i+1)
-                fprintf(stderr, "Found tree #%d but expected tree #%d\n", this_tree_num, i+1);
-        }
-        fscanf(tree_file, "%s", strbuf);
-        if (! strcmp(strbuf, "Beta") && fscanf(tree_file, "%s", strbuf) > 0) {
-            if (this_tree_num == 1) {
-                // Initialize boosting_betas array and set do_boosting to TRUE
-                ensemble->boosting_betas = (double *)malloc(sizeof(double));
-                args->do_boosting = TRUE;
-            } else {
-                // Reallocate for new number of trees
-                ensemble->boosting_betas = (double *)realloc(ensemble->boosting_betas, this_tree_num * sizeof(double));
-            }
-            ensemble->boosting_betas[this_tree_num-1] = atof(strbuf);
-            strbuf[0] = '\0'; // Zero out strbuf to signify that _read_tree needs to read first
-        } else {
-            // Didn't find a 'Beta' line so _read_tree should NOT read as its first action
-            // If we're boosting, this is a problem
-            if (args->do_boosting == TRUE) {
-                fprintf(stderr, "ERROR: Ensemble file format error - no beta for tree %d\n", this_tree_num);
-                exit(-1);
-            }
+    // Read trees from the rest of the text
+    if (args->trees_file_is_a_string == TRUE) {
+        long offset = ftell(tree_file);
+        read_text_trees(args->trees_string + offset, strlen(args->trees_string) - offset, ensemble, args);
+    } else {
+        // The trees are parsed straight out of a read-only mapping of the file
+        Input_Text input;
+        long offset = ftell(tree_file);
+        if (! open_input_text(tree_filename, NULL, FALSE, FALSE, &input) || (size_t)offset > input.length) {
+            fprintf(stderr, "Failed to read trees from file: '%s'\nExiting ...\n", tree_filename);
+            exit(8);
         }
-        //printf("Reading Tree %d (i=%d)\n", this_tree_num, i);
-        ensemble->Books[i].num_malloced_nodes = 1;
-        ensemble->Books[i].next_unused_node = 1;
-        ensemble->Books[i].current_node = 0;
-        ensemble->Trees[i] = (DT_Node *)malloc(ensemble->Books[i].num_malloced_nodes * sizeof(DT_Node));
-        reset_DT_Node(ensemble->Trees[i]);
-        _read_tree(strbuf, &ensemble->Trees[i], &ensemble->Books[i], tree_file, ensemble->num_classes);
+        read_text_trees(input.text + offset, input.length - offset, ensemble, args);
+        close_input_text(&input);
     }
     
     fclose(tree_file);
@@ -1771,204 +1869,85 @@ void read_ensemble(DT_Ensemble *ensemble, int fold_num, int force_num_trees, Arg
     
 }
 
-//Modified by DACIESL June-04-08: Laplacean Estimates
-//added consideration for reading class counts from file
-void _read_tree(char *initial_str, DT_Node **tree, Tree_Bookkeeping *book, FILE *fh, int num_classes) {
-    int this_node = book->current_node;
-    char strbuf[16384];
-    int i;
-    int rc = 1; // Initialize in case we don't do an initial read
-    //printf("Reading trees...\n");
-    
-    // If we're passed an empty string, then read from fh. Otherwise, use what we were given
-    if (! strcmp(initial_str, ""))
-        rc = fscanf(fh, "%s", strbuf);
-    else
-        strcpy(strbuf, initial_str);
-    
-    //printf("First read: '%s' (%d)\n", strbuf, rc);
-    if (strbuf == NULL) {
-        fprintf(stderr, "Didn't read anything. Returning\n");
-        return;
-    }
-    if (rc == EOF) {
-        fprintf(stderr, "Got EOF. Returning\n");
-        return;
-    }
-    
-    // We have a leaf
-    if (! strcmp(strbuf, "LEAF")) {
-        while (this_node >= book->num_malloced_nodes) {
-            book->num_malloced_nodes *= 2;
-            *tree = (DT_Node *)realloc(*tree, book->num_malloced_nodes * sizeof(DT_Node));
-        }
-        //printf("Node %d is a leaf\n", this_node);
-        (*tree)[this_node].branch_type = LEAF;
-        (*tree)[this_node].num_branches = 0;
-        int j;
-        float total = 0.0;
-        fscanf(fh, "%s", strbuf);
-	if (! strcmp(strbuf, "Class")) {
-            fscanf(fh, "%d", &j);
-            (*tree)[this_node].Node_Value.class_label = j;
-            (*tree)[this_node].class_count = (int *)calloc(num_classes, sizeof(int));
-            //printf("Allocate class_probs in _read_tree() for Class for node %d\n", this_node);
-            (*tree)[this_node].class_probs = (float *)calloc(num_classes, sizeof(float));
-            fscanf(fh, "%s", strbuf);
-            for (i = 0; i < num_classes; i++) {
-                fscanf(fh, "%d", &j);
-                (*tree)[this_node].class_count[i] = j;
-                total += j;
-            }
-            for (i = 0; i < num_classes; i++) {
-  	        (*tree)[this_node].class_probs[i] = ((*tree)[this_node].class_count[i] + 1.0)/(num_classes + total);
-            }
-	} else {
-            (*tree)[this_node].Node_Value.class_label = atoi(strbuf);
-            (*tree)[this_node].class_count = (int *)calloc(num_classes, sizeof(int));
-            //printf("Allocate class_probs in _read_tree() for !Class for node %d\n", this_node);
-            (*tree)[this_node].class_probs = (float *)calloc(num_classes, sizeof(float));
-            for (i = 0; i < num_classes; i++) {
-                (*tree)[this_node].class_count[i] = -1;
-            }
-            for (i = 0; i < num_classes; i++) {
-	        (*tree)[this_node].class_probs[i] = 0.0;
-            }
-	    (*tree)[this_node].class_probs[(*tree)[this_node].Node_Value.class_label] = 1.0;
-	}
-        return;
-    }
-    
-    // We have a split
-    else if (! strcmp(strbuf, "SPLIT")) {
-        fscanf(fh, "%s", strbuf);
-        if (! strcmp(strbuf, "DISCRETE")) {
-            while (this_node >= book->num_malloced_nodes) {
-                book->num_malloced_nodes *= 2;
-                *tree = (DT_Node *)realloc(*tree, book->num_malloced_nodes * sizeof(DT_Node));
-            }
-            (*tree)[this_node].branch_type  = BRANCH;
-            (*tree)[this_node].attribute_type = DISCRETE;
-            fscanf(fh, "%s", strbuf); // should be "ATT#"
-            fscanf(fh, "%s", strbuf);
-            (*tree)[this_node].attribute = atoi(strbuf);
-            fscanf(fh, "%s", strbuf); // should be "VAL#"
-            fscanf(fh, "%s", strbuf); // should be the branch number
-            int this_branch_number = atoi(strbuf);
-            fscanf(fh, "%s", strbuf); // should be "/"
-            fscanf(fh, "%s", strbuf); // should be total number of splits
-            (*tree)[this_node].num_branches = atoi(strbuf);
-            if (this_branch_number == 1)
-                (*tree)[this_node].Node_Value.branch = (int *)malloc((*tree)[this_node].num_branches * sizeof(int));
-            //printf("Node %d has child %d\n", this_node, book->next_unused_node);
-            (*tree)[this_node].Node_Value.branch[this_branch_number-1] = book->next_unused_node;
-            book->current_node = book->next_unused_node;
-            book->next_unused_node++;
-            _read_tree("", tree, book, fh, num_classes);
-            while (this_branch_number < (*tree)[this_node].num_branches) {
-                // Handle comments
-                fscanf(fh, "%s", strbuf);
-                while (! strncmp(strbuf, "#", 1)) {
-                    // Finish reading the comment line
-                    //printf("Comment line: '%s", strbuf);
-                    if (fscanf(fh, "%[^\n]", strbuf) <= 0)
-                        fscanf(fh, "%[\n]", strbuf);
-                    //printf("%s'\n", strbuf);
-                    // Read start of next line
-                    fscanf(fh, "%s", strbuf);
-                }
-                for (i = 1; i < 5; i++)
-                    fscanf(fh, "%s", strbuf);
-                fscanf(fh, "%s", strbuf); // should be the branch number
-                this_branch_number = atoi(strbuf);
-                fscanf(fh, "%s", strbuf); // should be "/"
-                fscanf(fh, "%s", strbuf); // should be total number of splits
-                if (atoi(strbuf) != (*tree)[this_node].num_branches) {
-                    fprintf(stderr, "ERROR: Error reading tree file: Got %d branches but expected %d\n",
-                                    atoi(strbuf), (*tree)[this_node].num_branches);
-                    exit(-8);
-                }
-                //printf("Node %d has child %d\n", this_node, book->next_unused_node);
-                (*tree)[this_node].Node_Value.branch[this_branch_number-1] = book->next_unused_node;
-                book->current_node = book->next_unused_node;
-                book->next_unused_node++;
-                _read_tree("", tree, book, fh, num_classes);
-            }
-        } else if (! strcmp(strbuf, "CONTINUOUS")) {
-            while (this_node >= book->num_malloced_nodes) {
-                book->num_malloced_nodes *= 2;
-                *tree = (DT_Node *)realloc(*tree, book->num_malloced_nodes * sizeof(DT_Node));
-            }
-            (*tree)[this_node].branch_type  = BRANCH;
-            (*tree)[this_node].attribute_type = CONTINUOUS;
-            fscanf(fh, "%s", strbuf); // should be "ATT#"
-            fscanf(fh, "%s", strbuf);
-            (*tree)[this_node].attribute = atoi(strbuf);
-            fscanf(fh, "%s", strbuf); // should be "<" or ">="
-            fscanf(fh, "%s", strbuf);
-            (*tree)[this_node].branch_threshold = atof(strbuf);
-            (*tree)[this_node].num_branches = 2;
-            (*tree)[this_node].Node_Value.branch = (int *)malloc(2 * sizeof(int));
-            //printf("Node %d has child %d\n", this_node, book->next_unused_node);
-            (*tree)[this_node].Node_Value.branch[0] = book->next_unused_node;
-            book->current_node = book->next_unused_node;
-            book->next_unused_node++;
-            _read_tree("", tree, book, fh, num_classes);
-            //printf("Node %d has child %d\n", this_node, book->next_unused_node);
-            (*tree)[this_node].Node_Value.branch[1] = book->next_unused_node;
-            book->current_node = book->next_unused_node;
-            book->next_unused_node++;
-            // Skip over next line which is the redefinition of the previous SPLIT
-            // First check for comments
-            fscanf(fh, "%s", strbuf);
-            while (! strncmp(strbuf, "#", 1)) {
-                // Finish reading the comment line
-                //printf("Comment line: '%s", strbuf);
-                if (fscanf(fh, "%[^\n]", strbuf) <= 0)
-                    fscanf(fh, "%[\n]", strbuf);
-                //printf("%s'\n", strbuf);
-                // Read start of next line
-                fscanf(fh, "%s", strbuf);
-            }
-            for (i = 1; i < 6; i++)
-                fscanf(fh, "%s", strbuf);
-            _read_tree("", tree, book, fh, num_classes);
-        } else {
-            fprintf(stderr, "Got unknown node type: '%s'\n", strbuf);
-        }
-    }
-    
-    else if (! strncmp(strbuf, "#", 1)) {
-        // Finish reading the comment line
-        //printf("Comment line: '%s", strbuf);
-        if (fscanf(fh, "%[^\n]", strbuf) <= 0)
-            fscanf(fh, "%[\n]", strbuf);
-        //printf("%s'\n", strbuf);
-        // I am ignoring comments so call myself again to get the next line and keep going
-        _read_tree("", tree, book, fh, num_classes);
-    }
+/*
+ * Returns the number of trees in an ensemble file, reading only its metadata
+ */
+int read_ensemble_num_trees(int fold_num, Args_Opts args) {
+    char *tree_filename = build_output_filename(fold_num, args.trees_file, args);
+    FILE *tree_file;
+    DT_Ensemble ensemble;
+    int num_trees;
     
-    // Unknown line
-    else {
-        fprintf(stderr, "Got unexpected token inside a tree: '%s'\n", strbuf);
+    if ((tree_file = fopen(tree_filename, "r")) == NULL) {
+        fprintf(stderr, "Failed to open file for reading trees: '%s'\nExiting ...\n", tree_filename);
+        exit(8);
     }
+    reset_DT_Ensemble(&ensemble);
+    // read_ensemble_metadata replaces the caller's list of skipped features
+    args.skipped_features = NULL;
+    read_ensemble_metadata(tree_file, &ensemble, 0, &args);
+    num_trees = ensemble.num_trees;
     
-    return;
+    fclose(tree_file);
+    free(tree_filename);
+    free(args.skipped_features);
+    free_DT_Ensemble(ensemble, TEST_MODE);
+    return num_trees;
+}
+
+/*
+ * Returns TRUE if column i of the attributes plus skipped features is one of the features to skip
+ */
+int is_skipped_column(int i, Args_Opts *args) {
+    if (args->truth_column > 0 && i+1 >= args->truth_column &&
+        find_int(i+2, args->num_skipped_features, args->skipped_features)) {
+        // The current attribute is in a column past the truth column so look for the
+        // attribute number + 2 (extra +1 is because all_atts is 0-based) in the list
+        // of features to skip since the list is based on column number and not attribute number
+        return TRUE;
+    } else if (args->truth_column > 0 && i+1 < args->truth_column &&
+               find_int(i+1, args->num_skipped_features, args->skipped_features)) {
+        // The current attribute is before the truth column so attribute number corresponds
+        // to column number.
+        return TRUE;
+    } else if (args->truth_column < 0 &&
+               find_int(i+1, args->num_skipped_features, args->skipped_features)) {
+        // The truth column is last so all attributes are before the truth column
+        return TRUE;
+    }
+    return FALSE;
 }
 
 char* write_tree_file_header(int num_trees, CV_Metadata meta, int fold_num, char *tree_filename, Args_Opts args) {
-    int i;
     FILE *tree_file;
+    char *mod_tree_filename = build_output_filename(fold_num, tree_filename, args);
+    if ((tree_file = fopen(mod_tree_filename, "w")) == NULL) {
+        fprintf(stderr, "Failed to open file for writing metadata: '%s'\nExiting ...\n", mod_tree_filename);
+        exit(8);
+    }
+    _write_tree_file_header(tree_file, num_trees, meta, tree_filename, args);
+    fclose(tree_file);
+    return(mod_tree_filename);
+}
+
+/*
+ * Writes the metadata to an open file. tree_filename is the unmodified name of the file, which
+ * says whether this is the ensemble file or the oob-data file
+ */
+static void _write_tree_file_header(FILE *tree_file, int num_trees, CV_Metadata meta, char *tree_filename, Args_Opts args) {
+    int i;
     // Print hash marks before metadata if we're writing the oob-data file
     char *comment;
     if (! strcmp(tree_filename, args.oob_file))
         comment = av_strdup("#");
     else
         comment = av_strdup("");
-    char *mod_tree_filename = build_output_filename(fold_num, tree_filename, args);
-    if ((tree_file = fopen(mod_tree_filename, "w")) == NULL) {
-        fprintf(stderr, "Failed to open file for writing metadata: '%s'\nExiting ...\n", mod_tree_filename);
-        exit(8);
+    
+    // A binary ensemble file has no room for the run summary
+    if (args.binary_trees && ! strcmp(tree_filename, args.trees_file)) {
+        write_binary_trees_header(tree_file, num_trees, meta, args);
+        free(comment);
+        return;
     }
     
     // Print run summary info to ensemble file
@@ -1995,25 +1974,7 @@ char* write_tree_file_header(int num_trees, CV_Metadata meta, int fold_num, char
     fprintf(tree_file, "%sAttributeTypes: ", comment);
     int skip_offset = 0;
     for (i = 0; i < meta.num_attributes + args.num_skipped_features; i++) {
-        if (args.truth_column > 0 && i+1 >= args.truth_column &&
-            find_int(i+2, args.num_skipped_features, args.skipped_features)) {
-            // The current attribute is in a column past the truth column so look for the
-            // attribute number + 2 (extra +1 is because all_atts is 0-based) in the list
-            // of features to skip since the list is based on column number and not attribute number
-            //printf("Skipping this att because %d+2 is in the list of features to skip\n", i);
-            skip_offset++;
-            fprintf(tree_file, "UNKNOWN ");
-        } else if (args.truth_column > 0 && i+1 < args.truth_column &&
-                   find_int(i+1, args.num_skipped_features, args.skipped_features)) {
-            // The current attribute is before the truth column so attribute number corresponds
-            // to column number.
-            //printf("Skipping this att because %d+1 is in the list of features to skip\n", i);
-            skip_offset++;
-            fprintf(tree_file, "UNKNOWN ");
-        } else if (args.truth_column < 0 &&
-                   find_int(i+1, args.num_skipped_features, args.skipped_features)) {
-            // The truth column is last so all attributes are before the truth column
-            //printf("Skipping this att because %d+1 is in the list of features to skip\n", i);
+        if (is_skipped_column(i, &args)) {
             skip_offset++;
             fprintf(tree_file, "UNKNOWN ");
         } else if (meta.attribute_types[i-skip_offset] == DISCRETE) {
@@ -2027,55 +1988,17 @@ char* write_tree_file_header(int num_trees, CV_Metadata meta, int fold_num, char
     fprintf(tree_file, "\n");
     fprintf(tree_file, "%sSkipAttributes: ", comment);
     for (i = 0; i < meta.num_attributes + args.num_skipped_features; i++) {
-        if (args.truth_column > 0 && i+1 >= args.truth_column &&
-            find_int(i+2, args.num_skipped_features, args.skipped_features)) {
-            // The current attribute is in a column past the truth column so look for the
-            // attribute number + 2 (extra +1 is because all_atts is 0-based) in the list
-            // of features to skip since the list is based on column number and not attribute number
-            //printf("Skipping this att because %d+2 is in the list of features to skip\n", i);
-            skip_offset++;
+        if (is_skipped_column(i, &args))
             fprintf(tree_file, "SKIP ");
-        } else if (args.truth_column > 0 && i+1 < args.truth_column &&
-                   find_int(i+1, args.num_skipped_features, args.skipped_features)) {
-            // The current attribute is before the truth column so attribute number corresponds
-            // to column number.
-            //printf("Skipping this att because %d+1 is in the list of features to skip\n", i);
-            skip_offset++;
-            fprintf(tree_file, "SKIP ");
-        } else if (args.truth_column < 0 &&
-                   find_int(i+1, args.num_skipped_features, args.skipped_features)) {
-            // The truth column is last so all attributes are before the truth column
-            //printf("Skipping this att because %d+1 is in the list of features to skip\n", i);
-            skip_offset++;
-            fprintf(tree_file, "SKIP ");
-        } else {
+        else
             fprintf(tree_file, "NOSKIP ");
-        }
     }
     fprintf(tree_file, "\n");
     fprintf(tree_file, "%sMissingAttributeValues: ", comment);
     skip_offset = 0;
     for (i = 0; i < meta.num_attributes + args.num_skipped_features; i++) {
         //printf("Looking at 0-based att %d\n", i);
-        if (args.truth_column > 0 && i+1 >= args.truth_column &&
-            find_int(i+2, args.num_skipped_features, args.skipped_features)) {
-            // The current attribute is in a column past the truth column so look for the
-            // attribute number + 2 (extra +1 is because all_atts is 0-based) in the list
-            // of features to skip since the list is based on column number and not attribute number
-            //printf("Skipping this att because %d+2 is in the list of features to skip\n", i);
-            skip_offset++;
-            fprintf(tree_file, "??");
-        } else if (args.truth_column > 0 && i+1 < args.truth_column &&
-                   find_int(i+1, args.num_skipped_features, args.skipped_features)) {
-            // The current attribute is before the truth column so attribute number corresponds
-            // to column number.
-            //printf("Skipping this att because %d+1 is in the list of features to skip\n", i);
-            skip_offset++;
-            fprintf(tree_file, "??");
-        } else if (args.truth_column < 0 &&
-                   find_int(i+1, args.num_skipped_features, args.skipped_features)) {
-            // The truth column is last so all attributes are before the truth column
-            //printf("Skipping this att because %d+1 is in the list of features to skip\n", i);
+        if (is_skipped_column(i, &args)) {
             skip_offset++;
             fprintf(tree_file, "??");
         } else if (args.format == AVATAR_FORMAT && meta.attribute_types[i-skip_offset] == DISCRETE) {
@@ -2092,11 +2015,9 @@ char* write_tree_file_header(int num_trees, CV_Metadata meta, int fold_num, char
             fprintf(tree_file, ",");
     }
     fprintf(tree_file, "\n");
-    
-    fclose(tree_file);
+    free(comment);
     
     find_int_release();
-    return(mod_tree_filename);
 }
 
 /*
@@ -2142,6 +2063,10 @@ void write_tree_file_header_E(DT_Ensemble ensemble, int fold_num, Args_Opts args
 void save_ensemble(DT_Ensemble ensemble, CV_Metadata data, int fold_num, Args_Opts args, int num_classes) {
     int i;
     FILE *tree_file;
+    if (args.binary_trees) {
+        save_binary_ensemble(ensemble, data, fold_num, args, num_classes);
+        return;
+    }
     char *tree_filename = write_tree_file_header(ensemble.num_trees, data, fold_num, args.trees_file, args);
     if ((tree_file = fopen(tree_filename, "a")) == NULL) {
         fprintf(stderr, "Failed to open file for saving trees: '%s'\nExiting ...\n", tree_filename);
@@ -2157,6 +2082,224 @@ void save_ensemble(DT_Ensemble ensemble, CV_Metadata data, int fold_num, Args_Op
     free(tree_filename);
 }
 
+/*
+ * Writes an ensemble that is already in memory to filename in either format, taking the header
+ * from the ensemble and the skipped features in args rather than from a dataset. The file is
+ * written under a temporary name first so that filename may be the file the ensemble was read from.
+ */
+void write_ensemble_file(char *filename, DT_Ensemble ensemble, Args_Opts args, Boolean binary) {
+    int i;
+    int skip_offset;
+    int num_columns = ensemble.num_attributes + args.num_skipped_features;
+    FILE *fh;
+    char *tmp_filename;
+    
+    tmp_filename = (char *)malloc((strlen(filename) + 5) * sizeof(char));
+    sprintf(tmp_filename, "%s.tmp", filename);
+    if ((fh = fopen(tmp_filename, "w")) == NULL) {
+        fprintf(stderr, "Failed to open file for writing trees: '%s'\nExiting ...\n", tmp_filename);
+        exit(8);
+    }
+    
+    if (binary) {
+        write_binary_ensemble_header(fh, ensemble, args);
+        for (i = 0; i < ensemble.num_trees; i++)
+            save_binary_tree(fh, ensemble.Trees[i], i+1,
+                             ensemble.boosting_betas != NULL ? ensemble.boosting_betas[i] : 0.0, ensemble.num_classes);
+    } else {
+        // Same layout as write_tree_file_header and save_ensemble
+        fprintf(fh, "NumTrainingExamples  %d\n", ensemble.num_training_examples);
+        fprintf(fh, "NumClasses           %d\n", ensemble.num_classes);
+        fprintf(fh, "NumExamplesPerClass: ");
+        for (i = 0; i < ensemble.num_classes; i++)
+            fprintf(fh, "%d ", ensemble.num_training_examples_per_class[i]);
+        fprintf(fh, "\n");
+        fprintf(fh, "NumAttributes        %d\n", ensemble.num_attributes);
+        fprintf(fh, "NumSkippedAttributes %d\n", args.num_skipped_features);
+        fprintf(fh, "NumTrees             %d\n", ensemble.num_trees);
+        fprintf(fh, "AttributeTypes: ");
+        skip_offset = 0;
+        for (i = 0; i < num_columns; i++) {
+            if (find_int(i+1, args.num_skipped_features, args.skipped_features)) {
+                skip_offset++;
+                fprintf(fh, "UNKNOWN ");
+            } else {
+                fprintf(fh, "%s ", ensemble.attribute_types[i-skip_offset] == DISCRETE ? "DISCRETE" : "CONTINUOUS");
+            }
+        }
+        fprintf(fh, "\n");
+        fprintf(fh, "SkipAttributes: ");
+        for (i = 0; i < num_columns; i++)
+            fprintf(fh, "%s ", find_int(i+1, args.num_skipped_features, args.skipped_features) ? "SKIP" : "NOSKIP");
+        fprintf(fh, "\n");
+        fprintf(fh, "MissingAttributeValues: ");
+        skip_offset = 0;
+        for (i = 0; i < num_columns; i++) {
+            if (find_int(i+1, args.num_skipped_features, args.skipped_features)) {
+                skip_offset++;
+                fprintf(fh, "??");
+            } else if (ensemble.attribute_types[i-skip_offset] == DISCRETE) {
+                // The text format holds the value's name, so keep the one that was read
+                if (ensemble.missing_names != NULL && ensemble.missing_names[i-skip_offset] != NULL)
+                    fprintf(fh, "%s", ensemble.missing_names[i-skip_offset]);
+                else
+                    fprintf(fh, "%d", ensemble.Missing[i-skip_offset].Discrete);
+            } else {
+                fprintf(fh, "%g", ensemble.Missing[i-skip_offset].Continuous);
+            }
+            if (i < num_columns - 1)
+                fprintf(fh, ",");
+        }
+        fprintf(fh, "\n");
+        
+        for (i = 0; i < ensemble.num_trees; i++) {
+            fprintf(fh, "Tree %d\n", i+1);
+            if (ensemble.boosting_betas != NULL)
+                fprintf(fh, "Beta %g\n", ensemble.boosting_betas[i]);
+            _save_node(ensemble.Trees[i], 0, fh, ensemble.num_classes);
+        }
+    }
+    
+    fclose(fh);
+    if (rename(tmp_filename, filename) < 0) {
+        fprintf(stderr, "Failed to rename '%s' to '%s'\nExiting ...\n", tmp_filename, filename);
+        exit(8);
+    }
+    free(tmp_filename);
+}
+
+/*
+ * With --stream-trees, train() hands each tree to stream_tree as soon as it is built instead of
+ * keeping the ensemble for save_ensemble. The file is written under a temporary name and renamed
+ * into place by end_tree_stream. When the stopping algorithm decides the number of trees, the
+ * header can't be written first so the trees go to a second temporary file and end_tree_stream
+ * copies the ones that are kept in after the header, using the options and metadata from the
+ * start of training. Either way the result is the file that save_ensemble would have written.
+ */
+static void _init_tree_stream(Tree_Stream *stream, int num_trees, CV_Metadata meta, int fold_num, Args_Opts args) {
+    stream->filename = build_output_filename(fold_num, args.trees_file, args);
+    stream->meta = meta;
+    stream->args = args;
+    stream->tmp_filename = (char *)malloc((strlen(stream->filename) + 5) * sizeof(char));
+    sprintf(stream->tmp_filename, "%s.tmp", stream->filename);
+    stream->body_filename = NULL;
+    if (num_trees <= 0) {
+        stream->body_filename = (char *)malloc((strlen(stream->filename) + 6) * sizeof(char));
+        sprintf(stream->body_filename, "%s.body", stream->filename);
+    }
+    stream->num_trees = 0;
+    stream->num_malloced = 100;
+    stream->tree_ends = (long *)malloc(stream->num_malloced * sizeof(long));
+}
+
+void begin_tree_stream(Tree_Stream *stream, int num_trees, CV_Metadata meta, int fold_num, Args_Opts args) {
+    _init_tree_stream(stream, num_trees, meta, fold_num, args);
+    
+    if (num_trees > 0) {
+        if ((stream->fh = fopen(stream->tmp_filename, "w")) == NULL) {
+            fprintf(stderr, "Failed to open file for saving trees: '%s'\nExiting ...\n", stream->tmp_filename);
+            exit(8);
+        }
+        _write_tree_file_header(stream->fh, num_trees, meta, args.trees_file, args);
+    } else {
+        if ((stream->fh = fopen(stream->body_filename, "w+")) == NULL) {
+            fprintf(stderr, "Failed to open file for saving trees: '%s'\nExiting ...\n", stream->body_filename);
+            exit(8);
+        }
+    }
+}
+
+/*
+ * Reopens the file that an interrupted stream was writing and carries on after its first num_streamed
+ * trees, which end at the offsets in tree_ends. Anything written after them is discarded.
+ * Returns FALSE if the file is missing or too short.
+ */
+Boolean resume_tree_stream(Tree_Stream *stream, int num_trees, int num_streamed, long *tree_ends,
+                           CV_Metadata meta, int fold_num, Args_Opts args) {
+    struct stat sb;
+    char *partial;
+    _init_tree_stream(stream, num_trees, meta, fold_num, args);
+    partial = stream->body_filename != NULL ? stream->body_filename : stream->tmp_filename;
+    
+    while (stream->num_malloced < num_streamed)
+        stream->num_malloced *= 2;
+    stream->tree_ends = (long *)realloc(stream->tree_ends, stream->num_malloced * sizeof(long));
+    memcpy(stream->tree_ends, tree_ends, num_streamed * sizeof(long));
+    stream->num_trees = num_streamed;
+    
+    if (stat(partial, &sb) != 0 || sb.st_size < tree_ends[num_streamed-1] ||
+        (stream->fh = fopen(partial, "r+")) == NULL) {
+        free(stream->tree_ends);
+        free(stream->body_filename);
+        free(stream->tmp_filename);
+        free(stream->filename);
+        return FALSE;
+    }
+    if (ftruncate(fileno(stream->fh), tree_ends[num_streamed-1]) != 0) {
+        fprintf(stderr, "Failed to truncate '%s'\nExiting ...\n", partial);
+        exit(8);
+    }
+    fseek(stream->fh, 0, SEEK_END);
+    return TRUE;
+}
+
+void stream_tree(Tree_Stream *stream, DT_Node *tree, double beta, Args_Opts args, int num_classes) {
+    if (args.binary_trees) {
+        save_binary_tree(stream->fh, tree, stream->num_trees+1, args.do_boosting == TRUE ? beta : 0.0, num_classes);
+    } else {
+        fprintf(stream->fh, "Tree %d\n", stream->num_trees+1);
+        if (args.do_boosting == TRUE)
+            fprintf(stream->fh, "Beta %g\n", beta);
+        _save_node(tree, 0, stream->fh, num_classes);
+    }
+    if (stream->num_trees == stream->num_malloced) {
+        stream->num_malloced *= 2;
+        stream->tree_ends = (long *)realloc(stream->tree_ends, stream->num_malloced * sizeof(long));
+    }
+    stream->tree_ends[stream->num_trees++] = ftell(stream->fh);
+}
+
+/*
+ * Finishes the ensemble file with the first num_trees trees that were streamed
+ */
+void end_tree_stream(Tree_Stream *stream, int num_trees) {
+    if (stream->body_filename != NULL) {
+        FILE *tree_file;
+        char buf[65536];
+        long remaining = num_trees > 0 ? stream->tree_ends[num_trees-1] : 0;
+        if ((tree_file = fopen(stream->tmp_filename, "w")) == NULL) {
+            fprintf(stderr, "Failed to open file for saving trees: '%s'\nExiting ...\n", stream->tmp_filename);
+            exit(8);
+        }
+        _write_tree_file_header(tree_file, num_trees, stream->meta, stream->args.trees_file, stream->args);
+        rewind(stream->fh);
+        while (remaining > 0) {
+            size_t n = fread(buf, 1, remaining < (long)sizeof(buf) ? (size_t)remaining : sizeof(buf), stream->fh);
+            if (n == 0) {
+                fprintf(stderr, "Failed to read back trees from '%s'\nExiting ...\n", stream->body_filename);
+                exit(8);
+            }
+            fwrite(buf, 1, n, tree_file);
+            remaining -= n;
+        }
+        fclose(stream->fh);
+        remove(stream->body_filename);
+        free(stream->body_filename);
+        stream->fh = tree_file;
+    }
+    if (fclose(stream->fh) != 0) {
+        fprintf(stderr, "Failed to write trees to '%s'\nExiting ...\n", stream->tmp_filename);
+        exit(8);
+    }
+    if (rename(stream->tmp_filename, stream->filename) < 0) {
+        fprintf(stderr, "Failed to rename '%s' to '%s'\nExiting ...\n", stream->tmp_filename, stream->filename);
+        exit(8);
+    }
+    free(stream->tree_ends);
+    free(stream->tmp_filename);
+    free(stream->filename);
+}
+
 //Added by MEGOLDS August, 2012: subsampling
 //Modified by MEGOLDS September, 2012
 // Sample source without replacement to produce subsample of given size
@@ -2226,6 +2369,17 @@ void free_copied_CV_Subset(CV_Subset *sub) {
     free(sub->discrete_used);
 }
 
+// Returns the branch of node that example goes down
+static int _find_branch(DT_Node *node, CV_Example *example, int returned_low, int returned_high) {
+    if (node->attribute_type == CONTINUOUS) {
+        // < threshold goes left; >= threshold goes right
+        if (example->distinct_attribute_values[node->attribute] < (float)(returned_low + returned_high)/2.0)
+            return 0;
+        return 1;
+    }
+    return example->distinct_attribute_values[node->attribute];
+}
+
 //Modified by DACIESL June-03-08: Laplacean Estimates
 //Modified stop(data, args) == true case to fill new class_count and class_prob variables at each node
 //Modified to handle collapse cases as well
@@ -2291,35 +2445,28 @@ void build_tree(CV_Subset *data, DT_Node **tree, Tree_Bookkeeping *Books, Args_O
             branch_data = (CV_Subset *)calloc((*tree)[this_node].num_branches, sizeof(CV_Subset));
             
 // NOTE: Can I do these one at a time so I don't have to have them all in memory at the same time?
-//       Can I more accurately size them for the number of examples in the branch rather than allocating num_examples?
 
-            // Initialize the branch datasets by malloc'ing and pointing to values that won't be modified
-            for (i = 0; i < (*tree)[this_node].num_branches; i++)
-                copy_subset_meta(*data, &branch_data[i], data->meta.num_examples);
+            // Count the examples in each branch so each branch dataset is sized exactly
+            int *branch_size = (int *)calloc((*tree)[this_node].num_branches, sizeof(int));
+            for (i = 0; i < data->meta.num_examples; i++)
+                branch_size[_find_branch(&(*tree)[this_node], &data->examples[i], returned_low, returned_high)]++;
             
-            // Assign each example to the appropriate branch
-            if ((*tree)[this_node].attribute_type == CONTINUOUS) {
-                for (i = 0; i < data->meta.num_examples; i++) {
-                    // < threshold goes left; >= threshold goes right
-                    if (data->examples[i].distinct_attribute_values[(*tree)[this_node].attribute] <
-                                                                        (float)(returned_low + returned_high)/2.0) {
-                        branch_data[0].examples[branch_data[0].meta.num_examples] = data->examples[i];
-                        branch_data[0].meta.num_examples++;
-                    } else {
-                        branch_data[1].examples[branch_data[1].meta.num_examples] = data->examples[i];
-                        branch_data[1].meta.num_examples++;
-                    }
-                }
-            } else if ((*tree)[this_node].attribute_type == DISCRETE) {
-                for (i = 0; i < data->meta.num_examples; i++) {
-                    int b = data->examples[i].distinct_attribute_values[(*tree)[this_node].attribute];
-                    //printf("Example %d Attribute %d DistinctValue %d\n", i, (*tree)[this_node].attribute, b);
-                    branch_data[b].examples[branch_data[b].meta.num_examples] = data->examples[i];
-                    branch_data[b].meta.num_examples++;
+            // Initialize the branch datasets by malloc'ing and pointing to values that won't be modified.
+            // With --out-of-core the larger ones are kept in scratch files
+            for (i = 0; i < (*tree)[this_node].num_branches; i++) {
+                copy_subset_meta(*data, &branch_data[i], branch_size[i]);
+                if (args.out_of_core == TRUE) {
+                    free(branch_data[i].examples);
+                    branch_data[i].examples = (CV_Example *)scratch_alloc(branch_size[i] * sizeof(CV_Example), args);
                 }
-                //printf("Split up %d examples into: %d\n", data->meta.num_examples, branch_data[0].num_examples);
-                //for (i = 1; i < (*tree)[this_node].num_branches; i++)
-                //    printf("                           %d\n", branch_data[i].num_examples);
+            }
+            free(branch_size);
+            
+            // Assign each example to the appropriate branch
+            for (i = 0; i < data->meta.num_examples; i++) {
+                int b = _find_branch(&(*tree)[this_node], &data->examples[i], returned_low, returned_high);
+                branch_data[b].examples[branch_data[b].meta.num_examples] = data->examples[i];
+                branch_data[b].meta.num_examples++;
             }
 
             // Copy values that will be modified
@@ -2448,7 +2595,7 @@ void build_tree(CV_Subset *data, DT_Node **tree, Tree_Bookkeeping *Books, Args_O
             // Clean up
             for (i = 0; i < num_branches_to_clean; i++) {
                 //free_CV_Subset_inter(branch_data[i], args, TRAIN_MODE);
-                free(branch_data[i].examples);
+                scratch_free(branch_data[i].examples);
                 free(branch_data[i].high);
                 free(branch_data[i].low);
                 free(branch_data[i].discrete_used);
@@ -2873,6 +3020,8 @@ void copy_subset_meta(CV_Subset src, CV_Subset *dest, int population) {
     dest->meta.global_offset = src.meta.global_offset;
     dest->float_data = src.float_data;
     dest->meta.discrete_attribute_map = src.meta.discrete_attribute_map;
+    dest->meta.discrete_index = src.meta.discrete_index;
+    dest->meta.class_index = src.meta.class_index;
     dest->meta.num_discrete_values = src.meta.num_discrete_values;
     dest->meta.Missing = src.meta.Missing;
     //Cosmin added if statement (09/01/2020)
@@ -2958,15 +3107,27 @@ void copy_example_data(int num_atts, CV_Example src, CV_Example *dest) {
         dest->distinct_attribute_values[i] = src.distinct_attribute_values[i];
 }
 
+// Same as copy_example_data except dest points at src's attribute values instead of a copy
+void share_example_data(CV_Example src, CV_Example *dest) {
+    dest->global_id_num = src.global_id_num;
+    dest->random_gid = src.random_gid;
+    dest->fclib_seq_num = src.fclib_seq_num;
+    dest->fclib_id_num = src.fclib_id_num;
+    dest->containing_class_num = src.containing_class_num;
+    dest->containing_fold_num = src.containing_fold_num;
+    dest->distinct_attribute_values = src.distinct_attribute_values;
+}
+
+// The stopping algorithm's accuracy history, per partition
+static float **raw_accuracies;
+static float **avg_accuracies;
+static float **max_smoothed_acc;
+static float **running_avg_acc;
+static float **running_max_acc;
+static int *num_malloced;
+static float *cumulative_avg_acc;
+
 int check_stopping_algorithm(int init, int part_num, float raw_accuracy, int trees, float *max_raw, char *oob_filename, Args_Opts args) {
-    static float **raw_accuracies;
-    static float **avg_accuracies;
-    static float **max_smoothed_acc;
-    static float **running_avg_acc;
-    static float **running_max_acc;
-    static int *num_malloced;
-    static float *cumulative_avg_acc;
-    
     int i, j;
     
     // Init
@@ -3144,3 +3305,107 @@ void check_ensemble_validity(const char *label, DT_Ensemble *ensemble) {
   printf("%s: check_ensemble_validity = %d/%d trees\n",label,num_valid_trees,ensemble->num_trees);
   if(num_valid_trees != ensemble->num_trees) exit(1);
 }
+
+/*
+ * Save the stopping algorithm's history for one partition so that a checkpointed run can pick up
+ * where it left off. Only valid after the first tree has been checked.
+ */
+void write_stopping_history(FILE *fh, int part_num, Args_Opts args) {
+    fwrite(&num_malloced[part_num], sizeof(int), 1, fh);
+    fwrite(raw_accuracies[part_num], sizeof(float), num_malloced[part_num], fh);
+    fwrite(avg_accuracies[part_num], sizeof(float), num_malloced[part_num], fh);
+    fwrite(running_max_acc[part_num], sizeof(float), num_malloced[part_num], fh);
+    fwrite(max_smoothed_acc[part_num], sizeof(float), num_malloced[part_num]/args.build_size, fh);
+    fwrite(running_avg_acc[part_num], sizeof(float), args.build_size, fh);
+    fwrite(&cumulative_avg_acc[part_num], sizeof(float), 1, fh);
+}
+
+/*
+ * Put back the history saved by write_stopping_history in place of the first check's allocation.
+ * Returns FALSE if the file ends early.
+ */
+Boolean read_stopping_history(FILE *fh, int part_num, Args_Opts args) {
+    int n;
+    if (fread(&n, sizeof(int), 1, fh) != 1 || n < args.build_size)
+        return FALSE;
+    num_malloced[part_num] = n;
+    raw_accuracies[part_num] = (float *)malloc(n * sizeof(float));
+    avg_accuracies[part_num] = (float *)malloc(n * sizeof(float));
+    running_max_acc[part_num] = (float *)malloc(n * sizeof(float));
+    max_smoothed_acc[part_num] = (float *)malloc((n/args.build_size) * sizeof(float));
+    running_avg_acc[part_num] = (float *)malloc(args.build_size * sizeof(float));
+    if (fread(raw_accuracies[part_num], sizeof(float), n, fh) != (size_t)n ||
+        fread(avg_accuracies[part_num], sizeof(float), n, fh) != (size_t)n ||
+        fread(running_max_acc[part_num], sizeof(float), n, fh) != (size_t)n ||
+        fread(max_smoothed_acc[part_num], sizeof(float), n/args.build_size, fh) != (size_t)(n/args.build_size) ||
+        fread(running_avg_acc[part_num], sizeof(float), args.build_size, fh) != (size_t)args.build_size ||
+        fread(&cumulative_avg_acc[part_num], sizeof(float), 1, fh) != 1)
+        return FALSE;
+    return TRUE;
+}
+
+/*
+ * Starts a new ensemble with the trees of the existing one and brings the OOB votes and boosting
+ * weights up to date with them. make_bag is the only user of its RNG, so replaying it with the
+ * original seed gives each tree the bag it was built from, and the OOB vote counts are exact.
+ * Tied OOB votes are broken with lrand48, which the original run also drew from while building the
+ * trees with --random-forests (or any other random split choice). The replay can't repeat those
+ * draws, so with such options the tie-breaks, and the --verbose-oob history written for the
+ * existing trees, can differ from the original run's.
+ * The other RNGs are reseeded so the new trees don't repeat the choices made for the first ones.
+ * Returns the number of trees in the existing ensemble.
+ */
+static int _continue_ensemble(Tree_Stream *stream, Vote_Cache *cache, CV_Subset *data, int fold_num, Args_Opts args) {
+    int i, j;
+    int num_trees;
+    DT_Ensemble old;
+    Args_Opts read_args = args;
+    CV_Subset *data_bag;
+    float best_oob_acc;
+    char *mod_oob_file = NULL;
+    
+    reset_DT_Ensemble(&old);
+    // read_ensemble replaces the caller's list of skipped features
+    read_args.skipped_features = NULL;
+    read_ensemble(&old, fold_num, 0, &read_args);
+    free(read_args.skipped_features);
+    if (old.num_classes != data->meta.num_classes || old.num_attributes != data->meta.num_attributes ||
+        old.num_training_examples != data->meta.num_examples) {
+        fprintf(stderr, "The ensemble to add trees to was not trained on this data\nExiting ...\n");
+        exit(8);
+    }
+    if ((old.boosting_betas != NULL) != (args.do_boosting == TRUE)) {
+        fprintf(stderr, "--boosting must match the ensemble to add trees to\nExiting ...\n");
+        exit(8);
+    }
+    
+    if (args.output_verbose_oob)
+        mod_oob_file = build_output_filename(fold_num, args.oob_file, args);
+    data_bag = (CV_Subset *)calloc(1, sizeof(CV_Subset));
+    for (i = 0; i < old.num_trees; i++) {
+        if (args.do_bagging == TRUE) {
+            make_bag(data, data_bag, args, 0);
+            cache->current_classifier_count = i + 1;
+            cache->oob_error = compute_oob_error_rate(old.Trees[i], *data, cache, args);
+            check_stopping_algorithm(0, 0, 1.0 - cache->oob_error, i + 1, &best_oob_acc, mod_oob_file, args);
+            if (args.out_of_core == FALSE)
+                for (j = 0; j < data_bag->meta.num_examples; j++)
+                    free(data_bag->examples[j].distinct_attribute_values);
+            free_CV_Subset_inter(data_bag, args, TRAIN_MODE);
+        }
+        if (args.do_boosting == TRUE) {
+            update_weights(&data->weights, old.Trees[i], *data);
+            reset_weights(data->meta.num_examples, data->weights);
+        }
+        stream_tree(stream, old.Trees[i], old.boosting_betas != NULL ? old.boosting_betas[i] : 0.0, args,
+                    data->meta.num_classes);
+    }
+    free(data_bag);
+    free(mod_oob_file);
+    
+    num_trees = old.num_trees;
+    free_DT_Ensemble(old, TEST_MODE);
+    srand48(args.random_seed + num_trees);
+    srandom(args.random_seed + num_trees);
+    return num_trees;
+}
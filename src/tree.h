@@ -38,6 +38,18 @@ Philip Kegelmeyer, wpk@sandia.gov
 
 #include "crossval.h"
 
+typedef struct tree_stream_struct {
+    FILE *fh;
+    char *filename;
+    char *tmp_filename;
+    char *body_filename;    // Holds the trees until the header can be written, if the number of trees isn't known
+    int num_trees;
+    int num_malloced;
+    long *tree_ends;        // Offset in fh just past each tree
+    CV_Metadata meta;       // For the header written by end_tree_stream
+    Args_Opts args;
+} Tree_Stream;
+
 //Added by DACIESL June-03-08: Laplacean Estimates
 //Function prototypes for Laplacean Estimates support
 int * find_class_count(CV_Subset *data);
@@ -58,10 +70,17 @@ int is_pure(CV_Subset *data);
 int find_best_class(CV_Subset *data);
 int errors_guessing_best_class(CV_Subset *data);
 //void write_tree_file_header_E(DT_Ensemble ensemble, int fold_num, Args_Opts args);
+int is_skipped_column(int i, Args_Opts *args);
 char* write_tree_file_header(int num_trees, CV_Metadata meta, int fold_num, char *tree_filename, Args_Opts args);
 void save_ensemble(DT_Ensemble ensemble, CV_Metadata data, int fold_num, Args_Opts args, int num_classes);
 char* build_output_filename(int fold_num, char *filename, Args_Opts args);
+void write_ensemble_file(char *filename, DT_Ensemble ensemble, Args_Opts args, Boolean binary);
 void save_tree(DT_Node *tree, int fold_num, int tree_num, Args_Opts args, int num_classes);
+void begin_tree_stream(Tree_Stream *stream, int num_trees, CV_Metadata meta, int fold_num, Args_Opts args);
+Boolean resume_tree_stream(Tree_Stream *stream, int num_trees, int num_streamed, long *tree_ends,
+                           CV_Metadata meta, int fold_num, Args_Opts args);
+void stream_tree(Tree_Stream *stream, DT_Node *tree, double beta, Args_Opts args, int num_classes);
+void end_tree_stream(Tree_Stream *stream, int num_trees);
 void _save_node(DT_Node *tree, int node, FILE *fh, int num_classes);
 void copy_dataset_meta(CV_Dataset src, CV_Subset *dest, int population);
 void copy_subset_meta(CV_Subset src, CV_Subset *dest, int population);
@@ -69,14 +88,18 @@ void point_subset_data(CV_Subset src, CV_Subset *dest);
 void copy_subset_data(CV_Subset src, CV_Subset *dest);
 void copy_example_metadata(CV_Example src, CV_Example *dest);
 void copy_example_data(int num_atts, CV_Example src, CV_Example *dest);
+void share_example_data(CV_Example src, CV_Example *dest);
 void read_ensemble_metadata(FILE *fh, DT_Ensemble *ensemble, int force_num_trees, Args_Opts *args);
+void resolve_missing_values(DT_Ensemble *ensemble, CV_Metadata meta, Args_Opts args);
 void read_ensemble(DT_Ensemble *ensemble, int fold_num, int force_num_trees, Args_Opts *args);
-void _read_tree(char *initial_str, DT_Node **tree, Tree_Bookkeeping *book, FILE *fh, int num_classes);
+int read_ensemble_num_trees(int fold_num, Args_Opts args);
 int check_stopping_algorithm(int init, int part_num, float raw_accuracy, int trees, float *max_raw, char *oob_filename, Args_Opts args);
+void write_stopping_history(FILE *fh, int part_num, Args_Opts args);
+Boolean read_stopping_history(FILE *fh, int part_num, Args_Opts args);
 double _fminf(double x, double y);
 
-void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Dataset dataset, int fold_num, Args_Opts args);
-void test_ivote(CV_Subset test_data, Vote_Cache cache, FC_Dataset dataset, int fold_num, Args_Opts args);
+void test(CV_Subset test_data, int num_ensembles, DT_Ensemble *ensemble, FC_Dataset dataset, int fold_num, Args_Opts args, CV_Overall_Confusion *overall);
+void test_ivote(CV_Subset test_data, Vote_Cache cache, FC_Dataset dataset, int fold_num, Args_Opts args, CV_Overall_Confusion *overall);
 
 int check_tree_validity(DT_Node* tree, int node, int num_classes, int num_nodes);
 void check_ensemble_validity(const char * label,DT_Ensemble *ensemble);
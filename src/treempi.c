@@ -356,8 +356,9 @@ void train_mpi(CV_Partition partitions, DT_Ensemble **ensemble, int myrank, Args
             build_tree(data_rs, &(*ensemble)[0].Trees[0], &(*ensemble)[0].Books[0], args);
             
             if (args.do_bagging == TRUE) {
-                for (j = 0; j < (int)(args.bag_size * (float)data_bag->meta.num_examples / 100.0); j++)
-                    free(data_bag->examples[j].distinct_attribute_values);
+                if (args.out_of_core == FALSE)
+                    for (j = 0; j < (int)(args.bag_size * (float)data_bag->meta.num_examples / 100.0); j++)
+                        free(data_bag->examples[j].distinct_attribute_values);
                 free_CV_Subset_inter(data_bag, args, TRAIN_MODE);
             }
             if (args.random_subspaces > 0)
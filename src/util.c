@@ -162,6 +162,9 @@ int read_line(FILE *fh, char **str) {
     while (read_eol == FALSE) {
         // Read and check for EOF or error
         if (fgets(strbuf, max, fh) == NULL) {
+            // A last line without a line terminator is still a line
+            if (feof(fh) != 0 && first_read == FALSE)
+                break;
             if (feof(fh) != 0)
                 return 0;
             if (ferror(fh) != 0)
@@ -194,3 +197,131 @@ int read_line(FILE *fh, char **str) {
     return ret_val;
 }
 
+/*
+    Same as read_line but reads into *str, which is reused from one call to the next and only
+    grown when a line does not fit. *size holds the number of bytes malloc'd for *str.
+    Start with *str = NULL and *size = 0 and free(*str) after the last read.
+ */
+int read_line_reuse(FILE *fh, char **str, int *size) {
+    int len = 0;
+    
+    if (*size < 8192) {
+        *size = 8192;
+        *str = (char *)realloc(*str, *size * sizeof(char));
+    }
+    
+    while (1) {
+        // Read and check for EOF or error
+        if (fgets(*str + len, *size - len, fh) == NULL) {
+            // A last line without a line terminator is still a line
+            if (feof(fh) != 0 && len > 0)
+                break;
+            if (feof(fh) != 0)
+                return 0;
+            if (ferror(fh) != 0)
+                return -1;
+        }
+        len += strlen(*str + len);
+        if (len > 0 && (*str)[len-1] == '\n')
+            break;
+        // The line did not fit so make room for more
+        if (len == *size - 1) {
+            *size *= 2;
+            *str = (char *)realloc(*str, *size * sizeof(char));
+        }
+    }
+    
+    // Return the length of the line with line terminators but remove the line terminators
+    int ret_val = len;
+    if (len > 0 && ((*str)[len-1] == 10 || (*str)[len-1] == 13))
+        (*str)[--len] = '\0';
+    if (len > 0 && ((*str)[len-1] == 10 || (*str)[len-1] == 13))
+        (*str)[--len] = '\0';
+    
+    return ret_val;
+}
+
+/*
+    Same value as atof(str) for a token that holds nothing but the number.
+    Plain decimals with at most 19 significant digits and a small enough power of ten are
+    converted with one exactly rounded multiply or divide (Clinger's fast path), so the result
+    is the correctly rounded double. Everything else (long mantissas, large exponents, hex,
+    inf, nan, trailing characters) is handed to strtod.
+ */
+double fast_atof(const char *str) {
+    static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char *p = str;
+    unsigned long long mantissa = 0;
+    int num_digits = 0;
+    int exponent = 0;
+    Boolean negative = FALSE;
+    Boolean any_digits = FALSE;
+    double value;
+    
+    if (*p == '-' || *p == '+')
+        negative = (*p++ == '-');
+    
+    // Leading zeros are not significant
+    while (*p == '0') {
+        p++;
+        any_digits = TRUE;
+    }
+    while (*p >= '0' && *p <= '9') {
+        if (num_digits++ < 19)
+            mantissa = mantissa * 10 + (*p - '0');
+        else
+            exponent++;
+        p++;
+        any_digits = TRUE;
+    }
+    if (*p == '.') {
+        p++;
+        if (num_digits == 0) {
+            while (*p == '0') {
+                p++;
+                exponent--;
+                any_digits = TRUE;
+            }
+        }
+        while (*p >= '0' && *p <= '9') {
+            if (num_digits++ < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+            p++;
+            any_digits = TRUE;
+        }
+    }
+    if (any_digits && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        Boolean negative_exponent = FALSE;
+        int exp_value = 0;
+        if (*e == '-' || *e == '+')
+            negative_exponent = (*e++ == '-');
+        if (*e >= '0' && *e <= '9') {
+            while (*e >= '0' && *e <= '9') {
+                if (exp_value < 10000)
+                    exp_value = exp_value * 10 + (*e - '0');
+                e++;
+            }
+            exponent += negative_exponent ? -exp_value : exp_value;
+            p = e;
+        }
+    }
+    
+    // Anything unusual or anything the fast path can't round exactly goes to strtod
+    if (! any_digits || *p != '\0' || num_digits > 19 || mantissa > (1ULL << 53))
+        return strtod(str, NULL);
+    if (mantissa == 0)
+        return negative ? -0.0 : 0.0;
+    if (exponent < -22 || exponent > 22)
+        return strtod(str, NULL);
+    
+    value = (double)mantissa;
+    if (exponent < 0)
+        value /= powers_of_ten[-exponent];
+    else
+        value *= powers_of_ten[exponent];
+    return negative ? -value : value;
+}
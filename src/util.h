@@ -65,11 +65,25 @@ int num_digits(int n);
 /*
     Reads the next line from the file open as fh
     The read is done in a DOS-friendly way
-    The \n and/or \r characters are removed
+    The \n and/or \r characters are removed. A last line with no \n is still returned
     read_line returns the number of characters in the line, 0 if EOF, or -1 if error
 
     NB: caller is responsible for calling free(*str).
  */ 
 int read_line(FILE *fh, char **str);
 
+/*
+    Same as read_line but reuses the buffer in *str, which has *size bytes, from one line to the next.
+    Start with *str = NULL and *size = 0.
+
+    NB: caller is responsible for calling free(*str) after the last read.
+ */
+int read_line_reuse(FILE *fh, char **str, int *size);
+
+/*
+    Same value as atof() for a string holding just a number, but without strtod's overhead
+    for ordinary decimal values.
+ */
+double fast_atof(const char *str);
+
 #endif // __UTIL__
@@ -9,6 +9,14 @@ tribits_add_executable(remoteness SOURCES remoteness.c proximity_utils.c INSTALL
 
 tribits_add_executable(tree_stats SOURCES tree_stats.c INSTALLABLE)
 
+tribits_add_executable(tree2c SOURCES tree2c.c INSTALLABLE)
+
+tribits_add_executable(avatard SOURCES avatard.c avatard_utils.c INSTALLABLE)
+
+tribits_add_executable(convert_trees SOURCES convert_trees.c INSTALLABLE)
+
+tribits_add_executable(prune_trees SOURCES prune_trees.c diversity_measures.c INSTALLABLE)
+
 install(PROGRAMS data_inspector extract-class-stats tree2dot DESTINATION bin)
 
 
@@ -0,0 +1,665 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/un.h>
+#ifndef _GNU_SOURCE
+  #include "getopt.h"
+#else
+  #include <getopt.h>
+#endif
+#include "../src/version_info.h"
+#include "../src/crossval.h"
+#include "../src/avatar_api.h"
+#include "avatard_utils.h"
+
+#define MAX_CONNECTIONS 64
+
+struct Global_Args_t {
+  char* socket_path;
+  int batch_size;
+  Boolean verbose;
+  int num_models;
+  char** filestems;
+} MyArgs;
+
+// A client sending requests on in_fd and reading responses from out_fd.
+// Rows are collected until the request ends or batch_size rows are waiting
+typedef struct {
+  int in_fd;
+  int out_fd;
+  char* in_buf;
+  size_t in_len;
+  size_t in_size;
+  char* out_buf;
+  size_t out_len;
+  size_t out_size;
+  float* rows;
+  int sized_for;       // model the batch buffers are sized for
+  int* predictions;
+  float* probabilities;
+  int num_rows;        // rows waiting to be scored
+  int request_rows;    // rows in the current request
+  char* error;         // first problem seen in the current request
+  int model;
+  struct timespec start;
+} Connection;
+
+static Served_Model* Models = NULL;
+static volatile sig_atomic_t Reload_Requested = 0;
+static volatile sig_atomic_t Quit_Requested = 0;
+
+// Prototypes for helper functions.
+void _display_usage(void);
+void _process_opts(int argc, char** argv);
+void _handle_signal(int sig);
+Connection* _open_connection(int in_fd, int out_fd);
+void _close_connection(Connection* conn);
+int _read_connection(Connection* conn);
+int _handle_line(Connection* conn, char* line);
+int _handle_command(Connection* conn, char* line);
+void _parse_row(Connection* conn, char* line);
+void _score_rows(Connection* conn);
+void _finish_request(Connection* conn);
+void _reply(Connection* conn, const char* format, ...);
+int _send(Connection* conn);
+int _listen_on(const char* path);
+double _elapsed_usec(struct timespec* start);
+
+void
+display_usage()
+{
+  _display_usage();
+}
+
+int
+main(int argc, char** argv)
+{
+  Connection* conns[MAX_CONNECTIONS];
+  int num_conns = 0;
+  int listen_fd = -1;
+  struct sigaction sa;
+  fd_set readable;
+  char* error;
+  int max_fd, fd;
+  int i, j;
+
+  _process_opts(argc, argv);
+
+  Models = (Served_Model *)calloc(MyArgs.num_models, sizeof(Served_Model));
+  for (i = 0; i < MyArgs.num_models; i++) {
+    Models[i].filestem = MyArgs.filestems[i];
+    Models[i].trees_file = (char *)malloc(strlen(MyArgs.filestems[i]) + 7);
+    sprintf(Models[i].trees_file, "%s.trees", MyArgs.filestems[i]);
+    if (! reload_model(&Models[i], NULL, &error)) {
+      fprintf(stderr, "%s\n", error);
+      exit(-1);
+    }
+    fprintf(stderr, "avatard: model %d is %s (%d attributes, %d classes)\n",
+                    i, Models[i].filestem, Models[i].num_attributes, Models[i].num_classes);
+  }
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = _handle_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGHUP, &sa, NULL);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (MyArgs.socket_path != NULL) {
+    listen_fd = _listen_on(MyArgs.socket_path);
+    fprintf(stderr, "avatard: listening on %s\n", MyArgs.socket_path);
+  } else {
+    conns[num_conns++] = _open_connection(STDIN_FILENO, STDOUT_FILENO);
+  }
+
+  while (! Quit_Requested && (listen_fd >= 0 || num_conns > 0)) {
+    if (Reload_Requested) {
+      Reload_Requested = 0;
+      for (i = 0; i < MyArgs.num_models; i++) {
+        if (reload_model(&Models[i], NULL, &error))
+          fprintf(stderr, "avatard: reloaded %s\n", Models[i].trees_file);
+        else
+          fprintf(stderr, "%s\n", error);
+      }
+    }
+
+    FD_ZERO(&readable);
+    max_fd = -1;
+    if (listen_fd >= 0 && num_conns < MAX_CONNECTIONS) {
+      FD_SET(listen_fd, &readable);
+      max_fd = listen_fd;
+    }
+    for (i = 0; i < num_conns; i++) {
+      FD_SET(conns[i]->in_fd, &readable);
+      if (conns[i]->in_fd > max_fd)
+        max_fd = conns[i]->in_fd;
+    }
+    if (select(max_fd + 1, &readable, NULL, NULL, NULL) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("avatard: select");
+      break;
+    }
+
+    if (listen_fd >= 0 && FD_ISSET(listen_fd, &readable)) {
+      if ((fd = accept(listen_fd, NULL, NULL)) >= 0)
+        conns[num_conns++] = _open_connection(fd, fd);
+    }
+    for (i = 0; i < num_conns; i++) {
+      if (FD_ISSET(conns[i]->in_fd, &readable) && ! _read_connection(conns[i])) {
+        _close_connection(conns[i]);
+        for (j = i; j < num_conns - 1; j++)
+          conns[j] = conns[j+1];
+        num_conns--;
+        i--;
+      }
+    }
+  }
+
+  // clean up
+  for (i = 0; i < num_conns; i++)
+    _close_connection(conns[i]);
+  if (listen_fd >= 0) {
+    close(listen_fd);
+    unlink(MyArgs.socket_path);
+  }
+  for (i = 0; i < MyArgs.num_models; i++) {
+    if (Models[i].requests > 0)
+      fprintf(stderr, "avatard: %s served %lu requests (%lu rows), mean latency %.1f us, max %.1f us\n",
+                      Models[i].filestem, Models[i].requests, Models[i].rows,
+                      Models[i].total_usec / Models[i].requests, Models[i].max_usec);
+    avatar_cleanup(Models[i].handle);
+    free(Models[i].trees_file);
+    free(Models[i].num_values);
+  }
+  free(Models);
+
+  return 0;
+}
+
+void
+_handle_signal(int sig)
+{
+  if (sig == SIGHUP)
+    Reload_Requested = 1;
+  else
+    Quit_Requested = 1;
+}
+
+Connection*
+_open_connection(int in_fd, int out_fd)
+{
+  Connection* conn = (Connection *)calloc(1, sizeof(Connection));
+  conn->in_fd = in_fd;
+  conn->out_fd = out_fd;
+  conn->in_size = 4096;
+  conn->in_buf = (char *)malloc(conn->in_size);
+  conn->out_size = 4096;
+  conn->out_buf = (char *)malloc(conn->out_size);
+  conn->sized_for = -1;
+  return conn;
+}
+
+void
+_close_connection(Connection* conn)
+{
+  if (conn->in_fd != STDIN_FILENO)
+    close(conn->in_fd);
+  free(conn->in_buf);
+  free(conn->out_buf);
+  free(conn->rows);
+  free(conn->predictions);
+  free(conn->probabilities);
+  free(conn->error);
+  free(conn);
+}
+
+// Reads what is available and handles every complete line.  Returns FALSE once the
+// connection should be closed
+int
+_read_connection(Connection* conn)
+{
+  char* line;
+  char* eol;
+  ssize_t n;
+  size_t used;
+
+  if (conn->in_len + 1 >= conn->in_size) {
+    conn->in_size *= 2;
+    conn->in_buf = (char *)realloc(conn->in_buf, conn->in_size);
+  }
+  n = read(conn->in_fd, conn->in_buf + conn->in_len, conn->in_size - conn->in_len - 1);
+  if (n < 0 && errno == EINTR)
+    return TRUE;
+  if (n <= 0) {
+    // A final request does not need its terminating blank line
+    conn->in_buf[conn->in_len] = '\0';
+    if (conn->in_len > 0)
+      _handle_line(conn, conn->in_buf);
+    if (conn->request_rows > 0 || conn->error != NULL)
+      _finish_request(conn);
+    return FALSE;
+  }
+  conn->in_len += n;
+  conn->in_buf[conn->in_len] = '\0';
+
+  line = conn->in_buf;
+  while ((eol = strchr(line, '\n')) != NULL) {
+    *eol = '\0';
+    if (! _handle_line(conn, line))
+      return FALSE;
+    line = eol + 1;
+  }
+  used = line - conn->in_buf;
+  memmove(conn->in_buf, line, conn->in_len - used);
+  conn->in_len -= used;
+  return TRUE;
+}
+
+// A request is one or more rows ended by a blank line.  Lines starting with a
+// letter between requests are commands
+int
+_handle_line(Connection* conn, char* line)
+{
+  size_t len = strlen(line);
+
+  if (len > 0 && line[len-1] == '\r')
+    line[--len] = '\0';
+  if (len == 0) {
+    if (conn->request_rows > 0 || conn->error != NULL)
+      _finish_request(conn);
+    return TRUE;
+  }
+  if (conn->request_rows == 0 && conn->error == NULL && line[0] >= 'A' && line[0] <= 'Z')
+    return _handle_command(conn, line);
+
+  if (conn->request_rows == 0 && conn->error == NULL)
+    clock_gettime(CLOCK_MONOTONIC, &conn->start);
+  _parse_row(conn, line);
+  return TRUE;
+}
+
+int
+_handle_command(Connection* conn, char* line)
+{
+  Served_Model* model = &Models[conn->model];
+  char* command = strtok(line, " \t");
+  char* arg = strtok(NULL, " \t");
+  char* error;
+  char* end;
+  int i;
+
+  if (! strcmp(command, "QUIT")) {
+    _reply(conn, "OK bye\n");
+    _send(conn);
+    return FALSE;
+  } else if (! strcmp(command, "MODELS")) {
+    for (i = 0; i < MyArgs.num_models; i++)
+      _reply(conn, "%s%d %s %s %d %d\n", i == conn->model ? "*" : "", i, Models[i].filestem,
+                   Models[i].trees_file, Models[i].num_attributes, Models[i].num_classes);
+    _reply(conn, "OK %d\n", MyArgs.num_models);
+  } else if (! strcmp(command, "USE")) {
+    if (arg == NULL) {
+      _reply(conn, "ERR USE needs a model number or filestem\n");
+    } else {
+      i = (int)strtol(arg, &end, 10);
+      if (*end != '\0')
+        for (i = 0; i < MyArgs.num_models && strcmp(arg, Models[i].filestem); i++);
+      if (i < 0 || i >= MyArgs.num_models) {
+        _reply(conn, "ERR No model '%s'\n", arg);
+      } else {
+        conn->model = i;
+        _reply(conn, "OK %d %s\n", i, Models[i].filestem);
+      }
+    }
+  } else if (! strcmp(command, "RELOAD")) {
+    if (reload_model(model, arg, &error)) {
+      fprintf(stderr, "avatard: reloaded %s\n", model->trees_file);
+      _reply(conn, "OK %s\n", model->trees_file);
+    } else {
+      _reply(conn, "ERR %s\n", error);
+    }
+  } else if (! strcmp(command, "STATS")) {
+    _reply(conn, "OK %lu %lu %.1f %.1f\n", model->requests, model->rows,
+                 model->requests > 0 ? model->total_usec / model->requests : 0.0, model->max_usec);
+  } else {
+    _reply(conn, "ERR Unknown command '%s'\n", command);
+  }
+  return _send(conn);
+}
+
+// Adds one comma separated row to the pending batch.  '?' or an empty field is a
+// missing value
+void
+_parse_row(Connection* conn, char* line)
+{
+  Served_Model* model = &Models[conn->model];
+  float* row;
+  char* field;
+  char* end;
+  int col = 0;
+  int size;
+
+  if (conn->error != NULL)
+    return;
+  if (conn->sized_for != conn->model) {
+    // First request or USE picked a different model
+    conn->rows = (float *)realloc(conn->rows, MyArgs.batch_size * sizeof(float) * model->num_attributes);
+    conn->predictions = (int *)realloc(conn->predictions, MyArgs.batch_size * sizeof(int));
+    conn->probabilities = (float *)realloc(conn->probabilities, MyArgs.batch_size * sizeof(float) * model->num_classes);
+    conn->sized_for = conn->model;
+  }
+  row = conn->rows + (size_t)conn->num_rows * model->num_attributes;
+
+  for (field = line; field != NULL && col <= model->num_attributes; col++) {
+    end = strchr(field, ',');
+    if (end != NULL)
+      *end++ = '\0';
+    if (col < model->num_attributes) {
+      while (*field == ' ' || *field == '\t')
+        field++;
+      if (*field == '\0' || *field == '?') {
+        row[col] = NAN;
+      } else {
+        char* stop;
+        row[col] = strtof(field, &stop);
+        while (*stop == ' ' || *stop == '\t')
+          stop++;
+        // A discrete value is the index of one of the attribute's values
+        if (*stop != '\0' || (model->num_values[col] > 0 &&
+                              (row[col] < 0 || row[col] >= model->num_values[col] || row[col] != floorf(row[col])))) {
+          size = snprintf(NULL, 0, "Row %d: bad value '%s' in column %d", conn->request_rows + 1, field, col + 1);
+          conn->error = (char *)malloc(size + 1);
+          sprintf(conn->error, "Row %d: bad value '%s' in column %d", conn->request_rows + 1, field, col + 1);
+          return;
+        }
+      }
+    }
+    field = end;
+  }
+  if (col != model->num_attributes) {
+    size = snprintf(NULL, 0, "Row %d: expected %d values", conn->request_rows + 1, model->num_attributes);
+    conn->error = (char *)malloc(size + 1);
+    sprintf(conn->error, "Row %d: expected %d values", conn->request_rows + 1, model->num_attributes);
+    return;
+  }
+
+  conn->num_rows++;
+  conn->request_rows++;
+  if (conn->num_rows == MyArgs.batch_size)
+    _score_rows(conn);
+}
+
+// Scores the pending rows in one call and queues one line per row holding the
+// predicted class name and the class probabilities
+void
+_score_rows(Connection* conn)
+{
+  Served_Model* model = &Models[conn->model];
+  int i, j;
+
+  if (conn->num_rows == 0)
+    return;
+  avatar_predict_rows(model->handle, conn->rows, conn->num_rows, model->num_attributes,
+                      conn->predictions, conn->probabilities);
+  for (i = 0; i < conn->num_rows; i++) {
+    _reply(conn, "%s", avatar_class_name(model->handle, conn->predictions[i]));
+    for (j = 0; j < model->num_classes; j++)
+      _reply(conn, ",%g", conn->probabilities[i * model->num_classes + j]);
+    _reply(conn, "\n");
+  }
+  conn->num_rows = 0;
+}
+
+// Scores anything left in the request and sends the response, which ends with
+// "OK <rows> <latency in microseconds>" or "ERR <message>"
+void
+_finish_request(Connection* conn)
+{
+  Served_Model* model = &Models[conn->model];
+  double usec;
+
+  if (conn->error != NULL) {
+    conn->out_len = 0;
+    _reply(conn, "ERR %s\n", conn->error);
+    free(conn->error);
+    conn->error = NULL;
+  } else {
+    _score_rows(conn);
+    usec = _elapsed_usec(&conn->start);
+    _reply(conn, "OK %d %.1f\n", conn->request_rows, usec);
+    model->requests++;
+    model->rows += conn->request_rows;
+    model->total_usec += usec;
+    if (usec > model->max_usec)
+      model->max_usec = usec;
+    if (MyArgs.verbose)
+      fprintf(stderr, "avatard: %s: %d rows in %.1f us\n", model->filestem, conn->request_rows, usec);
+  }
+  conn->num_rows = 0;
+  conn->request_rows = 0;
+  _send(conn);
+}
+
+void
+_reply(Connection* conn, const char* format, ...)
+{
+  va_list ap;
+  int n;
+
+  va_start(ap, format);
+  n = vsnprintf(conn->out_buf + conn->out_len, conn->out_size - conn->out_len, format, ap);
+  va_end(ap);
+  if (conn->out_len + n >= conn->out_size) {
+    while (conn->out_len + n >= conn->out_size)
+      conn->out_size *= 2;
+    conn->out_buf = (char *)realloc(conn->out_buf, conn->out_size);
+    va_start(ap, format);
+    vsnprintf(conn->out_buf + conn->out_len, conn->out_size - conn->out_len, format, ap);
+    va_end(ap);
+  }
+  conn->out_len += n;
+}
+
+// Writes the queued response.  Returns FALSE if the client has gone away
+int
+_send(Connection* conn)
+{
+  size_t sent = 0;
+  ssize_t n;
+
+  while (sent < conn->out_len) {
+    n = write(conn->out_fd, conn->out_buf + sent, conn->out_len - sent);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      conn->out_len = 0;
+      return FALSE;
+    }
+    sent += n;
+  }
+  conn->out_len = 0;
+  return TRUE;
+}
+
+int
+_listen_on(const char* path)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path '%s' is too long\n", path);
+    exit(-1);
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+      bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(fd, MAX_CONNECTIONS) < 0) {
+    fprintf(stderr, "Failed to listen on socket '%s': %s\n", path, strerror(errno));
+    exit(-1);
+  }
+  return fd;
+}
+
+double
+_elapsed_usec(struct timespec* start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+void
+_display_usage()
+{
+  printf("usage: %s [options] filestem [filestem ...]\n\n", "avatard");
+  printf("Loads the ensembles in filestem.trees (using filestem.names) once and then\n"
+	 "serves predictions on STDIN/STDOUT or on a Unix domain socket.  Each line of\n"
+	 "a request is one row of comma separated attribute values in names-file order\n"
+	 "with the class column removed.  Discrete attributes are given as the 0-based\n"
+	 "index of their value in the names file, and anything else is an error.  '?'\n"
+	 "marks a missing value.  A blank line (or the end of input) ends the\n"
+	 "request.  The rows are scored in batches and the response has one line per\n"
+	 "row:\n"
+	 "\n"
+	 "    class_name,P(class 0),P(class 1),...\n"
+	 "\n"
+	 "followed by 'OK rows latency' where latency is the time in microseconds\n"
+	 "from reading the first row to writing the response, or by 'ERR message' if\n"
+	 "the request could not be scored.  Predictions match avatar_predict_rows.\n"
+	 "\n"
+	 "Between requests a line may hold one of these commands:\n"
+	 "\n"
+	 "  USE m                   : Score later requests with model m, given as\n"
+	 "                            its number or filestem (default 0).\n"
+	 "  MODELS                  : List the models being served.\n"
+	 "  RELOAD [f]              : Reload the current model from its trees file or\n"
+	 "                            from f.  Every connection waits while the file is\n"
+	 "                            loaded.  The old ensemble is kept on failure,\n"
+	 "                            including a trees file that can't be read or\n"
+	 "                            has fewer trees than its NumTrees.\n"
+	 "  STATS                   : Print 'OK requests rows mean_latency max_latency'\n"
+	 "                            for the current model.\n"
+	 "  QUIT                    : Close the connection.\n"
+	 "\n"
+	 "A SIGHUP reloads every model from its trees file.\n"
+	 "\n"
+	 "OPTIONS\n\n"
+	 "  -s, --socket path       : Listen on the Unix domain socket path instead of\n"
+	 "                            reading STDIN.\n"
+	 "  -b, --batch-size n      : Score at most n rows at once (default 1024).\n"
+	 "  -v, --verbose           : Log the latency of every request to STDERR.\n"
+	 "  -h                      : show this help message\n"
+	 );
+}
+
+static const char* opt_string = "+hvs:b:";
+
+static const struct option long_opts[] = {
+  {"socket", required_argument, NULL, 's'},
+  {"batch-size", required_argument, NULL, 'b'},
+  {"verbose", no_argument, NULL, 'v'},
+  {"help", no_argument, NULL, 'h'},
+  {NULL, no_argument, NULL, 0}
+};
+
+void
+_process_opts(int argc, char** argv)
+{
+  int opt = 0;
+  int long_index = 0;
+  Boolean found_opt = 0;
+
+  // Initialize
+  MyArgs.socket_path = NULL;
+  MyArgs.batch_size = 1024;
+  MyArgs.verbose = FALSE;
+
+  // Grab options.
+  found_opt = -1 != (opt = getopt_long(argc, argv, opt_string, long_opts, &long_index));
+  while (found_opt) {
+    switch (opt) {
+      case 's':
+	MyArgs.socket_path = optarg;
+	break;
+      case 'b':
+	MyArgs.batch_size = atoi(optarg);
+	break;
+      case 'v':
+	MyArgs.verbose = TRUE;
+	break;
+      case 'h':
+	_display_usage();
+	exit(0);
+      default:
+	break;
+    }
+    found_opt = -1 != (opt = getopt_long(argc, argv, opt_string, long_opts, &long_index));
+  }
+
+  if (MyArgs.batch_size < 1) {
+    fprintf(stderr, "The batch size must be at least 1\n");
+    exit(-1);
+  }
+
+  // Grab required arguments.
+  argc -= optind;
+  if (argc < 1) {
+    fprintf(stderr, "Missing filestem argument.\n");
+    _display_usage();
+    exit(0);
+  }
+
+  argv += optind;
+  MyArgs.num_models = argc;
+  MyArgs.filestems = argv;
+}
@@ -0,0 +1,209 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../src/crossval.h"
+#include "../src/options.h"
+#include "../src/tree.h"
+#include "avatard_utils.h"
+
+// Loads trees_file in a child process, since the readers exit on a file they can't
+// parse, and writes what was loaded to copy_file in the binary format.  Returns the
+// child's exit status; a message explaining a failure goes to error_fd
+static int
+_load_in_child(const char* filestem, const char* trees_file, const char* copy_file, int error_fd)
+{
+  char message[1024];
+  Avatar_handle* handle;
+  Args_Opts args;
+  int num_trees;
+
+  memset(&args, 0, sizeof(Args_Opts));
+  init_default_opts(&args);
+  args.trees_file = (char *)trees_file;
+  num_trees = read_ensemble_num_trees(-1, args);
+
+  if ((handle = avatar_load((char *)filestem, NULL, 0, (char *)trees_file, 0)) == NULL)
+    return 1;
+  if (avatar_num_trees(handle) < num_trees) {
+    // The readers only warn about a file that was cut short
+    snprintf(message, sizeof(message), "Trees file '%s' has %d of its %d trees",
+             trees_file, avatar_num_trees(handle), num_trees);
+    if (write(error_fd, message, strlen(message)) < 0)
+      perror("avatard");
+    return 1;
+  }
+  avatar_save_trees(handle, (char *)copy_file, 1);
+  return 0;
+}
+
+// Loads an ensemble from trees_file using the names file for filestem.  trees_file
+// need not live next to the names file.  Returns NULL and sets error if the file
+// can't be read or holds fewer trees than its NumTrees.  trees_file is only read
+// once, by a child process, and the server maps the binary copy the child leaves
+// behind, so a file that is replaced or broken mid-reload can't take it down
+Avatar_handle*
+load_model_handle(const char* filestem, const char* trees_file, char** error)
+{
+  static char message[1024];
+  char copy_file[4096];
+  const char* tmpdir;
+  Avatar_handle* handle;
+  FILE* fh;
+  pid_t pid;
+  int status;
+  int pipe_fds[2];
+  int fd;
+  ssize_t len, got;
+
+  if ((fh = fopen(trees_file, "rb")) == NULL) {
+    snprintf(message, sizeof(message), "Failed to open trees file '%s'", trees_file);
+    *error = message;
+    return NULL;
+  }
+  fclose(fh);
+
+  if ((tmpdir = getenv("TMPDIR")) == NULL || *tmpdir == '\0')
+    tmpdir = "/tmp";
+  snprintf(copy_file, sizeof(copy_file), "%s/avatard.XXXXXX", tmpdir);
+  if ((fd = mkstemp(copy_file)) < 0) {
+    snprintf(message, sizeof(message), "Failed to create a copy of trees file '%s' in %s", trees_file, tmpdir);
+    *error = message;
+    return NULL;
+  }
+  close(fd);
+  if (pipe(pipe_fds) < 0) {
+    unlink(copy_file);
+    snprintf(message, sizeof(message), "Failed to read trees file '%s'", trees_file);
+    *error = message;
+    return NULL;
+  }
+
+  if ((pid = fork()) == 0) {
+    close(pipe_fds[0]);
+    _exit(_load_in_child(filestem, trees_file, copy_file, pipe_fds[1]));
+  }
+  close(pipe_fds[1]);
+  len = 0;
+  while (len < (ssize_t)sizeof(message) - 1) {
+    got = read(pipe_fds[0], message + len, sizeof(message) - 1 - len);
+    if (got > 0)
+      len += got;
+    else if (got == 0 || errno != EINTR)
+      break;
+  }
+  message[len] = '\0';
+  close(pipe_fds[0]);
+  while (pid > 0 && waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR)
+      pid = -1;
+  }
+  if (pid < 0 || ! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    unlink(copy_file);
+    if (len == 0)
+      snprintf(message, sizeof(message), "Failed to read trees file '%s'", trees_file);
+    *error = message;
+    return NULL;
+  }
+
+  // The mapping outlives the copy's name
+  handle = avatar_load((char *)filestem, NULL, 0, copy_file, 0);
+  unlink(copy_file);
+  return handle;
+}
+
+// Replaces model's handle with one loaded from trees_file (or the model's current
+// trees file if NULL).  The old handle is kept if the new ensemble can't be used
+int
+reload_model(Served_Model* model, const char* trees_file, char** error)
+{
+  static char message[1024];
+  Avatar_handle* handle;
+  char* names_file;
+  FILE* fh;
+  int i;
+
+  if (trees_file == NULL)
+    trees_file = model->trees_file;
+  names_file = (char *)malloc(strlen(model->filestem) + 7);
+  sprintf(names_file, "%s.names", model->filestem);
+  fh = fopen(names_file, "r");
+  free(names_file);
+  if (fh == NULL) {
+    snprintf(message, sizeof(message), "Failed to open names file for %s", model->filestem);
+    *error = message;
+    return FALSE;
+  }
+  fclose(fh);
+
+  if ((handle = load_model_handle(model->filestem, trees_file, error)) == NULL)
+    return FALSE;
+  if (avatar_num_attributes(handle) < 1) {
+    avatar_cleanup(handle);
+    snprintf(message, sizeof(message), "No trees found in %s", trees_file);
+    *error = message;
+    return FALSE;
+  }
+  // Other connections may have rows of the old width waiting to be scored
+  if (model->handle != NULL && (avatar_num_attributes(handle) != model->num_attributes ||
+                                avatar_num_classes(handle) != model->num_classes)) {
+    snprintf(message, sizeof(message), "Ensemble %s does not match %s (%d/%d classes, %d/%d attributes)",
+             trees_file, model->trees_file, avatar_num_classes(handle), model->num_classes,
+             avatar_num_attributes(handle), model->num_attributes);
+    avatar_cleanup(handle);
+    *error = message;
+    return FALSE;
+  }
+
+  if (model->handle != NULL)
+    avatar_cleanup(model->handle);
+  model->handle = handle;
+  model->num_attributes = avatar_num_attributes(handle);
+  model->num_classes = avatar_num_classes(handle);
+  model->num_values = (int *)realloc(model->num_values, model->num_attributes * sizeof(int));
+  for (i = 0; i < model->num_attributes; i++)
+    model->num_values[i] = avatar_num_attribute_values(handle, i);
+  if (trees_file != model->trees_file) {
+    free(model->trees_file);
+    model->trees_file = strdup(trees_file);
+  }
+  return TRUE;
+}
@@ -0,0 +1,161 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef _GNU_SOURCE
+  #include "getopt.h"
+#else
+  #include <getopt.h>
+#endif
+#include "../src/version_info.h"
+#include "../src/crossval.h"
+#include "../src/tree.h"
+#include "../src/options.h"
+#include "../src/memory.h"
+#include "../src/reset.h"
+
+struct Global_Args_t {
+  char* infile;
+  char* outfile;
+  Boolean to_binary;
+} MyArgs;
+
+// Prototypes for helper functions.
+void _display_usage(void);
+void _process_opts(int argc, char** argv);
+
+void
+display_usage()
+{
+  _display_usage();
+}
+
+int
+main(int argc, char** argv)
+{
+  DT_Ensemble model;
+  Args_Opts ens_opts;
+
+  reset_DT_Ensemble(&model);
+
+  // parse arguments and options
+  _process_opts(argc, argv);
+  ens_opts = process_opts(0, NULL);  // all this line does is default init.
+  ens_opts.trees_file = MyArgs.infile;
+
+  // load model into memory; either format is recognized
+  read_ensemble(&model, -1, 0, &ens_opts);
+
+  // written under a temporary name so that infile and outfile may be the same
+  write_ensemble_file(MyArgs.outfile, model, ens_opts, MyArgs.to_binary);
+
+  // clean up
+  free_DT_Ensemble(model, TEST_MODE);
+
+  return 0;
+}
+
+void
+_display_usage()
+{
+  printf("usage: %s [options] infile outfile\n\n", "convert_trees");
+  printf("Converts an ensemble file between the text format and the binary format\n"
+	 "written by --binary-trees.  The format of infile is detected automatically.\n"
+	 "A binary ensemble is mapped into memory instead of being parsed when it is\n"
+	 "read, so large ensembles load almost instantly and every process that reads\n"
+	 "the same file shares one copy of the trees.  Binary files are only readable\n"
+	 "on machines with the byte order of the machine that wrote them.\n"
+	 "\n"
+	 "OPTIONS\n\n"
+	 "  -b, --binary   : write outfile in the binary format (the default)\n"
+	 "  -t, --text     : write outfile in the text format\n"
+	 "  -h             : show this help message\n"
+	 );
+}
+
+static const char* opt_string = "+bth";
+
+static const struct option long_opts[] = {
+  {"binary", no_argument, NULL, 'b'},
+  {"text", no_argument, NULL, 't'},
+  {"help", no_argument, NULL, 'h'},
+  {NULL, no_argument, NULL, 0}
+};
+
+void
+_process_opts(int argc, char** argv)
+{
+  int opt = 0;
+  int long_index = 0;
+  Boolean found_opt = 0;
+
+  // Initialize
+  MyArgs.infile = NULL;
+  MyArgs.outfile = NULL;
+  MyArgs.to_binary = TRUE;
+
+  // Grab options.
+  found_opt = -1 != (opt = getopt_long(argc, argv, opt_string, long_opts, &long_index));
+  while (found_opt) {
+    switch (opt) {
+      case 'b':
+	MyArgs.to_binary = TRUE;
+	break;
+      case 't':
+	MyArgs.to_binary = FALSE;
+	break;
+      case 'h':
+	_display_usage();
+	exit(0);
+      default:
+	break;
+    }
+    found_opt = -1 != (opt = getopt_long(argc, argv, opt_string, long_opts, &long_index));
+  }
+
+  // Grab required arguments.
+  argc -= optind;
+  if (argc < 2) {
+    fprintf(stderr, "Missing input and/or output file arguments.\n");
+    _display_usage();
+    exit(0);
+  }
+
+  argv += optind;
+  MyArgs.infile = argv[0];
+  MyArgs.outfile = argv[1];
+}
@@ -187,3 +187,161 @@ double compute_dietterich_kappa(int num_trees, int num_classes, int num_examples
     
     return Kappa_sum / ( (double)(num_trees*(num_trees-1)) / 2.0 );
 }
+
+/*
+    Number of examples the vote of trees in a matrix built by init_matrix gets right, scored as
+    avatardt's test does
+    
+    trees[0..num_trees-1] holds the 0-based tree numbers to vote or is NULL for the first num_trees.
+    Ties are broken from the start of the --seed stream, as in a new avatardt run
+ */
+
+int count_voted_correct(int num_trees, int *trees, int num_classes, int num_examples, int **matrix,
+                        Args_Opts args) {
+    int i, k;
+    int **confusion;
+    int num_correct = 0;
+    CV_Matrix votes;
+    
+    votes.num_examples = num_examples;
+    votes.num_classifiers = num_trees;
+    votes.additional_cols = 1;
+    votes.num_classes = num_classes;
+    votes.classes = NULL;
+    votes.data = (union data_type_union **)malloc(num_examples * sizeof(union data_type_union *));
+    for (k = 0; k < num_examples; k++) {
+        votes.data[k] = (union data_type_union *)malloc((num_trees + 1) * sizeof(union data_type_union));
+        votes.data[k][0].Integer = matrix[0][k];
+        for (i = 0; i < num_trees; i++)
+            votes.data[k][i+1].Integer = matrix[(trees == NULL ? i : trees[i]) + 1][k];
+    }
+    
+    find_best_class_from_matrix(0, votes, args, 0, 1);
+    compute_voted_accuracy(votes, &confusion, args);
+    
+    for (i = 0; i < num_classes; i++) {
+        num_correct += confusion[i][i];
+        free(confusion[i]);
+    }
+    free(confusion);
+    for (k = 0; k < num_examples; k++)
+        free(votes.data[k]);
+    free(votes.data);
+    return num_correct;
+}
+
+/*
+    Greedy forward selection of a smaller ensemble from a matrix built by init_matrix
+    
+    Trees are added one at a time, each time taking the tree that gives the most accurate vote
+    together with the trees already chosen. Ties go to the tree that disagrees with the vote of the
+    chosen trees on the most examples, which favors diverse trees. A vote goes to the class with the
+    greatest total weight, the lowest numbered class among equals.
+    
+    weights[t=0..T-1] holds the weight of tree t's vote or is NULL for one vote per tree
+    tolerance is the fraction of accuracy the selected trees may give up against all T trees
+    selected[0..T-1] receives the 0-based tree numbers in the order they were chosen
+    accuracy[0..1] receives the accuracy of all T trees and of the selected trees
+    args, if not NULL, breaks tied votes as avatardt's test does for both accuracies and for
+    deciding when enough trees have been selected; the search itself still uses the lowest class.
+    It only applies to unweighted votes since avatardt gives a boosted tie to the lowest class too
+    
+    Returns the number of trees selected
+ */
+
+int select_trees(int num_trees, int num_classes, int num_examples, int **matrix, double *weights,
+                 double tolerance, int *selected, double *accuracy, Args_Opts *args) {
+    int i, j, k, n;
+    int num_correct, best_correct, disagree, best_disagree, best_tree, this_class;
+    double this_vote;
+    double target;
+    double **votes;
+    double *best_vote;
+    int *best_class;
+    Boolean *chosen;
+    
+    votes = (double **)malloc(num_examples * sizeof(double *));
+    for (k = 0; k < num_examples; k++)
+        votes[k] = (double *)calloc(num_classes, sizeof(double));
+    best_vote = (double *)malloc(num_examples * sizeof(double));
+    best_class = (int *)malloc(num_examples * sizeof(int));
+    chosen = (Boolean *)calloc(num_trees, sizeof(Boolean));
+    
+    // Accuracy of the whole ensemble
+    num_correct = 0;
+    for (k = 0; k < num_examples; k++) {
+        for (n = 1; n < num_trees+1; n++)
+            votes[k][matrix[n][k]] += weights == NULL ? 1.0 : weights[n-1];
+        this_class = 0;
+        for (i = 1; i < num_classes; i++)
+            if (votes[k][i] > votes[k][this_class])
+                this_class = i;
+        if (this_class == matrix[0][k])
+            num_correct++;
+        for (i = 0; i < num_classes; i++)
+            votes[k][i] = 0.0;
+        best_class[k] = -1;
+        best_vote[k] = 0.0;
+    }
+    if (args != NULL && weights == NULL)
+        num_correct = count_voted_correct(num_trees, NULL, num_classes, num_examples, matrix, *args);
+    accuracy[0] = (double)num_correct / (double)num_examples;
+    target = (double)num_correct - tolerance * (double)num_examples;
+    
+    // Only the class of the tree being tried changes its total, so the new vote is either that
+    // class or the class that was winning
+    for (j = 0; j < num_trees; j++) {
+        best_tree = -1;
+        best_correct = -1;
+        best_disagree = -1;
+        for (n = 0; n < num_trees; n++) {
+            if (chosen[n])
+                continue;
+            num_correct = 0;
+            disagree = 0;
+            for (k = 0; k < num_examples; k++) {
+                this_class = matrix[n+1][k];
+                this_vote = votes[k][this_class] + (weights == NULL ? 1.0 : weights[n]);
+                if (this_class != best_class[k]) {
+                    disagree++;
+                    if (best_class[k] >= 0 && (this_vote < best_vote[k] ||
+                                               (this_vote == best_vote[k] && this_class > best_class[k])))
+                        this_class = best_class[k];
+                }
+                if (this_class == matrix[0][k])
+                    num_correct++;
+            }
+            if (num_correct > best_correct || (num_correct == best_correct && disagree > best_disagree)) {
+                best_tree = n;
+                best_correct = num_correct;
+                best_disagree = disagree;
+            }
+        }
+        
+        chosen[best_tree] = TRUE;
+        selected[j] = best_tree;
+        for (k = 0; k < num_examples; k++) {
+            this_class = matrix[best_tree+1][k];
+            votes[k][this_class] += weights == NULL ? 1.0 : weights[best_tree];
+            if (best_class[k] < 0 || votes[k][this_class] > best_vote[k] ||
+                                     (votes[k][this_class] == best_vote[k] && this_class < best_class[k])) {
+                best_class[k] = this_class;
+                best_vote[k] = votes[k][this_class];
+            }
+        }
+        if (args != NULL && weights == NULL)
+            best_correct = count_voted_correct(j+1, selected, num_classes, num_examples, matrix, *args);
+        if ((double)best_correct >= target)
+            break;
+    }
+    accuracy[1] = (double)best_correct / (double)num_examples;
+    
+    for (k = 0; k < num_examples; k++)
+        free(votes[k]);
+    free(votes);
+    free(best_vote);
+    free(best_class);
+    free(chosen);
+    
+    return j < num_trees ? j+1 : num_trees;
+}
@@ -38,3 +38,7 @@ double compute_pcdm(int num_trees, int num_examples, int **matrix);
 double compute_interrater_kappa(int num_trees, int num_examples, int **matrix);
 double compute_Q_statistic(int num_trees, int num_examples, int **matrix);
 double compute_dietterich_kappa(int num_trees, int num_classes, int num_examples, int **matrix, Args_Opts args);
+int count_voted_correct(int num_trees, int *trees, int num_classes, int num_examples, int **matrix,
+                        Args_Opts args);
+int select_trees(int num_trees, int num_classes, int num_examples, int **matrix, double *weights,
+                 double tolerance, int *selected, double *accuracy, Args_Opts *args);
@@ -292,6 +292,8 @@ void display_usage( void ) {
     printf("                       They are applied left to right.\n");
     printf("    --truth-column=S : Location of the truth column. S = first or last\n");
     printf("                       Default = last\n");
+    printf("    --data-cache     : Save the parsed data next to the data file as FILE.avbin\n");
+    printf("                       and load it instead of the text on later runs\n");
     printf("\n");
     printf("alternate filenames:\n");
     printf("    --names-file=FILE       : For avatar format data, use FILE for the names file\n");
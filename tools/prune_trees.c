@@ -0,0 +1,181 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../src/crossval.h"
+#include "../src/options.h"
+#include "../src/version_info.h"
+#include "../src/rw_data.h"
+#include "../src/tree.h"
+#include "../src/gain.h"
+#include "../src/reset.h"
+#include "../src/evaluate.h"
+#include "diversity_measures.h"
+
+int main(int argc, char **argv) {
+    DT_Ensemble Ensemble, Pruned;
+    Args_Opts Args;
+    AV_SortedBlobArray Sorted_Examples;
+    FC_Dataset ds = {0};
+    CV_Dataset Dataset = {0};
+    CV_Subset Subset = {0};
+    int i;
+    int num_selected;
+    int *selected;
+    int **result_matrix;
+    int **pruned_matrix;
+    double *weights = NULL;
+    double accuracy[2];
+    
+    Args = process_opts(argc, argv);
+    Args.do_testing = TRUE;
+    Args.caller = PRUNE_CALLER;
+    if (! sanity_check(&Args))
+        exit(-1);
+    set_output_filenames(&Args, FALSE, FALSE);
+    
+    if (Args.format == EXODUS_FORMAT && ! Args.do_training) {
+        init_fc(Args);
+        open_exo_datafile(&ds, Args.datafile);
+    }
+    av_exitIfError(av_initSortedBlobArray(&Sorted_Examples));
+    read_testing_data(&ds, Subset.meta, &Dataset, &Subset, &Sorted_Examples, &Args);
+    late_process_opts(Dataset.meta.num_attributes, Dataset.meta.num_examples, &Args);
+    
+    reset_DT_Ensemble(&Ensemble);
+    read_ensemble(&Ensemble, -1, 0, &Args);
+    if (Ensemble.num_trees < 1 || Subset.meta.num_examples < 1) {
+        fprintf(stderr, "Need at least one tree and one testing example to prune an ensemble\n");
+        exit(-1);
+    }
+    
+    // Boosted trees vote with the same weights that build_boost_prediction_matrix uses
+    if (Ensemble.boosting_betas != NULL) {
+        weights = (double *)malloc(Ensemble.num_trees * sizeof(double));
+        for (i = 0; i < Ensemble.num_trees; i++)
+            weights[i] = dlog_2(1.0/Ensemble.boosting_betas[i]);
+    }
+    
+    // The search gives a tied vote to the lowest class but avatardt breaks ties at random unless
+    // boosting, so the accuracies and the tolerance are measured the way avatardt would with the same --seed
+    init_matrix(Ensemble, Subset, &result_matrix);
+    selected = (int *)malloc(Ensemble.num_trees * sizeof(int));
+    num_selected = select_trees(Ensemble.num_trees, Subset.meta.num_classes, Subset.meta.num_examples,
+                                result_matrix, weights, Args.prune_tolerance / 100.0, selected, accuracy, &Args);
+    
+    // The selected trees are written in the order they were chosen so the most useful come first
+    Pruned = Ensemble;
+    Pruned.num_trees = num_selected;
+    Pruned.Trees = (DT_Node **)malloc(num_selected * sizeof(DT_Node *));
+    if (Ensemble.boosting_betas != NULL)
+        Pruned.boosting_betas = (double *)malloc(num_selected * sizeof(double));
+    pruned_matrix = (int **)malloc((num_selected+1) * sizeof(int *));
+    pruned_matrix[0] = result_matrix[0];
+    for (i = 0; i < num_selected; i++) {
+        Pruned.Trees[i] = Ensemble.Trees[selected[i]];
+        if (Ensemble.boosting_betas != NULL)
+            Pruned.boosting_betas[i] = Ensemble.boosting_betas[selected[i]];
+        pruned_matrix[i+1] = result_matrix[selected[i]+1];
+    }
+    write_ensemble_file(Args.pruned_trees_file, Pruned, Args, Args.binary_trees);
+    
+    printf("Testing Examples  = %d\n", Subset.meta.num_examples);
+    printf("Original Trees    = %d\n", Ensemble.num_trees);
+    printf("Original Accuracy = %.4f%%\n", 100.0 * accuracy[0]);
+    printf("Pruned Trees      = %d\n", num_selected);
+    printf("Pruned Accuracy   = %.4f%%\n", 100.0 * accuracy[1]);
+    if (num_selected > 1) {
+        printf("Original Q        = %f\n", compute_Q_statistic(Ensemble.num_trees, Subset.meta.num_examples,
+                                                               result_matrix));
+        printf("Pruned Q          = %f\n", compute_Q_statistic(num_selected, Subset.meta.num_examples,
+                                                               pruned_matrix));
+    }
+    printf("Saved %d trees to '%s'\n", num_selected, Args.pruned_trees_file);
+    return 0;
+}
+
+void display_usage( void ) {
+    printf("\nprune_trees ");
+    printf(get_version_string());
+    printf("\n");
+    printf("\nUsage: prune_trees options\n");
+    printf("\nSelects a small subset of the trees in an ensemble whose voted accuracy on the testing\n");
+    printf("data is within a tolerance of the whole ensemble's, and saves it as a new ensemble.\n");
+    printf("\nbasic arguments:\n");
+    printf("    -o, --format=FMTNAME      : Data format. FMTNAME is either 'exodus' or 'avatar'\n");
+    printf("                                Default = 'exodus'\n");
+    printf("    --prune-tolerance=F       : The pruned ensemble may be up to F percent less accurate\n");
+    printf("                                than the whole ensemble. Default = 0\n");
+    printf("    --binary-trees            : Save the pruned ensemble in the binary format\n");
+    printf("    --seed=N                  : Break tied votes in the accuracies the tolerance applies to\n");
+    printf("                                at random from seed N, as avatardt --seed=N does. The search\n");
+    printf("                                for trees gives a tied vote to the lowest numbered class\n");
+    printf("    --no-break-ties-randomly  : Give a tied vote to the lowest numbered class everywhere\n");
+    printf("\n");
+    printf("required exodus-specific arguments:\n");
+    printf("    -d, --datafile=FILE     : Use FILE as the exodus datafile\n");
+    printf("    --test-times=R          : Use data from the range of times R to test (e.g. 5,7-10)\n");
+    printf("    -V, --class-var=VARNAME : Use the variable named VARNAME as the class\n");
+    printf("                              definition\n");
+    printf("    -C, --class-file=FILE   : FILE the gives number of classes and thresholds:\n");
+    printf("                              E.g.\n");
+    printf("                                  class_var_name Osaliency\n");
+    printf("                                  number_of_classes 5\n");
+    printf("                                  thresholds 0.2,0.4,0.6,0.8\n");
+    printf("                                Will put all values <=0.2 in class 0,\n");
+    printf("                                <=0.4 in class 1, etc\n");
+    printf("\n");
+    printf("required avatar-specific arguments:\n");
+    printf("    -f, --filestem=STRING : Use STRING as the filestem\n");
+    printf("\n");
+    printf("avatar-specific options:\n");
+    printf("    --include=R      : Include the features listed in R (e.g. 1-4,6)\n");
+    printf("    --exclude=R      : Exclude the features listed in R (e.g. 1-4,6)\n");
+    printf("                       --include and --exclude may be specified multiple times.\n");
+    printf("                       They are applied left to right.\n");
+    printf("    --truth-column=S : Location of the truth column. S = first or last\n");
+    printf("                       Default = last\n");
+    printf("\n");
+    printf("alternate filenames:\n");
+    printf("    --names-file=FILE        : For avatar format data, use FILE for the names file\n");
+    printf("    --test-file=FILE         : For avatar format data, use FILE for testing data\n");
+    printf("    --trees-file=FILE        : For avatar format data, use FILE for ensemble file\n");
+    printf("    --pruned-trees-file=FILE : Save the pruned ensemble to FILE\n");
+    printf("                               Default = <filestem>.pruned.trees\n");
+    printf("\n");
+    exit(-1);
+}
@@ -58,6 +58,7 @@ struct Global_Args_t {
     char* datafile;   // file with data points to test for remoteness
     char* ref_datafile;// reference data that is presumed to be clean
     Boolean print_prox_progress;
+    Boolean data_cache;
     int truth_column;
     int num_skipped_features;
     int* skipped_features;
@@ -86,6 +87,7 @@ main(int argc, char **argv)
     CV_Metadata meta;    memset(&meta, 0, sizeof(CV_Metadata));
     CV_Class classmeta;  memset(&classmeta, 0, sizeof(CV_Class));
     ens_opts.truth_column = MyArgs.truth_column;
+    ens_opts.data_cache = MyArgs.data_cache;
     ens_opts.num_skipped_features = MyArgs.num_skipped_features;
     if (ens_opts.num_skipped_features > 0) {
         int i;
@@ -190,6 +192,7 @@ _display_usage(Boolean show_details) {
            "\n"
            "OPTIONS\n"
            "\n"
+           "  --data-cache        : Load and save .avbin caches of the data files.\n"
            "  --help              : Show this help message.\n"
            "  --exclude=R         : Exclude features listed in R (e.g., 1-4,6).  May be\n"
            "                      : specified multiple times.\n"
@@ -245,6 +248,7 @@ enum {
     option_print_prox_progress,
     option_ref_data,
     option_truth_column,
+    option_data_cache,
 };
 
 static const struct option long_opts[] = {
@@ -254,6 +258,7 @@ static const struct option long_opts[] = {
     {"print-proximity-progress", no_argument, NULL, option_print_prox_progress},
     {"ref-data", required_argument, NULL, option_ref_data},
     {"truth-column", required_argument, NULL, option_truth_column},
+    {"data-cache", no_argument, NULL, option_data_cache},
     {NULL, no_argument, NULL, 0}
 };
 
@@ -297,6 +302,9 @@ _process_opts(int argc, char** argv)
         case option_print_prox_progress:
             MyArgs.print_prox_progress = TRUE;
             break;
+        case option_data_cache:
+            MyArgs.data_cache = TRUE;
+            break;
         case option_ref_data:
             MyArgs.ref_datafile = e_strdup(optarg);
             break;
@@ -0,0 +1,430 @@
+/********************************************************************************** 
+Avatar Tools 
+Copyright (c) 2019, National Technology and Engineering Solutions of Sandia, LLC
+All rights reserved. 
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer  in the
+  documentation and/or other materials provided with the distribution.
+
+
+3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For questions, comments or contributions contact 
+Philip Kegelmeyer, wpk@sandia.gov 
+*******************************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#ifndef _GNU_SOURCE
+  #include "getopt.h"
+#else
+  #include <getopt.h>
+#endif
+#include "../src/version_info.h"
+#include "../src/crossval.h"
+#include "../src/tree.h"
+#include "../src/gain.h"
+#include "../src/options.h"
+#include "../src/rw_data.h"
+#include "../src/memory.h"
+#include "../src/reset.h"
+#include "../src/array.h"
+
+struct Global_Args_t {
+  char* modelfile;
+  char* namesfile;
+  char* outfile;
+  char* function_name;
+  char* macro_prefix;   // function_name in upper case, so two generated files can share a program
+} MyArgs;
+
+// Prototypes for helper functions.
+void _display_usage(void);
+void _process_opts(int argc, char** argv);
+void _write_header(FILE* fh, DT_Ensemble* model, CV_Metadata* meta, int* att_map);
+void _write_tree(FILE* fh, DT_Ensemble* model, int tree_num, double* leaf_weights);
+void _write_node(FILE* fh, DT_Node* tree, int node, int depth, int num_classes, double leaf_weight);
+void _write_predict(FILE* fh, DT_Ensemble* model, CV_Metadata* meta, int* att_map);
+void _indent(FILE* fh, int depth);
+void _write_float(FILE* fh, float value);
+
+void
+display_usage()
+{
+  _display_usage();
+}
+
+int
+main(int argc, char** argv)
+{
+  DT_Ensemble model;
+  Args_Opts ens_opts;
+  CV_Metadata meta;
+  CV_Class classmeta;
+  FILE* out;
+  double* leaf_weights;
+  double sum_betas;
+  int* att_map;
+  int i, j;
+
+  reset_CV_Metadata(&meta);
+  reset_DT_Ensemble(&model);
+
+  // parse arguments and options
+  _process_opts(argc, argv);
+  ens_opts = process_opts(0, NULL);  // all this line does is default init.
+  ens_opts.trees_file = MyArgs.modelfile;
+  ens_opts.names_file = MyArgs.namesfile;
+
+  // read names file
+  if (!read_names_file(&meta, &classmeta, &ens_opts, TRUE)) {
+    fprintf(stderr, "Error reading names file %s\n", ens_opts.names_file);
+    exit(-1);
+  }
+
+  // load model into memory
+  read_ensemble(&model, -1, 0, &ens_opts);
+  if (model.num_trees < 1) {
+    fprintf(stderr, "No trees found in %s\n", ens_opts.trees_file);
+    exit(-1);
+  }
+  // The names file lists every attribute, including those the ensemble skipped
+  if (model.num_classes != meta.num_classes ||
+      model.num_attributes + ens_opts.num_skipped_features != meta.num_attributes) {
+    fprintf(stderr, "Ensemble %s does not match names file %s (%d/%d classes, %d+%d skipped/%d attributes)\n",
+            ens_opts.trees_file, ens_opts.names_file, model.num_classes, meta.num_classes,
+            model.num_attributes, ens_opts.num_skipped_features, meta.num_attributes);
+    exit(-1);
+  }
+  att_map = (int *)malloc(model.num_attributes * sizeof(int));
+  for (i = 0, j = 0; i < model.num_attributes; i++, j++) {
+    while (find_int(j+1, ens_opts.num_skipped_features, ens_opts.skipped_features))
+      j++;
+    att_map[i] = j;
+  }
+  resolve_missing_values(&model, meta, ens_opts);
+
+  // Each leaf adds its class probabilities scaled by the same weight the
+  // library uses when it builds a probability matrix for the ensemble
+  leaf_weights = (double *)malloc(model.num_trees * sizeof(double));
+  if (model.boosting_betas != NULL) {
+    sum_betas = 0.0;
+    for (i = 0; i < model.num_trees; i++)
+      sum_betas += model.boosting_betas[i];
+    for (i = 0; i < model.num_trees; i++)
+      leaf_weights[i] = model.boosting_betas[i] / sum_betas;
+  } else {
+    for (i = 0; i < model.num_trees; i++)
+      leaf_weights[i] = 1.0 / (double)model.num_trees;
+  }
+
+  if (MyArgs.outfile == NULL) {
+    out = stdout;
+  } else if ((out = fopen(MyArgs.outfile, "w")) == NULL) {
+    fprintf(stderr, "Failed to open file for writing C source: '%s'\nExiting ...\n", MyArgs.outfile);
+    exit(8);
+  }
+
+  _write_header(out, &model, &meta, att_map);
+  for (i = 0; i < model.num_trees; i++)
+    _write_tree(out, &model, i, leaf_weights);
+  _write_predict(out, &model, &meta, att_map);
+
+  if (out != stdout)
+    fclose(out);
+
+  // clean up
+  free(leaf_weights);
+  free(att_map);
+  free(MyArgs.macro_prefix);
+  free_CV_Class(classmeta);
+  free_DT_Ensemble(model, TEST_MODE);
+
+  return 0;
+}
+
+void
+_indent(FILE* fh, int depth)
+{
+  int i;
+  for (i = 0; i < depth; i++)
+    fprintf(fh, "    ");
+}
+
+// Print a float literal that reads back as exactly the same value
+void
+_write_float(FILE* fh, float value)
+{
+  char buf[64];
+  sprintf(buf, "%.9g", value);
+  fprintf(fh, "%s%sf", buf, strpbrk(buf, ".e") == NULL ? ".0" : "");
+}
+
+void
+_write_header(FILE* fh, DT_Ensemble* model, CV_Metadata* meta, int* att_map)
+{
+  char* version = get_version_string();
+  int i;
+
+  fprintf(fh, "/*\n"
+              " * Generated by tree2c (avatar %s) from\n"
+              " *   ensemble: %s\n"
+              " *   names:    %s\n"
+              " *\n"
+              " * int %s(const float *row, float *probs)\n"
+              " *\n"
+              " * row holds the %d attribute values in names-file order with the class\n"
+              " * column and any skipped attributes removed.  Discrete attributes hold\n"
+              " * the 0-based index of their value in the names file.  NaN, or a\n"
+              " * discrete value that is not one of those indexes, marks a missing\n"
+              " * value and is replaced by the value stored in the ensemble.  probs\n"
+              " * receives the %d class probabilities and the return value is the\n"
+              " * %s class, with ties going to the lowest class number.\n"
+              " *\n"
+              " * const char *%s_class_name(int class_num)\n"
+              " *\n"
+              " * returns the name of a class number from the names file.\n"
+              " */\n",
+          version, MyArgs.modelfile, MyArgs.namesfile, MyArgs.function_name,
+          model->num_attributes, model->num_classes,
+          model->boosting_betas != NULL ? "boosting-weighted winning" : "majority vote",
+          MyArgs.function_name);
+  free(version);
+  fprintf(fh, "#include <math.h>\n\n");
+  fprintf(fh, "#define %s_NUM_CLASSES %d\n", MyArgs.macro_prefix, model->num_classes);
+  fprintf(fh, "#define %s_NUM_ATTRIBUTES %d\n", MyArgs.macro_prefix, model->num_attributes);
+  fprintf(fh, "#define %s_NUM_TREES %d\n\n", MyArgs.macro_prefix, model->num_trees);
+
+  fprintf(fh, "static const char *class_names[%s_NUM_CLASSES] = {\n", MyArgs.macro_prefix);
+  for (i = 0; i < model->num_classes; i++)
+    fprintf(fh, "    \"%s\"%s\n", meta->class_names[i], i < model->num_classes - 1 ? "," : "");
+  fprintf(fh, "};\n\n");
+
+  fprintf(fh, "static const float missing_values[%s_NUM_ATTRIBUTES] = {\n", MyArgs.macro_prefix);
+  for (i = 0; i < model->num_attributes; i++) {
+    if (model->attribute_types[i] == DISCRETE)
+      fprintf(fh, "    %d.0f%s /* row[%d]: %s (discrete, %s) */\n", model->Missing[i].Discrete,
+              i < model->num_attributes - 1 ? "," : "", i, meta->attribute_names[att_map[i]],
+              meta->discrete_attribute_map[att_map[i]][model->Missing[i].Discrete]);
+    else {
+      fprintf(fh, "    ");
+      _write_float(fh, model->Missing[i].Continuous);
+      fprintf(fh, "%s /* row[%d]: %s */\n", i < model->num_attributes - 1 ? "," : "", i,
+              meta->attribute_names[att_map[i]]);
+    }
+  }
+  fprintf(fh, "};\n\n");
+
+  fprintf(fh, "const char *%s_class_name(int class_num)\n"
+              "{\n"
+              "    return class_num >= 0 && class_num < %s_NUM_CLASSES ? class_names[class_num] : 0;\n"
+              "}\n\n",
+          MyArgs.function_name, MyArgs.macro_prefix);
+}
+
+void
+_write_tree(FILE* fh, DT_Ensemble* model, int tree_num, double* leaf_weights)
+{
+  fprintf(fh, "static int tree_%d(const float *row, float *probs)\n{\n", tree_num + 1);
+  _write_node(fh, model->Trees[tree_num], 0, 1, model->num_classes, leaf_weights[tree_num]);
+  fprintf(fh, "}\n\n");
+}
+
+void
+_write_node(FILE* fh, DT_Node* tree, int node, int depth, int num_classes, double leaf_weight)
+{
+  int i;
+
+  if (tree[node].branch_type == LEAF) {
+    for (i = 0; i < num_classes; i++) {
+      // Adding zero is a no-op so those classes are left out
+      if (tree[node].class_probs[i] == 0.0)
+        continue;
+      _indent(fh, depth);
+      fprintf(fh, "probs[%d] = (float)(probs[%d] + %.17g);\n", i, i,
+              (double)tree[node].class_probs[i] * leaf_weight);
+    }
+    _indent(fh, depth);
+    fprintf(fh, "return %d;\n", tree[node].Node_Value.class_label);
+  } else if (tree[node].attribute_type == CONTINUOUS) {
+    _indent(fh, depth);
+    fprintf(fh, "if (row[%d] < ", tree[node].attribute);
+    _write_float(fh, tree[node].branch_threshold);
+    fprintf(fh, ") {\n");
+    _write_node(fh, tree, tree[node].Node_Value.branch[0], depth + 1, num_classes, leaf_weight);
+    _indent(fh, depth);
+    fprintf(fh, "} else {\n");
+    _write_node(fh, tree, tree[node].Node_Value.branch[1], depth + 1, num_classes, leaf_weight);
+    _indent(fh, depth);
+    fprintf(fh, "}\n");
+  } else {
+    _indent(fh, depth);
+    fprintf(fh, "switch ((int)row[%d]) {\n", tree[node].attribute);
+    for (i = 0; i < tree[node].num_branches; i++) {
+      if (i == 0) {
+        // Like the library, send a missing value that is out of range down the first branch
+        _indent(fh, depth);
+        fprintf(fh, "default:\n");
+      }
+      _indent(fh, depth);
+      fprintf(fh, "case %d:\n", i);
+      _write_node(fh, tree, tree[node].Node_Value.branch[i], depth + 1, num_classes, leaf_weight);
+    }
+    _indent(fh, depth);
+    fprintf(fh, "}\n");
+  }
+}
+
+void
+_write_predict(FILE* fh, DT_Ensemble* model, CV_Metadata* meta, int* att_map)
+{
+  int i;
+
+  fprintf(fh, "int %s(const float *row, float *probs)\n{\n", MyArgs.function_name);
+  fprintf(fh, "    float x[%s_NUM_ATTRIBUTES];\n", MyArgs.macro_prefix);
+  if (model->boosting_betas != NULL)
+    fprintf(fh, "    float votes[%s_NUM_CLASSES];\n", MyArgs.macro_prefix);
+  else
+    fprintf(fh, "    int votes[%s_NUM_CLASSES];\n", MyArgs.macro_prefix);
+  fprintf(fh, "    int best_class;\n"
+              "    int i;\n\n"
+              "    for (i = 0; i < %s_NUM_ATTRIBUTES; i++)\n"
+              "        x[i] = isnan(row[i]) ? missing_values[i] : row[i];\n",
+          MyArgs.macro_prefix);
+  for (i = 0; i < model->num_attributes; i++) {
+    if (model->attribute_types[i] != DISCRETE)
+      continue;
+    fprintf(fh, "    if (!(x[%d] >= 0.0f && x[%d] < %d.0f && x[%d] == floorf(x[%d])))\n"
+                "        x[%d] = missing_values[%d];\n",
+            i, i, meta->num_discrete_values[att_map[i]], i, i, i, i);
+  }
+  fprintf(fh, "    for (i = 0; i < %s_NUM_CLASSES; i++) {\n"
+              "        probs[i] = 0.0f;\n"
+              "        votes[i] = 0;\n"
+              "    }\n\n",
+          MyArgs.macro_prefix);
+  for (i = 0; i < model->num_trees; i++) {
+    if (model->boosting_betas != NULL) {
+      fprintf(fh, "    votes[tree_%d(x, probs)] += ", i + 1);
+      _write_float(fh, (float)dlog_2(1.0/model->boosting_betas[i]));
+      fprintf(fh, ";\n");
+    } else
+      fprintf(fh, "    votes[tree_%d(x, probs)]++;\n", i + 1);
+  }
+  // Ties go to the lowest class number, as they do in avatardt
+  fprintf(fh, "\n"
+              "    best_class = 0;\n"
+              "    for (i = 1; i < %s_NUM_CLASSES; i++)\n"
+              "        if (votes[i] > votes[best_class])\n"
+              "            best_class = i;\n"
+              "    return best_class;\n"
+              "}\n",
+          MyArgs.macro_prefix);
+}
+
+void
+_display_usage()
+{
+  printf("usage: %s [options] modelfile namesfile\n\n", "tree2c");
+  printf("Translates a saved ensemble into a standalone C source file.  Each tree\n"
+	 "becomes a function of nested if/else (continuous splits) and switch\n"
+	 "(discrete splits) statements with the thresholds and leaf probabilities\n"
+	 "compiled in as constants.  The file defines a single entry point:\n"
+	 "\n"
+	 "    int predict(const float *row, float *probs);\n"
+	 "\n"
+	 "which fills probs with the ensemble's class probabilities and returns the\n"
+	 "predicted class number, and predict_class_name() to look up the name of a\n"
+	 "class number.  Every other symbol in the file is static or prefixed with\n"
+	 "the entry point's name, so several generated files can be linked into one\n"
+	 "program.  Predictions and probabilities match those written by avatardt\n"
+	 "--output-probabilities=weighted for the same ensemble, except that tied\n"
+	 "votes always go to the lowest class number as they do with\n"
+	 "--no-break-ties-randomly.\n"
+	 "\n"
+	 "OPTIONS\n\n"
+	 "  -o, --output f          : Write the C source to f instead of STDOUT.\n"
+	 "  -n, --function-name s   : Name the entry point s instead of predict.\n"
+	 "  -h                      : show this help message\n"
+	 );
+}
+
+static const char* opt_string = "+ho:n:";
+
+static const struct option long_opts[] = {
+  {"output", required_argument, NULL, 'o'},
+  {"function-name", required_argument, NULL, 'n'},
+  {"help", no_argument, NULL, 'h'},
+  {NULL, no_argument, NULL, 0}
+};
+
+void
+_process_opts(int argc, char** argv)
+{
+  int opt = 0;
+  int long_index = 0;
+  Boolean found_opt = 0;
+
+  // Initialize
+  MyArgs.modelfile = NULL;
+  MyArgs.namesfile = NULL;
+  MyArgs.outfile = NULL;
+  MyArgs.function_name = "predict";
+
+  // Grab options.
+  found_opt = -1 != (opt = getopt_long(argc, argv, opt_string, long_opts, &long_index));
+  while (found_opt) {
+    switch (opt) {
+      case 'o':
+	MyArgs.outfile = optarg;
+	break;
+      case 'n':
+	MyArgs.function_name = optarg;
+	break;
+      case 'h':
+	_display_usage();
+	exit(0);
+      default:
+	break;
+    }
+    found_opt = -1 != (opt = getopt_long(argc, argv, opt_string, long_opts, &long_index));
+  }
+
+  // Grab required arguments.
+  argc -= optind;
+  if (argc < 2) {
+    fprintf(stderr, "Missing model and/or names file arguments.\n");
+    _display_usage();
+    exit(0);
+  }
+
+  argv += optind;
+  MyArgs.modelfile = argv[0];
+  MyArgs.namesfile = argv[1];
+
+  MyArgs.macro_prefix = strdup(MyArgs.function_name);
+  for (opt = 0; MyArgs.macro_prefix[opt] != '\0'; opt++)
+    MyArgs.macro_prefix[opt] = toupper((unsigned char)MyArgs.macro_prefix[opt]);
+}
@@ -49,11 +49,13 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "../src/rw_data.h"
 #include "../src/memory.h"
 #include "../src/reset.h"
+#include "../src/lazy_trees.h"
 
 struct Global_Args_t {
   char* modelfile;
   char* namesfile;
   char* datafile;
+  int max_tree_memory;
 } MyArgs;
 
 // Prototypes for helper functions.
@@ -94,8 +96,8 @@ main(int argc, char** argv)
   }
   //printf("after read names\n"); fflush(stdout);
 
-  // load model into memory
-  read_ensemble(&model, -1, 0, &ens_opts);
+  // index the model; trees are loaded one at a time as the statistics need them
+  read_lazy_ensemble(&model, -1, 0, (size_t)MyArgs.max_tree_memory << 20, &ens_opts);
   //printf("after read ensemble\n"); fflush(stdout);
 
   // compute tree-based statistics of feature importance
@@ -172,6 +174,8 @@ _display_usage()
 	 "\n"
 	 "OPTIONS\n\n"
 	 "  --datafile f   : Base statistics on data in f, instead of from train set.\n"
+	 "  --max-tree-memory MB\n"
+	 "                 : Keep at most MB megabytes of trees in memory at once.\n"
 	 "  -h             : show this help message\n"
 	 "\n"
 	 "REFERENCES\n\n"
@@ -182,10 +186,11 @@ _display_usage()
 	 );
 }
 
-static const char* opt_string = "+hd:";
+static const char* opt_string = "+hd:m:";
 
 static const struct option long_opts[] = {
   {"datafile", required_argument, NULL, 'd'},
+  {"max-tree-memory", required_argument, NULL, 'm'},
   {"help", no_argument, NULL, 'h'},
   {NULL, no_argument, NULL, 0}
 };
@@ -201,6 +206,7 @@ _process_opts(int argc, char** argv)
   MyArgs.modelfile = NULL;
   MyArgs.namesfile = NULL;
   MyArgs.datafile = NULL;
+  MyArgs.max_tree_memory = 0;
 
   // Grab options.
   found_opt = -1 != (opt = getopt_long(argc, argv, opt_string, long_opts, &long_index));
@@ -209,6 +215,9 @@ _process_opts(int argc, char** argv)
       case 'd':
 	MyArgs.datafile = optarg;
 	break;
+      case 'm':
+	MyArgs.max_tree_memory = atoi(optarg);
+	break;
       case 'h':
 	_display_usage();
 	break;
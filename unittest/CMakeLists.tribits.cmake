@@ -38,6 +38,14 @@ ELSE()
     ../src/att_noising.c
     ../src/bagging.c
     ../src/balanced_learning.c
+    ../src/binary_trees.c
+    ../src/binary_data.c
+    ../src/test_stream.c
+    ../src/out_of_core.c
+    ../src/mapped_input.c
+    ../src/checkpoint.c
+    ../src/text_trees.c
+    ../src/lazy_trees.c
     ../src/boost.c
     ../src/crossval_util.c
     ../src/distinct_values.c
@@ -46,9 +54,11 @@ ELSE()
     ../src/heartbeat.c
     ../src/ivote.c
     ../src/knn.c
+    ../src/lockstep.c
     ../src/memory.c
     ../src/missing_values.c
     ../src/options.c
+    ../src/quickscorer.c
     ../src/rw_data.c
     ../src/safe_memory.c
     ../src/schema.c
@@ -58,6 +68,7 @@ ELSE()
     ../src/tree.c
     ../src/util.c
     ../src/version_info.c
+    ../tools/avatard_utils.c
     ../tools/diversity_measures.c
     ../tools/proximity_utils.c
     )
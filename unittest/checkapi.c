@@ -34,10 +34,12 @@ For questions, comments or contributions contact
 Philip Kegelmeyer, wpk@sandia.gov 
 *******************************************************************************/
 #include <string.h>
+#include <math.h>
 #include "check.h"
 #include "checkall.h"
 #include "../src/crossval.h"
 #include "../src/avatar_api.h"
+#include "../tools/avatard_utils.h"
 #include "../src/crossval.h"
 
 struct Avatar_struct{
@@ -54,21 +56,21 @@ struct Avatar_struct{
 START_TEST(check_avatar_train)
 {
     Avatar_handle* a;
-    a = calloc(1, sizeof(Avatar_handle));
     int argc;
-    char * argv[4];
+    char * argv[5];
     argv[0] = "./avatar_api.c";
-    argv[1] = "-fapi_testing";
+    argv[1] = "-fdata/api_testing";
     argv[2] = "--format=avatar";
     argv[3] = "--seed=24601";
+    argv[4] = "--no-save-trees"; // Don't overwrite data/api_testing.trees
 
-    argc = 4;
+    argc = 5;
 
     FILE *datafile;
     char datastr[10000];
-    char* filename = "api_testing.data";
+    char* filename = "data/api_testing.data";
 
-    char train_string[10000];
+    char train_string[10000] = "";
     
     datafile = fopen(filename, "r");
     while (fgets(datastr,10000, datafile) != NULL)
@@ -78,9 +80,9 @@ START_TEST(check_avatar_train)
 
     FILE *namesfile;
     char namesstr[10000];
-    filename = "api_testing.names";
+    filename = "data/api_testing.names";
 
-    char names_string[10000];
+    char names_string[10000] = "";
     
     namesfile = fopen(filename, "r");
     while (fgets(namesstr,10000, namesfile) != NULL)
@@ -90,25 +92,27 @@ START_TEST(check_avatar_train)
 
     a = avatar_train(argc, argv, names_string, 1, train_string, 1);
 
-    CV_Subset dataset = {0};
-    dataset = a->Train_Subset;
     DT_Ensemble ensemble = {0};
     ensemble = a->Test_Ensembles[0];
 
-    //Check train data meta
-    fail_unless(dataset.meta.num_examples == 12, "Number of training examples should be 12 but is %d", dataset.meta.num_examples);
-    fail_unless(dataset.meta.num_classes == 2, "Number of classes should be 2 but is %d", dataset.meta.num_classes);
-    fail_unless(dataset.meta.num_examples_per_class[0] == 8, "Number of examples in first class should be 8 but is %d", dataset.meta.num_examples_per_class[0]);
-    fail_unless(dataset.meta.num_examples_per_class[1] == 4, "Number of examples in second class should be 4 but is %d", dataset.meta.num_examples_per_class[1]);
-
     //Check ensemble stats 
     fail_unless(ensemble.num_trees==1, "Num trees should be 1 but is %d", ensemble.num_trees);
     fail_unless(ensemble.num_classes==2, "Num classes should be 2 but is %d", ensemble.num_classes);
     fail_unless(ensemble.num_attributes==4, "Num attributes should be 4 but is %d", ensemble.num_attributes);
+    fail_unless(ensemble.num_training_examples == 12, "Number of training examples should be 12 but is %d", ensemble.num_training_examples);
     fail_unless(ensemble.Trees[0][1].Node_Value.class_label==0, "The second node should have class value 0 but has value %d", ensemble.Trees[0][1].Node_Value.class_label);
     fail_unless(ensemble.Trees[0][2].Node_Value.class_label==1, "The third node should have class value 1 but has value %d", ensemble.Trees[0][2].Node_Value.class_label);
 
-    free(a);
+    //The trained ensemble can be scored without being saved and reloaded
+    float rows[8] = { 5, 37, 1, 3,
+                     31,  3, 2, 3 };
+    int preds[2];
+    float probs[2 * 2];
+    fail_unless(avatar_predict_rows(a, rows, 2, 4, preds, probs) == 2, "Both rows should be scored");
+    fail_unless(preds[0]==0, "1st row should be classified as zero but it's classified as %d", preds[0]);
+    fail_unless(preds[1]==1, "2nd row should be classified as one but it's classified as %d", preds[1]);
+
+    avatar_cleanup(a);
 }
 END_TEST
 
@@ -131,6 +135,10 @@ START_TEST(check_avatar_load)
     fail_unless(ensemble.num_attributes==4, "Num attributes should be 4 but is %d", ensemble.num_attributes);
     fail_unless(ensemble.num_training_examples == 12, "Number of training examples should be 12", ensemble.num_training_examples);
 
+    fail_unless(avatar_num_attributes(a) == 4, "avatar_num_attributes should be 4 but is %d", avatar_num_attributes(a));
+    fail_unless(! strcmp(avatar_class_name(a, 1), "1"), "Class 1 should be named '1' but is '%s'", avatar_class_name(a, 1));
+    fail_unless(avatar_class_name(a, 2) == NULL, "There is no class 2");
+
 }
 END_TEST
 
@@ -166,6 +174,148 @@ START_TEST(check_avatar_test)
 }
 END_TEST
 
+START_TEST(check_avatar_predict_rows)
+{
+    Avatar_handle* a;
+    a = avatar_load("data/api_testing", "data/api_testing.names", 0, "data/api_testing.trees", 0);
+
+    // The last row is missing the split attribute, which falls back to 13 from the trees file
+    float rows[16] = { 5, 37, 1, 3,
+                      19, 19, 1, 4,
+                      24, 11, 2, 4,
+                      NAN, 3, 2, 3 };
+    int preds[4];
+    float probs[2 * 4];
+
+    fail_unless(avatar_predict_rows(a, rows, 4, 4, preds, probs) == 4, "All 4 rows should be scored");
+    fail_unless(preds[0]==0, "1st row should be classified as zero but it's classified as %d", preds[0]);
+    fail_unless(preds[1]==0, "2nd row should be classified as zero but it's classified as %d", preds[1]);
+    fail_unless(preds[2]==1, "3rd row should be classified as one but it's classified as %d", preds[2]);
+    fail_unless(preds[3]==0, "4th row should be classified as zero but it's classified as %d", preds[3]);
+    fail_unless(fabs(probs[0] - 0.9) < 1e-6, "1st row should have P(0) = 0.9 but has %f", probs[0]);
+    fail_unless(fabs(probs[5] - 5.0/6.0) < 1e-6, "3rd row should have P(1) = 0.8333 but has %f", probs[5]);
+    fail_unless(avatar_predict_rows(a, rows, 4, 3, preds, probs) == -1, "Rows with the wrong number of columns should be rejected");
+
+    avatar_cleanup(a);
+}
+END_TEST
+
+START_TEST(check_predict_rows_discrete_missing)
+{
+    Avatar_handle* a;
+    char names[] = "c0 : continuous\n"
+                   "d1 : discrete x,tri,sq\n"
+                   "class : class A,B\n";
+    // The missing value for d1 is stored by name and must map to its index, 1, not to atoi("tri")
+    char trees[] = "NumTrainingExamples  6\n"
+                   "NumClasses           2\n"
+                   "NumExamplesPerClass: 3 3\n"
+                   "NumAttributes        2\n"
+                   "NumSkippedAttributes 0\n"
+                   "NumTrees             1\n"
+                   "AttributeTypes: CONTINUOUS DISCRETE\n"
+                   "SkipAttributes: NOSKIP NOSKIP\n"
+                   "MissingAttributeValues: 0.5,tri\n"
+                   "Tree 1\n"
+                   "SPLIT DISCRETE ATT# 1 VAL# 1 / 3\n"
+                   "LEAF Class 0 Proportions 2 0\n"
+                   "SPLIT DISCRETE ATT# 1 VAL# 2 / 3\n"
+                   "LEAF Class 1 Proportions 0 3\n"
+                   "SPLIT DISCRETE ATT# 1 VAL# 3 / 3\n"
+                   "LEAF Class 0 Proportions 1 0\n";
+    float rows[10] = { 0, 2,
+                       0, NAN,
+                       0, 1.5,
+                       0, 7,
+                       0, -1 };
+    int preds[5];
+    float probs[2 * 5];
+    int i;
+
+    a = avatar_load("discrete_missing", names, 1, trees, 1);
+    fail_unless(avatar_predict_rows(a, rows, 5, 2, preds, probs) == 5, "All 5 rows should be scored");
+    fail_unless(preds[0] == 0, "A value of sq should be classified as zero but it's classified as %d", preds[0]);
+    for (i = 1; i < 5; i++)
+        fail_unless(preds[i] == 1, "Row %d has no valid value for d1 and should take the missing value, tri, "
+                                   "but it's classified as %d", i+1, preds[i]);
+    avatar_cleanup(a);
+}
+END_TEST
+
+START_TEST(check_reload_model)
+{
+    Served_Model model = {0};
+    Avatar_handle* handle;
+    char* error;
+    char* trees;
+    char* last_tree;
+    long size;
+    FILE* fh;
+    Avatar_handle* direct;
+    float rows[3 * 9] = { 0.5,   3, 0.2, -0.1, 0.7,   1,   9, 0.3, -0.4,
+                          NAN, NAN, NAN,  NAN, NAN, NAN, NAN, NAN,  NAN,
+                         -0.9,   7, 0.8,  0.4, NAN,   5, NAN, 0.1,  0.6 };
+    int preds[3], direct_preds[3];
+    float probs[3 * 5], direct_probs[3 * 5];
+    int i;
+
+    model.filestem = "data/diversity_test";
+    model.trees_file = strdup("data/diversity_test.trees");
+    fail_unless(reload_model(&model, NULL, &error), "Failed to load diversity_test.trees");
+    fail_unless(avatar_num_trees(model.handle) == 10, "Loaded %d trees instead of 10", avatar_num_trees(model.handle));
+    fail_unless(model.num_values[0] == 0 && model.num_values[1] == 10,
+                "RAND1 should have 10 values and FLUCpm1a none but they have %d and %d", model.num_values[1], model.num_values[0]);
+    handle = model.handle;
+
+    // The server maps the copy the loading process wrote, which must score like the file itself
+    direct = avatar_load("data/diversity_test", NULL, 0, "data/diversity_test.trees", 0);
+    fail_unless(avatar_predict_rows(model.handle, rows, 3, 9, preds, probs) == 3, "All 3 rows should be scored");
+    fail_unless(avatar_predict_rows(direct, rows, 3, 9, direct_preds, direct_probs) == 3, "All 3 rows should be scored");
+    for (i = 0; i < 3; i++)
+        fail_unless(preds[i] == direct_preds[i], "Row %d is class %d but %d when loaded directly", i+1, preds[i], direct_preds[i]);
+    for (i = 0; i < 3 * 5; i++)
+        fail_unless(probs[i] == direct_probs[i], "Probability %d is %f but %f when loaded directly", i, probs[i], direct_probs[i]);
+    avatar_cleanup(direct);
+
+    // Cut the file off before its last tree
+    fh = fopen("data/diversity_test.trees", "rb");
+    fseek(fh, 0, SEEK_END);
+    size = ftell(fh);
+    rewind(fh);
+    trees = (char *)malloc(size + 1);
+    fail_unless(fread(trees, 1, size, fh) == size, "Failed to read diversity_test.trees");
+    trees[size] = '\0';
+    fclose(fh);
+    last_tree = strstr(trees, "\nTree 10");
+    fail_unless(last_tree != NULL, "diversity_test.trees has no Tree 10");
+    fh = fopen("data/truncated_test.trees", "wb");
+    fwrite(trees, 1, last_tree - trees, fh);
+    fclose(fh);
+
+    fail_unless(! reload_model(&model, "data/truncated_test.trees", &error), "A truncated trees file should be rejected");
+    fail_unless(strstr(error, "9 of its 10 trees") != NULL, "Unexpected error '%s'", error);
+    fail_unless(model.handle == handle, "The old handle should be kept");
+    fail_unless(! strcmp(model.trees_file, "data/diversity_test.trees"), "The trees file should not change to %s", model.trees_file);
+
+    // Cut it off in the middle of a split in the last tree, which the reader exits on
+    fh = fopen("data/truncated_test.trees", "wb");
+    fwrite(trees, 1, size - 300, fh);
+    fclose(fh);
+    fail_unless(! reload_model(&model, "data/truncated_test.trees", &error), "A trees file that can't be parsed should be rejected");
+    fail_unless(strstr(error, "Failed to read") != NULL, "Unexpected error '%s'", error);
+    fail_unless(model.handle == handle, "The old handle should be kept");
+    fail_unless(! reload_model(&model, "data/no_such_file.trees", &error), "A missing trees file should be rejected");
+    fail_unless(model.handle == handle, "The old handle should be kept");
+    fail_unless(reload_model(&model, NULL, &error), "Failed to reload diversity_test.trees: %s", error);
+
+    remove("data/truncated_test.trees");
+    free(trees);
+    avatar_cleanup(model.handle);
+    free(model.trees_file);
+    free(model.num_values);
+}
+END_TEST
+
 
 Suite *api_suite(void)
 {
@@ -174,8 +324,11 @@ Suite *api_suite(void)
     TCase *tc_api = tcase_create(" API ");
     
     suite_add_tcase(suite, tc_api);
-    //tcase_add_test(tc_api, check_avatar_train);
+    tcase_add_test(tc_api, check_avatar_train);
     tcase_add_test(tc_api, check_avatar_load);
+    tcase_add_test(tc_api, check_avatar_predict_rows);
+    tcase_add_test(tc_api, check_predict_rows_discrete_missing);
+    tcase_add_test(tc_api, check_reload_model);
     //tcase_add_test(tc_api, check_avatar_test);
     
     return suite;
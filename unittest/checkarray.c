@@ -325,6 +325,36 @@ START_TEST(parse_commas)
 }
 END_TEST
 
+START_TEST(split_commas)
+{
+    char string1[] = "foo, :, bar  ,one,,    three,\"  five six   seven\" , eight  ";
+    char string2[] = " a ";
+    char **elements = NULL;
+    int num_elements;
+    int num_malloced = 0;
+    split_delimited_string(',', string1, &num_elements, &elements, &num_malloced);
+    
+    fail_unless(num_elements == 8, "(1) did not get 8 elements in list");
+    fail_unless(! strcmp(elements[0], "foo"), "(1) did not get 'foo'");
+    fail_unless(! strcmp(elements[1], ":"), "(1) did not get ':'");
+    fail_unless(! strcmp(elements[2], "bar"), "(1) did not get 'bar'");
+    fail_unless(! strcmp(elements[3], "one"), "(1) did not get 'one'");
+    fail_unless(! strcmp(elements[4], ""), "(1) did not get ''");
+    fail_unless(! strcmp(elements[5], "three"), "(1) did not get 'three'");
+    fail_unless(! strcmp(elements[6], "\"  five six   seven\""), "(1) did not get '\"  five six   seven\"'");
+    fail_unless(! strcmp(elements[7], "eight"), "(1) did not get 'eight'");
+    fail_unless(elements[0] == string1, "(1) 'foo' is not a view into the string");
+    
+    // The array is reused for the next string
+    split_delimited_string(',', string2, &num_elements, &elements, &num_malloced);
+    fail_unless(num_elements == 1, "(2) did not get 1 element in list");
+    fail_unless(! strcmp(elements[0], "a"), "(2) did not get 'a'");
+    fail_unless(num_malloced >= 8, "(2) array was shrunk to %d", num_malloced);
+    
+    free(elements);
+}
+END_TEST
+
 START_TEST(parse_colons)
 {
     int i;
@@ -416,6 +446,7 @@ Suite *array_suite(void)
     tcase_add_test(tc_array, array2range);
     tcase_add_test(tc_array, parse_spaces);
     tcase_add_test(tc_array, parse_commas);
+    tcase_add_test(tc_array, split_commas);
     tcase_add_test(tc_array, parse_colons);
     tcase_add_test(tc_array, test_shuffle_sort);
     tcase_add_test(tc_array, test_dup_removal);
@@ -55,6 +55,7 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "checkall.h"
 #include "util.h"
 #include "../src/bagging.h"
+#include "../src/av_rng.h"
 #include "../src/util.h"
 
 void _gen_bag_data(int num_examples, CV_Subset *data, Args_Opts *args);
@@ -222,6 +223,48 @@ START_TEST(bagging20)
 }
 END_TEST
 
+START_TEST(bagging_restart)
+{
+    int i;
+    int num = 1000;
+    Args_Opts Args = {0};
+    CV_Subset Data = {0}, Bag = {0}, Again = {0};
+    int bag_state;
+    unsigned short rand48_state[3];
+    char random_state[AV_RANDOM_STATE_SIZE];
+    long lrand48_draw, random_draw;
+    
+    _gen_bag_data(num, &Data, &Args);
+    Args.bag_size = 50;
+    make_bag(&Data, &Bag, Args, 0);
+    _free_bag_data(Bag);
+    
+    // Remember where every generator is, draw from them, then put them back and draw again
+    fail_unless(get_bag_rng_state(&bag_state) == TRUE, "bagging RNG not seeded by make_bag");
+    av_get_rand48_state(rand48_state);
+    av_get_random_state(random_state);
+    make_bag(&Data, &Bag, Args, 0);
+    lrand48_draw = lrand48();
+    random_draw = random();
+    
+    set_bag_rng_state(TRUE, bag_state);
+    av_set_rand48_state(rand48_state);
+    av_set_random_state(random_state);
+    make_bag(&Data, &Again, Args, 0);
+    fail_unless(Bag.meta.num_examples == Again.meta.num_examples, "restarted bag has a different size");
+    for (i = 0; i < Bag.meta.num_examples; i++)
+        fail_unless(Bag.examples[i].global_id_num == Again.examples[i].global_id_num,
+                    "restarted bag differs at %d", i);
+    fail_unless(lrand48() == lrand48_draw, "drand48 state not restored");
+    fail_unless(random() == random_draw, "random state not restored");
+    
+    _free_bag_data(Bag);
+    _free_bag_data(Again);
+    _free_bag_data(Data);
+    make_bag(NULL, NULL, Args, 1);
+}
+END_TEST
+
 // *********************************************
 // ***** Populate the Suite with the tests
 // *********************************************
@@ -237,6 +280,7 @@ Suite *bagging_suite(void)
     tcase_add_test(tc_bagging, bagging100);
     tcase_add_test(tc_bagging, bagging71);
     tcase_add_test(tc_bagging, bagging20);
+    tcase_add_test(tc_bagging, bagging_restart);
     
     return suite;
 }
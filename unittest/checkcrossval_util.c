@@ -180,6 +180,64 @@ START_TEST(comp_functions)
 }
 END_TEST
 
+START_TEST(bulk_blob_sorting)
+{
+    int i;
+    int num_examples = 200;
+    CV_Example *Examples;
+    AV_SortedBlobArray Added, Appended, Merged, Extra;
+    
+    // Shuffled seq_ids with every tenth example repeating the one before it
+    Examples = (CV_Example *)calloc(num_examples, sizeof(CV_Example));
+    for (i = 0; i < num_examples; i++) {
+        Examples[i].fclib_seq_num = (i * 7) % 3;
+        Examples[i].fclib_id_num = (i * 37) % num_examples;
+        if (i % 10 == 9)
+            Examples[i].fclib_id_num = Examples[i-1].fclib_id_num;
+    }
+    
+    // Appending and sorting once gives the same array as adding one at a time
+    fail_unless(av_initSortedBlobArray(&Added) == AV_SUCCESS, "failed to init SortedBlobArray (1)");
+    fail_unless(av_initSortedBlobArray(&Appended) == AV_SUCCESS, "failed to init SortedBlobArray (2)");
+    for (i = 0; i < num_examples; i++) {
+        av_addBlobToSortedBlobArray(&Added, &Examples[i], cv_example_compare_by_seq_id);
+        fail_unless(av_appendBlobToSortedBlobArray(&Appended, &Examples[i]) == 1, "failed to append blob %d", i);
+    }
+    fail_unless(Appended.numBlob == num_examples, "append s/b keep every blob");
+    i = av_sortSortedBlobArray(&Appended, cv_example_compare_by_seq_id);
+    fail_unless(i == num_examples - Added.numBlob, "sort s/b drop %d duplicates but dropped %d",
+                num_examples - Added.numBlob, i);
+    fail_unless(Appended.numBlob == Added.numBlob &&
+                ! memcmp(Appended.blobs, Added.blobs, Added.numBlob * sizeof(void *)),
+                "append and sort s/b match adding one at a time");
+    fail_unless(av_sortSortedBlobArray(&Appended, cv_example_compare_by_seq_id) == 0,
+                "sorting a sorted array s/b drop nothing");
+    
+    // Merging the second half into the first half gives the same array too
+    fail_unless(av_initSortedBlobArray(&Merged) == AV_SUCCESS, "failed to init SortedBlobArray (3)");
+    fail_unless(av_initSortedBlobArray(&Extra) == AV_SUCCESS, "failed to init SortedBlobArray (4)");
+    for (i = 0; i < num_examples; i++)
+        av_appendBlobToSortedBlobArray(i < num_examples/2 ? &Merged : &Extra, &Examples[i]);
+    // One blob of the second half is already in the first half
+    av_appendBlobToSortedBlobArray(&Extra, &Examples[0]);
+    av_sortSortedBlobArray(&Merged, cv_example_compare_by_seq_id);
+    av_sortSortedBlobArray(&Extra, cv_example_compare_by_seq_id);
+    i = av_mergeSortedBlobArrays(&Merged, &Extra, cv_example_compare_by_seq_id);
+    fail_unless(i == 1, "merge s/b skip 1 blob already there but skipped %d", i);
+    fail_unless(Merged.numBlob == Added.numBlob &&
+                ! memcmp(Merged.blobs, Added.blobs, Added.numBlob * sizeof(void *)),
+                "merging s/b match adding one at a time");
+    fail_unless(av_mergeSortedBlobArrays(&Merged, &Merged, cv_example_compare_by_seq_id) == AV_INPUT_ERROR,
+                "merging an array into itself s/b an error");
+    
+    av_freeSortedBlobArray(&Added);
+    av_freeSortedBlobArray(&Appended);
+    av_freeSortedBlobArray(&Merged);
+    av_freeSortedBlobArray(&Extra);
+    free(Examples);
+}
+END_TEST
+
 START_TEST(assign_folds)
 {
     CV_Class Class = {0};
@@ -480,6 +538,7 @@ Suite *crossval_util_suite(void)
     
     suite_add_tcase(suite, tc_blob_sorting);    
     tcase_add_test(tc_blob_sorting, comp_functions);
+    tcase_add_test(tc_blob_sorting, bulk_blob_sorting);
     
     suite_add_tcase(suite, tc_assign_folds);
     tcase_add_test(tc_assign_folds, assign_folds);
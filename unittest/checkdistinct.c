@@ -41,6 +41,7 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "../src/crossval.h"
 #include "../src/util.h"
 #include "../src/array.h"
+#include "../src/av_utils.h"
 #include "../src/distinct_values.h"
 
 
@@ -75,6 +76,27 @@ START_TEST(create_array)
 }
 END_TEST
 
+START_TEST(sort_unique)
+{
+    int num_unique;
+    float array[] = { 3, .31, 1.3, 2.3, 0.4, 3.9, 0.3, 1.3, 0.3, 4, -2, -0.5, 4, -2, 1e-30, -1e30 };
+    float truth[] = { -1e30, -2, -0.5, 1e-30, 0.3, 0.31, 0.4, 1.3, 2.3, 3, 3.9, 4 };
+    num_unique = sort_unique_floats(array, 16);
+    fail_unless(num_unique == 12, "should have 12 unique values");
+    fail_unless(! memcmp(array, truth, num_unique * sizeof(float)), "sorted array not correct");
+    
+    // Values that arrive in order are what made the binary tree slow
+    int i;
+    float *ordered_array = (float *)malloc(100000 * sizeof(float));
+    for (i = 0; i < 100000; i++)
+        ordered_array[i] = (float)(i / 2);
+    fail_unless(sort_unique_floats(ordered_array, 100000) == 50000, "should have 50000 unique values");
+    for (i = 0; i < 50000; i++)
+        fail_unless(ordered_array[i] == (float)i, "sorted array not correct");
+    free(ordered_array);
+}
+END_TEST
+
 START_TEST(check_translate_discrete)
 {
     char *map[] = { "zero", "one", "two", "three", "four", "five", "six" };
@@ -90,6 +112,39 @@ START_TEST(check_translate_discrete)
 }
 END_TEST
 
+START_TEST(check_translate_discrete_indexed)
+{
+    char *map[] = { "zero", "one", "two", "three", "four", "five", "six", "two" };
+    char *other[] = { "six", "five", "four", "three", "two", "one", "zero", "two" };
+    char label[16];
+    char *many[2000];
+    int i;
+    Discrete_Index *index = build_discrete_index(map, 8);
+    
+    for (i = 0; i < 7; i++)
+        fail_unless(translate_discrete_indexed(index, map, 8, map[i]) == i, "didn't translate '%s' to %d", map[i], i);
+    fail_unless(translate_discrete_indexed(index, map, 8, "seven") == -1, "didn't translate 'seven' to -1");
+    fail_unless(translate_discrete_indexed(index, map, 8, "") == -1, "didn't translate '' to -1");
+    // An index built for another map is ignored
+    fail_unless(translate_discrete_indexed(index, other, 8, "zero") == 6, "didn't fall back for another map");
+    fail_unless(translate_discrete_indexed(NULL, map, 8, "two") == 2, "didn't fall back without an index");
+    free_discrete_index(index);
+    
+    for (i = 0; i < 2000; i++) {
+        sprintf(label, "%d", i);
+        many[i] = av_strdup(label);
+    }
+    index = build_discrete_index(many, 2000);
+    fail_unless(index->num_slots >= 4000, "only %d slots for 2000 labels", index->num_slots);
+    for (i = 0; i < 2000; i++)
+        fail_unless(translate_discrete_indexed(index, many, 2000, many[i]) == i, "didn't translate '%s' to %d", many[i], i);
+    fail_unless(translate_discrete_indexed(index, many, 2000, "2000") == -1, "didn't translate '2000' to -1");
+    free_discrete_index(index);
+    for (i = 0; i < 2000; i++)
+        free(many[i]);
+}
+END_TEST
+
 Suite *distinct_suite(void)
 {
     Suite *suite = suite_create("DistinctValues");
@@ -99,9 +154,11 @@ Suite *distinct_suite(void)
     
     suite_add_tcase(suite, tc_create_array);
     tcase_add_test(tc_create_array, create_array);
+    tcase_add_test(tc_create_array, sort_unique);
     
     suite_add_tcase(suite, tc_translations);
     tcase_add_test(tc_create_array, check_translate_discrete);
+    tcase_add_test(tc_create_array, check_translate_discrete_indexed);
     
     return suite;
 }
@@ -119,6 +119,56 @@ START_TEST(check_PCDM)
 }
 END_TEST
 
+START_TEST(check_select_trees)
+{
+    int i, n;
+    int num_selected;
+    int best_tree = 0;
+    int *selected;
+    double accuracy[2];
+    Boolean *seen;
+    _read_data_and_trees_init_matrix();
+    selected = (int *)malloc(Ensemble.num_trees * sizeof(int));
+    seen = (Boolean *)calloc(Ensemble.num_trees, sizeof(Boolean));
+    
+    // No tolerance: the selected trees are at least as accurate as all of them
+    num_selected = select_trees(Ensemble.num_trees, Subset.meta.num_classes, Subset.meta.num_examples,
+                                result_matrix, NULL, 0.0, selected, accuracy, NULL);
+    fail_unless(num_selected >= 1 && num_selected <= Ensemble.num_trees, "wrong number of trees selected");
+    fail_unless(accuracy[1] >= accuracy[0], "selected trees are less accurate than the ensemble");
+    for (i = 0; i < num_selected; i++) {
+        fail_unless(selected[i] >= 0 && selected[i] < Ensemble.num_trees && ! seen[selected[i]],
+                    "tree selected twice");
+        seen[selected[i]] = TRUE;
+    }
+    
+    // Complete tolerance: the single most accurate tree
+    for (n = 1; n < Ensemble.num_trees; n++)
+        if (result_matrix[n+1][Subset.meta.num_examples] < result_matrix[best_tree+1][Subset.meta.num_examples])
+            best_tree = n;
+    num_selected = select_trees(Ensemble.num_trees, Subset.meta.num_classes, Subset.meta.num_examples,
+                                result_matrix, NULL, 1.0, selected, accuracy, NULL);
+    fail_unless(num_selected == 1 && selected[0] == best_tree, "most accurate tree not selected first");
+    fail_unless(av_eqf(accuracy[1], 1.0 - (double)result_matrix[best_tree+1][Subset.meta.num_examples] /
+                                          (double)Subset.meta.num_examples), "single tree accuracy incorrect");
+    
+    // Random tie-breaks: the tolerance holds for the accuracies avatardt would report
+    Args.break_ties_randomly = TRUE;
+    Args.random_seed = 1;
+    num_selected = select_trees(Ensemble.num_trees, Subset.meta.num_classes, Subset.meta.num_examples,
+                                result_matrix, NULL, 0.04, selected, accuracy, &Args);
+    fail_unless(av_eqf(accuracy[0], (double)count_voted_correct(Ensemble.num_trees, NULL, Subset.meta.num_classes,
+                                                                 Subset.meta.num_examples, result_matrix, Args) /
+                                    (double)Subset.meta.num_examples), "ensemble accuracy does not break ties as avatardt does");
+    fail_unless(av_eqf(accuracy[1], (double)count_voted_correct(num_selected, selected, Subset.meta.num_classes,
+                                                                 Subset.meta.num_examples, result_matrix, Args) /
+                                    (double)Subset.meta.num_examples), "pruned accuracy does not break ties as avatardt does");
+    fail_unless(accuracy[1] >= accuracy[0] - 0.04 - 1e-9, "selected trees are outside the tolerance");
+    free(selected);
+    free(seen);
+}
+END_TEST
+
 Suite *diversity_suite(void)
 {
     Suite *suite = suite_create("DiversityMeasures");
@@ -130,6 +180,7 @@ Suite *diversity_suite(void)
     tcase_add_test(tc_diversity_measures, check_Q);
     tcase_add_test(tc_diversity_measures, check_interrater);
     tcase_add_test(tc_diversity_measures, check_PCDM);
+    tcase_add_test(tc_diversity_measures, check_select_trees);
         
     return suite;
 }
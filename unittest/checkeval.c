@@ -36,12 +36,22 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include <string.h>
 #include <time.h>
 #include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "check.h"
 #include "checkall.h"
 #include "../src/crossval.h"
 #include "../src/evaluate.h"
 #include "../src/util.h"
 #include "../src/gain.h"
+#include "../src/lockstep.h"
+#include "../src/quickscorer.h"
+#include "../src/rw_data.h"
+#include "../src/tree.h"
+#include "../src/options.h"
+#include "../src/memory.h"
+#include "../src/mapped_input.h"
+#include "../src/test_stream.h"
 
 void _set_up(DT_Ensemble *ensemble, CV_Subset *data);
 void _set_up_matrix(CV_Matrix *truth_matrix);
@@ -609,6 +619,148 @@ START_TEST(check_best_class)
 }
 END_TEST
 
+START_TEST(check_lockstep_matrix)
+{
+    int i, j;
+    int leaf_node;
+    int isa;
+    DT_Ensemble ensemble = {0};
+    CV_Subset data = {0};
+    CV_Matrix matrix = {0};
+    
+    _set_up(&ensemble, &data);
+    
+    // Every kernel this CPU supports must agree with the recursive classifier
+    for (isa = LOCKSTEP_SCALAR; isa <= lockstep_best_isa(); isa++) {
+        int num_errors = 0;
+        lockstep_build_prediction_matrix(data, ensemble, &matrix, (Lockstep_ISA)isa);
+        for (i = 0; i < data.meta.num_examples; i++) {
+            if (matrix.data[i][0].Integer != data.examples[i].containing_class_num)
+                num_errors++;
+            for (j = 0; j < ensemble.num_trees; j++)
+                if (matrix.data[i][j+1].Integer != classify_example(ensemble.Trees[j], data.examples[i], data.float_data, &leaf_node))
+                    num_errors++;
+        }
+        fail_unless(num_errors == 0, "lockstep matrix does not match classify_example");
+        _clean_up_matrix(&matrix);
+    }
+    
+    _clean_up(&ensemble, data);
+}
+END_TEST
+
+START_TEST(check_quickscorer_matrix)
+{
+    int i, j;
+    int leaf_node;
+    int num_errors = 0;
+    DT_Ensemble ensemble = {0};
+    CV_Subset data = {0};
+    CV_Matrix matrix = {0};
+    QuickScorer qs;
+    
+    _set_up(&ensemble, &data);
+    
+    quickscorer_build_prediction_matrix(data, ensemble, &matrix);
+    for (i = 0; i < data.meta.num_examples; i++)
+        for (j = 0; j < ensemble.num_trees; j++)
+            if (matrix.data[i][j+1].Integer != classify_example(ensemble.Trees[j], data.examples[i], data.float_data, &leaf_node))
+                num_errors++;
+    fail_unless(num_errors == 0, "QuickScorer matrix does not match classify_example");
+    
+    // Leaves are numbered left to right so tree 0 has leaves at nodes 3, 4, 5, 7, 8
+    quickscorer_build(ensemble, &qs);
+    fail_unless(qs.num_leaves[0] == 5, "wrong number of leaves in tree 0");
+    fail_unless(qs.leaf_nodes[0][0] == 3 && qs.leaf_nodes[0][2] == 5 && qs.leaf_nodes[0][4] == 8,
+                "leaves of tree 0 are not numbered left to right");
+    for (i = 1; i < qs.num_conditions[2]; i++)
+        fail_unless(qs.conditions[2][i-1].threshold <= qs.conditions[2][i].threshold, "splits are not sorted by threshold");
+    quickscorer_free(&qs);
+    
+    _clean_up(&ensemble, data);
+    _clean_up_matrix(&matrix);
+}
+END_TEST
+
+START_TEST(check_early_exit_matrix)
+{
+    int i;
+    DT_Ensemble ensemble = {0};
+    CV_Subset data = {0};
+    CV_Matrix matrix = {0}, early = {0};
+    Args_Opts args = {0};
+    long num_saved;
+    
+    _set_up(&ensemble, &data);
+    args.break_ties_randomly = FALSE;
+    
+    build_prediction_matrix(data, ensemble, &matrix);
+    num_saved = build_early_exit_prediction_matrix(data, ensemble, &early);
+    // Examples 0, 2, 3, 5, and 6 get the same vote from the first two trees so the third is not needed
+    fail_unless(num_saved == 5, "wrong number of skipped tree evaluations");
+    fail_unless(early.num_examples == matrix.num_examples && early.num_classifiers == matrix.num_classifiers,
+                "early exit matrix has the wrong size");
+    for (i = 0; i < matrix.num_examples; i++)
+        fail_unless(find_best_class_from_matrix(i, early, args, i, 0) == find_best_class_from_matrix(i, matrix, args, i, 0),
+                    "early exit voting changed the voted class");
+    
+    // With only two trees, nothing can be decided before the last tree
+    ensemble.num_trees = 2;
+    _clean_up_matrix(&early);
+    num_saved = build_early_exit_prediction_matrix(data, ensemble, &early);
+    fail_unless(num_saved == 0, "skipped tree evaluations that could change the vote");
+    ensemble.num_trees = 3;
+    
+    _clean_up(&ensemble, data);
+    _clean_up_matrix(&matrix);
+    _clean_up_matrix(&early);
+}
+END_TEST
+
+START_TEST(check_best_class_reentrant)
+{
+    int i;
+    int first[10], second[10];
+    CV_Matrix matrix = {0};
+    Args_Opts args = {0};
+    struct ParkMiller *rng_a = NULL, *rng_b = NULL, *rng_c = NULL;
+    long seed_a, seed_b, seed_c;
+    
+    // Every example gets one vote for each class so every one is a tie
+    matrix.num_examples = 10;
+    matrix.num_classifiers = 2;
+    matrix.additional_cols = 1;
+    matrix.num_classes = 2;
+    matrix.data = (union data_type_union **)malloc(matrix.num_examples * sizeof(union data_type_union *));
+    for (i = 0; i < matrix.num_examples; i++) {
+        matrix.data[i] = (union data_type_union *)malloc(3 * sizeof(union data_type_union));
+        matrix.data[i][0].Integer = 0;
+        matrix.data[i][1].Integer = 0;
+        matrix.data[i][2].Integer = 1;
+    }
+    args.break_ties_randomly = TRUE;
+    args.random_seed = 7;
+    
+    for (i = 0; i < matrix.num_examples; i++)
+        first[i] = find_best_class_from_matrix_r(i, matrix, args, i, &rng_a, &seed_a);
+    // Interleaving two callers must not change either one's sequence
+    for (i = 0; i < matrix.num_examples; i++) {
+        second[i] = find_best_class_from_matrix_r(i, matrix, args, i, &rng_b, &seed_b);
+        fail_unless(find_best_class_from_matrix_r(i, matrix, args, i, &rng_c, &seed_c) == first[i],
+                    "interleaved tie breaking changed the winner of example %d", i);
+    }
+    for (i = 0; i < matrix.num_examples; i++)
+        fail_unless(second[i] == first[i], "tie breaking is not reproducible for example %d", i);
+    
+    free(rng_a);
+    free(rng_b);
+    free(rng_c);
+    for (i = 0; i < matrix.num_examples; i++)
+        free(matrix.data[i]);
+    free(matrix.data);
+}
+END_TEST
+
 START_TEST(check_count_votes)
 {
     DT_Ensemble ensemble = {0};
@@ -640,6 +792,111 @@ START_TEST(check_count_votes)
 }
 END_TEST
 
+/*
+ * Runs diversity_test through test(), or through test_stream() if batch_size > 0, and returns
+ * what it printed and the .pred file it wrote
+ */
+static void _run_stream_test(int batch_size, char **printed, char **predictions) {
+    int fd, saved_stdout;
+    FC_Dataset ds = {0};
+    CV_Dataset dataset = {0};
+    CV_Subset subset = {0};
+    CV_Class class = {0};
+    CV_Overall_Confusion overall = {0};
+    CV_Matrix m = {0};
+    DT_Ensemble ensemble = {0};
+    AV_SortedBlobArray sorted_examples = {0};
+    Args_Opts args;
+    Input_Text in;
+    
+    memset(&args, 0, sizeof(Args_Opts));
+    init_default_opts(&args);
+    args.caller = AVATARDT_CALLER;
+    args.format = AVATAR_FORMAT;
+    args.base_filestem = av_strdup("diversity_test");
+    args.data_path = av_strdup("./data");
+    args.truth_column = 5;
+    args.save_trees = TRUE;
+    args.do_testing = TRUE;
+    args.output_probabilities = TRUE;
+    args.output_predictions = TRUE;
+    args.output_accuracies = ON;
+    args.output_confusion_matrix = TRUE;
+    args.test_batch_size = batch_size;
+    set_output_filenames(&args, TRUE, TRUE);
+    free(args.test_file);
+    args.test_file = av_strdup("./data/stream_test.test");
+    
+    // Each run breaks ties from the start of the seeded stream
+    find_best_class_from_matrix(0, m, args, 0, 1);
+    fflush(stdout);
+    saved_stdout = dup(1);
+    fd = open("./data/stream_test.out", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(fd, 1);
+    close(fd);
+    if (batch_size > 0) {
+        read_names_file(&dataset.meta, &class, &args, TRUE);
+        read_ensemble(&ensemble, -1, 0, &args);
+        test_stream(&dataset, &class, dataset.meta, ensemble, args);
+        free_CV_Class(class);
+    } else {
+        av_exitIfError(av_initSortedBlobArray(&sorted_examples));
+        read_testing_data(&ds, dataset.meta, &dataset, &subset, &sorted_examples, &args);
+        read_ensemble(&ensemble, -1, 0, &args);
+        test(subset, 1, &ensemble, ds, -1, args, &overall);
+        free_CV_Subset(&subset, args, TEST_MODE);
+        av_freeSortedBlobArray(&sorted_examples);
+    }
+    fflush(stdout);
+    dup2(saved_stdout, 1);
+    close(saved_stdout);
+    free_DT_Ensemble(ensemble, TEST_MODE);
+    
+    fail_unless(open_input_text("./data/stream_test.out", NULL, FALSE, FALSE, &in) == 1, "nothing was printed");
+    *printed = av_strdup(in.text);
+    close_input_text(&in);
+    fail_unless(open_input_text(args.predictions_file, NULL, FALSE, FALSE, &in) == 1, "no .pred file was written");
+    *predictions = av_strdup(in.text);
+    close_input_text(&in);
+    remove(args.predictions_file);
+    remove("./data/stream_test.out");
+}
+
+START_TEST(check_test_stream)
+{
+    int i;
+    int batch_sizes[] = { 7, 50, 1000 };
+    char *printed, *predictions, *batch_printed, *batch_predictions, *pos;
+    Input_Text in;
+    FILE *fh;
+    
+    // The test data with no newline after the last line, which must still be tested and written
+    fail_unless(open_input_text("./data/diversity_test.test", NULL, FALSE, FALSE, &in) == 1, "can't read diversity_test.test");
+    fh = fopen("./data/stream_test.test", "w");
+    fwrite(in.text, 1, in.length - 1, fh);
+    fclose(fh);
+    close_input_text(&in);
+    
+    _run_stream_test(0, &printed, &predictions);
+    fail_unless(strstr(printed, "Voted Accuracy") != NULL, "test() did not print the accuracy");
+    // The labels line and one line for each of the 50 examples
+    for (i = 0, pos = predictions; (pos = strchr(pos, '\n')) != NULL; i++, pos++);
+    fail_unless(i == 51, "the .pred file has %d lines instead of 51", i);
+    // 50 rows of 50 has no batch that ends early, 7 leaves a short last batch
+    for (i = 0; i < 3; i++) {
+        _run_stream_test(batch_sizes[i], &batch_printed, &batch_predictions);
+        fail_unless(! strcmp(batch_printed, printed), "batches of %d printed\n%s\ninstead of\n%s",
+                    batch_sizes[i], batch_printed, printed);
+        fail_unless(! strcmp(batch_predictions, predictions), "batches of %d wrote a different .pred file", batch_sizes[i]);
+        free(batch_printed);
+        free(batch_predictions);
+    }
+    free(printed);
+    free(predictions);
+    remove("./data/stream_test.test");
+}
+END_TEST
+
 Suite *eval_suite(void)
 {
     Suite *suite = suite_create("Evaluate");
@@ -655,8 +912,13 @@ Suite *eval_suite(void)
     tcase_add_test(tc_matrix, check_accuracies);
     //tcase_add_test(tc_matrix, check_best_class);
     tcase_add_test(tc_matrix, check_count_votes);
+    tcase_add_test(tc_matrix, check_best_class_reentrant);
+    tcase_add_test(tc_matrix, check_early_exit_matrix);
+    tcase_add_test(tc_matrix, check_lockstep_matrix);
+    tcase_add_test(tc_matrix, check_quickscorer_matrix);
     tcase_add_test(tc_matrix, run_build_boost_matrix);
     tcase_add_test(tc_matrix, check_boost_accuracies);
+    tcase_add_test(tc_matrix, check_test_stream);
     
     return suite;
 }
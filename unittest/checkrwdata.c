@@ -214,6 +214,65 @@ START_TEST(names_file_test)
 END_TEST
 
 
+START_TEST(check_binary_data)
+{
+    int i, j;
+    int pass;
+    CV_Dataset dataset[2] = {{{0}}};
+    CV_Subset data[2] = {{{0}}};
+    AV_SortedBlobArray blob[2];
+    Args_Opts args[2];
+    
+    // The first read parses the text and saves the cache, the second loads the cache
+    remove("./data/smote_5d.data.avbin");
+    for (pass = 0; pass < 2; pass++) {
+        memset(&args[pass], 0, sizeof(Args_Opts));
+        args[pass].format = AVATAR_FORMAT;
+        args[pass].datafile = strdup("./data/smote_5d.data");
+        args[pass].base_filestem = strdup("smote_5d");
+        args[pass].data_path = strdup("./data");
+        args[pass].names_file = strdup("./data/smote_5d.names");
+        args[pass].do_training = TRUE;
+        args[pass].truth_column = 6;
+        args[pass].exclude_all_features_above = -1;
+        args[pass].data_cache = TRUE;
+        read_training_data(NULL, &dataset[pass], &data[pass], &blob[pass], &args[pass]);
+        FILE *fh = fopen("./data/smote_5d.data.avbin", "r");
+        fail_unless(fh != NULL, "The dataset cache was not written");
+        fclose(fh);
+    }
+    
+    fail_unless(data[0].meta.num_examples == data[1].meta.num_examples && data[0].meta.num_examples > 0,
+                "Cached data has %d examples but s/b %d", data[1].meta.num_examples, data[0].meta.num_examples);
+    fail_unless(blob[1].numBlob == blob[0].numBlob, "Cached data s/b in the SortedBlobArray");
+    for (i = 0; i < data[0].meta.num_classes; i++)
+        fail_unless(data[0].meta.num_examples_per_class[i] == data[1].meta.num_examples_per_class[i],
+                    "Class %d has %d examples but s/b %d", i,
+                    data[1].meta.num_examples_per_class[i], data[0].meta.num_examples_per_class[i]);
+    for (j = 0; j < data[0].meta.num_attributes; j++) {
+        fail_unless(data[0].high[j] == data[1].high[j] && data[1].low[j] == 0, "high/low differ for attribute %d", j);
+        if (data[0].meta.attribute_types[j] == CONTINUOUS) {
+            fail_unless(! memcmp(data[0].float_data[j], data[1].float_data[j], (data[0].high[j] + 1) * sizeof(float)),
+                        "float_data differs for attribute %d", j);
+            fail_unless(data[0].meta.Missing[j].Continuous == data[1].meta.Missing[j].Continuous,
+                        "Missing value differs for attribute %d", j);
+        } else {
+            fail_unless(data[0].meta.Missing[j].Discrete == data[1].meta.Missing[j].Discrete,
+                        "Missing value differs for attribute %d", j);
+        }
+    }
+    for (i = 0; i < data[0].meta.num_examples; i++) {
+        fail_unless(data[0].examples[i].containing_class_num == data[1].examples[i].containing_class_num &&
+                    data[0].examples[i].global_id_num == data[1].examples[i].global_id_num,
+                    "Example %d differs", i);
+        fail_unless(! memcmp(data[0].examples[i].distinct_attribute_values, data[1].examples[i].distinct_attribute_values,
+                             data[0].meta.num_attributes * sizeof(int)), "Values differ for example %d", i);
+    }
+    remove("./data/smote_5d.data.avbin");
+}
+END_TEST
+
+
 START_TEST(test_file_test)
 {
     AV_SortedBlobArray file_Sorted_Examples;
@@ -340,6 +399,10 @@ Suite *rwdata_suite(void)
     tcase_add_test(tc_loaddataset, load_dataset);
 #endif
 
+    TCase *tc_binarydata = tcase_create(" Binary Data ");
+    suite_add_tcase(suite, tc_binarydata);
+    tcase_add_test(tc_binarydata, check_binary_data);
+
     suite_add_tcase(suite, tc_stringinput);
     tcase_add_test(tc_stringinput, names_file_test);
     tcase_add_test(tc_stringinput, test_file_test);
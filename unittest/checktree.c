@@ -33,11 +33,18 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 For questions, comments or contributions contact 
 Philip Kegelmeyer, wpk@sandia.gov 
 *******************************************************************************/
+#include <string.h>
 #include <math.h>
 #include "check.h"
 #include "checkall.h"
 #include "../src/crossval.h"
 #include "../src/tree.h"
+#include "../src/options.h"
+#include "../src/memory.h"
+#include "../src/reset.h"
+#include "../src/binary_trees.h"
+#include "../src/text_trees.h"
+#include "../src/lazy_trees.h"
 
 START_TEST(check_is_pure)
 {
@@ -87,6 +94,283 @@ START_TEST(check_find_best_class)
 }
 END_TEST
 
+START_TEST(check_ensemble_num_trees)
+{
+    int skipped[2] = {4, 7};
+    DT_Ensemble ensemble;
+    Args_Opts args = process_opts(0, NULL);
+    reset_DT_Ensemble(&ensemble);
+    
+    args.trees_file = "./data/diversity_test.trees";
+    args.num_skipped_features = 2;
+    args.skipped_features = skipped;
+    // The caller's skipped features must survive reading the metadata
+    int num_trees = read_ensemble_num_trees(-1, args);
+    fail_unless(args.skipped_features == skipped && skipped[0] == 4 && skipped[1] == 7,
+                "read_ensemble_num_trees changed the skipped features");
+    
+    args.skipped_features = NULL;
+    read_ensemble(&ensemble, -1, 0, &args);
+    fail_unless(num_trees == ensemble.num_trees, "Expected %d trees but got %d", ensemble.num_trees, num_trees);
+    free(args.skipped_features);
+    free_DT_Ensemble(ensemble, TEST_MODE);
+}
+END_TEST
+
+START_TEST(check_binary_trees)
+{
+    int i, j, k;
+    FILE *fh;
+    DT_Ensemble text, binary;
+    Args_Opts args = process_opts(0, NULL);
+    reset_DT_Ensemble(&text);
+    reset_DT_Ensemble(&binary);
+    
+    // Convert a text ensemble with DISCRETE and CONTINUOUS splits and read it back
+    args.trees_file = "./data/diversity_test.trees";
+    read_ensemble(&text, -1, 0, &args);
+    fail_unless((fh = fopen("./data/.binary_test.trees", "w")) != NULL, "Could not write binary ensemble");
+    write_binary_ensemble_header(fh, text, args);
+    for (i = 0; i < text.num_trees; i++)
+        save_binary_tree(fh, text.Trees[i], i+1, 0.0, text.num_classes);
+    fclose(fh);
+    args.trees_file = "./data/.binary_test.trees";
+    read_ensemble(&binary, -1, 0, &args);
+    remove(args.trees_file);
+    
+    fail_unless(binary.mapped_trees != NULL, "Binary ensemble should be mapped");
+    fail_unless(binary.num_trees == 10 && binary.num_classes == 5 && binary.num_attributes == 9,
+                "Wrong metadata: %d trees, %d classes, %d attributes", binary.num_trees, binary.num_classes, binary.num_attributes);
+    fail_unless(binary.num_training_examples == text.num_training_examples, "Wrong number of training examples");
+    for (j = 0; j < text.num_classes; j++)
+        fail_unless(binary.num_training_examples_per_class[j] == text.num_training_examples_per_class[j],
+                    "Wrong number of examples for class %d", j);
+    for (j = 0; j < text.num_attributes; j++) {
+        fail_unless(binary.attribute_types[j] == text.attribute_types[j], "Wrong type for attribute %d", j);
+        fail_unless(! memcmp(&binary.Missing[j], &text.Missing[j], sizeof(union data_point_union)),
+                    "Wrong missing value for attribute %d", j);
+        if (text.attribute_types[j] == DISCRETE)
+            fail_unless(binary.missing_names[j] != NULL && ! strcmp(binary.missing_names[j], text.missing_names[j]),
+                        "Attribute %d should be missing '%s' but is missing '%s'", j, text.missing_names[j],
+                        binary.missing_names[j] != NULL ? binary.missing_names[j] : "(null)");
+        else
+            fail_unless(binary.missing_names[j] == NULL, "Continuous attribute %d has a missing value name", j);
+    }
+    for (i = 0; i < text.num_trees; i++) {
+        fail_unless(binary.Books[i].next_unused_node == text.Books[i].next_unused_node,
+                    "Tree %d has %d nodes but should have %d", i, binary.Books[i].next_unused_node, text.Books[i].next_unused_node);
+        for (j = 0; j < text.Books[i].next_unused_node; j++) {
+            DT_Node *a = &text.Trees[i][j];
+            DT_Node *b = &binary.Trees[i][j];
+            fail_unless(a->branch_type == b->branch_type, "Tree %d node %d has the wrong branch type", i, j);
+            if (a->branch_type == LEAF) {
+                fail_unless(a->Node_Value.class_label == b->Node_Value.class_label, "Tree %d node %d has the wrong class", i, j);
+                for (k = 0; k < text.num_classes; k++) {
+                    fail_unless(a->class_count[k] == b->class_count[k], "Tree %d node %d has the wrong counts", i, j);
+                    fail_unless(a->class_probs[k] == b->class_probs[k], "Tree %d node %d has the wrong probabilities", i, j);
+                }
+            } else {
+                fail_unless(a->attribute_type == b->attribute_type && a->attribute == b->attribute &&
+                            a->num_branches == b->num_branches, "Tree %d node %d has the wrong split", i, j);
+                if (a->attribute_type == CONTINUOUS)
+                    fail_unless(a->branch_threshold == b->branch_threshold, "Tree %d node %d has the wrong threshold", i, j);
+                for (k = 0; k < a->num_branches; k++)
+                    fail_unless(a->Node_Value.branch[k] == b->Node_Value.branch[k], "Tree %d node %d has the wrong children", i, j);
+            }
+        }
+    }
+    
+    free_DT_Ensemble(text, TEST_MODE);
+    free_DT_Ensemble(binary, TEST_MODE);
+}
+END_TEST
+
+START_TEST(check_text_trees)
+{
+    int i;
+    DT_Ensemble ensemble;
+    Args_Opts args = process_opts(0, NULL);
+    const char *text =
+        "# Comments can appear anywhere\n"
+        "Tree 1\n"
+        "SPLIT CONTINUOUS ATT# 0 < 2.50000\n"
+        "LEAF Class 0 Proportions 3 1\n"
+        "# Inside a tree too\n"
+        "SPLIT CONTINUOUS ATT# 0 >= 2.50000\n"
+        "SPLIT DISCRETE ATT# 1 VAL# 1 / 3\n"
+        "LEAF 1\n"
+        "SPLIT DISCRETE ATT# 1 VAL# 2 / 3\n"
+        "LEAF Class 1 Proportions 0 5\n"
+        "SPLIT DISCRETE ATT# 1 VAL# 3 / 3\n"
+        "LEAF Class 0 Proportions 2 0\n"
+        "Tree 2\n"
+        "  SPLIT CONTINUOUS ATT# 2 < -1.23457e-05\n"
+        "  LEAF Class 1 Proportions 1 2\n"
+        "  SPLIT CONTINUOUS ATT# 2 >= -1.23457e-05\n"
+        "  LEAF Class 0 Proportions 4 0\n";
+    reset_DT_Ensemble(&ensemble);
+    ensemble.num_trees = 2;
+    ensemble.num_classes = 2;
+    ensemble.Trees = (DT_Node **)malloc(ensemble.num_trees * sizeof(DT_Node *));
+    ensemble.Books = (Tree_Bookkeeping *)malloc(ensemble.num_trees * sizeof(Tree_Bookkeeping));
+    read_text_trees(text, strlen(text), &ensemble, &args);
+    
+    fail_unless(ensemble.num_trees == 2, "Read %d trees instead of 2", ensemble.num_trees);
+    fail_unless(ensemble.boosting_betas == NULL && args.do_boosting == FALSE, "Trees without betas are not boosted");
+    
+    // Nodes are numbered in the order they appear in the file
+    fail_unless(ensemble.Books[0].next_unused_node == 6 && ensemble.Books[0].num_malloced_nodes == 8,
+                "Tree 1 has %d nodes in %d slots", ensemble.Books[0].next_unused_node, ensemble.Books[0].num_malloced_nodes);
+    fail_unless(ensemble.Trees[0][0].branch_type == BRANCH && ensemble.Trees[0][0].attribute_type == CONTINUOUS &&
+                ensemble.Trees[0][0].attribute == 0 && ensemble.Trees[0][0].branch_threshold == 2.5, "Wrong root for tree 1");
+    fail_unless(ensemble.Trees[0][0].Node_Value.branch[0] == 1 && ensemble.Trees[0][0].Node_Value.branch[1] == 2,
+                "Wrong children for the root of tree 1");
+    fail_unless(ensemble.Trees[0][1].branch_type == LEAF && ensemble.Trees[0][1].Node_Value.class_label == 0 &&
+                ensemble.Trees[0][1].class_count[0] == 3 && ensemble.Trees[0][1].class_count[1] == 1, "Wrong leaf at node 1");
+    fail_unless(ensemble.Trees[0][1].class_probs[0] == (float)(4.0/6.0) && ensemble.Trees[0][1].class_probs[1] == (float)(2.0/6.0),
+                "Leaf probabilities should be Laplacean estimates");
+    fail_unless(ensemble.Trees[0][2].attribute_type == DISCRETE && ensemble.Trees[0][2].attribute == 1 &&
+                ensemble.Trees[0][2].num_branches == 3, "Wrong discrete split at node 2");
+    for (i = 0; i < 3; i++)
+        fail_unless(ensemble.Trees[0][2].Node_Value.branch[i] == 3 + i, "Wrong child %d for node 2", i);
+    // A leaf with only a class has no counts
+    fail_unless(ensemble.Trees[0][3].Node_Value.class_label == 1 && ensemble.Trees[0][3].class_count[0] == -1 &&
+                ensemble.Trees[0][3].class_probs[0] == 0.0 && ensemble.Trees[0][3].class_probs[1] == 1.0, "Wrong leaf at node 3");
+    
+    fail_unless(ensemble.Books[1].next_unused_node == 3 && ensemble.Books[1].current_node == 2, "Wrong bookkeeping for tree 2");
+    fail_unless(ensemble.Trees[1][0].attribute == 2 && ensemble.Trees[1][0].branch_threshold == (float)atof("-1.23457e-05"),
+                "Wrong threshold for tree 2");
+    fail_unless(ensemble.Trees[1][2].class_count[0] == 4, "Wrong leaf for tree 2");
+    
+    free_DT_Ensemble(ensemble, TEST_MODE);
+}
+END_TEST
+
+START_TEST(check_lazy_trees)
+{
+    int i, j, k, num_loaded;
+    DT_Ensemble eager, lazy;
+    DT_Node *tree;
+    Args_Opts args = process_opts(0, NULL);
+    reset_DT_Ensemble(&eager);
+    reset_DT_Ensemble(&lazy);
+    
+    args.trees_file = "./data/diversity_test.trees";
+    read_ensemble(&eager, -1, 0, &args);
+    // A one byte budget keeps only the tree asked for
+    read_lazy_ensemble(&lazy, -1, 0, 1, &args);
+    
+    fail_unless(lazy.num_trees == eager.num_trees && lazy.num_classes == eager.num_classes &&
+                lazy.num_attributes == eager.num_attributes, "Wrong metadata");
+    for (i = 0; i < lazy.num_trees; i++)
+        fail_unless(lazy.Trees[i] == NULL, "Tree %d should not be loaded yet", i);
+    
+    // Go backwards so every tree is loaded after the index is built
+    for (i = lazy.num_trees - 1; i >= 0; i--) {
+        tree = ensemble_tree(lazy, i);
+        fail_unless(lazy.Books[i].next_unused_node == eager.Books[i].next_unused_node,
+                    "Tree %d has %d nodes but should have %d", i, lazy.Books[i].next_unused_node, eager.Books[i].next_unused_node);
+        for (j = 0; j < eager.Books[i].next_unused_node; j++) {
+            DT_Node *a = &eager.Trees[i][j];
+            DT_Node *b = &tree[j];
+            fail_unless(a->branch_type == b->branch_type, "Tree %d node %d has the wrong branch type", i, j);
+            if (a->branch_type == LEAF) {
+                for (k = 0; k < eager.num_classes; k++)
+                    fail_unless(a->class_probs[k] == b->class_probs[k], "Tree %d node %d has the wrong probabilities", i, j);
+            } else {
+                fail_unless(a->attribute_type == b->attribute_type && a->attribute == b->attribute &&
+                            a->num_branches == b->num_branches, "Tree %d node %d has the wrong split", i, j);
+                if (a->attribute_type == CONTINUOUS)
+                    fail_unless(a->branch_threshold == b->branch_threshold, "Tree %d node %d has the wrong threshold", i, j);
+                for (k = 0; k < a->num_branches; k++)
+                    fail_unless(a->Node_Value.branch[k] == b->Node_Value.branch[k], "Tree %d node %d has the wrong children", i, j);
+            }
+        }
+        num_loaded = 0;
+        for (j = 0; j < lazy.num_trees; j++)
+            if (lazy.Trees[j] != NULL)
+                num_loaded++;
+        fail_unless(num_loaded == 1, "%d trees are loaded but the budget only allows 1", num_loaded);
+    }
+    
+    free_DT_Ensemble(eager, TEST_MODE);
+    free_DT_Ensemble(lazy, TEST_MODE);
+}
+END_TEST
+
+static Boolean _same_file(const char *a, const char *b) {
+    int ca, cb;
+    FILE *fa = fopen(a, "r");
+    FILE *fb = fopen(b, "r");
+    if (fa == NULL || fb == NULL)
+        return FALSE;
+    do {
+        ca = fgetc(fa);
+        cb = fgetc(fb);
+    } while (ca == cb && ca != EOF);
+    fclose(fa);
+    fclose(fb);
+    return ca == cb ? TRUE : FALSE;
+}
+
+START_TEST(check_tree_stream)
+{
+    int i, j, format;
+    char *zero = "0";
+    char **zero_map = &zero;
+    Tree_Stream stream;
+    CV_Metadata meta;
+    DT_Ensemble ensemble;
+    Args_Opts args = process_opts(0, NULL);
+    reset_DT_Ensemble(&ensemble);
+    
+    args.trees_file = "./data/diversity_test.trees";
+    args.oob_file = "./data/.stream_test.oob";
+    read_ensemble(&ensemble, -1, 0, &args);
+    // Only the bytes matter so every missing value is the first value
+    meta.num_examples = ensemble.num_training_examples;
+    meta.num_classes = ensemble.num_classes;
+    meta.num_attributes = ensemble.num_attributes;
+    meta.num_examples_per_class = ensemble.num_training_examples_per_class;
+    meta.attribute_types = ensemble.attribute_types;
+    meta.Missing = (union data_point_union *)calloc(meta.num_attributes, sizeof(union data_point_union));
+    meta.discrete_attribute_map = (char ***)malloc(meta.num_attributes * sizeof(char **));
+    for (j = 0; j < meta.num_attributes; j++)
+        meta.discrete_attribute_map[j] = zero_map;
+    
+    for (format = 0; format < 2; format++) {
+        args.binary_trees = format == 1 ? TRUE : FALSE;
+        // A known number of trees and the stopping algorithm keeping the first 7 of 10
+        for (i = 0; i < 2; i++) {
+            int num_kept = i == 0 ? ensemble.num_trees : 7;
+            args.trees_file = "./data/.stream_test.trees";
+            begin_tree_stream(&stream, i == 0 ? ensemble.num_trees : 0, meta, -1, args);
+            for (j = 0; j < ensemble.num_trees; j++)
+                stream_tree(&stream, ensemble.Trees[j], 0.0, args, ensemble.num_classes);
+            end_tree_stream(&stream, num_kept);
+            fail_unless(fopen("./data/.stream_test.trees.tmp", "r") == NULL &&
+                        fopen("./data/.stream_test.trees.body", "r") == NULL, "Temporary files were left behind");
+            
+            args.trees_file = "./data/.saved_test.trees";
+            int num_trees = ensemble.num_trees;
+            ensemble.num_trees = num_kept;
+            save_ensemble(ensemble, meta, -1, args, ensemble.num_classes);
+            ensemble.num_trees = num_trees;
+            
+            fail_unless(_same_file("./data/.stream_test.trees", "./data/.saved_test.trees"),
+                        "Streaming %d of %d %s trees should write the same file as save_ensemble",
+                        num_kept, ensemble.num_trees, format == 1 ? "binary" : "text");
+            remove("./data/.stream_test.trees");
+            remove("./data/.saved_test.trees");
+        }
+    }
+    
+    free(meta.Missing);
+    free(meta.discrete_attribute_map);
+    free_DT_Ensemble(ensemble, TEST_MODE);
+}
+END_TEST
+
 Suite *tree_suite(void)
 {
     Suite *suite = suite_create("Tree");
@@ -95,6 +379,23 @@ Suite *tree_suite(void)
     suite_add_tcase(suite, tc_tree_utils);
     tcase_add_test(tc_tree_utils, check_is_pure);
     tcase_add_test(tc_tree_utils, check_find_best_class);
+    tcase_add_test(tc_tree_utils, check_ensemble_num_trees);
+    
+    TCase *tc_binary_trees = tcase_create(" Check BinaryTrees ");
+    suite_add_tcase(suite, tc_binary_trees);
+    tcase_add_test(tc_binary_trees, check_binary_trees);
+    
+    TCase *tc_text_trees = tcase_create(" Check TextTrees ");
+    suite_add_tcase(suite, tc_text_trees);
+    tcase_add_test(tc_text_trees, check_text_trees);
+    
+    TCase *tc_lazy_trees = tcase_create(" Check LazyTrees ");
+    suite_add_tcase(suite, tc_lazy_trees);
+    tcase_add_test(tc_lazy_trees, check_lazy_trees);
+    
+    TCase *tc_tree_stream = tcase_create(" Check TreeStream ");
+    suite_add_tcase(suite, tc_tree_stream);
+    tcase_add_test(tc_tree_stream, check_tree_stream);
     
     return suite;
 }
@@ -39,6 +39,10 @@ Philip Kegelmeyer, wpk@sandia.gov
 #include "check.h"
 #include "checkall.h"
 #include "../src/util.h"
+#include "../src/crossval.h"
+#include "../src/mapped_input.h"
+#include "../src/memory.h"
+#include "../src/out_of_core.h"
 
 
 START_TEST(test_factorial)
@@ -95,6 +99,167 @@ START_TEST(test_num_digits)
 }
 END_TEST
 
+START_TEST(test_fast_atof)
+{
+    int i;
+    char str[64];
+    char *values[] = { "0", "-0", "1", "-1.5", "+2.25", "0.1", ".5", "5.", "3.14159265358979",
+                       "1e10", "1E-5", "-2.5e+3", "0.000123456789", "123456789012345678",
+                       "12345678901234567890123", "9007199254740993", "1e23", "1e-30", "1e400",
+                       "0x1p3", "inf", "-nan", "1e", "1.5x", "", ".", "-", "00012.500" };
+    
+    for (i = 0; i < sizeof(values)/sizeof(values[0]); i++) {
+        double expected = atof(values[i]);
+        double got = fast_atof(values[i]);
+        if (expected != expected)
+            fail_unless(got != got, "fast_atof(\"%s\") s/b nan", values[i]);
+        else
+            fail_unless(! memcmp(&got, &expected, sizeof(double)),
+                        "fast_atof(\"%s\") s/b %.17g but got %.17g", values[i], expected, got);
+    }
+    
+    // Random values with varying numbers of digits and exponents
+    srand(1);
+    for (i = 0; i < 100000; i++) {
+        double expected, got;
+        switch (i % 3) {
+            case 0: sprintf(str, "%.*f", rand() % 12, (rand() - RAND_MAX/2) / (double)(rand() % 100000 + 1)); break;
+            case 1: sprintf(str, "%.*e", rand() % 18, (double)rand() * (rand() % 2 ? 1e-20 : 1e10)); break;
+            case 2: sprintf(str, "%d.%d", rand() % 100000, rand()); break;
+        }
+        expected = atof(str);
+        got = fast_atof(str);
+        fail_unless(! memcmp(&got, &expected, sizeof(double)),
+                    "fast_atof(\"%s\") s/b %.17g but got %.17g", str, expected, got);
+    }
+}
+END_TEST
+
+START_TEST(test_next_input_line)
+{
+    int i;
+    char text[] = "first\r\n\nthird line\n\r\nlast";
+    char *expected[] = { "first", "", "third line", "", "last" };
+    char *line, *pos;
+    Input_Text in;
+    
+    fail_unless(open_input_text(NULL, text, TRUE, TRUE, &in) == 1, "open_input_text failed on a string");
+    fail_unless(in.text != text, "a writable view of a string s/b a copy");
+    fail_unless(in.length == strlen(text), "length s/b %d but got %d", (int)strlen(text), (int)in.length);
+    pos = in.text;
+    for (i = 0; (line = next_input_line(&in, &pos)) != NULL; i++) {
+        fail_unless(i < 5, "too many lines");
+        fail_unless(! strcmp(line, expected[i]), "line %d s/b '%s' but got '%s'", i, expected[i], line);
+    }
+    fail_unless(i == 5, "number of lines s/b 5 but got %d", i);
+    fail_unless(! strcmp(text, "first\r\n\nthird line\n\r\nlast"), "the string s/b unchanged");
+    close_input_text(&in);
+    fail_unless(in.text == NULL && in.length == 0, "close_input_text s/b clear the view");
+    
+    fail_unless(open_input_text("/nonexistent/file", NULL, FALSE, FALSE, &in) == 0,
+                "open_input_text s/b fail on a missing file");
+}
+END_TEST
+
+START_TEST(test_read_line_last_line)
+{
+    int i, size = 0;
+    char *expected[] = { "first", "", "third line", "last" };
+    char *line = NULL;
+    FILE *fh = tmpfile();
+    
+    // The last line has no line terminator and must not be lost
+    fputs("first\r\n\nthird line\nlast", fh);
+    rewind(fh);
+    for (i = 0; i < 4; i++) {
+        fail_unless(read_line(fh, &line) > 0, "read_line s/b return line %d", i);
+        fail_unless(! strcmp(line, expected[i]), "read_line line %d s/b '%s' but got '%s'", i, expected[i], line);
+        free(line);
+    }
+    fail_unless(read_line(fh, &line) == 0, "read_line s/b return 0 at EOF");
+    
+    line = NULL;
+    rewind(fh);
+    for (i = 0; i < 4; i++) {
+        fail_unless(read_line_reuse(fh, &line, &size) > 0, "read_line_reuse s/b return line %d", i);
+        fail_unless(! strcmp(line, expected[i]), "read_line_reuse line %d s/b '%s' but got '%s'", i, expected[i], line);
+    }
+    fail_unless(read_line_reuse(fh, &line, &size) == 0, "read_line_reuse s/b return 0 at EOF");
+    free(line);
+    fclose(fh);
+}
+END_TEST
+
+START_TEST(test_scratch_files)
+{
+    int i, j;
+    int *block, *first_row;
+    Attribute_Type types[3] = { CONTINUOUS, DISCRETE, CONTINUOUS };
+    Args_Opts args;
+    CV_Subset sub;
+    
+    memset(&args, 0, sizeof(Args_Opts));
+    args.out_of_core = TRUE;
+    args.scratch_dir = "./data";
+    
+    // Small blocks stay on the heap and big ones go to a scratch file
+    block = (int *)scratch_alloc(16, args);
+    fail_unless(scratch_base(block) == NULL, "a small block s/b on the heap");
+    scratch_free(block);
+    block = (int *)scratch_alloc(4 << 20, args);
+    fail_unless(scratch_base(block) == block && scratch_base(block + 1000) == block, "a big block s/b in a scratch file");
+    block[(1 << 20) - 1] = 7;
+    fail_unless(block[(1 << 20) - 1] == 7, "the scratch file s/b writable");
+    scratch_free(block);
+    fail_unless(scratch_base(block) == NULL, "scratch_free s/b release the scratch file");
+    args.out_of_core = FALSE;
+    block = (int *)scratch_alloc(4 << 20, args);
+    fail_unless(scratch_base(block) == NULL, "without out_of_core a big block s/b on the heap");
+    scratch_free(block);
+    
+    // page_out_examples moves the rows and float_data to one scratch file and keeps their values
+    args.out_of_core = TRUE;
+    memset(&sub, 0, sizeof(CV_Subset));
+    sub.meta.num_examples = 5;
+    sub.meta.num_attributes = 3;
+    sub.meta.attribute_types = types;
+    sub.low = (int *)calloc(3, sizeof(int));
+    sub.high = (int *)malloc(3 * sizeof(int));
+    sub.float_data = (float **)calloc(3, sizeof(float *));
+    sub.examples = (CV_Example *)calloc(5, sizeof(CV_Example));
+    for (j = 0; j < 3; j++) {
+        sub.high[j] = 2 - j;
+        if (types[j] == CONTINUOUS) {
+            sub.float_data[j] = (float *)malloc((sub.high[j] + 1) * sizeof(float));
+            for (i = 0; i <= sub.high[j]; i++)
+                sub.float_data[j][i] = 0.5 * i + j;
+        }
+    }
+    for (i = 0; i < 5; i++) {
+        sub.examples[i].distinct_attribute_values = (int *)malloc(3 * sizeof(int));
+        for (j = 0; j < 3; j++)
+            sub.examples[i].distinct_attribute_values[j] = 3 * i + j;
+    }
+    page_out_examples(&sub, args);
+    first_row = sub.examples[0].distinct_attribute_values;
+    fail_unless(scratch_base(first_row) != NULL, "the rows s/b in a scratch file");
+    for (i = 0; i < 5; i++) {
+        fail_unless(scratch_base(sub.examples[i].distinct_attribute_values) == scratch_base(first_row),
+                    "row %d s/b in the same scratch file", i);
+        for (j = 0; j < 3; j++)
+            fail_unless(sub.examples[i].distinct_attribute_values[j] == 3 * i + j,
+                        "value %d of row %d s/b %d but got %d", j, i, 3 * i + j, sub.examples[i].distinct_attribute_values[j]);
+    }
+    for (j = 0; j < 3; j += 2) {
+        fail_unless(scratch_base(sub.float_data[j]) == scratch_base(first_row), "float_data[%d] s/b in the scratch file", j);
+        for (i = 0; i <= sub.high[j]; i++)
+            fail_unless(sub.float_data[j][i] == 0.5 * i + j, "float_data[%d][%d] s/b %g but got %g", j, i, 0.5 * i + j, sub.float_data[j][i]);
+    }
+    free_CV_Subset(&sub, args, TRAIN_MODE);
+    fail_unless(scratch_base(first_row) == NULL, "free_CV_Subset s/b release the scratch file");
+}
+END_TEST
+
 Suite *util_suite(void)
 {
     Suite *suite = suite_create("Utilities");
@@ -105,6 +270,10 @@ Suite *util_suite(void)
     tcase_add_test(tc_misc, test_factorial);
     tcase_add_test(tc_misc, test_exploding_filenames);
     tcase_add_test(tc_misc, test_num_digits);
+    tcase_add_test(tc_misc, test_fast_atof);
+    tcase_add_test(tc_misc, test_next_input_line);
+    tcase_add_test(tc_misc, test_read_line_last_line);
+    tcase_add_test(tc_misc, test_scratch_files);
 
     return suite;
 }